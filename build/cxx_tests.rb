@@ -37,10 +37,14 @@
     "test/cxx/Core/ApplicationPool/ProcessTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/Core/ApplicationPool/PoolTest.o" =>
     "test/cxx/Core/ApplicationPool/PoolTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/Core/ApplicationPool/RestartFileWatcherTest.o" =>
+    "test/cxx/Core/ApplicationPool/RestartFileWatcherTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/Core/SpawningKit/DirectSpawnerTest.o" =>
     "test/cxx/Core/SpawningKit/DirectSpawnerTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/Core/SpawningKit/SmartSpawnerTest.o" =>
     "test/cxx/Core/SpawningKit/SmartSpawnerTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/Core/UnionStation/TransportTest.o" =>
+    "test/cxx/Core/UnionStation/TransportTest.cpp",
 
   "#{TEST_OUTPUT_DIR}cxx/Core/ResponseCacheTest.o" =>
     "test/cxx/Core/ResponseCacheTest.cpp",
@@ -59,6 +63,8 @@
     "test/cxx/ServerKit/ServerTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/ServerKit/HttpServerTest.o" =>
     "test/cxx/ServerKit/HttpServerTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/ServerKit/TimerWheelTest.o" =>
+    "test/cxx/ServerKit/TimerWheelTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/ServerKit/CookieUtilsTest.o" =>
     "test/cxx/ServerKit/CookieUtilsTest.cpp",
 
@@ -80,8 +86,12 @@
     "test/cxx/DataStructures/LStringTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/DataStructures/StringKeyTableTest.o" =>
     "test/cxx/DataStructures/StringKeyTableTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/DataStructures/DeadlineHeapTest.o" =>
+    "test/cxx/DataStructures/DeadlineHeapTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/MessageReadersWritersTest.o" =>
     "test/cxx/MessageReadersWritersTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/LoggingKitTest.o" =>
+    "test/cxx/LoggingKitTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/StaticStringTest.o" =>
     "test/cxx/StaticStringTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/FileChangeCheckerTest.o" =>
@@ -112,6 +122,12 @@
     "test/cxx/UtilsTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/Utils/StrIntUtilsTest.o" =>
     "test/cxx/Utils/StrIntUtilsTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/Utils/OpenMetricsWriterTest.o" =>
+    "test/cxx/Utils/OpenMetricsWriterTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/Algorithms/AdaptiveConcurrencyLimitTest.o" =>
+    "test/cxx/Algorithms/AdaptiveConcurrencyLimitTest.cpp",
+  "#{TEST_OUTPUT_DIR}cxx/Algorithms/HistogramTest.o" =>
+    "test/cxx/Algorithms/HistogramTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/IOUtilsTest.o" =>
     "test/cxx/IOUtilsTest.cpp",
   "#{TEST_OUTPUT_DIR}cxx/TemplateTest.o" =>
@@ -0,0 +1,89 @@
+/*
+ * Logging throughput benchmark for LoggingKit. It logs from a number of
+ * threads, first in synchronous mode and then in asynchronous mode
+ * (the `async` LoggingKit option), and reports how long the logging
+ * threads were busy, and how long it took until everything was written.
+ *
+ * Build libpassenger_common first (for example with `rake test:cxx`), then
+ * compile and run with:
+ *
+ *   ar rcs /tmp/libpassenger_common.a \
+ *     $(find buildout/common/libpassenger_common -name '*.o')
+ *   c++ -O2 -std=gnu++11 -Isrc/cxx_supportlib -Isrc/cxx_supportlib/vendor-copy \
+ *     -Isrc/cxx_supportlib/vendor-modified -o /tmp/benchmark_logging \
+ *     dev/benchmark_logging.cpp /tmp/libpassenger_common.a \
+ *     buildout/common/libboost_oxt.a -lpthread -lrt -ldl
+ *   /tmp/benchmark_logging [threads] [lines per thread] [log file]
+ *
+ * The log file defaults to /tmp/benchmark_logging.log. Pass a FIFO with a
+ * slow reader on the other end to see how a slow log target affects the
+ * logging threads.
+ */
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <oxt/initialize.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <LoggingKit/LoggingKit.h>
+#include <LoggingKit/Context.h>
+#include <Utils/SystemTime.h>
+
+using namespace std;
+using namespace Passenger;
+
+static void
+logLines(LoggingKit::Context *context, unsigned int threadNumber, unsigned int count) {
+	for (unsigned int i = 0; i < count; i++) {
+		P_LOG(context, LoggingKit::NOTICE, __FILE__, __LINE__,
+			"Benchmark thread " << threadNumber << " logging line " << i
+			<< " of " << count);
+	}
+}
+
+static void
+run(bool async, unsigned int threadCount, unsigned int lines, const string &target) {
+	Json::Value config;
+	config["target"] = target;
+	config["redirect_stderr"] = false;
+	config["async"] = async;
+
+	int fd = open(target.c_str(), O_WRONLY | O_TRUNC);
+	if (fd != -1) {
+		close(fd);
+	}
+
+	LoggingKit::Context *context = new LoggingKit::Context(config);
+	MonotonicTimeUsec begin = SystemTime::getMonotonicUsec();
+	boost::thread_group threads;
+	for (unsigned int i = 0; i < threadCount; i++) {
+		threads.create_thread(boost::bind(logLines, context, i, lines));
+	}
+	threads.join_all();
+	MonotonicTimeUsec logged = SystemTime::getMonotonicUsec();
+	// Waits until the async writer has written everything.
+	delete context;
+	MonotonicTimeUsec written = SystemTime::getMonotonicUsec();
+
+	unsigned long long total = (unsigned long long) threadCount * lines;
+	printf("%-6s %8.1f ns/line in logging threads, %10.0f lines/sec until written\n",
+		async ? "async:" : "sync:",
+		(logged - begin) * 1000.0 * threadCount / total,
+		total * 1000000.0 / (written - begin));
+}
+
+int
+main(int argc, char *argv[]) {
+	unsigned int threadCount = (argc > 1) ? atoi(argv[1]) : 4;
+	unsigned int lines = (argc > 2) ? atoi(argv[2]) : 250000;
+	string target = (argc > 3) ? argv[3] : "/tmp/benchmark_logging.log";
+
+	oxt::initialize();
+	printf("%u threads, %u lines per thread, logging to %s\n",
+		threadCount, lines, target.c_str());
+	run(false, threadCount, lines, target);
+	run(true, threadCount, lines, target);
+	return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * Microbenchmark for the secure header construction in the Nginx module's
+ * construct_request_buffer(). It compares formatting every location-dependent
+ * header on each request (the old approach) with appending the preformatted
+ * per-location static headers cache that passenger_merge_loc_conf() builds.
+ *
+ * The Nginx module cannot be linked without an Nginx build, so this mirrors
+ * the module's two-pass (size, then copy) construction with plain memcpy().
+ *
+ * Compile and run with:
+ *
+ *   cc -O2 -o /tmp/benchmark_nginx_request_construction \
+ *     dev/benchmark_nginx_request_construction.c
+ *   /tmp/benchmark_nginx_request_construction [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const char *data;
+    size_t len;
+} str_t;
+
+#define STR(s) { s, sizeof(s) - 1 }
+
+/* A location with an explicit app root, an environment and a couple of
+ * options and environment variables set, like a typical production vhost.
+ */
+static const str_t method       = STR("GET ");
+static const str_t uri          = STR("/users/1234/profile");
+static const str_t client_headers = STR(
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/60.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Cookie: _session_id=0123456789abcdef0123456789abcdef\r\n");
+static const str_t password     = STR("0123456789abcdef0123456789abcdef");
+static const str_t public_dir   = STR("/var/www/app/current/public");
+static const str_t remote_addr  = STR("192.168.1.100");
+static const str_t remote_port  = STR("53124");
+static const str_t app_root     = STR("/var/www/app/current");
+static const str_t environment  = STR("production");
+static const str_t app_type     = STR("rack");
+static const str_t options_cache = STR(
+    "!~PASSENGER_APP_ROOT: /var/www/app/current\r\n"
+    "!~PASSENGER_APP_ENV: production\r\n"
+    "!~PASSENGER_MIN_PROCESSES: 2\r\n"
+    "!~PASSENGER_MAX_REQUESTS: 1000\r\n"
+    "!~PASSENGER_FRIENDLY_ERROR_PAGES: f\r\n"
+    "!~PASSENGER_LOAD_SHELL_ENVVARS: t\r\n"
+    "!~PASSENGER_USER: www-data\r\n"
+    "!~PASSENGER_START_TIMEOUT: 90\r\n");
+static const str_t env_vars_cache = STR(
+    "U0VDUkVUX0tFWV9CQVNFAGFiY2RlZmdoaWprbG1ub3BxcnN0dXZ3eHl6AA==");
+
+static str_t static_headers_cache;
+
+#define PUSH(ptr, len) \
+    do { \
+        if (b != NULL) { \
+            memcpy(b, ptr, len); \
+            b += len; \
+        } \
+        total_size += len; \
+    } while (0)
+#define PUSH_STR(s) PUSH((s).data, (s).len)
+#define PUSH_STATIC_STR(s) PUSH(s, sizeof(s) - 1)
+
+static size_t
+push_dynamic_headers(char *b) {
+    size_t total_size = 0;
+
+    PUSH_STR(method);
+    PUSH_STR(uri);
+    PUSH_STATIC_STR(" HTTP/1.1\r\nConnection: close\r\n");
+    PUSH_STR(client_headers);
+    PUSH_STATIC_STR("!~: ");
+    PUSH_STR(password);
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STATIC_STR("!~DOCUMENT_ROOT: ");
+    PUSH_STR(public_dir);
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STATIC_STR("!~REMOTE_ADDR: ");
+    PUSH_STR(remote_addr);
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STATIC_STR("!~REMOTE_PORT: ");
+    PUSH_STR(remote_port);
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STATIC_STR("!~PASSENGER_APP_TYPE: ");
+    PUSH_STR(app_type);
+    PUSH_STATIC_STR("\r\n");
+    return total_size;
+}
+
+static size_t
+construct_per_request(char *b) {
+    size_t total_size = push_dynamic_headers(b);
+
+    if (b != NULL) {
+        b += total_size;
+    }
+    PUSH_STATIC_STR("!~PASSENGER_APP_GROUP_NAME: ");
+    PUSH_STR(app_root);
+    PUSH_STATIC_STR(" (");
+    PUSH_STR(environment);
+    PUSH_STATIC_STR(")");
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STR(options_cache);
+    PUSH_STATIC_STR("!~PASSENGER_ENV_VARS: ");
+    PUSH_STR(env_vars_cache);
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STATIC_STR("!~FLAGS: DC");
+    PUSH_STATIC_STR("\r\n\r\n");
+    return total_size;
+}
+
+static size_t
+construct_precompiled(char *b) {
+    size_t total_size = push_dynamic_headers(b);
+
+    if (b != NULL) {
+        b += total_size;
+    }
+    PUSH_STR(static_headers_cache);
+    PUSH_STATIC_STR("\r\n\r\n");
+    return total_size;
+}
+
+static void
+build_static_headers_cache(void) {
+    static char buf[4096];
+    char *b = buf;
+    size_t total_size = 0;
+
+    PUSH_STATIC_STR("!~PASSENGER_APP_GROUP_NAME: ");
+    PUSH_STR(app_root);
+    PUSH_STATIC_STR(" (");
+    PUSH_STR(environment);
+    PUSH_STATIC_STR(")");
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STR(options_cache);
+    PUSH_STATIC_STR("!~PASSENGER_ENV_VARS: ");
+    PUSH_STR(env_vars_cache);
+    PUSH_STATIC_STR("\r\n");
+    PUSH_STATIC_STR("!~FLAGS: DC");
+
+    static_headers_cache.data = buf;
+    static_headers_cache.len = total_size;
+}
+
+static double
+now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double
+run(const char *name, size_t (*construct)(char *), long iterations) {
+    /* Volatile so that the compiler cannot hoist the construction out of the loop. */
+    size_t (* volatile construct_fn)(char *) = construct;
+    char *buf;
+    size_t size, checksum = 0;
+    double begin, elapsed;
+    long i;
+
+    buf = malloc(construct(NULL));
+    begin = now();
+    for (i = 0; i < iterations; i++) {
+        size = construct_fn(NULL);
+        checksum += construct_fn(buf) + (unsigned char) buf[size - 5];
+    }
+    elapsed = now() - begin;
+    free(buf);
+
+    printf("%-13s %7.1f ns/request (checksum %lu)\n", name,
+        elapsed * 1e9 / iterations, (unsigned long) checksum);
+    return elapsed;
+}
+
+int
+main(int argc, char *argv[]) {
+    long iterations = (argc > 1) ? atol(argv[1]) : 10000000;
+    char a[4096], b[4096];
+    size_t a_len, b_len;
+    double per_request, precompiled;
+
+    build_static_headers_cache();
+
+    a_len = construct_per_request(a);
+    b_len = construct_precompiled(b);
+    if (a_len != b_len || memcmp(a, b, a_len) != 0) {
+        fprintf(stderr, "Both approaches must produce the same request\n");
+        return 1;
+    }
+
+    printf("Request size: %lu bytes, %ld iterations\n",
+        (unsigned long) a_len, iterations);
+    per_request = run("per-request:", construct_per_request, iterations);
+    precompiled = run("precompiled:", construct_precompiled, iterations);
+    printf("Speedup: %.2fx\n", per_request / precompiled);
+    return 0;
+}
@@ -31,6 +31,7 @@
 #include <boost/regex.hpp>
 #include <oxt/thread.hpp>
 #include <string>
+#include <map>
 #include <cstring>
 #include <exception>
 #include <sys/types.h>
@@ -53,6 +54,7 @@
 #include <Utils/StrIntUtils.h>
 #include <Utils/BufferedIO.h>
 #include <Utils/MessageIO.h>
+#include <Utils/OpenMetricsWriter.h>
 
 namespace Passenger {
 namespace Core {
@@ -68,7 +70,10 @@ using namespace std;
  *
  *   accept_burst_count             unsigned integer   -   default(32)
  *   authorizations                 array              -   default("[FILTERED]"),secret
+ *   client_body_timeout            unsigned integer   -   default(60)
  *   client_freelist_limit          unsigned integer   -   default(0)
+ *   client_header_timeout          unsigned integer   -   default(60)
+ *   client_keepalive_timeout       unsigned integer   -   default(75)
  *   instance_dir                   string             -   -
  *   min_spare_clients              unsigned integer   -   default(0)
  *   request_freelist_limit         unsigned integer   -   default(1024)
@@ -117,6 +122,7 @@ public:
 	Authorization authorization;
 	unsigned int controllerStatesGathered;
 	vector<Json::Value> controllerStates;
+	vector<ControllerMetrics> controllerMetrics;
 
 	DEFINE_SERVER_KIT_BASE_HTTP_REQUEST_FOOTER(Passenger::Core::ApiServer::Request);
 };
@@ -159,6 +165,10 @@ private:
 			processServerStatus(client, req);
 		} else if (regex_match(path, serverConnectionPath)) {
 			processServerConnectionOperation(client, req);
+		} else if (path == P_STATIC_STRING("/metrics")
+			|| path == P_STATIC_STRING("/request_latencies.json"))
+		{
+			processMetrics(client, req);
 		} else if (path == P_STATIC_STRING("/pool.xml")) {
 			processPoolStatusXml(client, req);
 		} else if (path == P_STATIC_STRING("/pool.txt")) {
@@ -289,6 +299,252 @@ private:
 		}
 	}
 
+	void processMetrics(Client *client, Request *req) {
+		if (authorizeStateInspectionOperation(this, client, req)) {
+			req->controllerMetrics.resize(controllers.size());
+			for (unsigned int i = 0; i < controllers.size(); i++) {
+				refRequest(req, __FILE__, __LINE__);
+				controllers[i]->getContext()->libev->runLater(boost::bind(
+					&ApiServer::gatherControllerMetrics, this,
+					client, req, controllers[i], i));
+			}
+		} else {
+			apiServerRespondWith401(this, client, req);
+		}
+	}
+
+	void gatherControllerMetrics(Client *client, Request *req,
+		Controller *controller, unsigned int i)
+	{
+		ControllerMetrics metrics;
+		controller->collectMetrics(metrics);
+		getContext()->libev->runLater(boost::bind(&ApiServer::controllerMetricsGathered,
+			this, client, req, i, metrics));
+	}
+
+	void controllerMetricsGathered(Client *client, Request *req,
+		unsigned int i, ControllerMetrics metrics)
+	{
+		if (req->ended()) {
+			unrefRequest(req, __FILE__, __LINE__);
+			return;
+		}
+
+		req->controllerStatesGathered++;
+		req->controllerMetrics[i] = metrics;
+
+		if (req->controllerStatesGathered == controllers.size()) {
+			RequestPhaseHistogramsMap requestPhaseHistograms;
+			mergeRequestPhaseHistograms(req->controllerMetrics, requestPhaseHistograms);
+
+			HeaderTable headers;
+			headers.insert(req->pool, "Cache-Control", "no-cache, no-store, must-revalidate");
+			if (req->getPathWithoutQueryString() == P_STATIC_STRING("/metrics")) {
+				OpenMetricsWriter writer;
+				appPool->writeMetrics(writer);
+				writeControllerMetrics(writer, req->controllerMetrics);
+				writeRequestPhaseMetrics(writer, requestPhaseHistograms);
+
+				headers.insert(req->pool, "Content-Type",
+					"application/openmetrics-text; version=1.0.0; charset=utf-8");
+				writeSimpleResponse(client, 200, &headers,
+					psg_pstrdup(req->pool, writer.finish()));
+			} else {
+				headers.insert(req->pool, "Content-Type", "application/json");
+				writeSimpleResponse(client, 200, &headers,
+					psg_pstrdup(req->pool, inspectRequestPhaseHistogramsAsJson(
+						requestPhaseHistograms).toStyledString()));
+			}
+			if (!req->ended()) {
+				Request *req2 = req;
+				endRequest(&client, &req2);
+			}
+		}
+
+		unrefRequest(req, __FILE__, __LINE__);
+	}
+
+	typedef map<string, RequestPhaseHistograms> RequestPhaseHistogramsMap;
+
+	static void mergeRequestPhaseHistograms(const vector<ControllerMetrics> &allMetrics,
+		RequestPhaseHistogramsMap &result)
+	{
+		vector<ControllerMetrics>::const_iterator it, end = allMetrics.end();
+
+		for (it = allMetrics.begin(); it != end; it++) {
+			RequestPhaseHistogramsList::const_iterator it2,
+				end2 = it->requestPhaseHistograms.end();
+			for (it2 = it->requestPhaseHistograms.begin(); it2 != end2; it2++) {
+				result[it2->first].merge(*it2->second);
+			}
+		}
+	}
+
+	static void writeRequestPhaseMetrics(OpenMetricsWriter &writer,
+		const RequestPhaseHistogramsMap &histograms)
+	{
+		// In microseconds.
+		static const boost::uint64_t buckets[] = {
+			1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+			1000000, 2500000, 5000000, 10000000, 30000000, 60000000
+		};
+		RequestPhaseHistogramsMap::const_iterator it, end = histograms.end();
+
+		writer.declare("passenger_request_phase_duration_seconds", "histogram",
+			"The time that requests spent in each phase of request handling.");
+		for (it = histograms.begin(); it != end; it++) {
+			for (unsigned int i = 0; i < RequestPhaseHistograms::PHASE_COUNT; i++) {
+				writer.histogram("passenger_request_phase_duration_seconds",
+					OpenMetricsWriter::labels(
+						"group", it->first,
+						"phase", RequestPhaseHistograms::getPhaseName(i)),
+					it->second.phases[i],
+					buckets, sizeof(buckets) / sizeof(boost::uint64_t),
+					1000000);
+			}
+		}
+	}
+
+	static Json::Value inspectRequestPhaseHistogramsAsJson(
+		const RequestPhaseHistogramsMap &histograms)
+	{
+		Json::Value doc(Json::objectValue);
+		RequestPhaseHistogramsMap::const_iterator it, end = histograms.end();
+
+		for (it = histograms.begin(); it != end; it++) {
+			Json::Value group(Json::arrayValue);
+			for (unsigned int i = 0; i < RequestPhaseHistograms::PHASE_COUNT; i++) {
+				const Histogram &histogram = it->second.phases[i];
+				Json::Value phase;
+				phase["phase"] = RequestPhaseHistograms::getPhaseName(i);
+				phase["count"] = (Json::UInt64) histogram.getCount();
+				if (histogram.getCount() > 0) {
+					phase["mean"] = usecToMsec((double) histogram.getSum()
+						/ histogram.getCount());
+				} else {
+					phase["mean"] = 0.0;
+				}
+				phase["p50"] = usecToMsec(histogram.getPercentile(50));
+				phase["p90"] = usecToMsec(histogram.getPercentile(90));
+				phase["p99"] = usecToMsec(histogram.getPercentile(99));
+				phase["max"] = usecToMsec(histogram.getMax());
+				group.append(phase);
+			}
+			doc[it->first] = group;
+		}
+
+		Json::Value result;
+		result["unit"] = "milliseconds";
+		result["groups"] = doc;
+		return result;
+	}
+
+	static double usecToMsec(double usec) {
+		return usec / 1000;
+	}
+
+	static void writeControllerMetrics(OpenMetricsWriter &writer,
+		const vector<ControllerMetrics> &allMetrics)
+	{
+		vector<ControllerMetrics>::const_iterator it, end = allMetrics.end();
+		vector<string> labels;
+
+		for (it = allMetrics.begin(); it != end; it++) {
+			labels.push_back(OpenMetricsWriter::label("thread",
+				toString(it->threadNumber)));
+		}
+
+		writer.declare("passenger_server_clients", "gauge",
+			"The number of clients that are connected to a server thread.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			writer.sample("passenger_server_clients",
+				labels[i] + ",state=\"active\"",
+				allMetrics[i].activeClientCount);
+			writer.sample("passenger_server_clients",
+				labels[i] + ",state=\"disconnected\"",
+				allMetrics[i].disconnectedClientCount);
+		}
+
+		writer.declare("passenger_server_clients_accepted", "counter",
+			"The number of clients that a server thread has accepted.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			writer.sample("passenger_server_clients_accepted_total", labels[i],
+				allMetrics[i].totalClientsAccepted);
+		}
+
+		writer.declare("passenger_server_received_bytes", "counter",
+			"The number of bytes that a server thread has received from clients.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			writer.sample("passenger_server_received_bytes_total", labels[i],
+				allMetrics[i].totalBytesConsumed);
+		}
+
+		writer.declare("passenger_server_mbuf_blocks", "gauge",
+			"The number of I/O buffer blocks of a server thread.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			writer.sample("passenger_server_mbuf_blocks",
+				labels[i] + ",state=\"active\"",
+				allMetrics[i].mbufActiveBlocks);
+			writer.sample("passenger_server_mbuf_blocks",
+				labels[i] + ",state=\"free\"",
+				allMetrics[i].mbufFreeBlocks);
+			writer.sample("passenger_server_mbuf_blocks",
+				labels[i] + ",state=\"released\"",
+				allMetrics[i].mbufReleasedBlocks);
+		}
+
+		writer.declare("passenger_server_mbuf_memory_bytes", "gauge",
+			"The memory used by the I/O buffer blocks of a server thread.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			writer.sample("passenger_server_mbuf_memory_bytes",
+				labels[i] + ",state=\"active\"",
+				(boost::uint64_t) allMetrics[i].mbufActiveMemory);
+			writer.sample("passenger_server_mbuf_memory_bytes",
+				labels[i] + ",state=\"spare\"",
+				(boost::uint64_t) allMetrics[i].mbufSpareMemory);
+		}
+
+		writer.declare("passenger_turbocache_fetches", "counter",
+			"The number of turbocache lookups.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			if (allMetrics[i].turbocachingEnabled) {
+				writer.sample("passenger_turbocache_fetches_total", labels[i],
+					allMetrics[i].turbocacheFetches);
+			}
+		}
+
+		writer.declare("passenger_turbocache_hits", "counter",
+			"The number of turbocache lookups that found an entry.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			if (allMetrics[i].turbocachingEnabled) {
+				writer.sample("passenger_turbocache_hits_total", labels[i],
+					allMetrics[i].turbocacheHits);
+			}
+		}
+
+		writer.declare("passenger_turbocache_misses", "counter",
+			"The number of turbocache lookups that did not find an entry.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			if (allMetrics[i].turbocachingEnabled) {
+				writer.sample("passenger_turbocache_misses_total", labels[i],
+					allMetrics[i].turbocacheFetches - allMetrics[i].turbocacheHits);
+			}
+		}
+
+		writer.declare("passenger_turbocache_stores", "counter",
+			"The number of attempts to store a response in the turbocache.");
+		for (unsigned int i = 0; i < allMetrics.size(); i++) {
+			if (allMetrics[i].turbocachingEnabled) {
+				writer.sample("passenger_turbocache_stores_total",
+					labels[i] + ",result=\"success\"",
+					allMetrics[i].turbocacheStoreSuccesses);
+				writer.sample("passenger_turbocache_stores_total",
+					labels[i] + ",result=\"failure\"",
+					allMetrics[i].turbocacheStores - allMetrics[i].turbocacheStoreSuccesses);
+			}
+		}
+	}
+
 	void processPoolStatusXml(Client *client, Request *req) {
 		Authorization auth(authorize(this, client, req));
 		if (auth.canReadPool) {
@@ -469,7 +725,7 @@ private:
 		ServerKit::Context *ctx = controller->getContext();
 		unsigned int count;
 
-		count = mbuf_pool_compact(&ctx->mbuf_pool);
+		count = ctx->compactMbufPools();
 		SKS_NOTICE_FROM_STATIC(controller, "Freed " << count << " mbufs");
 
 		controller->compact(LoggingKit::NOTICE);
@@ -674,6 +930,7 @@ protected:
 		}
 		req->authorization = Authorization();
 		req->controllerStates.clear();
+		req->controllerMetrics.clear();
 		ParentClass::deinitializeRequest(client, req);
 	}
 
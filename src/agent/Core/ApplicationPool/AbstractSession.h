@@ -58,6 +58,7 @@ public:
 	virtual void initiate(bool blocking = true) = 0;
 
 	virtual void requestOOBW() { /* Do nothing */ }
+	virtual void reportRequestTimeout(bool captureBacktrace) { /* Do nothing */ }
 
 	/**
 	 * This Session object becomes fully unsable after closing.
@@ -30,6 +30,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/intrusive_ptr.hpp>
 #include <boost/function.hpp>
+#include <boost/atomic.hpp>
 #include <oxt/tracable_exception.hpp>
 #include <ResourceLocator.h>
 #include <RandomGenerator.h>
@@ -175,6 +176,23 @@ typedef boost::function<void ()> Callback;
 struct GetCallback {
 	void (*func)(const AbstractSessionPtr &session, const ExceptionPtr &e, void *userData);
 	mutable void *userData;
+	/**
+	 * If not NULL, the caller sets this to true when it is no longer
+	 * interested in a session, for example because its client disconnected.
+	 * A request that is queued is then removed from the queue instead of
+	 * being served. The callback is still called.
+	 */
+	const boost::atomic<bool> *cancelled;
+
+	GetCallback()
+		: func(NULL),
+		  userData(NULL),
+		  cancelled(NULL)
+		{ }
+
+	bool isCancelled() const {
+		return cancelled != NULL && cancelled->load(boost::memory_order_acquire);
+	}
 
 	void operator()(const AbstractSessionPtr &session, const ExceptionPtr &e) const {
 		func(session, e, userData);
@@ -188,10 +206,13 @@ struct GetCallback {
 struct GetWaiter {
 	Options options;
 	GetCallback callback;
+	/** When this waiter was queued, in microseconds. */
+	unsigned long long enqueueTime;
 
-	GetWaiter(const Options &o, const GetCallback &cb)
+	GetWaiter(const Options &o, const GetCallback &cb, unsigned long long _enqueueTime = 0)
 		: options(o),
-		  callback(cb)
+		  callback(cb),
+		  enqueueTime(_enqueueTime)
 	{
 		options.persist(o);
 	}
@@ -31,6 +31,7 @@
 #include <Exceptions.h>
 #include <Utils/ClassUtils.h>
 #include <Core/SpawningKit/Factory.h>
+#include <Core/ApplicationPool/RestartFileWatcher.h>
 
 namespace Passenger {
 namespace ApplicationPool2 {
@@ -66,6 +67,11 @@ private:
 	P_PROPERTY_CONST_REF(private, SpawningKit::FactoryPtr, SpawningKitFactory);
 
 
+	/****** Helper objects ******/
+
+	P_RO_PROPERTY_REF(private, RestartFileWatcher, RestartFileWatcher);
+
+
 public:
 	/****** Initialization ******/
 
@@ -48,6 +48,9 @@
 #include <MemoryKit/palloc.h>
 #include <Hooks.h>
 #include <Utils.h>
+#include <Algorithms/Histogram.h>
+#include <Algorithms/MovingAverage.h>
+#include <Utils/SpeedMeter.h>
 #include <Core/ApplicationPool/Common.h>
 #include <Core/ApplicationPool/Context.h>
 #include <Core/ApplicationPool/BasicGroupInfo.h>
@@ -77,6 +80,7 @@ public:
 	struct GetAction {
 		GetCallback callback;
 		SessionPtr session;
+		ExceptionPtr exception;
 	};
 
 	struct DisableWaiter {
@@ -180,6 +184,11 @@ public:
 
 	string restartFile;
 	string alwaysRestartFile;
+	/**
+	 * Set if the restart files are watched in the background, in which case
+	 * `needsRestart()` does not stat() them when `statThrottleRate > 0`.
+	 */
+	RestartFileWatchPtr restartFileWatch;
 	ProcessPtr nullProcess;
 
 	/** This timer scans `detachedProcesses` periodically to see
@@ -236,6 +245,15 @@ public:
 	void startCheckingDetachedProcesses(bool immediately);
 	void detachedProcessesCheckerMain(GroupPtr self);
 
+	bool memoryLimitRestartInProgress() const;
+	bool reachedMaxRequests(const Process *process) const;
+	unsigned int countRecyclingProcesses() const;
+	bool recycleBeforeDetaching(Process *process);
+	void detachRecycledProcess(boost::container::vector<Callback> &postLockActions);
+	void abortRecycling();
+	void lockAndDetachAfterMemoryLimitDisable(const ProcessPtr &process,
+		DisableResult result, GroupPtr self);
+
 	/****** Out-of-band work ******/
 
 	bool oobwAllowed() const;
@@ -269,6 +287,12 @@ public:
 	Group *findOtherGroupWaitingForCapacity() const;
 	bool pushGetWaiter(const Options &newOptions, const GetCallback &callback,
 		boost::container::vector<Callback> &postLockActions);
+	ExceptionPtr checkGetWaiter(const GetWaiter &waiter, unsigned long long now);
+	void removeExpiredGetWaiters(unsigned long long now,
+		boost::container::vector<Callback> &postLockActions);
+	void recordQueueTime(const GetWaiter &waiter, unsigned long long now);
+	void resetRequestQueueStateIfEmpty();
+	bool getWaitlistIsLifo() const;
 	template<typename Lock> void assignSessionsToGetWaitersQuickly(Lock &lock);
 	void assignSessionsToGetWaiters(boost::container::vector<Callback> &postLockActions);
 	bool testOverflowRequestQueue() const;
@@ -408,11 +432,81 @@ public:
 	 */
 	deque<DisableWaiter> disableWaitlist;
 
+	/**
+	 * The number of requests that exceeded `options.maxRequestTime`, causing
+	 * the process that handled them to be restarted, and the time (in
+	 * microseconds) at which that last happened.
+	 */
+	unsigned int requestTimeouts;
+	unsigned long long lastRequestTimeoutTime;
+
+	/**
+	 * The number of processes that were restarted because they exceeded
+	 * `options.memoryLimit`, and the time (in microseconds) at which the
+	 * last such restart was initiated.
+	 */
+	unsigned int memoryLimitRestarts;
+	unsigned long long lastMemoryLimitRestartTime;
+
+	/**
+	 * The number of spawn attempts that succeeded and failed so far, and
+	 * how long they took (in microseconds).
+	 */
+	unsigned int spawnsSucceeded;
+	unsigned int spawnsFailed;
+	Histogram spawnDurations;
+
+	/**
+	 * The load model that predictive autoscaling is based on. See
+	 * updateLoadModel().
+	 *
+	 * `requestsReceived` is the number of get() requests so far.
+	 * `requestRateMeter` measures how many requests arrive per second, and
+	 * `requestRateTrendMeter` how fast that rate changes per second.
+	 * `avgRequestTime` is the average time (in microseconds) that a session
+	 * is open, or -1 if unknown; it is only measured if
+	 * `options.targetUtilization` is set. `predictedProcessCount` is the
+	 * number of processes that the model asked for during its last update,
+	 * or 0 if predictive autoscaling is not in effect.
+	 */
+	unsigned long long requestsReceived;
+	SpeedMeter<unsigned long long, 8, 1000000, 60 * 1000000, 1000000> requestRateMeter;
+	SpeedMeter<double, 8, 1000000, 60 * 1000000, 1000000> requestRateTrendMeter;
+	double avgRequestTime;
+	unsigned int predictedProcessCount;
+
+	/**
+	 * Overload control for `getWaitlist`, see `options.requestQueueTargetDelay`.
+	 *
+	 * `requestQueueAboveTargetSince` is the time (in microseconds) since
+	 * which every request that left the queue had waited longer than the
+	 * target delay, or 0 if the last one did not. `requestQueueOverloaded`
+	 * is set once that has lasted for REQUEST_QUEUE_OVERLOAD_INTERVAL, and
+	 * is cleared as soon as a request leaves the queue within the target
+	 * delay, or when the queue becomes empty.
+	 *
+	 * `queueTimes` records how long (in microseconds) requests waited in
+	 * `getWaitlist` before they were served or timed out.
+	 * `requestQueueTimeouts` is the number of requests that were failed
+	 * because of overload control, and `cancelledGetWaiters` the number of
+	 * requests that were removed from the queue because they were cancelled.
+	 */
+	unsigned long long requestQueueAboveTargetSince;
+	bool requestQueueOverloaded;
+	Histogram queueTimes;
+	unsigned int requestQueueTimeouts;
+	unsigned int cancelledGetWaiters;
+
 	/**
 	 * Invariant:
 	 *    (lifeStatus == ALIVE) == (spawner != NULL)
 	 */
 	SpawningKit::SpawnerPtr spawner;
+	/**
+	 * Links this group into Pool::idlePreloaders while its spawner may
+	 * need to be cleaned up. See Pool::schedulePreloaderGc().
+	 */
+	DeadlineHeapEntry preloaderGcEntry;
 
 
 	/****** Initialization and shutdown ******/
@@ -441,6 +535,7 @@ public:
 
 	SessionPtr get(const Options &newOptions, const GetCallback &callback,
 		boost::container::vector<Callback> &postLockActions);
+	void reportRequestTimeout(const ProcessPtr &process, bool captureBacktrace);
 
 	/****** Spawning and restarting ******/
 
@@ -453,6 +548,7 @@ public:
 	bool shouldSpawn() const;
 	bool shouldSpawnForGetAction() const;
 	bool allowSpawn() const;
+	void updateLoadModel(unsigned long long now);
 
 	/****** Process list management ******/
 
@@ -465,10 +561,13 @@ public:
 	void enable(const ProcessPtr &process,
 		boost::container::vector<Callback> &postLockActions);
 	DisableResult disable(const ProcessPtr &process, const DisableCallback &callback);
+	void checkMemoryLimit(const ProcessPtr &process, unsigned long long now,
+		boost::container::vector<Callback> &postLockActions);
 
 	/****** State inspection ******/
 
 	unsigned int getProcessCount() const;
+	unsigned int getMinProcesses() const;
 	bool processLowerLimitsSatisfied() const;
 	bool processUpperLimitsReached() const;
 	bool allEnabledProcessesAreTotallyBusy() const;
@@ -478,8 +577,6 @@ public:
 	bool garbageCollectable(unsigned long long now = 0) const;
 
 	void inspectXml(std::ostream &stream, bool includeSecrets = true) const;
-	void inspectPropertiesInAdminPanelFormat(Json::Value &result) const;
-	void inspectConfigInAdminPanelFormat(Json::Value &result) const;
 
 	/****** Out-of-band work ******/
 
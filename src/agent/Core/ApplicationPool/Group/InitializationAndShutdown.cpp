@@ -109,6 +109,20 @@ Group::Group(Pool *_pool, const Options &_options)
 	disablingCount = 0;
 	disabledCount  = 0;
 	nEnabledProcessesTotallyBusy = 0;
+	requestTimeouts = 0;
+	spawnsSucceeded = 0;
+	spawnsFailed = 0;
+	lastRequestTimeoutTime = 0;
+	memoryLimitRestarts = 0;
+	lastMemoryLimitRestartTime = 0;
+	requestsReceived = 0;
+	avgRequestTime = -1;
+	predictedProcessCount = 0;
+	requestQueueAboveTargetSince = 0;
+	requestQueueOverloaded = false;
+	requestQueueTimeouts = 0;
+	cancelledGetWaiters = 0;
+	preloaderGcEntry.userData = this;
 	spawner        = getContext()->getSpawningKitFactory()->create(options);
 	restartsInitiated = 0;
 	processesBeingSpawned = 0;
@@ -128,6 +142,10 @@ Group::Group(Pool *_pool, const Options &_options)
 		restartFile = options.appRoot + "/" + options.restartDir + "/restart.txt";
 		alwaysRestartFile = options.appRoot + "/" + options.restartDir + "/always_restart.txt";
 	}
+	if (options.statThrottleRate > 0) {
+		restartFileWatch = getContext()->getRestartFileWatcher().watch(
+			restartFile, alwaysRestartFile, options.statThrottleRate);
+	}
 
 	detachedProcessesCheckerActive = false;
 }
@@ -179,6 +197,7 @@ Group::shutdown(const Callback &callback,
 	detachAll(postLockActions);
 	startCheckingDetachedProcesses(true);
 	interruptableThreads.interrupt_all();
+	pool->unschedulePreloaderGc(this);
 	postLockActions.push_back(boost::bind(doCleanupSpawner, spawner));
 	spawner.reset();
 	selfPointer = shared_from_this();
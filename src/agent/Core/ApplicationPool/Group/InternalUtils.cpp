@@ -85,7 +85,11 @@ Group::resetOptions(const Options &newOptions, Options *destination) {
 void
 Group::mergeOptions(const Options &other) {
 	options.maxRequests      = other.maxRequests;
+	options.maxRequestsJitter = other.maxRequestsJitter;
+	options.maxRequestTime   = other.maxRequestTime;
+	options.memoryLimit      = other.memoryLimit;
 	options.minProcesses     = other.minProcesses;
+	options.targetUtilization = other.targetUtilization;
 	options.statThrottleRate = other.statThrottleRate;
 	options.maxPreloaderIdleTime = other.maxPreloaderIdleTime;
 }
@@ -219,13 +223,24 @@ bool
 Group::pushGetWaiter(const Options &newOptions, const GetCallback &callback,
 	boost::container::vector<Callback> &postLockActions)
 {
+	unsigned long long now = SystemTime::getUsec();
+
+	if (requestQueueOverloaded
+	 || (newOptions.maxRequestQueueSize != 0
+	     && getWaitlist.size() >= newOptions.maxRequestQueueSize))
+	{
+		// Make room by removing waiters that won't be served anyway.
+		removeExpiredGetWaiters(now, postLockActions);
+	}
+
 	if (OXT_LIKELY(!testOverflowRequestQueue()
 		&& (newOptions.maxRequestQueueSize == 0
 		    || getWaitlist.size() < newOptions.maxRequestQueueSize)))
 	{
 		getWaitlist.push_back(GetWaiter(
 			newOptions.copyAndPersist().detachFromUnionStationTransaction(),
-			callback));
+			callback,
+			(newOptions.currentTime != 0) ? newOptions.currentTime : now));
 		return true;
 	} else {
 		postLockActions.push_back(boost::bind(GetCallback::call,
@@ -241,6 +256,104 @@ Group::pushGetWaiter(const Options &newOptions, const GetCallback &callback,
 	}
 }
 
+/**
+ * Checks whether the given waiter must be removed from `getWaitlist` without
+ * being served, and if so, returns the exception to pass to its callback:
+ * either because it was cancelled, or because the request queue is
+ * overloaded and the waiter has already waited longer than the target delay.
+ */
+ExceptionPtr
+Group::checkGetWaiter(const GetWaiter &waiter, unsigned long long now) {
+	if (waiter.callback.isCancelled()) {
+		cancelledGetWaiters++;
+		return boost::make_shared<GetAbortedException>(
+			"The request was cancelled while it was waiting in the request queue");
+	} else if (requestQueueOverloaded && enabledCount > 0) {
+		// If there are no enabled processes then the waiters are waiting
+		// for a spawn, not for capacity, so we leave them alone.
+		unsigned long long queueTime = (now > waiter.enqueueTime)
+			? now - waiter.enqueueTime
+			: 0;
+		if (queueTime > options.requestQueueTargetDelay * 1000ull) {
+			requestQueueTimeouts++;
+			queueTimes.record(queueTime);
+			return boost::make_shared<RequestQueueTimeoutException>(
+				options.requestQueueTargetDelay);
+		}
+	}
+	return ExceptionPtr();
+}
+
+void
+Group::removeExpiredGetWaiters(unsigned long long now,
+	boost::container::vector<Callback> &postLockActions)
+{
+	deque<GetWaiter>::iterator it = getWaitlist.begin();
+	while (it != getWaitlist.end()) {
+		ExceptionPtr exception = checkGetWaiter(*it, now);
+		if (exception != NULL) {
+			postLockActions.push_back(boost::bind(GetCallback::call,
+				it->callback, SessionPtr(), exception));
+			it = getWaitlist.erase(it);
+		} else {
+			it++;
+		}
+	}
+	resetRequestQueueStateIfEmpty();
+}
+
+/**
+ * Called when a waiter is about to be served. Records how long it waited,
+ * and updates the overload state: the queue is considered overloaded if,
+ * for a full REQUEST_QUEUE_OVERLOAD_INTERVAL, no request has been served
+ * within the target delay. Like CoDel, this looks at the minimum queue time
+ * over an interval, so that short bursts (which a queue is meant to absorb)
+ * don't count as overload.
+ */
+void
+Group::recordQueueTime(const GetWaiter &waiter, unsigned long long now) {
+	unsigned long long queueTime = (now > waiter.enqueueTime)
+		? now - waiter.enqueueTime
+		: 0;
+	queueTimes.record(queueTime);
+
+	if (options.requestQueueTargetDelay == 0) {
+		return;
+	}
+	if (queueTime <= options.requestQueueTargetDelay * 1000ull) {
+		requestQueueAboveTargetSince = 0;
+		requestQueueOverloaded = false;
+	} else if (requestQueueAboveTargetSince == 0) {
+		requestQueueAboveTargetSince = now;
+	} else if (!requestQueueOverloaded
+		&& now >= requestQueueAboveTargetSince + REQUEST_QUEUE_OVERLOAD_INTERVAL * 1000ull)
+	{
+		P_NOTICE("The request queue of group " << info.name << " is overloaded: requests"
+			" have been waiting longer than " << options.requestQueueTargetDelay
+			<< " msec for at least " << REQUEST_QUEUE_OVERLOAD_INTERVAL << " msec."
+			" Failing queued requests that exceed that delay until the queue recovers");
+		requestQueueOverloaded = true;
+	}
+}
+
+void
+Group::resetRequestQueueStateIfEmpty() {
+	if (getWaitlist.empty()) {
+		requestQueueAboveTargetSince = 0;
+		requestQueueOverloaded = false;
+	}
+}
+
+/**
+ * Under sustained overload, serving the newest waiters first (if enabled)
+ * keeps latency low for most requests, instead of making every request wait
+ * for the entire backlog.
+ */
+bool
+Group::getWaitlistIsLifo() const {
+	return requestQueueOverloaded && options.requestQueueLifo;
+}
+
 template<typename Lock>
 void
 Group::assignSessionsToGetWaitersQuickly(Lock &lock) {
@@ -251,19 +364,33 @@ Group::assignSessionsToGetWaitersQuickly(Lock &lock) {
 	}
 
 	SmallVector<GetAction, 8> actions;
+	unsigned long long now = SystemTime::getUsec();
+	bool lifo = getWaitlistIsLifo();
 	unsigned int i = 0;
 	bool done = false;
 
 	actions.reserve(getWaitlist.size());
 
 	while (!done && i < getWaitlist.size()) {
-		const GetWaiter &waiter = getWaitlist[i];
+		unsigned int index = lifo ? getWaitlist.size() - 1 - i : i;
+		const GetWaiter &waiter = getWaitlist[index];
+		ExceptionPtr exception = checkGetWaiter(waiter, now);
+		if (exception != NULL) {
+			GetAction action;
+			action.callback  = waiter.callback;
+			action.exception = exception;
+			getWaitlist.erase(getWaitlist.begin() + index);
+			actions.push_back(action);
+			continue;
+		}
+
 		RouteResult result = route(waiter.options);
 		if (result.process != NULL) {
 			GetAction action;
 			action.callback = waiter.callback;
 			action.session  = newSession(result.process);
-			getWaitlist.erase(getWaitlist.begin() + i);
+			recordQueueTime(waiter, now);
+			getWaitlist.erase(getWaitlist.begin() + index);
 			actions.push_back(action);
 		} else {
 			done = result.finished;
@@ -272,22 +399,37 @@ Group::assignSessionsToGetWaitersQuickly(Lock &lock) {
 			}
 		}
 	}
+	resetRequestQueueStateIfEmpty();
 
 	verifyInvariants();
 	lock.unlock();
 	SmallVector<GetAction, 50>::const_iterator it, end = actions.end();
 	for (it = actions.begin(); it != end; it++) {
-		it->callback(it->session, ExceptionPtr());
+		it->callback(it->session, it->exception);
 	}
 }
 
 void
 Group::assignSessionsToGetWaiters(boost::container::vector<Callback> &postLockActions) {
+	unsigned long long now = SystemTime::getUsec();
+	bool lifo = getWaitlistIsLifo();
 	unsigned int i = 0;
 	bool done = false;
 
 	while (!done && i < getWaitlist.size()) {
-		const GetWaiter &waiter = getWaitlist[i];
+		unsigned int index = lifo ? getWaitlist.size() - 1 - i : i;
+		const GetWaiter &waiter = getWaitlist[index];
+		ExceptionPtr exception = checkGetWaiter(waiter, now);
+		if (exception != NULL) {
+			postLockActions.push_back(boost::bind(
+				GetCallback::call,
+				waiter.callback,
+				SessionPtr(),
+				exception));
+			getWaitlist.erase(getWaitlist.begin() + index);
+			continue;
+		}
+
 		RouteResult result = route(waiter.options);
 		if (result.process != NULL) {
 			postLockActions.push_back(boost::bind(
@@ -295,7 +437,8 @@ Group::assignSessionsToGetWaiters(boost::container::vector<Callback> &postLockAc
 				waiter.callback,
 				newSession(result.process),
 				ExceptionPtr()));
-			getWaitlist.erase(getWaitlist.begin() + i);
+			recordQueueTime(waiter, now);
+			getWaitlist.erase(getWaitlist.begin() + index);
 		} else {
 			done = result.finished;
 			if (!result.finished) {
@@ -303,6 +446,7 @@ Group::assignSessionsToGetWaiters(boost::container::vector<Callback> &postLockAc
 			}
 		}
 	}
+	resetRequestQueueStateIfEmpty();
 }
 
 bool
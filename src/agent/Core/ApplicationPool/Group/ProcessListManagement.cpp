@@ -138,6 +138,7 @@ Group::addProcessToList(const ProcessPtr &process, ProcessList &destination) {
 	if (&destination == &enabledProcesses) {
 		process->enabled = Process::ENABLED;
 		enabledCount++;
+		pool->scheduleIdleProcessGc(process.get());
 		enabledProcessBusynessLevels.push_back(process->busyness());
 		if (process->isTotallyBusy()) {
 			nEnabledProcessesTotallyBusy++;
@@ -180,6 +181,7 @@ Group::removeProcessFromList(const ProcessPtr &process, ProcessList &source) {
 	case Process::ENABLED:
 		assert(&source == &enabledProcesses);
 		enabledCount--;
+		pool->unscheduleIdleProcessGc(process.get());
 		if (process->isTotallyBusy()) {
 			nEnabledProcessesTotallyBusy--;
 		}
@@ -328,6 +330,13 @@ Group::detachedProcessesCheckerMain(GroupPtr self) {
 							" has 0 active sessions now. Triggering shutdown.");
 						process->triggerShutdown();
 						assert(process->getLifeStatus() == Process::SHUTDOWN_TRIGGERED);
+					} else if (process->hung && process->shutdownTimeoutExpired()
+						&& process->osProcessExists())
+					{
+						// Its remaining sessions will be closed once it's dead.
+						P_WARN("Detached process " << process->inspect() <<
+							" is hung. Forcefully killing it with SIGKILL.");
+						kill(process->getPid(), SIGKILL);
 					}
 					break;
 				case Process::SHUTDOWN_TRIGGERED:
@@ -387,6 +396,160 @@ Group::detachedProcessesCheckerMain(GroupPtr self) {
 	}
 }
 
+/**
+ * Whether a process in this group is currently being disabled or detached
+ * because it exceeded `options.memoryLimit`.
+ */
+bool
+Group::memoryLimitRestartInProgress() const {
+	foreach (const ProcessPtr &process, disablingProcesses) {
+		if (process->exceededMemoryLimit) {
+			return true;
+		}
+	}
+	foreach (const ProcessPtr &process, disabledProcesses) {
+		if (process->exceededMemoryLimit) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// The 'self' parameter is for keeping the current Group object alive
+void
+Group::lockAndDetachAfterMemoryLimitDisable(const ProcessPtr &process,
+	DisableResult result, GroupPtr self)
+{
+	TRACE_POINT();
+
+	// Standard resource management boilerplate stuff...
+	Pool *pool = getPool();
+	boost::container::vector<Callback> actions;
+	boost::unique_lock<boost::mutex> lock(pool->syncher);
+	if (OXT_UNLIKELY(!process->isAlive()
+		|| process->enabled == Process::DETACHED
+		|| !isAlive()))
+	{
+		return;
+	}
+
+	if (result == DR_SUCCESS && process->enabled == Process::DISABLED) {
+		P_DEBUG("Process " << process->inspect() << " has finished its requests; "
+			"detaching it because it exceeded the memory limit");
+		pool->detachProcessUnlocked(process, actions);
+		pool->fullVerifyInvariants();
+	} else {
+		// We do not detach the process because it's likely that the
+		// administrator has explicitly changed the state.
+		P_DEBUG("Memory limit restart of process " << process->inspect() <<
+			" aborted because the process was reenabled after disabling");
+		process->exceededMemoryLimit = false;
+	}
+
+	lock.unlock();
+	runAllActions(actions);
+}
+
+/** Whether the given process has reached its maximum number of requests. */
+bool
+Group::reachedMaxRequests(const Process *process) const {
+	return options.maxRequests > 0
+		&& process->processed >= options.maxRequests + process->maxRequestsJitter;
+}
+
+unsigned int
+Group::countRecyclingProcesses() const {
+	const ProcessList *lists[] = { &enabledProcesses, &disablingProcesses, &disabledProcesses };
+	unsigned int result = 0;
+
+	for (unsigned int i = 0; i < sizeof(lists) / sizeof(ProcessList *); i++) {
+		foreach (const ProcessPtr &process, *lists[i]) {
+			if (process->recycling) {
+				result++;
+			}
+		}
+	}
+	return result;
+}
+
+/**
+ * Called when the given process has reached its maximum number of requests.
+ * Detaching it right away would reduce this group's capacity until a
+ * replacement has been spawned, so instead we spawn the replacement first
+ * and keep the process around until the replacement has been attached.
+ * See detachRecycledProcess().
+ *
+ * At most MAX_CONCURRENT_RECYCLES processes in a group are recycled at the
+ * same time. Other processes that reach their limit in the mean time keep
+ * handling requests until it's their turn.
+ *
+ * Returns false if the process must be detached immediately instead, which
+ * is the case if it's not enabled or if no replacement can be spawned.
+ */
+bool
+Group::recycleBeforeDetaching(Process *process) {
+	if (process->recycling) {
+		return true;
+	} else if (process->enabled != Process::ENABLED) {
+		return false;
+	} else if (countRecyclingProcesses() >= MAX_CONCURRENT_RECYCLES) {
+		P_DEBUG("Process " << process->inspect() << " has reached its maximum "
+			"number of requests, but other processes are already being replaced; "
+			"postponing its replacement");
+		return true;
+	}
+
+	switch (spawn()) {
+	case SR_OK:
+	case SR_IN_PROGRESS:
+		P_DEBUG("Process " << process->inspect() << " has reached its maximum "
+			"number of requests (" << options.maxRequests + process->maxRequestsJitter <<
+			"); detaching it after a replacement has been spawned");
+		process->recycling = true;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Called after a newly spawned process has been attached. Detaches one
+ * process that was waiting for a replacement, if any.
+ */
+void
+Group::detachRecycledProcess(boost::container::vector<Callback> &postLockActions) {
+	const ProcessList *lists[] = { &enabledProcesses, &disablingProcesses, &disabledProcesses };
+
+	for (unsigned int i = 0; i < sizeof(lists) / sizeof(ProcessList *); i++) {
+		foreach (const ProcessPtr &process, *lists[i]) {
+			if (process->recycling) {
+				P_DEBUG("Replacement for process " << process->inspect() <<
+					" has been attached; detaching it");
+				// detach() modifies the list we're iterating over.
+				ProcessPtr p = process;
+				detach(p, postLockActions);
+				return;
+			}
+		}
+	}
+}
+
+/**
+ * Called when the spawn loop is done. Processes that are still waiting for
+ * a replacement won't get one, so they are recycled again the next time
+ * that one of their sessions is closed.
+ */
+void
+Group::abortRecycling() {
+	const ProcessList *lists[] = { &enabledProcesses, &disablingProcesses, &disabledProcesses };
+
+	for (unsigned int i = 0; i < sizeof(lists) / sizeof(ProcessList *); i++) {
+		foreach (const ProcessPtr &process, *lists[i]) {
+			process->recycling = false;
+		}
+	}
+}
+
 
 /****************************
  *
@@ -418,9 +581,15 @@ Group::attach(const ProcessPtr &process,
 	}
 
 	process->initializeStickySessionId(generateStickySessionId());
+	if (options.maxRequestsJitter > 0) {
+		process->maxRequestsJitter = (unsigned int) (rand() % (options.maxRequestsJitter + 1));
+	}
 	if (options.forceMaxConcurrentRequestsPerProcess != -1) {
 		process->forceMaxConcurrency(options.forceMaxConcurrentRequestsPerProcess);
 	}
+	if (options.adaptiveConcurrency) {
+		process->enableAdaptiveConcurrency();
+	}
 
 	P_DEBUG("Attaching process " << process->inspect());
 	addProcessToList(process, enabledProcesses);
@@ -512,6 +681,7 @@ Group::detachAll(boost::container::vector<Callback> &postLockActions) {
 	P_DEBUG("Detaching all processes in group " << info.name);
 
 	foreach (ProcessPtr process, enabledProcesses) {
+		pool->unscheduleIdleProcessGc(process.get());
 		addProcessToList(process, detachedProcesses);
 	}
 	foreach (ProcessPtr process, disablingProcesses) {
@@ -613,6 +783,73 @@ Group::disable(const ProcessPtr &process, const DisableCallback &callback) {
 	}
 }
 
+/**
+ * Restarts the given process if it uses more memory than
+ * `options.memoryLimit`, as last measured by the analytics collector. The
+ * process is disabled so that it stops accepting new requests, and is
+ * detached as soon as its current requests have finished. A replacement
+ * process is spawned right away if the resource limits allow that.
+ *
+ * At most one process per group is restarted this way at a time, and such
+ * restarts are at least MEMORY_LIMIT_RESTART_INTERVAL seconds apart, so that
+ * a group whose processes all grow past the limit is never restarted all
+ * at once.
+ */
+void
+Group::checkMemoryLimit(const ProcessPtr &process, unsigned long long now,
+	boost::container::vector<Callback> &postLockActions)
+{
+	assert(process->getGroup() == this);
+	assert(isAlive());
+
+	if (options.memoryLimit == 0
+	 || process->enabled != Process::ENABLED
+	 || process->oobwStatus == Process::OOBW_IN_PROGRESS
+	 || !process->metrics.isValid()
+	 || process->metrics.realMemory() <= (size_t) options.memoryLimit * 1024)
+	{
+		return;
+	}
+
+	if (memoryLimitRestartInProgress()
+	 || now < lastMemoryLimitRestartTime + MEMORY_LIMIT_RESTART_INTERVAL * 1000000ull)
+	{
+		P_DEBUG("Process " << process->inspect() << " exceeds the memory limit, "
+			"but another process in this group was restarted for the same reason "
+			"recently; postponing its restart");
+		return;
+	}
+
+	P_NOTICE("Process " << process->inspect() << " is using " <<
+		process->metrics.realMemory() / 1024 << " MB of memory, which exceeds "
+		"the memory limit of " << options.memoryLimit << " MB. Restarting it "
+		"after it has finished its current requests");
+	process->exceededMemoryLimit = true;
+	DisableResult result = disable(process,
+		boost::bind(&Group::lockAndDetachAfterMemoryLimitDisable, this,
+			_1, _2, shared_from_this()));
+	switch (result) {
+	case DR_SUCCESS:
+		pool->detachProcessUnlocked(process, postLockActions);
+		break;
+	case DR_DEFERRED:
+		// lockAndDetachAfterMemoryLimitDisable() will eventually be called.
+		break;
+	case DR_ERROR:
+	case DR_NOOP:
+		P_WARN("Cannot restart process " << process->inspect() << " because "
+			"it could not be disabled");
+		process->exceededMemoryLimit = false;
+		return;
+	default:
+		P_BUG("Unexpected disable() result " << result);
+	}
+
+	memoryLimitRestarts++;
+	lastMemoryLimitRestartTime = now;
+	spawn();
+}
+
 
 } // namespace ApplicationPool2
 } // namespace Passenger
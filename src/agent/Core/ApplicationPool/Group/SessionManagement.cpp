@@ -152,6 +152,12 @@ Group::onSessionClose(Process *process, Session *session) {
 	UPDATE_TRACE_POINT();
 
 	/* Update statistics. */
+	if (options.targetUtilization > 0) {
+		unsigned long long now = SystemTime::getUsec();
+		unsigned long long checkoutTime = session->getCheckoutTime();
+		avgRequestTime = expMovingAverage(avgRequestTime,
+			(now > checkoutTime) ? now - checkoutTime : 0, 0.05);
+	}
 	bool wasTotallyBusy = process->isTotallyBusy();
 	process->sessionClosed(session);
 	assert(process->getLifeStatus() == Process::ALIVE);
@@ -160,23 +166,25 @@ Group::onSessionClose(Process *process, Session *session) {
 		|| process->enabled == Process::DETACHED);
 	if (process->enabled == Process::ENABLED) {
 		enabledProcessBusynessLevels[process->getIndex()] = process->busyness();
-		if (wasTotallyBusy) {
+		/* With adaptive concurrency, closing a session may lower the
+		 * process's limit, so the process can stay (or even become)
+		 * totally busy.
+		 */
+		bool isTotallyBusy = process->isTotallyBusy();
+		if (wasTotallyBusy && !isTotallyBusy) {
 			assert(nEnabledProcessesTotallyBusy >= 1);
 			nEnabledProcessesTotallyBusy--;
+		} else if (!wasTotallyBusy && isTotallyBusy) {
+			nEnabledProcessesTotallyBusy++;
 		}
 	}
 
-	/* This group now has a process that's guaranteed to be not
-	 * totally busy.
-	 */
-	assert(!process->isTotallyBusy());
-
 	bool detachingBecauseOfMaxRequests = false;
 	bool detachingBecauseCapacityNeeded = false;
 	bool shouldDetach =
 		( detachingBecauseOfMaxRequests = (
-			options.maxRequests > 0
-			&& process->processed >= options.maxRequests
+			reachedMaxRequests(process)
+			&& !recycleBeforeDetaching(process)
 		)) || (
 			detachingBecauseCapacityNeeded = (
 				process->sessions == 0
@@ -212,7 +220,7 @@ Group::onSessionClose(Process *process, Session *session) {
 				 */
 				P_DEBUG("Process " << process->inspect() <<
 					" has reached its maximum number of requests (" <<
-					options.maxRequests << "); detaching it");
+					options.maxRequests + process->maxRequestsJitter << "); detaching it");
 			}
 			pool->detachProcessUnlocked(process->shared_from_this(), actions);
 		} else {
@@ -288,6 +296,8 @@ Group::get(const Options &newOptions, const GetCallback &callback,
 		return nullProcess->createSessionObject((Socket *) NULL);
 	}
 
+	requestsReceived++;
+
 	if (OXT_UNLIKELY(enabledCount == 0)) {
 		/* We don't have any processes yet, but they're on the way.
 		 *
@@ -334,5 +344,41 @@ Group::get(const Options &newOptions, const GetCallback &callback,
 }
 
 
+/**
+ * Called when a request to the given process did not finish within
+ * `options.maxRequestTime`. The process is considered hung: it is detached
+ * (which also spawns a replacement if necessary) and killed shortly after,
+ * without waiting PROCESS_SHUTDOWN_TIMEOUT for its other requests.
+ *
+ * If `captureBacktrace` is true, the process is sent SIGQUIT first so that
+ * it prints the backtraces of all its threads.
+ *
+ * Thread-safe, but only call outside the pool lock!
+ */
+void
+Group::reportRequestTimeout(const ProcessPtr &process, bool captureBacktrace) {
+	// Standard resource management boilerplate stuff...
+	Pool *pool = getPool();
+	boost::container::vector<Callback> actions;
+	boost::unique_lock<boost::mutex> lock(pool->syncher);
+	if (!isAlive() || !process->isAlive() || process->enabled == Process::DETACHED) {
+		return;
+	}
+
+	requestTimeouts++;
+	lastRequestTimeoutTime = SystemTime::getUsec();
+	P_WARN("A request to process " << process->inspect() << " exceeded the maximum "
+		"request time of " << options.maxRequestTime << " seconds. Restarting process");
+	if (captureBacktrace) {
+		syscalls::kill(process->getPid(), SIGQUIT);
+	}
+	process->markHung();
+	pool->detachProcessUnlocked(process, actions);
+	pool->fullVerifyInvariants();
+	lock.unlock();
+	runAllActions(actions);
+}
+
+
 } // namespace ApplicationPool2
 } // namespace Passenger
@@ -91,6 +91,7 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 
 		ProcessPtr process;
 		ExceptionPtr exception;
+		MonotonicTimeUsec spawnStartTime = SystemTime::getMonotonicUsec();
 		try {
 			UPDATE_TRACE_POINT();
 			boost::this_thread::restore_interruption ri(di);
@@ -114,6 +115,13 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 		ScopeGuard guard(boost::bind(Process::forceTriggerShutdownAndCleanup, process));
 		boost::unique_lock<boost::mutex> lock(pool->syncher);
 
+		if (process != NULL) {
+			spawnsSucceeded++;
+		} else {
+			spawnsFailed++;
+		}
+		spawnDurations.record(SystemTime::getMonotonicUsec() - spawnStartTime);
+
 		if (!isAlive()) {
 			if (process != NULL) {
 				P_DEBUG("Group is being shut down so dropping process " <<
@@ -146,6 +154,7 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 
 		processesBeingSpawned--;
 		assert(processesBeingSpawned == 0);
+		pool->schedulePreloaderGc(this);
 
 		UPDATE_TRACE_POINT();
 		boost::container::vector<Callback> actions;
@@ -153,6 +162,7 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 			AttachResult result = attach(process, actions);
 			if (result == AR_OK) {
 				guard.clear();
+				detachRecycledProcess(actions);
 				if (getWaitlist.empty()) {
 					pool->assignSessionsToGetWaiters(actions);
 				} else {
@@ -179,12 +189,14 @@ Group::spawnThreadRealMain(const SpawningKit::SpawnerPtr &spawner,
 		}
 
 		done = done
-			|| (processLowerLimitsSatisfied() && getWaitlist.empty())
+			|| (processLowerLimitsSatisfied() && getWaitlist.empty()
+				&& countRecyclingProcesses() == 0)
 			|| processUpperLimitsReached()
 			|| pool->atFullCapacityUnlocked();
 		m_spawning = !done;
 		if (done) {
 			P_DEBUG("Spawn loop done");
+			abortRecycling();
 		} else {
 			processesBeingSpawned++;
 			P_DEBUG("Continue spawning");
@@ -331,6 +343,10 @@ bool
 Group::needsRestart(const Options &options) {
 	if (m_restarting) {
 		return false;
+	} else if (restartFileWatch != NULL && options.statThrottleRate > 0) {
+		// The RestartFileWatcher checks the restart files in the background.
+		return restartFileWatch->restartFileChanged.exchange(false, boost::memory_order_acq_rel)
+			|| restartFileWatch->alwaysRestartFileExists.load(boost::memory_order_acquire);
 	} else {
 		time_t now;
 		struct stat buf;
@@ -474,6 +490,76 @@ Group::allowSpawn() const {
 		&& !poolAtFullCapacity();
 }
 
+/**
+ * Updates the load model that predictive autoscaling is based on, and spawns
+ * a process if the model predicts that more processes are needed than there
+ * are now. Called every few seconds by the Pool.
+ *
+ * On average, the number of requests in progress is the request arrival
+ * rate times the average request time (Little's law). If the arrival rate
+ * is increasing, it is extrapolated over the average spawn duration, so
+ * that new processes are ready by the time the load arrives. The number of
+ * processes needed is then the number of requests in progress, divided by
+ * the concurrency per process and by `options.targetUtilization`.
+ *
+ * The result is used as a lower bound next to `options.minProcesses`: the
+ * spawn loop continues until it is reached, and the garbage collector does
+ * not shut down idle processes below it. Scaling down is therefore gradual:
+ * when the load drops, the predicted count drops, and surplus processes
+ * are shut down once they have been idle for the pool idle time.
+ *
+ * Groups whose processes have unlimited concurrency are not autoscaled.
+ */
+void
+Group::updateLoadModel(unsigned long long now) {
+	requestRateMeter.addSample(requestsReceived, now);
+	double rate = requestRateMeter.currentSpeed();
+	if (rate == (double) requestRateMeter.unknownSpeed() || rate < 0) {
+		return;
+	}
+	requestRateTrendMeter.addSample(rate, now);
+	double trend = requestRateTrendMeter.currentSpeed();
+	if (trend == requestRateTrendMeter.unknownSpeed()) {
+		trend = 0;
+	}
+
+	if (options.targetUtilization == 0 || avgRequestTime < 0 || enabledCount == 0) {
+		predictedProcessCount = 0;
+		return;
+	}
+
+	double concurrencyPerProcess = 0;
+	ProcessList::const_iterator it, end = enabledProcesses.end();
+	for (it = enabledProcesses.begin(); it != end; it++) {
+		int concurrency = (*it)->getEffectiveConcurrency();
+		if (concurrency == 0) {
+			predictedProcessCount = 0;
+			return;
+		}
+		concurrencyPerProcess += concurrency;
+	}
+	concurrencyPerProcess /= enabledCount;
+
+	double spawnDuration = 0;
+	if (spawnDurations.getCount() > 0) {
+		spawnDuration = spawnDurations.getSum() / (double) spawnDurations.getCount();
+	}
+	double predictedRate = rate + std::max(trend, 0.0) * spawnDuration / 1000000;
+	double utilization = std::min(options.targetUtilization, 100u) / 100.0;
+	double count = ceil(predictedRate * avgRequestTime / 1000000
+		/ (concurrencyPerProcess * utilization));
+	if (options.maxProcesses != 0) {
+		count = std::min<double>(count, options.maxProcesses);
+	}
+	predictedProcessCount = (unsigned int) std::min<double>(count, getPool()->max);
+
+	if (isAlive() && capacityUsed() < predictedProcessCount) {
+		P_DEBUG("Predicted load of group " << info.name << " (" << predictedRate <<
+			" requests/sec) needs " << predictedProcessCount << " processes; spawning");
+		spawn();
+	}
+}
+
 
 } // namespace ApplicationPool2
 } // namespace Passenger
@@ -24,6 +24,7 @@
  *  THE SOFTWARE.
  */
 #include <Core/ApplicationPool/Group.h>
+#include <Core/ApplicationPool/StateSnapshot.h>
 #include <FileTools/PathManip.h>
 #include <cassert>
 #include <modp_b64.h>
@@ -53,6 +54,16 @@ Group::getProcessCount() const {
 	return enabledCount + disablingCount + disabledCount;
 }
 
+/**
+ * Returns the number of processes that this group should keep around:
+ * `options.minProcesses`, or more if predictive autoscaling expects
+ * that more are needed.
+ */
+unsigned int
+Group::getMinProcesses() const {
+	return std::max(options.minProcesses, predictedProcessCount);
+}
+
 /**
  * Returns whether the lower bound of the group-specific process limits
  * have been satisfied. Note that even if the result is false, the pool limits
@@ -60,7 +71,7 @@ Group::getProcessCount() const {
  */
 bool
 Group::processLowerLimitsSatisfied() const {
-	return capacityUsed() >= options.minProcesses;
+	return capacityUsed() >= getMinProcesses();
 }
 
 /**
@@ -120,40 +131,123 @@ Group::garbageCollectable(unsigned long long now) const {
 
 void
 Group::inspectXml(std::ostream &stream, bool includeSecrets) const {
-	ProcessList::const_iterator it;
+	GroupSnapshot(*this).inspectXml(stream, includeSecrets);
+}
 
-	stream << "<name>" << escapeForXml(info.name) << "</name>";
-	stream << "<component_name>" << escapeForXml(info.name) << "</component_name>";
+
+/****************************
+ *
+ * GroupSnapshot
+ *
+ ****************************/
+
+
+static void
+snapshotProcesses(const ProcessList &processes, ProcessSnapshotList &result) {
+	ProcessList::const_iterator it, end = processes.end();
+	result.reserve(processes.size());
+	for (it = processes.begin(); it != end; it++) {
+		result.push_back(ProcessSnapshot(**it));
+	}
+}
+
+GroupSnapshot::GroupSnapshot(const Group &group)
+	: name(group.getName().data(), group.getName().size()),
+	  uuid(group.uuid),
+	  apiKey(group.getApiKey()),
+	  options(group.options.copyAndPersist()),
+	  resourceLocator(&group.getResourceLocator()),
+	  enabledCount(group.enabledCount),
+	  disablingCount(group.disablingCount),
+	  disabledCount(group.disabledCount),
+	  capacityUsed(group.capacityUsed()),
+	  getWaitlistSize(group.getWaitlist.size()),
+	  disableWaitlistSize(group.disableWaitlist.size()),
+	  processesBeingSpawned(group.processesBeingSpawned),
+	  requestTimeouts(group.requestTimeouts),
+	  memoryLimitRestarts(group.memoryLimitRestarts),
+	  predictedProcessCount(group.predictedProcessCount),
+	  spawnsSucceeded(group.spawnsSucceeded),
+	  spawnsFailed(group.spawnsFailed),
+	  spawnDurations(group.spawnDurations),
+	  requestQueueTimeouts(group.requestQueueTimeouts),
+	  cancelledGetWaiters(group.cancelledGetWaiters),
+	  queueTimes(group.queueTimes),
+	  spawning(group.spawning()),
+	  restarting(group.restarting()),
+	  requestQueueOverloaded(group.requestQueueOverloaded),
+	  lifeStatus((Group::LifeStatus) group.lifeStatus.load(boost::memory_order_relaxed))
+{
+	snapshotProcesses(group.enabledProcesses, enabledProcesses);
+	snapshotProcesses(group.disablingProcesses, disablingProcesses);
+	snapshotProcesses(group.disabledProcesses, disabledProcesses);
+	snapshotProcesses(group.detachedProcesses, detachedProcesses);
+}
+
+bool
+GroupSnapshot::authorizeByUid(uid_t uid) const {
+	return uid == 0 || SpawningKit::prepareUserSwitching(options).uid == uid;
+}
+
+bool
+GroupSnapshot::authorizeByApiKey(const ApiKey &key) const {
+	return key.isSuper() || key == apiKey;
+}
+
+void
+GroupSnapshot::inspectXml(std::ostream &stream, bool includeSecrets) const {
+	ProcessSnapshotList::const_iterator it;
+
+	stream << "<name>" << escapeForXml(name) << "</name>";
+	stream << "<component_name>" << escapeForXml(name) << "</component_name>";
 	stream << "<app_root>" << escapeForXml(options.appRoot) << "</app_root>";
 	stream << "<app_type>" << escapeForXml(options.appType) << "</app_type>";
 	stream << "<environment>" << escapeForXml(options.environment) << "</environment>";
-	stream << "<uuid>" << toString(uuid) << "</uuid>";
+	stream << "<uuid>" << uuid << "</uuid>";
 	stream << "<enabled_process_count>" << enabledCount << "</enabled_process_count>";
 	stream << "<disabling_process_count>" << disablingCount << "</disabling_process_count>";
 	stream << "<disabled_process_count>" << disabledCount << "</disabled_process_count>";
-	stream << "<capacity_used>" << capacityUsed() << "</capacity_used>";
-	stream << "<get_wait_list_size>" << getWaitlist.size() << "</get_wait_list_size>";
-	stream << "<disable_wait_list_size>" << disableWaitlist.size() << "</disable_wait_list_size>";
+	stream << "<capacity_used>" << capacityUsed << "</capacity_used>";
+	stream << "<get_wait_list_size>" << getWaitlistSize << "</get_wait_list_size>";
+	stream << "<disable_wait_list_size>" << disableWaitlistSize << "</disable_wait_list_size>";
 	stream << "<processes_being_spawned>" << processesBeingSpawned << "</processes_being_spawned>";
-	if (m_spawning) {
+	stream << "<request_timeouts>" << requestTimeouts << "</request_timeouts>";
+	stream << "<memory_limit_restarts>" << memoryLimitRestarts << "</memory_limit_restarts>";
+	if (options.targetUtilization > 0) {
+		stream << "<predicted_process_count>" << predictedProcessCount << "</predicted_process_count>";
+	}
+	stream << "<request_queue_timeouts>" << requestQueueTimeouts << "</request_queue_timeouts>";
+	stream << "<cancelled_queued_requests>" << cancelledGetWaiters << "</cancelled_queued_requests>";
+	if (requestQueueOverloaded) {
+		stream << "<request_queue_overloaded/>";
+	}
+	if (queueTimes.getCount() > 0) {
+		// In microseconds.
+		stream << "<queue_time>";
+		stream << "<p50>" << queueTimes.getPercentile(50) << "</p50>";
+		stream << "<p90>" << queueTimes.getPercentile(90) << "</p90>";
+		stream << "<p99>" << queueTimes.getPercentile(99) << "</p99>";
+		stream << "<max>" << queueTimes.getMax() << "</max>";
+		stream << "</queue_time>";
+	}
+	if (spawning) {
 		stream << "<spawning/>";
 	}
-	if (restarting()) {
+	if (restarting) {
 		stream << "<restarting/>";
 	}
 	if (includeSecrets) {
-		stream << "<secret>" << escapeForXml(getApiKey().toStaticString()) << "</secret>";
-		stream << "<api_key>" << escapeForXml(getApiKey().toStaticString()) << "</api_key>";
+		stream << "<secret>" << escapeForXml(apiKey.toStaticString()) << "</secret>";
+		stream << "<api_key>" << escapeForXml(apiKey.toStaticString()) << "</api_key>";
 	}
-	LifeStatus lifeStatus = (LifeStatus) this->lifeStatus.load(boost::memory_order_relaxed);
 	switch (lifeStatus) {
-	case ALIVE:
+	case Group::ALIVE:
 		stream << "<life_status>ALIVE</life_status>";
 		break;
-	case SHUTTING_DOWN:
+	case Group::SHUTTING_DOWN:
 		stream << "<life_status>SHUTTING_DOWN</life_status>";
 		break;
-	case SHUT_DOWN:
+	case Group::SHUT_DOWN:
 		stream << "<life_status>SHUT_DOWN</life_status>";
 		break;
 	default:
@@ -167,29 +261,29 @@ Group::inspectXml(std::ostream &stream, bool includeSecrets) const {
 	stream << "<gid>" << usInfo.gid << "</gid>";
 
 	stream << "<options>";
-	options.toXml(stream, getResourceLocator());
+	options.toXml(stream, *resourceLocator);
 	stream << "</options>";
 
 	stream << "<processes>";
 
 	for (it = enabledProcesses.begin(); it != enabledProcesses.end(); it++) {
 		stream << "<process>";
-		(*it)->inspectXml(stream, includeSecrets);
+		it->inspectXml(stream, includeSecrets);
 		stream << "</process>";
 	}
 	for (it = disablingProcesses.begin(); it != disablingProcesses.end(); it++) {
 		stream << "<process>";
-		(*it)->inspectXml(stream, includeSecrets);
+		it->inspectXml(stream, includeSecrets);
 		stream << "</process>";
 	}
 	for (it = disabledProcesses.begin(); it != disabledProcesses.end(); it++) {
 		stream << "<process>";
-		(*it)->inspectXml(stream, includeSecrets);
+		it->inspectXml(stream, includeSecrets);
 		stream << "</process>";
 	}
 	for (it = detachedProcesses.begin(); it != detachedProcesses.end(); it++) {
 		stream << "<process>";
-		(*it)->inspectXml(stream, includeSecrets);
+		it->inspectXml(stream, includeSecrets);
 		stream << "</process>";
 	}
 
@@ -197,10 +291,10 @@ Group::inspectXml(std::ostream &stream, bool includeSecrets) const {
 }
 
 void
-Group::inspectPropertiesInAdminPanelFormat(Json::Value &result) const {
+GroupSnapshot::inspectPropertiesInAdminPanelFormat(Json::Value &result) const {
 	result["path"] = absolutizePath(options.appRoot);
 	result["startup_file"] = absolutizePath(options.getStartupFile(), absolutizePath(options.appRoot));
-	result["start_command"] = options.getStartCommand(getResourceLocator());
+	result["start_command"] = options.getStartCommand(*resourceLocator);
 
 	if (options.appType == "rack") {
 		result["type"] = "ruby";
@@ -224,13 +318,13 @@ Group::inspectPropertiesInAdminPanelFormat(Json::Value &result) const {
 }
 
 void
-Group::inspectConfigInAdminPanelFormat(Json::Value &result) const {
+GroupSnapshot::inspectConfigInAdminPanelFormat(Json::Value &result) const {
 	#define VAL Pool::makeSingleValueJsonConfigFormat
 	#define SVAL Pool::makeSingleStrValueJsonConfigFormat
 	#define NON_EMPTY_SVAL Pool::makeSingleNonEmptyStrValueJsonConfigFormat
 
 	result["app_root"] = NON_EMPTY_SVAL(absolutizePath(options.appRoot));
-	result["app_group_name"] = NON_EMPTY_SVAL(info.name);
+	result["app_group_name"] = NON_EMPTY_SVAL(name);
 	result["default_user"] = NON_EMPTY_SVAL(options.defaultUser);
 	result["default_group"] = NON_EMPTY_SVAL(options.defaultGroup);
 	result["enabled"] = VAL(true, false);
@@ -246,6 +340,7 @@ Group::inspectConfigInAdminPanelFormat(Json::Value &result) const {
 	result["meteor_app_settings"] = NON_EMPTY_SVAL(options.meteorAppSettings);
 	result["min_processes"] = VAL(options.minProcesses, 1u);
 	result["max_processes"] = VAL(options.maxProcesses, 0u);
+	result["target_utilization"] = VAL(options.targetUtilization, 0u);
 	result["environment"] = SVAL(options.environment); // TODO: default value depends on integration mode
 	result["spawn_method"] = SVAL(options.spawnMethod, DEFAULT_SPAWN_METHOD);
 	result["start_timeout"] = VAL(options.startTimeout / 1000.0, DEFAULT_START_TIMEOUT / 1000.0);
@@ -261,9 +356,15 @@ Group::inspectConfigInAdminPanelFormat(Json::Value &result) const {
 	result["load_shell_envvars"] = VAL(options.loadShellEnvvars); // TODO: default value depends on integration mode
 	result["max_request_queue_size"] = VAL(options.maxRequestQueueSize,
 		(Json::UInt) DEFAULT_MAX_REQUEST_QUEUE_SIZE);
+	result["request_queue_target_delay"] = VAL(options.requestQueueTargetDelay, 0u);
+	result["request_queue_lifo"] = VAL(options.requestQueueLifo, false);
 	result["max_requests"] = VAL((Json::UInt) options.maxRequests, 0u);
+	result["max_requests_jitter"] = VAL((Json::UInt) options.maxRequestsJitter, 0u);
+	result["max_request_time"] = VAL(options.maxRequestTime, 0u);
+	result["memory_limit"] = VAL(options.memoryLimit, 0u);
 	result["abort_websockets_on_process_shutdown"] = VAL(options.abortWebsocketsOnProcessShutdown);
 	result["force_max_concurrent_requests_per_process"] = VAL(options.forceMaxConcurrentRequestsPerProcess, -1);
+	result["adaptive_concurrency"] = VAL(options.adaptiveConcurrency);
 	result["restart_dir"] = NON_EMPTY_SVAL(options.restartDir);
 
 	if (!options.environmentVariables.empty()) {
@@ -92,6 +92,7 @@ copyException(const tracable_exception &e) {
 
 	TRY_COPY_EXCEPTION(ConfigurationException);
 
+	TRY_COPY_EXCEPTION(RequestQueueTimeoutException);
 	TRY_COPY_EXCEPTION(RequestQueueFullException);
 	TRY_COPY_EXCEPTION(GetAbortedException);
 	TRY_COPY_EXCEPTION(SpawnException);
@@ -135,6 +136,7 @@ rethrowException(const ExceptionPtr &e) {
 	TRY_RETHROW_EXCEPTION(ConfigurationException);
 
 	TRY_RETHROW_EXCEPTION(SpawnException);
+	TRY_RETHROW_EXCEPTION(RequestQueueTimeoutException);
 	TRY_RETHROW_EXCEPTION(RequestQueueFullException);
 	TRY_RETHROW_EXCEPTION(GetAbortedException);
 
@@ -333,6 +335,12 @@ Session::requestOOBW() {
 	process->getGroup()->requestOOBW(process);
 }
 
+void
+Session::reportRequestTimeout(bool captureBacktrace) {
+	ProcessPtr process = getProcess()->shared_from_this();
+	process->getGroup()->reportRequestTimeout(process, captureBacktrace);
+}
+
 
 } // namespace ApplicationPool2
 } // namespace Passenger
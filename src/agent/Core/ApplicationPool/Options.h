@@ -294,6 +294,15 @@ public:
 	 */
 	int forceMaxConcurrentRequestsPerProcess;
 
+	/**
+	 * Whether to adjust the number of concurrent requests per process
+	 * based on the response latency of that process, instead of always
+	 * using the concurrency that the process advertised (or that was forced
+	 * with `forceMaxConcurrentRequestsPerProcess`). The advertised concurrency
+	 * becomes the upper bound. See Process::enableAdaptiveConcurrency().
+	 */
+	bool adaptiveConcurrency;
+
 	/** Whether debugger support should be enabled. */
 	bool debugger;
 
@@ -348,6 +357,14 @@ public:
 	 */
 	unsigned int maxProcesses;
 
+	/**
+	 * Enables predictive autoscaling if nonzero. Processes are then spawned
+	 * ahead of demand, based on the trend of the request rate and on the
+	 * average request time, so that processes are busy about this percentage
+	 * of the time. See Group::updateLoadModel().
+	 */
+	unsigned int targetUtilization;
+
 	/** The number of seconds that preloader processes may stay alive idling. */
 	long maxPreloaderIdleTime;
 
@@ -363,6 +380,23 @@ public:
 	 */
 	unsigned int maxRequestQueueSize;
 
+	/**
+	 * Enables overload control for the Group.getWaitlist queue if nonzero.
+	 * If requests have been waiting in the queue for longer than this many
+	 * milliseconds for at least REQUEST_QUEUE_OVERLOAD_INTERVAL, then the
+	 * queue is considered overloaded (as in CoDel), and queued requests that
+	 * have waited longer than this are failed with a
+	 * RequestQueueTimeoutException instead of being served late.
+	 */
+	unsigned int requestQueueTargetDelay;
+
+	/**
+	 * Whether to serve the most recently queued requests first while the
+	 * Group.getWaitlist queue is overloaded. Only has effect if
+	 * `requestQueueTargetDelay` is set.
+	 */
+	bool requestQueueLifo;
+
 	/**
 	 * Whether websocket connections should be aborted on process shutdown
 	 * or restart.
@@ -427,6 +461,27 @@ public:
 	 */
 	unsigned long maxRequests;
 
+	/**
+	 * Each process is restarted after `maxRequests` plus a random number
+	 * of requests between 0 and this value, so that processes that were
+	 * spawned at the same time are not restarted at the same time.
+	 */
+	unsigned long maxRequestsJitter;
+
+	/**
+	 * The maximum number of seconds that a request may take before the
+	 * Controller aborts it with a 504 and the process that was handling it
+	 * is restarted. A value of 0 means unlimited.
+	 */
+	unsigned int maxRequestTime;
+
+	/**
+	 * The maximum amount of memory, in MB, that a process may use. Processes
+	 * that use more are restarted after they have finished their current
+	 * requests. A value of 0 means unlimited.
+	 */
+	unsigned int memoryLimit;
+
 	/** If the current time (in microseconds) has already been queried, set it
 	 * here. Pool will use this timestamp instead of querying it again.
 	 */
@@ -483,6 +538,7 @@ public:
 		  nodejs(DEFAULT_NODEJS, sizeof(DEFAULT_NODEJS) - 1),
 		  fileDescriptorUlimit(0),
 		  forceMaxConcurrentRequestsPerProcess(-1),
+		  adaptiveConcurrency(false),
 		  debugger(false),
 		  loadShellEnvvars(true),
 		  userSwitching(true),
@@ -491,14 +547,20 @@ public:
 
 		  minProcesses(1),
 		  maxProcesses(0),
+		  targetUtilization(0),
 		  maxPreloaderIdleTime(-1),
 		  maxOutOfBandWorkInstances(1),
 		  maxRequestQueueSize(DEFAULT_MAX_REQUEST_QUEUE_SIZE),
+		  requestQueueTargetDelay(0),
+		  requestQueueLifo(false),
 		  abortWebsocketsOnProcessShutdown(true),
 
 		  stickySessionId(0),
 		  statThrottleRate(DEFAULT_STAT_THROTTLE_RATE),
 		  maxRequests(0),
+		  maxRequestsJitter(0),
+		  maxRequestTime(0),
+		  memoryLimit(0),
 		  currentTime(0),
 		  noop(false)
 		  /*********************************/
@@ -630,6 +692,7 @@ public:
 		if (fields & PER_GROUP_POOL_OPTIONS) {
 			appendKeyValue3(vec, "min_processes",       minProcesses);
 			appendKeyValue3(vec, "max_processes",       maxProcesses);
+			appendKeyValue3(vec, "target_utilization",  targetUtilization);
 			appendKeyValue2(vec, "max_preloader_idle_time", maxPreloaderIdleTime);
 			appendKeyValue3(vec, "max_out_of_band_work_instances", maxOutOfBandWorkInstances);
 		}
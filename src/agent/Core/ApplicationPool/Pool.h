@@ -52,6 +52,7 @@
 #include <ConfigKit/ConfigKit.h>
 #include <Exceptions.h>
 #include <Hooks.h>
+#include <DataStructures/DeadlineHeap.h>
 #include <Utils/Lock.h>
 #include <Utils/AnsiColorConstants.h>
 #include <Utils/SystemTime.h>
@@ -59,12 +60,14 @@
 #include <Utils/VariantMap.h>
 #include <Utils/ProcessMetricsCollector.h>
 #include <Utils/SystemMetricsCollector.h>
+#include <Utils/OpenMetricsWriter.h>
 #include <Core/UnionStation/StopwatchLog.h>
 #include <Core/ApplicationPool/Common.h>
 #include <Core/ApplicationPool/Context.h>
 #include <Core/ApplicationPool/Process.h>
 #include <Core/ApplicationPool/Group.h>
 #include <Core/ApplicationPool/Session.h>
+#include <Core/ApplicationPool/StateSnapshot.h>
 #include <Core/ApplicationPool/Options.h>
 #include <Core/SpawningKit/Factory.h>
 #include <Shared/ApplicationPoolApiKey.h>
@@ -235,6 +238,17 @@ public:
 	mutable GroupMap groups;
 	psg_pool_t *palloc;
 
+	/** How long, in microseconds, a state snapshot may be reused. */
+	static const MonotonicTimeUsec SNAPSHOT_MAX_AGE = 1000000;
+	/**
+	 * The last state snapshot created by `getSnapshot()`. Protected by
+	 * `snapshotSyncher`. If both `snapshotSyncher` and `syncher` must be
+	 * locked, then `snapshotSyncher` must be locked first.
+	 */
+	mutable boost::mutex snapshotSyncher;
+	mutable PoolSnapshotPtr snapshot;
+	mutable boost::uint64_t snapshotVersion;
+
 	/**
 	 * get() requests that...
 	 * - cannot be immediately satisfied because the pool is at full
@@ -331,6 +345,8 @@ public:
 	static void updateProcessMetrics(const ProcessList &processes,
 		const ProcessMetricMap &allMetrics,
 		vector<ProcessPtr> &processesToDetach);
+	void checkMemoryLimits(boost::container::vector<Callback> &postLockActions);
+	void updateLoadModels();
 	void prepareUnionStationProcessStateLogs(vector<UnionStationLogEntry> &logEntries,
 		const GroupPtr &group) const;
 	void prepareUnionStationSystemMetricsLogs(vector<UnionStationLogEntry> &logEntries,
@@ -342,20 +358,30 @@ public:
 
 	struct GarbageCollectorState {
 		unsigned long long now;
-		unsigned long long nextGcRunTime;
 		boost::container::vector<Callback> actions;
 	};
 
 	boost::condition_variable garbageCollectionCond;
+	/**
+	 * Enabled processes, by the time at which they may have been idle for
+	 * longer than maxIdleTime. Only maintained while maxIdleTime > 0.
+	 */
+	DeadlineHeap idleProcesses;
+	/** Groups, by the time at which their spawner may have been idle for too long. */
+	DeadlineHeap idlePreloaders;
+	/** The time at which the garbage collector will run next. 0 if unknown. */
+	unsigned long long nextGcRunTime;
 
 	void initializeGarbageCollection();
 	static void garbageCollect(PoolPtr self);
-	void maybeUpdateNextGcRuntime(GarbageCollectorState &state, unsigned long candidate);
-	void checkWhetherProcessCanBeGarbageCollected(GarbageCollectorState &state,
-		const GroupPtr &group, const ProcessPtr &process, ProcessList &output);
-	void garbageCollectProcessesInGroup(GarbageCollectorState &state,
-		const GroupPtr &group);
-	void maybeCleanPreloader(GarbageCollectorState &state, const GroupPtr &group);
+	void scheduleIdleProcessGc(Process *process);
+	void unscheduleIdleProcessGc(Process *process);
+	void rescheduleAllIdleProcessGc();
+	void schedulePreloaderGc(Group *group);
+	void unschedulePreloaderGc(Group *group);
+	void wakeupGarbageCollectorBefore(unsigned long long deadline);
+	void garbageCollectIdleProcesses(GarbageCollectorState &state);
+	void garbageCollectIdlePreloaders(GarbageCollectorState &state);
 	unsigned long long realGarbageCollect();
 	void wakeupGarbageCollector();
 
@@ -437,8 +463,9 @@ public:
 	static Json::Value makeSingleNonEmptyStrValueJsonConfigFormat(const StaticString &val);
 	unsigned int capacityUsedUnlocked() const;
 	bool atFullCapacityUnlocked() const;
+	PoolSnapshotPtr createSnapshotUnlocked(MonotonicTimeUsec now) const;
 	void inspectProcessList(const InspectOptions &options, stringstream &result,
-		const Group *group, const ProcessList &processes) const;
+		const GroupSnapshot &group, const ProcessSnapshotList &processes) const;
 
 public:
 	typedef void (*AbortLongRunningConnectionsCallback)(const ProcessPtr &process);
@@ -495,12 +522,14 @@ public:
 	bool atFullCapacity() const;
 	unsigned int getProcessCount(bool lock = true) const;
 	unsigned int getGroupCount() const;
+	PoolSnapshotPtr getSnapshot(bool lock = true) const;
 	string inspect(const InspectOptions &options = InspectOptions::makeAuthorized(),
 		bool lock = true) const;
 	string toXml(const ToXmlOptions &options = ToXmlOptions::makeAuthorized(),
 		bool lock = true) const;
 	Json::Value inspectPropertiesInAdminPanelFormat(const ToJsonOptions &options = ToJsonOptions::makeAuthorized()) const;
 	Json::Value inspectConfigInAdminPanelFormat(const ToJsonOptions &options = ToJsonOptions::makeAuthorized()) const;
+	void writeMetrics(OpenMetricsWriter &writer) const;
 
 
 	/****** Miscellaneous ******/
@@ -105,6 +105,36 @@ Pool::updateProcessMetrics(const ProcessList &processes,
 	}
 }
 
+void
+Pool::checkMemoryLimits(boost::container::vector<Callback> &postLockActions) {
+	unsigned long long now = SystemTime::getUsec();
+	GroupMap::ConstIterator g_it(groups);
+	while (*g_it != NULL) {
+		const GroupPtr &group = g_it.getValue();
+		if (group->options.memoryLimit > 0) {
+			// checkMemoryLimit() may move processes out of enabledProcesses.
+			ProcessList processes = group->enabledProcesses;
+			foreach (const ProcessPtr &process, processes) {
+				group->checkMemoryLimit(process, now, postLockActions);
+			}
+		}
+		g_it.next();
+	}
+}
+
+void
+Pool::updateLoadModels() {
+	unsigned long long now = SystemTime::getUsec();
+	GroupMap::ConstIterator g_it(groups);
+	while (*g_it != NULL) {
+		const GroupPtr &group = g_it.getValue();
+		if (group->isAlive()) {
+			group->updateLoadModel(now);
+		}
+		g_it.next();
+	}
+}
+
 void
 Pool::prepareUnionStationProcessStateLogs(vector<UnionStationLogEntry> &logEntries,
 	const GroupPtr &group) const
@@ -222,6 +252,11 @@ Pool::realCollectAnalytics() {
 		UPDATE_TRACE_POINT();
 		processesToDetach.clear();
 
+		UPDATE_TRACE_POINT();
+		checkMemoryLimits(actions);
+		UPDATE_TRACE_POINT();
+		updateLoadModels();
+
 		l.unlock();
 		UPDATE_TRACE_POINT();
 		if (!logEntries.empty()) {
@@ -58,11 +58,16 @@ Pool::garbageCollect(PoolPtr self) {
 	while (!this_thread::interruption_requested()) {
 		try {
 			UPDATE_TRACE_POINT();
-			unsigned long long sleepTime = self->realGarbageCollect();
+			self->realGarbageCollect();
 			UPDATE_TRACE_POINT();
 			ScopedLock lock(self->syncher);
-			self->garbageCollectionCond.timed_wait(lock,
-				posix_time::microseconds(sleepTime));
+			// nextGcRunTime may have been moved forward while we weren't
+			// holding the lock.
+			unsigned long long now = SystemTime::getUsec();
+			if (self->nextGcRunTime > now) {
+				self->garbageCollectionCond.timed_wait(lock,
+					posix_time::microseconds(self->nextGcRunTime - now));
+			}
 		} catch (const thread_interrupted &) {
 			break;
 		} catch (const tracable_exception &e) {
@@ -71,69 +76,130 @@ Pool::garbageCollect(PoolPtr self) {
 	}
 }
 
+/**
+ * Called whenever a process becomes enabled. The deadline is only a lower
+ * bound: `lastUsed` changes every time a session is opened, but we don't
+ * want to touch the heap on every request. Instead, the garbage collector
+ * reschedules processes that turn out to have been used in the meantime.
+ */
 void
-Pool::maybeUpdateNextGcRuntime(GarbageCollectorState &state, unsigned long candidate) {
-	if (state.nextGcRunTime == 0 || candidate < state.nextGcRunTime) {
-		state.nextGcRunTime = candidate;
+Pool::scheduleIdleProcessGc(Process *process) {
+	if (maxIdleTime > 0) {
+		unsigned long long deadline = process->lastUsed + maxIdleTime;
+		idleProcesses.schedule(&process->idleGcEntry, deadline);
+		wakeupGarbageCollectorBefore(deadline);
 	}
 }
 
 void
-Pool::checkWhetherProcessCanBeGarbageCollected(GarbageCollectorState &state,
-	const GroupPtr &group, const ProcessPtr &process, ProcessList &output)
-{
-	assert(maxIdleTime > 0);
-	unsigned long long processGcTime = process->lastUsed + maxIdleTime;
-	if (process->sessions == 0
-	 && state.now >= processGcTime)
-	{
-		if (output.capacity() == 0) {
-			output.reserve(group->enabledCount);
+Pool::unscheduleIdleProcessGc(Process *process) {
+	idleProcesses.remove(&process->idleGcEntry);
+}
+
+void
+Pool::rescheduleAllIdleProcessGc() {
+	GroupMap::ConstIterator g_it(groups);
+	while (*g_it != NULL) {
+		const GroupPtr &group = g_it.getValue();
+		foreach (const ProcessPtr &process, group->enabledProcesses) {
+			unscheduleIdleProcessGc(process.get());
+			scheduleIdleProcessGc(process.get());
 		}
-		output.push_back(process);
-	} else {
-		maybeUpdateNextGcRuntime(state, processGcTime);
+		g_it.next();
 	}
 }
 
+/**
+ * Called after every spawn, because that's when a spawner may start a
+ * preloader. Like with processes, the deadline is a lower bound.
+ */
 void
-Pool::garbageCollectProcessesInGroup(GarbageCollectorState &state,
-	const GroupPtr &group)
-{
-	ProcessList &processes = group->enabledProcesses;
-	ProcessList processesToGc;
-	ProcessList::iterator p_it, p_end = processes.end();
-
-	for (p_it = processes.begin(); p_it != p_end; p_it++) {
-		const ProcessPtr &process = *p_it;
-		checkWhetherProcessCanBeGarbageCollected(state, group, process,
-			processesToGc);
+Pool::schedulePreloaderGc(Group *group) {
+	if (!group->preloaderGcEntry.isInHeap()
+	 && group->spawner->cleanable()
+	 && group->options.getMaxPreloaderIdleTime() != 0)
+	{
+		unsigned long long deadline = group->spawner->lastUsed() +
+			group->options.getMaxPreloaderIdleTime() * 1000000;
+		idlePreloaders.schedule(&group->preloaderGcEntry, deadline);
+		wakeupGarbageCollectorBefore(deadline);
 	}
+}
 
-	p_it  = processesToGc.begin();
-	p_end = processesToGc.end();
-	while (p_it != p_end
-	 && (unsigned long) group->getProcessCount() > group->options.minProcesses)
-	{
-		ProcessPtr process = *p_it;
-		P_DEBUG("Garbage collect idle process: " << process->inspect() <<
-			", group=" << group->getName());
-		group->detach(process, state.actions);
-		p_it++;
+void
+Pool::unschedulePreloaderGc(Group *group) {
+	idlePreloaders.remove(&group->preloaderGcEntry);
+}
+
+void
+Pool::wakeupGarbageCollectorBefore(unsigned long long deadline) {
+	if (nextGcRunTime == 0 || deadline < nextGcRunTime) {
+		nextGcRunTime = deadline;
+		wakeupGarbageCollector();
+	}
+}
+
+/**
+ * Detaches processes that have been idle for more than maxIdleTime. Only
+ * looks at processes whose deadline has passed.
+ */
+void
+Pool::garbageCollectIdleProcesses(GarbageCollectorState &state) {
+	assert(maxIdleTime > 0);
+	DeadlineHeapEntry *entry;
+	// Processes that can't be garbage collected yet are rescheduled after
+	// the loop, so that every process is looked at only once per run.
+	SmallVector<Process *, 16> processesToReschedule;
+
+	while ((entry = idleProcesses.popExpired(state.now)) != NULL) {
+		ProcessPtr process(static_cast<Process *>(entry->userData));
+		Group *group = process->getGroup();
+		unsigned long long processGcTime = process->lastUsed + maxIdleTime;
+
+		if (process->sessions == 0
+		 && state.now >= processGcTime
+		 && group->getProcessCount() > group->getMinProcesses())
+		{
+			P_DEBUG("Garbage collect idle process: " << process->inspect() <<
+				", group=" << group->getName());
+			group->detach(process, state.actions);
+			group->verifyInvariants();
+		} else {
+			processesToReschedule.push_back(process.get());
+		}
+	}
+
+	SmallVector<Process *, 16>::const_iterator it, end = processesToReschedule.end();
+	for (it = processesToReschedule.begin(); it != end; it++) {
+		Process *process = *it;
+		unsigned long long processGcTime = process->lastUsed + maxIdleTime;
+		if (processGcTime <= state.now) {
+			// Busy, or needed to satisfy minProcesses or the predicted load.
+			processGcTime = state.now + maxIdleTime;
+		}
+		idleProcesses.schedule(&process->idleGcEntry, processGcTime);
 	}
 }
 
+/**
+ * Cleans up spawners that have been idle for more than
+ * their group's maxPreloaderIdleTime.
+ */
 void
-Pool::maybeCleanPreloader(GarbageCollectorState &state, const GroupPtr &group) {
-	if (group->spawner->cleanable() && group->options.getMaxPreloaderIdleTime() != 0) {
+Pool::garbageCollectIdlePreloaders(GarbageCollectorState &state) {
+	DeadlineHeapEntry *entry;
+
+	while ((entry = idlePreloaders.popExpired(state.now)) != NULL) {
+		Group *group = static_cast<Group *>(entry->userData);
 		unsigned long long spawnerGcTime =
 			group->spawner->lastUsed() +
 			group->options.getMaxPreloaderIdleTime() * 1000000;
 		if (state.now >= spawnerGcTime) {
+			// Rescheduled by schedulePreloaderGc() upon the next spawn.
 			P_DEBUG("Garbage collect idle spawner: group=" << group->getName());
 			group->cleanupSpawner(state.actions);
 		} else {
-			maybeUpdateNextGcRuntime(state, spawnerGcTime);
+			idlePreloaders.schedule(entry, spawnerGcTime);
 		}
 	}
 }
@@ -142,45 +208,39 @@ unsigned long long
 Pool::realGarbageCollect() {
 	TRACE_POINT();
 	ScopedLock lock(syncher);
-	GroupMap::ConstIterator g_it(groups);
 	GarbageCollectorState state;
 	state.now = SystemTime::getUsec();
-	state.nextGcRunTime = 0;
 
 	P_DEBUG("Garbage collection time...");
 	verifyInvariants();
 
-	// For all groups...
-	while (*g_it != NULL) {
-		const GroupPtr group = g_it.getValue();
-
-		if (maxIdleTime > 0) {
-			// ...detach processes that have been idle for more than maxIdleTime.
-			garbageCollectProcessesInGroup(state, group);
-		}
-
-		group->verifyInvariants();
-
-		// ...cleanup the spawner if it's been idle for more than preloaderIdleTime.
-		maybeCleanPreloader(state, group);
-
-		g_it.next();
+	if (maxIdleTime > 0) {
+		garbageCollectIdleProcesses(state);
 	}
+	garbageCollectIdlePreloaders(state);
 
 	verifyInvariants();
-	lock.unlock();
 
 	// Schedule next garbage collection run.
+	unsigned long long nextRunTime = 0;
+	if (maxIdleTime > 0 && !idleProcesses.empty()) {
+		nextRunTime = idleProcesses.top()->deadline;
+	}
+	if (!idlePreloaders.empty()
+	 && (nextRunTime == 0 || idlePreloaders.top()->deadline < nextRunTime))
+	{
+		nextRunTime = idlePreloaders.top()->deadline;
+	}
 	unsigned long long sleepTime;
-	if (state.nextGcRunTime == 0 || state.nextGcRunTime <= state.now) {
-		if (maxIdleTime == 0) {
-			sleepTime = 10 * 60 * 1000000;
-		} else {
-			sleepTime = maxIdleTime;
-		}
+	if (nextRunTime == 0) {
+		// Nothing to do until something is scheduled.
+		sleepTime = 10 * 60 * 1000000;
 	} else {
-		sleepTime = state.nextGcRunTime - state.now;
+		sleepTime = nextRunTime - state.now;
 	}
+	nextGcRunTime = state.now + sleepTime;
+	lock.unlock();
+
 	P_DEBUG("Garbage collection done; next garbage collect in " <<
 		std::fixed << std::setprecision(3) << (sleepTime / 1000000.0) << " sec");
 
@@ -58,6 +58,8 @@ Pool::Pool(const SpawningKit::FactoryPtr &spawningKitFactory,
 	maxIdleTime  = 60 * 1000000;
 	selfchecking = true;
 	palloc       = psg_create_pool(PSG_DEFAULT_POOL_SIZE);
+	snapshotVersion = 0;
+	nextGcRunTime = 0;
 
 	// The following code only serve to instantiate certain inline methods
 	// so that they can be invoked from gdb.
@@ -105,6 +107,8 @@ Pool::prepareForShutdown() {
 		foreach (ProcessPtr process, processes) {
 			// Ensure that the process is not immediately respawned.
 			process->getGroup()->options.minProcesses = 0;
+			process->getGroup()->options.targetUtilization = 0;
+			process->getGroup()->predictedProcessCount = 0;
 			abortLongRunningConnectionsCallback(process);
 		}
 	}
@@ -224,6 +224,7 @@ void
 Pool::setMaxIdleTime(unsigned long long value) {
 	LockGuard l(syncher);
 	maxIdleTime = value;
+	rescheduleAllIdleProcessGc();
 	wakeupGarbageCollector();
 }
 
@@ -68,21 +68,47 @@ Pool::atFullCapacityUnlocked() const {
 	return capacityUsedUnlocked() >= max;
 }
 
+PoolSnapshotPtr
+Pool::createSnapshotUnlocked(MonotonicTimeUsec now) const {
+	boost::shared_ptr<PoolSnapshot> result = boost::make_shared<PoolSnapshot>();
+	GroupMap::ConstIterator g_it(groups);
+
+	result->version = ++snapshotVersion;
+	result->creationTime = now;
+	result->max = max;
+	result->processCount = getProcessCount(false);
+	result->capacityUsed = capacityUsedUnlocked();
+
+	vector<GetWaiter>::const_iterator w_it, w_end = getWaitlist.end();
+	result->getWaitlist.reserve(getWaitlist.size());
+	for (w_it = getWaitlist.begin(); w_it != w_end; w_it++) {
+		result->getWaitlist.push_back(w_it->options.getAppGroupName());
+	}
+
+	result->groups.reserve(groups.size());
+	while (*g_it != NULL) {
+		result->groups.push_back(GroupSnapshot(*g_it.getValue()));
+		g_it.next();
+	}
+
+	return result;
+}
+
 void
 Pool::inspectProcessList(const InspectOptions &options, stringstream &result,
-	const Group *group, const ProcessList &processes) const
+	const GroupSnapshot &group, const ProcessSnapshotList &processes) const
 {
-	ProcessList::const_iterator p_it;
+	ProcessSnapshotList::const_iterator p_it;
 	for (p_it = processes.begin(); p_it != processes.end(); p_it++) {
-		const ProcessPtr &process = *p_it;
+		const ProcessSnapshot &process = *p_it;
 		char buf[128];
 		char cpubuf[10];
 		char membuf[10];
 
-		 if (process->metrics.isValid()) {
-			snprintf(cpubuf, sizeof(cpubuf), "%d%%", (int) process->metrics.cpu);
+		 if (process.metrics.isValid()) {
+			snprintf(cpubuf, sizeof(cpubuf), "%d%%", (int) process.metrics.cpu);
 			snprintf(membuf, sizeof(membuf), "%ldM",
-				(unsigned long) (process->metrics.realMemory() / 1024));
+				(unsigned long) (process.metrics.realMemory() / 1024));
 		} else {
 			snprintf(cpubuf, sizeof(cpubuf), "0%%");
 			snprintf(membuf, sizeof(membuf), "0M");
@@ -90,27 +116,27 @@ Pool::inspectProcessList(const InspectOptions &options, stringstream &result,
 		snprintf(buf, sizeof(buf),
 			"  * PID: %-5lu   Sessions: %-2u      Processed: %-5u   Uptime: %s\n"
 			"    CPU: %-5s   Memory  : %-5s   Last used: %s ago",
-			(unsigned long) process->getPid(),
-			process->sessions,
-			process->processed,
-			process->uptime().c_str(),
+			(unsigned long) process.pid,
+			process.sessions,
+			process.processed,
+			process.uptime().c_str(),
 			cpubuf,
 			membuf,
-			distanceOfTimeInWords(process->lastUsed / 1000000).c_str());
+			distanceOfTimeInWords(process.lastUsed / 1000000).c_str());
 		result << buf << endl;
 
-		if (process->enabled == Process::DISABLING) {
+		if (process.enabled == Process::DISABLING) {
 			result << "    Disabling..." << endl;
-		} else if (process->enabled == Process::DISABLED) {
+		} else if (process.enabled == Process::DISABLED) {
 			result << "    DISABLED" << endl;
-		} else if (process->enabled == Process::DETACHED) {
+		} else if (process.enabled == Process::DETACHED) {
 			result << "    Shutting down..." << endl;
 		}
 
-		const Socket *socket;
-		if (options.verbose && (socket = process->getSockets().findSocketWithName("http")) != NULL) {
+		const ProcessSnapshot::SocketInfo *socket;
+		if (options.verbose && (socket = process.findSocketWithName("http")) != NULL) {
 			result << "    URL     : http://" << replaceString(socket->address, "tcp://", "") << endl;
-			result << "    Password: " << group->getApiKey().toStaticString() << endl;
+			result << "    Password: " << group.apiKey.toStaticString() << endl;
 		}
 	}
 }
@@ -123,81 +149,99 @@ Pool::inspectProcessList(const InspectOptions &options, stringstream &result,
  ****************************/
 
 
+/**
+ * Returns an immutable copy of the state of all groups and processes. The
+ * state inspection functions format this snapshot instead of the live data
+ * structures, so that they hold the pool lock only for as long as it takes
+ * to copy the state.
+ *
+ * Snapshots are shared between callers for up to SNAPSHOT_MAX_AGE, so
+ * multiple monitoring tools polling at the same time only cause the pool
+ * lock to be grabbed once. If `lock` is false, then a new snapshot is
+ * created without grabbing any locks. That is only meant to be used from
+ * crash handlers.
+ */
+PoolSnapshotPtr
+Pool::getSnapshot(bool lock) const {
+	if (!lock) {
+		return createSnapshotUnlocked(SystemTime::getMonotonicUsec());
+	}
+
+	boost::lock_guard<boost::mutex> l(snapshotSyncher);
+	MonotonicTimeUsec now = SystemTime::getMonotonicUsec();
+	if (snapshot == NULL || now - snapshot->creationTime >= SNAPSHOT_MAX_AGE) {
+		LockGuard l2(syncher);
+		snapshot = createSnapshotUnlocked(now);
+	}
+	return snapshot;
+}
+
 string
 Pool::inspect(const InspectOptions &options, bool lock) const {
-	DynamicScopedLock l(syncher, lock);
+	PoolSnapshotPtr snapshot = getSnapshot(lock);
 	stringstream result;
 	const char *headerColor = maybeColorize(options, ANSI_COLOR_YELLOW ANSI_COLOR_BLUE_BG ANSI_COLOR_BOLD);
 	const char *resetColor  = maybeColorize(options, ANSI_COLOR_RESET);
 
-	if (!authorizeByUid(options.uid, false)
-	 && !authorizeByApiKey(options.apiKey, false))
+	if (!snapshot->authorizeByUid(options.uid)
+	 && !snapshot->authorizeByApiKey(options.apiKey))
 	{
 		throw SecurityException("Operation unauthorized");
 	}
 
 	result << headerColor << "----------- General information -----------" << resetColor << endl;
-	result << "Max pool size : " << max << endl;
-	result << "App groups    : " << groups.size() << endl;
-	result << "Processes     : " << getProcessCount(false) << endl;
-	result << "Requests in top-level queue : " << getWaitlist.size() << endl;
+	result << "Max pool size : " << snapshot->max << endl;
+	result << "App groups    : " << snapshot->groups.size() << endl;
+	result << "Processes     : " << snapshot->processCount << endl;
+	result << "Requests in top-level queue : " << snapshot->getWaitlist.size() << endl;
 	if (options.verbose) {
 		unsigned int i = 0;
-		foreach (const GetWaiter &waiter, getWaitlist) {
-			result << "  " << i << ": " << waiter.options.getAppGroupName() << endl;
+		foreach (const string &appGroupName, snapshot->getWaitlist) {
+			result << "  " << i << ": " << appGroupName << endl;
 			i++;
 		}
 	}
 	result << endl;
 
 	result << headerColor << "----------- Application groups -----------" << resetColor << endl;
-	GroupMap::ConstIterator g_it(groups);
-	while (*g_it != NULL) {
-		const GroupPtr &group = g_it.getValue();
-		if (!group->authorizeByUid(options.uid)
-		 && !group->authorizeByApiKey(options.apiKey))
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		if (!group.authorizeByUid(options.uid)
+		 && !group.authorizeByApiKey(options.apiKey))
 		{
-			g_it.next();
 			continue;
 		}
 
-		ProcessList::const_iterator p_it;
-
-		result << group->getName() << ":" << endl;
-		result << "  App root: " << group->options.appRoot << endl;
-		if (group->restarting()) {
+		result << group.name << ":" << endl;
+		result << "  App root: " << group.options.appRoot << endl;
+		if (group.restarting) {
 			result << "  (restarting...)" << endl;
 		}
-		if (group->spawning()) {
-			if (group->processesBeingSpawned == 0) {
+		if (group.spawning) {
+			if (group.processesBeingSpawned == 0) {
 				result << "  (spawning...)" << endl;
 			} else {
-				result << "  (spawning " << group->processesBeingSpawned << " new " <<
-					maybePluralize(group->processesBeingSpawned, "process", "processes") <<
+				result << "  (spawning " << group.processesBeingSpawned << " new " <<
+					maybePluralize(group.processesBeingSpawned, "process", "processes") <<
 					"...)" << endl;
 			}
 		}
-		result << "  Requests in queue: " << group->getWaitlist.size() << endl;
-		inspectProcessList(options, result, group.get(), group->enabledProcesses);
-		inspectProcessList(options, result, group.get(), group->disablingProcesses);
-		inspectProcessList(options, result, group.get(), group->disabledProcesses);
-		inspectProcessList(options, result, group.get(), group->detachedProcesses);
+		result << "  Requests in queue: " << group.getWaitlistSize << endl;
+		inspectProcessList(options, result, group, group.enabledProcesses);
+		inspectProcessList(options, result, group, group.disablingProcesses);
+		inspectProcessList(options, result, group, group.disabledProcesses);
+		inspectProcessList(options, result, group, group.detachedProcesses);
 		result << endl;
-
-		g_it.next();
 	}
 	return result.str();
 }
 
 string
 Pool::toXml(const ToXmlOptions &options, bool lock) const {
-	DynamicScopedLock l(syncher, lock);
+	PoolSnapshotPtr snapshot = getSnapshot(lock);
 	stringstream result;
-	GroupMap::ConstIterator g_it(groups);
-	ProcessList::const_iterator p_it;
 
-	if (!authorizeByUid(options.uid, false)
-	 && !authorizeByApiKey(options.apiKey, false))
+	if (!snapshot->authorizeByUid(options.uid)
+	 && !snapshot->authorizeByApiKey(options.apiKey))
 	{
 		throw SecurityException("Operation unauthorized");
 	}
@@ -206,51 +250,44 @@ Pool::toXml(const ToXmlOptions &options, bool lock) const {
 	result << "<info version=\"3\">";
 
 	result << "<passenger_version>" << PASSENGER_VERSION << "</passenger_version>";
-	result << "<group_count>" << groups.size() << "</group_count>";
-	result << "<process_count>" << getProcessCount(false) << "</process_count>";
-	result << "<max>" << max << "</max>";
-	result << "<capacity_used>" << capacityUsedUnlocked() << "</capacity_used>";
-	result << "<get_wait_list_size>" << getWaitlist.size() << "</get_wait_list_size>";
+	result << "<group_count>" << snapshot->groups.size() << "</group_count>";
+	result << "<process_count>" << snapshot->processCount << "</process_count>";
+	result << "<max>" << snapshot->max << "</max>";
+	result << "<capacity_used>" << snapshot->capacityUsed << "</capacity_used>";
+	result << "<get_wait_list_size>" << snapshot->getWaitlist.size() << "</get_wait_list_size>";
 
 	if (options.secrets) {
-		vector<GetWaiter>::const_iterator w_it, w_end = getWaitlist.end();
-
 		result << "<get_wait_list>";
-		for (w_it = getWaitlist.begin(); w_it != w_end; w_it++) {
-			const GetWaiter &waiter = *w_it;
+		foreach (const string &appGroupName, snapshot->getWaitlist) {
 			result << "<item>";
-			result << "<app_group_name>" << escapeForXml(waiter.options.getAppGroupName()) << "</app_group_name>";
+			result << "<app_group_name>" << escapeForXml(appGroupName) << "</app_group_name>";
 			result << "</item>";
 		}
 		result << "</get_wait_list>";
 	}
 
 	result << "<supergroups>";
-	while (*g_it != NULL) {
-		const GroupPtr &group = g_it.getValue();
-		if (!group->authorizeByUid(options.uid)
-		 && !group->authorizeByApiKey(options.apiKey))
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		if (!group.authorizeByUid(options.uid)
+		 && !group.authorizeByApiKey(options.apiKey))
 		{
-			g_it.next();
 			continue;
 		}
 
 		result << "<supergroup>";
-		result << "<name>" << escapeForXml(group->getName()) << "</name>";
+		result << "<name>" << escapeForXml(group.name) << "</name>";
 		result << "<state>READY</state>";
 		result << "<get_wait_list_size>0</get_wait_list_size>";
-		result << "<capacity_used>" << group->capacityUsed() << "</capacity_used>";
+		result << "<capacity_used>" << group.capacityUsed << "</capacity_used>";
 		if (options.secrets) {
-			result << "<secret>" << escapeForXml(group->getApiKey().toStaticString()) << "</secret>";
+			result << "<secret>" << escapeForXml(group.apiKey.toStaticString()) << "</secret>";
 		}
 
 		result << "<group default=\"true\">";
-		group->inspectXml(result, options.secrets);
+		group.inspectXml(result, options.secrets);
 		result << "</group>";
 
 		result << "</supergroup>";
-
-		g_it.next();
 	}
 	result << "</supergroups>";
 
@@ -260,40 +297,32 @@ Pool::toXml(const ToXmlOptions &options, bool lock) const {
 
 Json::Value
 Pool::inspectPropertiesInAdminPanelFormat(const ToJsonOptions &options) const {
-	ScopedLock l(syncher);
+	PoolSnapshotPtr snapshot = getSnapshot();
 	Json::Value result(Json::objectValue);
-	GroupMap::ConstIterator g_it(groups);
-	ProcessList::const_iterator p_it;
 
-	if (!authorizeByUid(options.uid, false)
-	 && !authorizeByApiKey(options.apiKey, false))
+	if (!snapshot->authorizeByUid(options.uid)
+	 && !snapshot->authorizeByApiKey(options.apiKey))
 	{
 		throw SecurityException("Operation unauthorized");
 	}
 
-	while (*g_it != NULL) {
-		const GroupPtr &group = g_it.getValue();
-
+	foreach (const GroupSnapshot &group, snapshot->groups) {
 		if (options.hasApplicationIdsFilter) {
 			const bool *tmp;
-			if (!options.applicationIdsFilter.lookup(group->info.name, &tmp)) {
-				g_it.next();
+			if (!options.applicationIdsFilter.lookup(group.name, &tmp)) {
 				continue;
 			}
 		}
 
-		if (!group->authorizeByUid(options.uid)
-		 && !group->authorizeByApiKey(options.apiKey))
+		if (!group.authorizeByUid(options.uid)
+		 && !group.authorizeByApiKey(options.apiKey))
 		{
-			g_it.next();
 			continue;
 		}
 
 		Json::Value groupDoc(Json::objectValue);
-		group->inspectPropertiesInAdminPanelFormat(groupDoc);
-		result[group->info.name] = groupDoc;
-
-		g_it.next();
+		group.inspectPropertiesInAdminPanelFormat(groupDoc);
+		result[group.name] = groupDoc;
 	}
 
 	return result;
@@ -301,45 +330,215 @@ Pool::inspectPropertiesInAdminPanelFormat(const ToJsonOptions &options) const {
 
 Json::Value
 Pool::inspectConfigInAdminPanelFormat(const ToJsonOptions &options) const {
-	ScopedLock l(syncher);
+	PoolSnapshotPtr snapshot = getSnapshot();
 	Json::Value result(Json::objectValue);
-	GroupMap::ConstIterator g_it(groups);
-	ProcessList::const_iterator p_it;
 
-	if (!authorizeByUid(options.uid, false)
-	 && !authorizeByApiKey(options.apiKey, false))
+	if (!snapshot->authorizeByUid(options.uid)
+	 && !snapshot->authorizeByApiKey(options.apiKey))
 	{
 		throw SecurityException("Operation unauthorized");
 	}
 
-	while (*g_it != NULL) {
-		const GroupPtr &group = g_it.getValue();
-
+	foreach (const GroupSnapshot &group, snapshot->groups) {
 		if (options.hasApplicationIdsFilter) {
 			const bool *tmp;
-			if (!options.applicationIdsFilter.lookup(group->info.name, &tmp)) {
-				g_it.next();
+			if (!options.applicationIdsFilter.lookup(group.name, &tmp)) {
 				continue;
 			}
 		}
 
-		if (!group->authorizeByUid(options.uid)
-		 && !group->authorizeByApiKey(options.apiKey))
+		if (!group.authorizeByUid(options.uid)
+		 && !group.authorizeByApiKey(options.apiKey))
 		{
-			g_it.next();
 			continue;
 		}
 
 		Json::Value groupDoc(Json::objectValue);
-		group->inspectConfigInAdminPanelFormat(groupDoc);
-		result[group->info.name] = groupDoc;
-
-		g_it.next();
+		group.inspectConfigInAdminPanelFormat(groupDoc);
+		result[group.name] = groupDoc;
 	}
 
 	return result;
 }
 
+/**
+ * Writes the state of all groups and processes in the OpenMetrics format,
+ * for the `/metrics` API endpoint. Like the other state inspection
+ * functions, this works on a snapshot of the pool state.
+ */
+void
+Pool::writeMetrics(OpenMetricsWriter &writer) const {
+	// In microseconds.
+	static const boost::uint64_t spawnDurationBuckets[] = {
+		100000, 250000, 500000, 1000000, 2500000, 5000000,
+		10000000, 30000000, 60000000, 120000000
+	};
+	// In microseconds.
+	static const boost::uint64_t queueTimeBuckets[] = {
+		1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+		1000000, 2500000, 5000000, 10000000
+	};
+	PoolSnapshotPtr snapshot = getSnapshot();
+
+	writer.declare("passenger_pool_max_processes", "gauge",
+		"The maximum number of processes in the pool.");
+	writer.sample("passenger_pool_max_processes", "", snapshot->max);
+	writer.declare("passenger_pool_processes", "gauge",
+		"The number of processes in the pool.");
+	writer.sample("passenger_pool_processes", "", snapshot->processCount);
+	writer.declare("passenger_pool_capacity_used", "gauge",
+		"The number of processes in the pool, including the ones being spawned.");
+	writer.sample("passenger_pool_capacity_used", "", snapshot->capacityUsed);
+	writer.declare("passenger_pool_queue_length", "gauge",
+		"The number of requests waiting for the pool to have capacity for a new group.");
+	writer.sample("passenger_pool_queue_length", "",
+		(unsigned int) snapshot->getWaitlist.size());
+
+	writer.declare("passenger_group_queue_length", "gauge",
+		"The number of requests waiting for a process.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_queue_length",
+			OpenMetricsWriter::label("group", group.name),
+			group.getWaitlistSize);
+	}
+
+	writer.declare("passenger_group_processes", "gauge",
+		"The number of enabled, disabling and disabled processes.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_processes",
+			OpenMetricsWriter::label("group", group.name),
+			group.enabledCount + group.disablingCount + group.disabledCount);
+	}
+
+	writer.declare("passenger_group_processes_being_spawned", "gauge",
+		"The number of processes that are being spawned.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_processes_being_spawned",
+			OpenMetricsWriter::label("group", group.name),
+			group.processesBeingSpawned);
+	}
+
+	writer.declare("passenger_group_spawns", "counter",
+		"The number of spawn attempts.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_spawns_total",
+			OpenMetricsWriter::labels("group", group.name, "result", "success"),
+			group.spawnsSucceeded);
+		writer.sample("passenger_group_spawns_total",
+			OpenMetricsWriter::labels("group", group.name, "result", "failure"),
+			group.spawnsFailed);
+	}
+
+	writer.declare("passenger_group_spawn_duration_seconds", "histogram",
+		"How long spawn attempts took.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.histogram("passenger_group_spawn_duration_seconds",
+			OpenMetricsWriter::label("group", group.name),
+			group.spawnDurations, spawnDurationBuckets,
+			sizeof(spawnDurationBuckets) / sizeof(boost::uint64_t), 1000000);
+	}
+
+	writer.declare("passenger_group_request_timeouts", "counter",
+		"The number of requests that exceeded max_request_time.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_request_timeouts_total",
+			OpenMetricsWriter::label("group", group.name),
+			group.requestTimeouts);
+	}
+
+	writer.declare("passenger_group_queue_time_seconds", "histogram",
+		"How long requests waited for a process.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.histogram("passenger_group_queue_time_seconds",
+			OpenMetricsWriter::label("group", group.name),
+			group.queueTimes, queueTimeBuckets,
+			sizeof(queueTimeBuckets) / sizeof(boost::uint64_t), 1000000);
+	}
+
+	writer.declare("passenger_group_request_queue_timeouts", "counter",
+		"The number of queued requests that were failed because they exceeded"
+		" request_queue_target_delay while the request queue was overloaded.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_request_queue_timeouts_total",
+			OpenMetricsWriter::label("group", group.name),
+			group.requestQueueTimeouts);
+	}
+
+	writer.declare("passenger_group_cancelled_queued_requests", "counter",
+		"The number of queued requests that were removed from the queue"
+		" because their client went away.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_cancelled_queued_requests_total",
+			OpenMetricsWriter::label("group", group.name),
+			group.cancelledGetWaiters);
+	}
+
+	writer.declare("passenger_group_memory_limit_restarts", "counter",
+		"The number of processes that were restarted because they exceeded memory_limit.");
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		writer.sample("passenger_group_memory_limit_restarts_total",
+			OpenMetricsWriter::label("group", group.name),
+			group.memoryLimitRestarts);
+	}
+
+	// Every process metric family is written separately, so
+	// format the process labels only once.
+	vector< pair<string, const ProcessSnapshot *> > processes;
+	foreach (const GroupSnapshot &group, snapshot->groups) {
+		const ProcessSnapshotList *lists[] = {
+			&group.enabledProcesses,
+			&group.disablingProcesses,
+			&group.disabledProcesses,
+			&group.detachedProcesses
+		};
+		for (unsigned int i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+			foreach (const ProcessSnapshot &process, *lists[i]) {
+				processes.push_back(make_pair(
+					OpenMetricsWriter::labels("group", group.name,
+						"pid", toString(process.pid)),
+					&process));
+			}
+		}
+	}
+
+	vector< pair<string, const ProcessSnapshot *> >::const_iterator it,
+		end = processes.end();
+
+	writer.declare("passenger_process_sessions", "gauge",
+		"The number of requests that a process is handling.");
+	for (it = processes.begin(); it != end; it++) {
+		writer.sample("passenger_process_sessions", it->first, it->second->sessions);
+	}
+
+	writer.declare("passenger_process_busyness", "gauge",
+		"How busy a process is. INT_MAX means that it cannot handle more requests.");
+	for (it = processes.begin(); it != end; it++) {
+		writer.sample("passenger_process_busyness", it->first, it->second->busyness);
+	}
+
+	writer.declare("passenger_process_concurrency_limit", "gauge",
+		"The maximum number of requests that a process currently accepts."
+		" 0 means unlimited.");
+	for (it = processes.begin(); it != end; it++) {
+		writer.sample("passenger_process_concurrency_limit", it->first,
+			it->second->effectiveConcurrency);
+	}
+
+	writer.declare("passenger_process_requests", "counter",
+		"The number of requests that a process has handled.");
+	for (it = processes.begin(); it != end; it++) {
+		writer.sample("passenger_process_requests_total", it->first, it->second->processed);
+	}
+
+	writer.declare("passenger_process_memory_bytes", "gauge",
+		"The real memory usage of a process.");
+	for (it = processes.begin(); it != end; it++) {
+		if (it->second->metrics.isValid()) {
+			writer.sample("passenger_process_memory_bytes", it->first,
+				(boost::uint64_t) it->second->metrics.realMemory() * 1024);
+		}
+	}
+}
 
 Json::Value
 Pool::makeSingleValueJsonConfigFormat(const Json::Value &val, const Json::Value &defaultValue) {
@@ -42,6 +42,8 @@
 #include <cstring>
 #include <Constants.h>
 #include <FileDescriptor.h>
+#include <Algorithms/AdaptiveConcurrencyLimit.h>
+#include <DataStructures/DeadlineHeap.h>
 #include <LoggingKit/LoggingKit.h>
 #include <Utils/SystemTime.h>
 #include <Utils/StrIntUtils.h>
@@ -105,6 +107,8 @@ public:
 	static const unsigned int MAX_SESSION_SOCKETS = 3;
 
 private:
+	friend struct ProcessSnapshot;
+
 	/*************************************************************
 	 * Read-only fields, set once during initialization and never
 	 * written to again. Reading is thread-safe.
@@ -368,6 +372,18 @@ public:
 	int sessions;
 	/** Number of sessions opened so far. */
 	unsigned int processed;
+	/**
+	 * A random number between 0 and `options.maxRequestsJitter`, chosen when
+	 * this process is attached. The process is recycled after
+	 * `options.maxRequests` plus this many requests, so that processes that
+	 * were spawned together don't all reach their limit at the same time.
+	 */
+	unsigned int maxRequestsJitter;
+	/**
+	 * Adjusts the effective concurrency of this process based on its
+	 * response latency. Disabled unless enableAdaptiveConcurrency() is called.
+	 */
+	AdaptiveConcurrencyLimit adaptiveConcurrencyLimit;
 	/** Do not access directly, always use `isAlive()`/`isDead()`/`getLifeStatus()` or
 	 * through `lifetimeSyncher`. */
 	enum LifeStatus {
@@ -419,10 +435,33 @@ public:
 	/** Caches whether or not the OS process still exists. */
 	mutable bool m_osProcessExists: 1;
 	bool longRunningConnectionsAborted: 1;
+	/**
+	 * Set when a request to this process exceeded `maxRequestTime`. Such a
+	 * process is killed HUNG_PROCESS_SHUTDOWN_TIMEOUT seconds after its
+	 * shutdown is triggered, instead of PROCESS_SHUTDOWN_TIMEOUT.
+	 */
+	bool hung: 1;
+	/**
+	 * Set while this process is being disabled and detached because it
+	 * exceeded `memoryLimit`. See Group::checkMemoryLimit().
+	 */
+	bool exceededMemoryLimit: 1;
+	/**
+	 * Set when this process has reached its maximum number of requests and
+	 * a replacement is being spawned. It keeps handling requests until the
+	 * replacement is attached, and is then detached.
+	 * See Group::recycleBeforeDetaching().
+	 */
+	bool recycling: 1;
 	/** Time at which shutdown began. */
 	time_t shutdownStartTime;
 	/** Collected by Pool::collectAnalytics(). */
 	ProcessMetrics metrics;
+	/**
+	 * Links this process into Pool::idleProcesses while it is enabled.
+	 * See Pool::scheduleIdleProcessGc().
+	 */
+	DeadlineHeapEntry idleGcEntry;
 
 
 	Process(const BasicGroupInfo *groupInfo, const Json::Value &json)
@@ -438,13 +477,18 @@ public:
 		  lastUsed(spawnEndTime),
 		  sessions(0),
 		  processed(0),
+		  maxRequestsJitter(0),
 		  lifeStatus(ALIVE),
 		  enabled(ENABLED),
 		  oobwStatus(OOBW_NOT_ACTIVE),
 		  m_osProcessExists(true),
 		  longRunningConnectionsAborted(false),
+		  hung(false),
+		  exceededMemoryLimit(false),
+		  recycling(false),
 		  shutdownStartTime(0)
 	{
+		idleGcEntry.userData = this;
 		initializeSocketsAndStringFields(json);
 		indexSessionSockets();
 
@@ -488,6 +532,35 @@ public:
 		}
 	}
 
+	/**
+	 * Makes the number of concurrent sessions that this process accepts
+	 * follow its response latency, up to `concurrency`. If `concurrency`
+	 * is 0 (unlimited) then the limit starts at ADAPTIVE_CONCURRENCY_INITIAL_LIMIT
+	 * and grows to at most ADAPTIVE_CONCURRENCY_MAX_LIMIT. Has no effect on
+	 * processes with a concurrency of 1.
+	 */
+	void enableAdaptiveConcurrency() {
+		if (concurrency == 0) {
+			adaptiveConcurrencyLimit.reset(ADAPTIVE_CONCURRENCY_INITIAL_LIMIT,
+				ADAPTIVE_CONCURRENCY_MAX_LIMIT);
+		} else if (concurrency > 1) {
+			adaptiveConcurrencyLimit.reset(concurrency, concurrency);
+		}
+	}
+
+	/**
+	 * The maximum number of concurrent sessions this process currently
+	 * accepts. This is `concurrency`, unless adaptive concurrency is enabled.
+	 * 0 means unlimited.
+	 */
+	int getEffectiveConcurrency() const {
+		if (adaptiveConcurrencyLimit.enabled()) {
+			return adaptiveConcurrencyLimit.get();
+		} else {
+			return concurrency;
+		}
+	}
+
 	void shutdownNotRequired() {
 		requiresShutdown = false;
 	}
@@ -562,8 +635,21 @@ public:
 		}
 	}
 
+	/**
+	 * Marks this process as hung. Its shutdown timeout starts counting
+	 * immediately, even if it still has sessions open, so that the detached
+	 * processes checker kills it without waiting for those sessions.
+	 */
+	void markHung() {
+		time_t now = SystemTime::get();
+		oxt::spin_lock::scoped_lock lock(lifetimeSyncher);
+		hung = true;
+		shutdownStartTime = now;
+	}
+
 	bool shutdownTimeoutExpired() const {
-		return SystemTime::get() >= shutdownStartTime + PROCESS_SHUTDOWN_TIMEOUT;
+		time_t timeout = hung ? HUNG_PROCESS_SHUTDOWN_TIMEOUT : PROCESS_SHUTDOWN_TIMEOUT;
+		return SystemTime::get() >= shutdownStartTime + timeout;
 	}
 
 	bool canCleanup() const {
@@ -712,10 +798,14 @@ public:
 		 * of processes with concurrency > 0 is usually higher than that of processes
 		 * with concurrency == 0.
 		 */
-		if (concurrency == 0) {
+		int effectiveConcurrency = getEffectiveConcurrency();
+		if (effectiveConcurrency == 0) {
 			return sessions;
+		} else if (sessions >= effectiveConcurrency) {
+			// The adaptive limit may drop below the number of open sessions.
+			return INT_MAX;
 		} else {
-			return (int) (((long long) sessions * INT_MAX) / (double) concurrency);
+			return (int) (((long long) sessions * INT_MAX) / (double) effectiveConcurrency);
 		}
 	}
 
@@ -724,7 +814,8 @@ public:
 	 * process.
 	 */
 	bool isTotallyBusy() const {
-		return concurrency != 0 && sessions >= concurrency;
+		int effectiveConcurrency = getEffectiveConcurrency();
+		return effectiveConcurrency != 0 && sessions >= effectiveConcurrency;
 	}
 
 	/**
@@ -789,7 +880,7 @@ public:
 		LockGuard l(context->getMmSyncher());
 		Session *session = context->getSessionObjectPool().malloc();
 		Guard guard(context, session);
-		session = new (session) Session(context, &info, socket);
+		session = new (session) Session(context, &info, socket, lastUsed);
 		guard.clear();
 		return SessionPtr(session, false);
 	}
@@ -803,7 +894,15 @@ public:
 		socket->sessions--;
 		this->sessions--;
 		processed++;
-		assert(!isTotallyBusy());
+		if (adaptiveConcurrencyLimit.enabled()) {
+			unsigned long long now = SystemTime::getUsec();
+			unsigned long long checkoutTime = session->getCheckoutTime();
+			adaptiveConcurrencyLimit.update(
+				(now > checkoutTime) ? now - checkoutTime : 0,
+				sessions);
+		} else {
+			assert(!isTotallyBusy());
+		}
 	}
 
 	/**
@@ -819,83 +918,6 @@ public:
 		result << "(pid=" << getPid() << ", group=" << getGroupName() << ")";
 		return result.str();
 	}
-
-	template<typename Stream>
-	void inspectXml(Stream &stream, bool includeSockets = true) const {
-		stream << "<pid>" << getPid() << "</pid>";
-		stream << "<sticky_session_id>" << getStickySessionId() << "</sticky_session_id>";
-		stream << "<gupid>" << getGupid() << "</gupid>";
-		stream << "<concurrency>" << concurrency << "</concurrency>";
-		stream << "<sessions>" << sessions << "</sessions>";
-		stream << "<busyness>" << busyness() << "</busyness>";
-		stream << "<processed>" << processed << "</processed>";
-		stream << "<spawner_creation_time>" << spawnerCreationTime << "</spawner_creation_time>";
-		stream << "<spawn_start_time>" << spawnStartTime << "</spawn_start_time>";
-		stream << "<spawn_end_time>" << spawnEndTime << "</spawn_end_time>";
-		stream << "<last_used>" << lastUsed << "</last_used>";
-		stream << "<last_used_desc>" << distanceOfTimeInWords(lastUsed / 1000000).c_str() << " ago</last_used_desc>";
-		stream << "<uptime>" << uptime() << "</uptime>";
-		if (!codeRevision.empty()) {
-			stream << "<code_revision>" << escapeForXml(codeRevision) << "</code_revision>";
-		}
-		switch (lifeStatus) {
-		case ALIVE:
-			stream << "<life_status>ALIVE</life_status>";
-			break;
-		case SHUTDOWN_TRIGGERED:
-			stream << "<life_status>SHUTDOWN_TRIGGERED</life_status>";
-			break;
-		case DEAD:
-			stream << "<life_status>DEAD</life_status>";
-			break;
-		default:
-			P_BUG("Unknown 'lifeStatus' state " << (int) lifeStatus);
-		}
-		switch (enabled) {
-		case ENABLED:
-			stream << "<enabled>ENABLED</enabled>";
-			break;
-		case DISABLING:
-			stream << "<enabled>DISABLING</enabled>";
-			break;
-		case DISABLED:
-			stream << "<enabled>DISABLED</enabled>";
-			break;
-		case DETACHED:
-			stream << "<enabled>DETACHED</enabled>";
-			break;
-		default:
-			P_BUG("Unknown 'enabled' state " << (int) enabled);
-		}
-		if (metrics.isValid()) {
-			stream << "<has_metrics>true</has_metrics>";
-			stream << "<cpu>" << (int) metrics.cpu << "</cpu>";
-			stream << "<rss>" << metrics.rss << "</rss>";
-			stream << "<pss>" << metrics.pss << "</pss>";
-			stream << "<private_dirty>" << metrics.privateDirty << "</private_dirty>";
-			stream << "<swap>" << metrics.swap << "</swap>";
-			stream << "<real_memory>" << metrics.realMemory() << "</real_memory>";
-			stream << "<vmsize>" << metrics.vmsize << "</vmsize>";
-			stream << "<process_group_id>" << metrics.processGroupId << "</process_group_id>";
-			stream << "<command>" << escapeForXml(metrics.command) << "</command>";
-		}
-		if (includeSockets) {
-			SocketList::const_iterator it;
-
-			stream << "<sockets>";
-			for (it = sockets.begin(); it != sockets.end(); it++) {
-				const Socket &socket = *it;
-				stream << "<socket>";
-				stream << "<name>" << escapeForXml(socket.name) << "</name>";
-				stream << "<address>" << escapeForXml(socket.address) << "</address>";
-				stream << "<protocol>" << escapeForXml(socket.protocol) << "</protocol>";
-				stream << "<concurrency>" << socket.concurrency << "</concurrency>";
-				stream << "<sessions>" << socket.sessions << "</sessions>";
-				stream << "</socket>";
-			}
-			stream << "</sockets>";
-		}
-	}
 };
 
 
@@ -0,0 +1,226 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_APPLICATION_POOL2_RESTART_FILE_WATCHER_H_
+#define _PASSENGER_APPLICATION_POOL2_RESTART_FILE_WATCHER_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <oxt/thread.hpp>
+#include <oxt/system_calls.hpp>
+#include <oxt/backtrace.hpp>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <Constants.h>
+#include <LoggingKit/LoggingKit.h>
+#include <Utils/CachedFileStat.hpp>
+#include <Utils/IOUtils.h>
+
+namespace Passenger {
+namespace ApplicationPool2 {
+
+using namespace std;
+
+
+/**
+ * Watches the restart.txt and always_restart.txt files of Groups in a
+ * background thread, so that `Group::needsRestart()` only has to read a
+ * flag instead of calling stat() on the request path.
+ *
+ * The files are checked through a CachedFileStat in inotify mode, so changes
+ * are noticed as soon as they happen. Files that cannot be watched (see
+ * CachedFileStat) are checked every `statThrottleRate` seconds instead.
+ * Only available on Linux; elsewhere `watch()` returns NULL and Groups
+ * stat() the files themselves.
+ */
+class RestartFileWatcher: public boost::noncopyable {
+public:
+	/**
+	 * How often the background thread wakes up in the absence of
+	 * filesystem events, in order to check files that cannot be watched.
+	 * In milliseconds.
+	 */
+	static const unsigned int CHECK_INTERVAL = 1000;
+
+	/** The restart file state of a single Group. */
+	struct Registration {
+		const string restartFile;
+		const string alwaysRestartFile;
+		const unsigned int throttleRate;
+		/** Only accessed with the watcher's lock held. */
+		time_t lastRestartFileMtime;
+
+		/**
+		 * Set when restart.txt is created or its mtime changes. The Group
+		 * clears it when it acts on it.
+		 */
+		boost::atomic<bool> restartFileChanged;
+		boost::atomic<bool> alwaysRestartFileExists;
+
+		Registration(const string &_restartFile, const string &_alwaysRestartFile,
+			unsigned int _throttleRate)
+			: restartFile(_restartFile),
+			  alwaysRestartFile(_alwaysRestartFile),
+			  throttleRate(_throttleRate),
+			  lastRestartFileMtime(0),
+			  restartFileChanged(false),
+			  alwaysRestartFileExists(false)
+			{ }
+	};
+
+	typedef boost::shared_ptr<Registration> RegistrationPtr;
+
+private:
+	boost::mutex syncher;
+	CachedFileStat cstat;
+	vector< boost::weak_ptr<Registration> > registrations;
+	oxt::thread *thr;
+	bool inotifySupported;
+
+	void check(Registration &reg) {
+		struct stat buf;
+
+		if (cstat.stat(reg.restartFile, &buf, reg.throttleRate) == 0) {
+			if (buf.st_mtime != reg.lastRestartFileMtime) {
+				reg.lastRestartFileMtime = buf.st_mtime;
+				reg.restartFileChanged.store(true, boost::memory_order_release);
+			}
+		} else {
+			reg.lastRestartFileMtime = 0;
+		}
+		reg.alwaysRestartFileExists.store(
+			cstat.stat(reg.alwaysRestartFile, &buf, reg.throttleRate) == 0,
+			boost::memory_order_release);
+	}
+
+	void checkAll() {
+		boost::lock_guard<boost::mutex> l(syncher);
+		vector< boost::weak_ptr<Registration> >::iterator it = registrations.begin();
+
+		// Also consumes events for files that are no longer registered.
+		cstat.processEvents();
+
+		while (it != registrations.end()) {
+			RegistrationPtr reg = it->lock();
+			if (reg == NULL) {
+				it = registrations.erase(it);
+			} else {
+				check(*reg);
+				it++;
+			}
+		}
+	}
+
+	void threadMain() {
+		TRACE_POINT();
+		try {
+			while (!boost::this_thread::interruption_requested()) {
+				int fd;
+				{
+					boost::lock_guard<boost::mutex> l(syncher);
+					fd = cstat.getInotifyFd();
+				}
+
+				UPDATE_TRACE_POINT();
+				unsigned long long timeout = CHECK_INTERVAL * 1000;
+				if (fd == -1) {
+					syscalls::usleep(timeout);
+				} else {
+					waitUntilReadable(fd, &timeout);
+				}
+
+				UPDATE_TRACE_POINT();
+				checkAll();
+			}
+		} catch (const boost::thread_interrupted &) {
+			// Return.
+		} catch (const tracable_exception &e) {
+			P_WARN("ERROR: " << e.what() << "\n  Backtrace:\n" << e.backtrace());
+		}
+	}
+
+public:
+	RestartFileWatcher()
+		: thr(NULL)
+	{
+		inotifySupported = cstat.enableInotify();
+	}
+
+	~RestartFileWatcher() {
+		if (thr != NULL) {
+			boost::this_thread::disable_interruption di;
+			boost::this_thread::disable_syscall_interruption dsi;
+			thr->interrupt_and_join();
+			delete thr;
+		}
+	}
+
+	/**
+	 * Starts watching the given restart files, until the returned object
+	 * is destroyed. Their current state is treated as the initial state:
+	 * an existing restart.txt does not cause a restart. Returns NULL if
+	 * watching is not supported on this platform.
+	 */
+	RegistrationPtr watch(const string &restartFile, const string &alwaysRestartFile,
+		unsigned int throttleRate)
+	{
+		if (!inotifySupported) {
+			return RegistrationPtr();
+		}
+
+		RegistrationPtr reg = boost::make_shared<Registration>(restartFile,
+			alwaysRestartFile, throttleRate);
+		boost::lock_guard<boost::mutex> l(syncher);
+		check(*reg);
+		reg->restartFileChanged.store(false, boost::memory_order_relaxed);
+		registrations.push_back(reg);
+
+		if (thr == NULL) {
+			thr = new oxt::thread(
+				boost::bind(&RestartFileWatcher::threadMain, this),
+				"Restart file watcher",
+				POOL_HELPER_THREAD_STACK_SIZE
+			);
+		}
+		return reg;
+	}
+};
+
+typedef RestartFileWatcher::RegistrationPtr RestartFileWatchPtr;
+
+
+} // namespace ApplicationPool2
+} // namespace Passenger
+
+#endif /* _PASSENGER_APPLICATION_POOL2_RESTART_FILE_WATCHER_H_ */
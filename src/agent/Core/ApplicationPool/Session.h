@@ -87,6 +87,8 @@ private:
 	Connection connection;
 	mutable boost::atomic<int> refcount;
 	bool closed;
+	/** When this session was checked out, in microseconds. */
+	unsigned long long checkoutTime;
 
 	void deinitiate(bool success, bool wantKeepAlive) {
 		connection.fail = !success;
@@ -118,12 +120,14 @@ public:
 	Callback onInitiateFailure;
 	Callback onClose;
 
-	Session(Context *_context, const BasicProcessInfo *_processInfo, Socket *_socket)
+	Session(Context *_context, const BasicProcessInfo *_processInfo, Socket *_socket,
+		unsigned long long _checkoutTime = 0)
 		: context(_context),
 		  processInfo(_processInfo),
 		  socket(_socket),
 		  refcount(1),
 		  closed(false),
+		  checkoutTime(_checkoutTime),
 		  onInitiateFailure(NULL),
 		  onClose(NULL)
 		{ }
@@ -176,6 +180,10 @@ public:
 		return socket;
 	}
 
+	unsigned long long getCheckoutTime() const {
+		return checkoutTime;
+	}
+
 	virtual StaticString getProtocol() const {
 		return getSocket()->protocol;
 	}
@@ -224,6 +232,7 @@ public:
 	}
 
 	virtual void requestOOBW();
+	virtual void reportRequestTimeout(bool captureBacktrace);
 
 
 	virtual void ref() const {
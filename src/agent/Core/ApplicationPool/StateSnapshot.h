@@ -0,0 +1,326 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_APPLICATION_POOL2_STATE_SNAPSHOT_H_
+#define _PASSENGER_APPLICATION_POOL2_STATE_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <sys/types.h>
+#include <unistd.h>
+#include <jsoncpp/json.h>
+#include <LoggingKit/LoggingKit.h>
+#include <Utils/StrIntUtils.h>
+#include <Utils/SystemTime.h>
+#include <Utils/ProcessMetricsCollector.h>
+#include <Algorithms/Histogram.h>
+#include <Core/ApplicationPool/Options.h>
+#include <Core/ApplicationPool/Process.h>
+#include <Core/ApplicationPool/Group.h>
+#include <Shared/ApplicationPoolApiKey.h>
+
+namespace Passenger {
+namespace ApplicationPool2 {
+
+using namespace std;
+
+
+/*
+ * Immutable copies of the Pool's state, used by the state inspection
+ * functions (`Pool::inspect()`, `Pool::toXml()`, the admin panel exports).
+ * A snapshot is created with the pool lock held, but formatting it, which
+ * is much more expensive (think of user database lookups), happens without
+ * holding the lock.
+ */
+
+
+struct ProcessSnapshot {
+	struct SocketInfo {
+		string name;
+		string address;
+		string protocol;
+		int concurrency;
+		int sessions;
+	};
+
+	pid_t pid;
+	unsigned int stickySessionId;
+	string gupid;
+	int concurrency;
+	int effectiveConcurrency;
+	int sessions;
+	int busyness;
+	bool adaptiveConcurrency;
+	/** Average response latencies in microseconds, if adaptiveConcurrency. */
+	double shortTermLatency;
+	double longTermLatency;
+	unsigned int processed;
+	unsigned long long spawnerCreationTime;
+	unsigned long long spawnStartTime;
+	unsigned long long spawnEndTime;
+	unsigned long long lastUsed;
+	string codeRevision;
+	Process::LifeStatus lifeStatus;
+	Process::EnabledStatus enabled;
+	ProcessMetrics metrics;
+	vector<SocketInfo> sockets;
+
+	ProcessSnapshot(const Process &process)
+		: pid(process.getPid()),
+		  stickySessionId(process.getStickySessionId()),
+		  gupid(process.getGupid().data(), process.getGupid().size()),
+		  concurrency(process.concurrency),
+		  effectiveConcurrency(process.getEffectiveConcurrency()),
+		  sessions(process.sessions),
+		  busyness(process.busyness()),
+		  adaptiveConcurrency(process.adaptiveConcurrencyLimit.enabled()),
+		  shortTermLatency(process.adaptiveConcurrencyLimit.getShortTermLatency()),
+		  longTermLatency(process.adaptiveConcurrencyLimit.getLongTermLatency()),
+		  processed(process.processed),
+		  spawnerCreationTime(process.spawnerCreationTime),
+		  spawnStartTime(process.spawnStartTime),
+		  spawnEndTime(process.spawnEndTime),
+		  lastUsed(process.lastUsed),
+		  codeRevision(process.codeRevision.data(), process.codeRevision.size()),
+		  lifeStatus(process.lifeStatus),
+		  enabled(process.enabled),
+		  metrics(process.metrics)
+	{
+		SocketList::const_iterator it, end = process.sockets.end();
+		sockets.reserve(process.sockets.size());
+		for (it = process.sockets.begin(); it != end; it++) {
+			SocketInfo info;
+			info.name = it->name;
+			info.address = it->address;
+			info.protocol = it->protocol;
+			info.concurrency = it->concurrency;
+			info.sessions = it->sessions;
+			sockets.push_back(info);
+		}
+	}
+
+	const SocketInfo *findSocketWithName(const StaticString &name) const {
+		vector<SocketInfo>::const_iterator it, end = sockets.end();
+		for (it = sockets.begin(); it != end; it++) {
+			if (it->name == name) {
+				return &(*it);
+			}
+		}
+		return NULL;
+	}
+
+	string uptime() const {
+		return distanceOfTimeInWords(spawnEndTime / 1000000);
+	}
+
+	template<typename Stream>
+	void inspectXml(Stream &stream, bool includeSockets = true) const {
+		stream << "<pid>" << pid << "</pid>";
+		stream << "<sticky_session_id>" << stickySessionId << "</sticky_session_id>";
+		stream << "<gupid>" << gupid << "</gupid>";
+		stream << "<concurrency>" << concurrency << "</concurrency>";
+		stream << "<effective_concurrency>" << effectiveConcurrency << "</effective_concurrency>";
+		if (adaptiveConcurrency && longTermLatency >= 0) {
+			stream << "<short_term_latency>" << (unsigned long long) shortTermLatency << "</short_term_latency>";
+			stream << "<long_term_latency>" << (unsigned long long) longTermLatency << "</long_term_latency>";
+		}
+		stream << "<sessions>" << sessions << "</sessions>";
+		stream << "<busyness>" << busyness << "</busyness>";
+		stream << "<processed>" << processed << "</processed>";
+		stream << "<spawner_creation_time>" << spawnerCreationTime << "</spawner_creation_time>";
+		stream << "<spawn_start_time>" << spawnStartTime << "</spawn_start_time>";
+		stream << "<spawn_end_time>" << spawnEndTime << "</spawn_end_time>";
+		stream << "<last_used>" << lastUsed << "</last_used>";
+		stream << "<last_used_desc>" << distanceOfTimeInWords(lastUsed / 1000000).c_str() << " ago</last_used_desc>";
+		stream << "<uptime>" << uptime() << "</uptime>";
+		if (!codeRevision.empty()) {
+			stream << "<code_revision>" << escapeForXml(codeRevision) << "</code_revision>";
+		}
+		switch (lifeStatus) {
+		case Process::ALIVE:
+			stream << "<life_status>ALIVE</life_status>";
+			break;
+		case Process::SHUTDOWN_TRIGGERED:
+			stream << "<life_status>SHUTDOWN_TRIGGERED</life_status>";
+			break;
+		case Process::DEAD:
+			stream << "<life_status>DEAD</life_status>";
+			break;
+		default:
+			P_BUG("Unknown 'lifeStatus' state " << (int) lifeStatus);
+		}
+		switch (enabled) {
+		case Process::ENABLED:
+			stream << "<enabled>ENABLED</enabled>";
+			break;
+		case Process::DISABLING:
+			stream << "<enabled>DISABLING</enabled>";
+			break;
+		case Process::DISABLED:
+			stream << "<enabled>DISABLED</enabled>";
+			break;
+		case Process::DETACHED:
+			stream << "<enabled>DETACHED</enabled>";
+			break;
+		default:
+			P_BUG("Unknown 'enabled' state " << (int) enabled);
+		}
+		if (metrics.isValid()) {
+			stream << "<has_metrics>true</has_metrics>";
+			stream << "<cpu>" << (int) metrics.cpu << "</cpu>";
+			stream << "<rss>" << metrics.rss << "</rss>";
+			stream << "<pss>" << metrics.pss << "</pss>";
+			stream << "<private_dirty>" << metrics.privateDirty << "</private_dirty>";
+			stream << "<swap>" << metrics.swap << "</swap>";
+			stream << "<real_memory>" << metrics.realMemory() << "</real_memory>";
+			stream << "<vmsize>" << metrics.vmsize << "</vmsize>";
+			stream << "<process_group_id>" << metrics.processGroupId << "</process_group_id>";
+			stream << "<command>" << escapeForXml(metrics.command) << "</command>";
+		}
+		if (includeSockets) {
+			vector<SocketInfo>::const_iterator it;
+
+			stream << "<sockets>";
+			for (it = sockets.begin(); it != sockets.end(); it++) {
+				const SocketInfo &socket = *it;
+				stream << "<socket>";
+				stream << "<name>" << escapeForXml(socket.name) << "</name>";
+				stream << "<address>" << escapeForXml(socket.address) << "</address>";
+				stream << "<protocol>" << escapeForXml(socket.protocol) << "</protocol>";
+				stream << "<concurrency>" << socket.concurrency << "</concurrency>";
+				stream << "<sessions>" << socket.sessions << "</sessions>";
+				stream << "</socket>";
+			}
+			stream << "</sockets>";
+		}
+	}
+};
+
+typedef vector<ProcessSnapshot> ProcessSnapshotList;
+
+
+struct GroupSnapshot {
+	string name;
+	string uuid;
+	ApiKey apiKey;
+	/** A persisted copy of the Group's options. */
+	Options options;
+	const ResourceLocator *resourceLocator;
+	unsigned int enabledCount;
+	unsigned int disablingCount;
+	unsigned int disabledCount;
+	unsigned int capacityUsed;
+	unsigned int getWaitlistSize;
+	unsigned int disableWaitlistSize;
+	unsigned int processesBeingSpawned;
+	unsigned int requestTimeouts;
+	unsigned int memoryLimitRestarts;
+	unsigned int predictedProcessCount;
+	unsigned int spawnsSucceeded;
+	unsigned int spawnsFailed;
+	Histogram spawnDurations;
+	unsigned int requestQueueTimeouts;
+	unsigned int cancelledGetWaiters;
+	Histogram queueTimes;
+	bool spawning;
+	bool restarting;
+	bool requestQueueOverloaded;
+	Group::LifeStatus lifeStatus;
+	ProcessSnapshotList enabledProcesses;
+	ProcessSnapshotList disablingProcesses;
+	ProcessSnapshotList disabledProcesses;
+	ProcessSnapshotList detachedProcesses;
+
+	/** Must be called with the pool lock held. */
+	GroupSnapshot(const Group &group);
+
+	bool authorizeByUid(uid_t uid) const;
+	bool authorizeByApiKey(const ApiKey &key) const;
+	void inspectXml(std::ostream &stream, bool includeSecrets = true) const;
+	void inspectPropertiesInAdminPanelFormat(Json::Value &result) const;
+	void inspectConfigInAdminPanelFormat(Json::Value &result) const;
+};
+
+
+struct PoolSnapshot {
+	/** Incremented every time the Pool creates a new snapshot. */
+	boost::uint64_t version;
+	MonotonicTimeUsec creationTime;
+	unsigned int max;
+	unsigned int processCount;
+	unsigned int capacityUsed;
+	/** The app group names of the requests in the Pool's getWaitlist. */
+	vector<string> getWaitlist;
+	vector<GroupSnapshot> groups;
+
+	PoolSnapshot()
+		: version(0),
+		  creationTime(0),
+		  max(0),
+		  processCount(0),
+		  capacityUsed(0)
+		{ }
+
+	/** Equivalent to `Pool::authorizeByUid()` at the time of the snapshot. */
+	bool authorizeByUid(uid_t uid) const {
+		if (uid == 0 || uid == geteuid()) {
+			return true;
+		}
+
+		vector<GroupSnapshot>::const_iterator it, end = groups.end();
+		for (it = groups.begin(); it != end; it++) {
+			if (it->authorizeByUid(uid)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Equivalent to `Pool::authorizeByApiKey()` at the time of the snapshot. */
+	bool authorizeByApiKey(const ApiKey &key) const {
+		if (key.isSuper()) {
+			return true;
+		}
+
+		vector<GroupSnapshot>::const_iterator it, end = groups.end();
+		for (it = groups.begin(); it != end; it++) {
+			if (it->apiKey == key) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+typedef boost::shared_ptr<const PoolSnapshot> PoolSnapshotPtr;
+
+
+} // namespace ApplicationPool2
+} // namespace Passenger
+
+#endif /* _PASSENGER_APPLICATION_POOL2_STATE_SNAPSHOT_H_ */
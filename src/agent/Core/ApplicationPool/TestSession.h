@@ -57,6 +57,8 @@ private:
 	mutable bool closed;
 	mutable bool success;
 	mutable bool wantKeepAlive;
+	bool requestTimedOut;
+	bool backtraceRequested;
 
 public:
 	TestSession()
@@ -67,7 +69,9 @@ public:
 		  stickySessionId(0),
 		  closed(false),
 		  success(false),
-		  wantKeepAlive(false)
+		  wantKeepAlive(false),
+		  requestTimedOut(false),
+		  backtraceRequested(false)
 		{ }
 
 	virtual void ref() const {
@@ -163,6 +167,16 @@ public:
 		return wantKeepAlive;
 	}
 
+	bool isRequestTimedOut() const {
+		boost::lock_guard<boost::mutex> l(syncher);
+		return requestTimedOut;
+	}
+
+	bool isBacktraceRequested() const {
+		boost::lock_guard<boost::mutex> l(syncher);
+		return backtraceRequested;
+	}
+
 	virtual void initiate(bool blocking = true) {
 		boost::lock_guard<boost::mutex> l(syncher);
 		connection = createUnixSocketPair(__FILE__, __LINE__);
@@ -172,6 +186,12 @@ public:
 		}
 	}
 
+	virtual void reportRequestTimeout(bool captureBacktrace) {
+		boost::lock_guard<boost::mutex> l(syncher);
+		requestTimedOut = true;
+		backtraceRequested = captureBacktrace;
+	}
+
 	virtual void close(bool _success, bool _wantKeepAlive = false) {
 		boost::lock_guard<boost::mutex> l(syncher);
 		closed = true;
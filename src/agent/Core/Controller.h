@@ -64,6 +64,7 @@
 #include <LoggingKit/LoggingKit.h>
 #include <MessageReadersWriters.h>
 #include <Constants.h>
+#include <SecureHeadersBlock.h>
 #include <ConfigKit/ConfigKit.h>
 #include <ServerKit/Errors.h>
 #include <ServerKit/HttpServer.h>
@@ -83,6 +84,7 @@
 #include <Core/Controller/Client.h>
 #include <Core/Controller/AppResponse.h>
 #include <Core/Controller/TurboCaching.h>
+#include <Core/Controller/Metrics.h>
 #include <Core/UnionStation/Context.h>
 
 namespace Passenger {
@@ -121,11 +123,16 @@ private:
 	HashedStaticString PASSENGER_APP_GROUP_NAME;
 	HashedStaticString PASSENGER_ENV_VARS;
 	HashedStaticString PASSENGER_MAX_REQUESTS;
+	HashedStaticString PASSENGER_MAX_REQUESTS_JITTER;
+	HashedStaticString PASSENGER_MAX_REQUEST_TIME;
+	HashedStaticString PASSENGER_MEMORY_LIMIT;
 	HashedStaticString PASSENGER_SHOW_VERSION_IN_HEADER;
 	HashedStaticString PASSENGER_STICKY_SESSIONS;
 	HashedStaticString PASSENGER_STICKY_SESSIONS_COOKIE_NAME;
 	HashedStaticString PASSENGER_REQUEST_OOB_WORK;
 	HashedStaticString UNION_STATION_SUPPORT;
+	HashedStaticString UNION_STATION_SAMPLE_RATE;
+	HashedStaticString UNION_STATION_SLOW_REQUEST_THRESHOLD;
 	HashedStaticString REMOTE_ADDR;
 	HashedStaticString REMOTE_PORT;
 	HashedStaticString REMOTE_USER;
@@ -139,6 +146,7 @@ private:
 	HashedStaticString HTTP_CONNECTION;
 	HashedStaticString HTTP_STATUS;
 	HashedStaticString HTTP_TRANSFER_ENCODING;
+	HashedStaticString SECURE_HEADERS_BLOCK_NAMES[PSG_SHB_ID_COUNT];
 
 	friend class TurboCaching<Request>;
 	friend class ResponseCache<Request>;
@@ -146,6 +154,18 @@ private:
 	TurboCaching<Request> turboCaching;
 	ConfigKit::Store *singleAppModeConfig;
 
+	// Union Station sampling statistics. A request with Union Station
+	// support is either sampled, or not sampled and then either promoted
+	// (because it turned out to be an error or slow) or dropped.
+	boost::uint64_t unionStationSampledRequests;
+	boost::uint64_t unionStationPromotedRequests;
+	boost::uint64_t unionStationDroppedRequests;
+	boost::uint32_t unionStationSamplingRandomState;
+
+	// Per application group name. Only accessed from the event loop thread;
+	// see collectMetrics().
+	StringKeyTable<RequestPhaseHistogramsPtr> requestPhaseHistograms;
+
 	#ifdef DEBUG_CC_EVENT_LOOP_BLOCKING
 		struct ev_prepare prepareWatcher;
 		ev_tstamp timeBeforeBlocking;
@@ -161,6 +181,9 @@ private:
 
 	struct RequestAnalysis;
 
+	bool decodeSecureHeadersBlock(Client *client, Request *req);
+	void insertSecureHeader(Request *req, const HashedStaticString &name,
+		const char *value, unsigned int size);
 	void initializeFlags(Client *client, Request *req, RequestAnalysis &analysis);
 	bool respondFromTurboCache(Client *client, Request *req);
 	void initializePoolOptions(Client *client, Request *req, RequestAnalysis &analysis);
@@ -183,6 +206,7 @@ private:
 	void createNewPoolOptions(Client *client, Request *req,
 		const HashedStaticString &appGroupName);
 	void initializeUnionStation(Client *client, Request *req, RequestAnalysis &analysis);
+	bool shouldSampleUnionStationRequest(unsigned int sampleRate);
 	void setStickySessionId(Client *client, Request *req);
 	const LString *getStickySessionCookieName(Request *req);
 
@@ -207,6 +231,8 @@ private:
 	void maybeSend100Continue(Client *client, Request *req);
 	void initiateSession(Client *client, Request *req);
 	static void checkoutSessionLater(Request *req);
+	static void onMaxRequestTimeReached(ServerKit::TimerWheelEntry *entry);
+	void maxRequestTimeReached(Client *client, Request *req);
 	void reportSessionCheckoutError(Client *client, Request *req,
 		const ExceptionPtr &e);
 	void writeRequestQueueFullExceptionErrorResponse(Client *client,
@@ -294,6 +320,8 @@ private:
 	OXT_FORCE_INLINE void keepAliveAppConnection(Client *client, Request *req);
 	void storeAppResponseInTurboCache(Client *client, Request *req);
 	void finalizeUnionStationWithSuccess(Client *client, Request *req);
+	void finalizeUnionStationCandidate(Client *client, Request *req);
+	void recordRequestPhaseTimes(Client *client, Request *req);
 
 
 	/***** Hooks ******/
@@ -391,6 +419,9 @@ public:
 
 		  turboCaching(),
 		  singleAppModeConfig(NULL),
+		  unionStationSampledRequests(0),
+		  unionStationPromotedRequests(0),
+		  unionStationDroppedRequests(0),
 		  resourceLocator(NULL)
 		  /**************************/
 	{
@@ -426,6 +457,7 @@ public:
 	virtual Json::Value inspectStateAsJson() const;
 	virtual Json::Value inspectClientStateAsJson(const Client *client) const;
 	virtual Json::Value inspectRequestStateAsJson(const Request *req) const;
+	void collectMetrics(ControllerMetrics &metrics) const;
 
 
 	/****** Miscellaneous *******/
@@ -63,8 +63,13 @@ Controller::checkoutSession(Client *client, Request *req) {
 
 	callback.func = sessionCheckedOut;
 	callback.userData = req;
+	callback.cancelled = &req->checkoutCancelled;
+	req->checkoutCancelled.store(false, boost::memory_order_relaxed);
 
 	options.currentTime = SystemTime::getUsec();
+	if (req->phaseTimes.checkoutBegin == 0) {
+		req->phaseTimes.checkoutBegin = SystemTime::getMonotonicUsec();
+	}
 
 	refRequest(req, __FILE__, __LINE__);
 	#ifdef DEBUG_CC_EVENT_LOOP_BLOCKING
@@ -136,6 +141,7 @@ Controller::sessionCheckedOutFromEventLoopThread(Client *client, Request *req,
 		}
 	#endif
 
+	req->phaseTimes.sessionCheckedOut = SystemTime::getMonotonicUsec();
 	if (e == NULL) {
 		SKC_DEBUG(client, "Session checked out: pid=" << session->getPid() <<
 			", gupid=" << session->getGupid());
@@ -207,10 +213,15 @@ Controller::initiateSession(Client *client, Request *req) {
 
 	UPDATE_TRACE_POINT();
 	SKC_DEBUG(client, "Session initiated: fd=" << req->session->fd());
+	req->phaseTimes.sessionInitiated = SystemTime::getMonotonicUsec();
 	req->appSink.reinitialize(req->session->fd());
 	req->appSource.reinitialize(req->session->fd());
 	/***************/
 	/***************/
+	if (req->options.maxRequestTime > 0) {
+		getContext()->timerWheel.arm(&req->maxRequestTimeEntry,
+			req->options.maxRequestTime);
+	}
 	reinitializeAppResponse(client, req);
 	sendHeaderToApp(client, req);
 }
@@ -228,6 +239,43 @@ Controller::checkoutSessionLater(Request *req) {
 	self->unrefRequest(req, __FILE__, __LINE__);
 }
 
+void
+Controller::onMaxRequestTimeReached(ServerKit::TimerWheelEntry *entry) {
+	Request *req = static_cast<Request *>(entry->userData);
+	Client *client = static_cast<Client *>(req->client);
+	Controller *self = static_cast<Controller *>(
+		Controller::getServerFromClient(client));
+	SKC_LOG_EVENT_FROM_STATIC(self, Controller, client, "onMaxRequestTimeReached");
+
+	if (!req->ended()) {
+		RequestRef ref(req, __FILE__, __LINE__);
+		self->maxRequestTimeReached(client, req);
+	}
+}
+
+void
+Controller::maxRequestTimeReached(Client *client, Request *req) {
+	TRACE_POINT();
+	if (req->session == NULL || req->session->isClosed()) {
+		return;
+	}
+
+	SKC_WARN(client, "Request did not finish within " <<
+		req->options.maxRequestTime << " seconds. Aborting it and "
+		"restarting application process " << req->session->getPid());
+	req->session->reportRequestTimeout(mainConfig.maxRequestTimeBacktraces);
+	req->session->close(false);
+
+	UPDATE_TRACE_POINT();
+	if (req->responseBegun) {
+		disconnectWithError(&client, "the request took longer than the maximum request time");
+	} else {
+		endRequestWithSimpleResponse(&client, &req,
+			"<h2>Gateway timeout</h2>"
+			"<p>The application did not respond in time.</p>", 504);
+	}
+}
+
 void
 Controller::reportSessionCheckoutError(Client *client, Request *req,
 	const ExceptionPtr &e)
@@ -83,8 +83,12 @@ parseControllerBenchmarkMode(const StaticString &mode) {
  *
  *   accept_burst_count                                  unsigned integer   -          default(32)
  *   benchmark_mode                                      string             -          -
+ *   client_body_timeout                                 unsigned integer   -          default(60)
  *   client_freelist_limit                               unsigned integer   -          default(0)
+ *   client_header_timeout                               unsigned integer   -          default(60)
+ *   client_keepalive_timeout                            unsigned integer   -          default(75)
  *   default_abort_websockets_on_process_shutdown        boolean            -          default(true)
+ *   default_adaptive_concurrency                        boolean            -          default(false)
  *   default_app_file_descriptor_ulimit                  unsigned integer   -          -
  *   default_environment                                 string             -          default("production")
  *   default_force_max_concurrent_requests_per_process   integer            -          default(-1)
@@ -93,20 +97,29 @@ parseControllerBenchmarkMode(const StaticString &mode) {
  *   default_load_shell_envvars                          boolean            -          default(false)
  *   default_max_preloader_idle_time                     unsigned integer   -          default(300)
  *   default_max_request_queue_size                      unsigned integer   -          default(100)
+ *   default_max_request_time                            unsigned integer   -          default(0)
  *   default_max_requests                                unsigned integer   -          default(0)
+ *   default_max_requests_jitter                         unsigned integer   -          default(0)
+ *   default_memory_limit                                unsigned integer   -          default(0)
  *   default_meteor_app_settings                         string             -          -
  *   default_min_instances                               unsigned integer   -          default(1)
  *   default_nodejs                                      string             -          default("node")
  *   default_python                                      string             -          default("python")
+ *   default_request_queue_lifo                          boolean            -          default(false)
+ *   default_request_queue_target_delay                  unsigned integer   -          default(0)
  *   default_ruby                                        string             -          default("ruby")
  *   default_server_name                                 string             required   -
  *   default_server_port                                 unsigned integer   required   -
  *   default_spawn_method                                string             -          default("smart")
  *   default_sticky_sessions                             boolean            -          default(false)
  *   default_sticky_sessions_cookie_name                 string             -          default("_passenger_route")
+ *   default_target_utilization                          unsigned integer   -          default(0)
+ *   default_union_station_sample_rate                   unsigned integer   -          default(100)
+ *   default_union_station_slow_request_threshold        unsigned integer   -          default(1000)
  *   default_user                                        string             -          default("nobody")
  *   graceful_exit                                       boolean            -          default(true)
  *   integration_mode                                    string             -          default("standalone"),read_only
+ *   max_request_time_backtraces                         boolean            -          default(false)
  *   min_spare_clients                                   unsigned integer   -          default(0)
  *   multi_app                                           boolean            -          default(true),read_only
  *   request_freelist_limit                              unsigned integer   -          default(1024)
@@ -164,11 +177,21 @@ private:
 		add("default_meteor_app_settings", STRING_TYPE, OPTIONAL);
 		add("default_app_file_descriptor_ulimit", UINT_TYPE, OPTIONAL);
 		add("default_min_instances", UINT_TYPE, OPTIONAL, 1);
+		add("default_target_utilization", UINT_TYPE, OPTIONAL, 0);
 		add("default_max_preloader_idle_time", UINT_TYPE, OPTIONAL, DEFAULT_MAX_PRELOADER_IDLE_TIME);
 		add("default_max_request_queue_size", UINT_TYPE, OPTIONAL, DEFAULT_MAX_REQUEST_QUEUE_SIZE);
+		add("default_request_queue_target_delay", UINT_TYPE, OPTIONAL, 0);
+		add("default_request_queue_lifo", BOOL_TYPE, OPTIONAL, false);
 		add("default_force_max_concurrent_requests_per_process", INT_TYPE, OPTIONAL, -1);
+		add("default_adaptive_concurrency", BOOL_TYPE, OPTIONAL, false);
 		add("default_abort_websockets_on_process_shutdown", BOOL_TYPE, OPTIONAL, true);
 		add("default_max_requests", UINT_TYPE, OPTIONAL, 0);
+		add("default_max_requests_jitter", UINT_TYPE, OPTIONAL, 0);
+		add("default_max_request_time", UINT_TYPE, OPTIONAL, 0);
+		add("default_memory_limit", UINT_TYPE, OPTIONAL, 0);
+		add("max_request_time_backtraces", BOOL_TYPE, OPTIONAL, false);
+		add("default_union_station_sample_rate", UINT_TYPE, OPTIONAL, 100);
+		add("default_union_station_slow_request_threshold", UINT_TYPE, OPTIONAL, 1000);
 
 
 		/*******************/
@@ -200,6 +223,10 @@ private:
 			errors.push_back(Error("'{{benchmark_mode}}' is not set to a valid value"));
 		}
 
+		if (config["default_union_station_sample_rate"].asUInt() > 100) {
+			errors.push_back(Error("'{{default_union_station_sample_rate}}' must be a percentage between 0 and 100"));
+		}
+
 		/*******************/
 	}
 
@@ -316,6 +343,7 @@ public:
 	bool userSwitching: 1;
 	bool defaultStickySessions: 1;
 	bool gracefulExit: 1;
+	bool maxRequestTimeBacktraces: 1;
 
 	/*******************/
 	/*******************/
@@ -332,7 +360,8 @@ public:
 		  singleAppMode(!config["multi_app"].asBool()),
 		  userSwitching(config["user_switching"].asBool()),
 		  defaultStickySessions(config["default_sticky_sessions"].asBool()),
-		  gracefulExit(config["graceful_exit"].asBool())
+		  gracefulExit(config["graceful_exit"].asBool()),
+		  maxRequestTimeBacktraces(config["max_request_time_backtraces"].asBool())
 
 		  /*******************/
 	{
@@ -362,6 +391,7 @@ public:
 		SWAP_BITFIELD(bool, userSwitching);
 		SWAP_BITFIELD(bool, defaultStickySessions);
 		SWAP_BITFIELD(bool, gracefulExit);
+		SWAP_BITFIELD(bool, maxRequestTimeBacktraces);
 
 		/*******************/
 
@@ -403,13 +433,22 @@ public:
 	StaticString defaultMeteorAppSettings;
 	unsigned int defaultAppFileDescriptorUlimit;
 	unsigned int defaultMinInstances;
+	unsigned int defaultTargetUtilization;
 	unsigned int defaultMaxPreloaderIdleTime;
 	unsigned int defaultMaxRequestQueueSize;
+	unsigned int defaultRequestQueueTargetDelay;
 	unsigned int defaultMaxRequests;
+	unsigned int defaultMaxRequestsJitter;
+	unsigned int defaultMaxRequestTime;
+	unsigned int defaultMemoryLimit;
+	unsigned int defaultUnionStationSampleRate;
+	unsigned int defaultUnionStationSlowRequestThreshold;
 	int defaultForceMaxConcurrentRequestsPerProcess;
 	bool showVersionInHeader: 1;
 	bool defaultAbortWebsocketsOnProcessShutdown;
 	bool defaultLoadShellEnvvars;
+	bool defaultAdaptiveConcurrency;
+	bool defaultRequestQueueLifo;
 
 	/*******************/
 	/*******************/
@@ -437,13 +476,22 @@ public:
 		  defaultMeteorAppSettings(psg_pstrdup(pool, config["default_meteor_app_settings"].asString())),
 		  defaultAppFileDescriptorUlimit(config["default_app_file_descriptor_ulimit"].asUInt()),
 		  defaultMinInstances(config["default_min_instances"].asUInt()),
+		  defaultTargetUtilization(config["default_target_utilization"].asUInt()),
 		  defaultMaxPreloaderIdleTime(config["default_max_preloader_idle_time"].asUInt()),
 		  defaultMaxRequestQueueSize(config["default_max_request_queue_size"].asUInt()),
+		  defaultRequestQueueTargetDelay(config["default_request_queue_target_delay"].asUInt()),
 		  defaultMaxRequests(config["default_max_requests"].asUInt()),
+		  defaultMaxRequestsJitter(config["default_max_requests_jitter"].asUInt()),
+		  defaultMaxRequestTime(config["default_max_request_time"].asUInt()),
+		  defaultMemoryLimit(config["default_memory_limit"].asUInt()),
+		  defaultUnionStationSampleRate(config["default_union_station_sample_rate"].asUInt()),
+		  defaultUnionStationSlowRequestThreshold(config["default_union_station_slow_request_threshold"].asUInt()),
 		  defaultForceMaxConcurrentRequestsPerProcess(config["default_force_max_concurrent_requests_per_process"].asInt()),
 		  showVersionInHeader(config["show_version_in_header"].asBool()),
 		  defaultAbortWebsocketsOnProcessShutdown(config["default_abort_websockets_on_process_shutdown"].asBool()),
-		  defaultLoadShellEnvvars(config["default_load_shell_envvars"].asBool())
+		  defaultLoadShellEnvvars(config["default_load_shell_envvars"].asBool()),
+		  defaultAdaptiveConcurrency(config["default_adaptive_concurrency"].asBool()),
+		  defaultRequestQueueLifo(config["default_request_queue_lifo"].asBool())
 
 		  /*******************/
 		{ }
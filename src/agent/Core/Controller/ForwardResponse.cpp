@@ -319,6 +319,8 @@ Controller::onAppResponseBegin(Client *client, Request *req) {
 	ssize_t bytesWritten;
 	bool oobw;
 
+	req->phaseTimes.responseBegin = SystemTime::getMonotonicUsec();
+
 	#ifdef DEBUG_CC_EVENT_LOOP_BLOCKING
 		req->timeOnRequestHeaderSent = ev_now(getLoop());
 		reportLargeTimeDiff(client,
@@ -1149,6 +1151,100 @@ void
 Controller::finalizeUnionStationWithSuccess(Client *client, Request *req) {
 	req->endStopwatchLog(&req->stopwatchLogs.requestProxying, true);
 	req->endStopwatchLog(&req->stopwatchLogs.requestProcessing, true);
+	req->unionStationCandidate.succeeded = true;
+}
+
+/**
+ * Called at the end of a request that was not sampled by Union Station.
+ * Creates a transaction after all if the request turned out to be an
+ * error or slow, so that those are always reported regardless of the
+ * sample rate.
+ */
+void
+Controller::finalizeUnionStationCandidate(Client *client, Request *req) {
+	if (req->unionStationCandidate.startTime == 0) {
+		return;
+	}
+
+	MonotonicTimeUsec now = SystemTime::getMonotonicUsec();
+	MonotonicTimeUsec startTime = req->unionStationCandidate.startTime;
+	unsigned int threshold = req->unionStationCandidate.slowRequestThreshold;
+	bool failed = !req->unionStationCandidate.succeeded
+		|| (req->appResponseInitialized && req->appResponse.statusCode >= 500);
+	bool slow = threshold > 0
+		&& now - startTime >= (MonotonicTimeUsec) threshold * 1000;
+	req->unionStationCandidate.startTime = 0;
+
+	if (!failed && !slow) {
+		unionStationDroppedRequests++;
+		return;
+	}
+
+	unionStationPromotedRequests++;
+	const LString *key = req->unionStationCandidate.key;
+	const LString *filters = req->unionStationCandidate.filters;
+	UnionStation::TransactionPtr transaction = unionStationContext->newTransaction(
+		req->options.getAppGroupName(), "requests",
+		string(key->start->data, key->size),
+		(filters != NULL)
+			? string(filters->start->data, filters->size)
+			: string());
+	if (transaction->isNull()) {
+		return;
+	}
+
+	UnionStation::StopwatchLog log(transaction, "request processing", NULL, startTime);
+	transaction->message(string("Request method: ") + http_method_str(req->method));
+	transaction->message("URI: " + StaticString(req->path.start->data, req->path.size));
+	if (req->appResponseInitialized) {
+		transaction->message("Status: " + toString(req->appResponse.statusCode));
+	}
+	if (!failed) {
+		log.success();
+	}
+}
+
+/**
+ * Called at the end of every request. Records the durations of the
+ * phases that the request went through in the request phase histograms
+ * of the request's application group. Requests that never got as far as
+ * checking out a session (e.g. because they were served from the
+ * turbocache) are not associated with a group and are not recorded.
+ */
+void
+Controller::recordRequestPhaseTimes(Client *client, Request *req) {
+	if (req->phaseTimes.checkoutBegin == 0) {
+		return;
+	}
+
+	HashedStaticString appGroupName(req->options.getAppGroupName());
+	RequestPhaseHistogramsPtr *histograms;
+	if (!requestPhaseHistograms.lookup(appGroupName, &histograms)) {
+		histograms = &requestPhaseHistograms.insert(appGroupName,
+			boost::make_shared<RequestPhaseHistograms>())->value;
+	}
+
+	Histogram *phases = (*histograms)->phases;
+	MonotonicTimeUsec now = SystemTime::getMonotonicUsec();
+	MonotonicTimeUsec checkedOut = req->phaseTimes.sessionCheckedOut;
+	MonotonicTimeUsec initiated = req->phaseTimes.sessionInitiated;
+	MonotonicTimeUsec responseBegin = req->phaseTimes.responseBegin;
+
+	phases[RequestPhaseHistograms::PREPARING].record(
+		req->phaseTimes.checkoutBegin - req->phaseTimes.begin);
+	// If the request ended while it was still waiting for a session, then
+	// the time spent waiting still counts as queueing time.
+	phases[RequestPhaseHistograms::QUEUEING].record(
+		((checkedOut != 0) ? checkedOut : now) - req->phaseTimes.checkoutBegin);
+	if (initiated != 0) {
+		phases[RequestPhaseHistograms::CONNECTING].record(initiated - checkedOut);
+		if (responseBegin != 0) {
+			phases[RequestPhaseHistograms::APP].record(responseBegin - initiated);
+			phases[RequestPhaseHistograms::RESPONDING].record(now - responseBegin);
+		}
+	}
+	phases[RequestPhaseHistograms::TOTAL].record(now - req->phaseTimes.begin);
+	req->phaseTimes.checkoutBegin = 0;
 }
 
 
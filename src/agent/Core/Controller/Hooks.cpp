@@ -97,6 +97,8 @@ void
 Controller::onRequestObjectCreated(Client *client, Request *req) {
 	ParentClass::onRequestObjectCreated(client, req);
 
+	req->maxRequestTimeEntry.callback = onMaxRequestTimeReached;
+	req->maxRequestTimeEntry.userData = req;
 	req->appSink.setContext(getContext());
 	req->appSink.setHooks(&req->hooks);
 
@@ -141,6 +143,9 @@ Controller::reinitializeRequest(Client *client, Request *req) {
 	req->cacheControl = NULL;
 	req->varyCookie = NULL;
 	req->envvars = NULL;
+	req->unionStationCandidate.startTime = 0;
+	req->unionStationCandidate.succeeded = false;
+	memset(&req->phaseTimes, 0, sizeof(req->phaseTimes));
 
 	#ifdef DEBUG_CC_EVENT_LOOP_BLOCKING
 		req->timedAppPoolGet = false;
@@ -154,6 +159,7 @@ Controller::reinitializeRequest(Client *client, Request *req) {
 
 void
 Controller::deinitializeRequest(Client *client, Request *req) {
+	req->checkoutCancelled.store(true, boost::memory_order_release);
 	req->session.reset();
 	req->config.reset();
 
@@ -161,6 +167,8 @@ Controller::deinitializeRequest(Client *client, Request *req) {
 	req->endStopwatchLog(&req->stopwatchLogs.bufferingRequestBody, false);
 	req->endStopwatchLog(&req->stopwatchLogs.requestProxying, false);
 	req->endStopwatchLog(&req->stopwatchLogs.requestProcessing, false);
+	finalizeUnionStationCandidate(client, req);
+	recordRequestPhaseTimes(client, req);
 
 	req->options.transaction.reset();
 
@@ -169,6 +177,7 @@ Controller::deinitializeRequest(Client *client, Request *req) {
 	req->appSource.deinitialize();
 	req->bodyBuffer.clearBuffersFlushedCallback();
 	req->bodyBuffer.deinitialize();
+	getContext()->timerWheel.disarm(&req->maxRequestTimeEntry);
 
 	/***************/
 	/***************/
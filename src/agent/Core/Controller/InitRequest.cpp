@@ -53,6 +53,102 @@ struct Controller::RequestAnalysis {
 };
 
 
+/**
+ * Decodes the binary secure headers block (see SecureHeadersBlock.h) into
+ * `req->secureHeaders`, so that the rest of the request initialization code
+ * works the same no matter how the web server sent the secure headers.
+ * Secure headers with an id are inserted with a precomputed hash, so this
+ * involves no text parsing or hashing.
+ *
+ * Returns false if the block is invalid, in which case the request is ended.
+ */
+bool
+Controller::decodeSecureHeadersBlock(Client *client, Request *req) {
+	const LString *block = psg_lstr_make_contiguous(&req->secureHeadersBlock, req->pool);
+	const char *pos = (block->size > 0) ? block->start->data : NULL;
+	const char *end = pos + block->size;
+	const string &password = getContext()->config.secureModePassword;
+	bool passwordGiven = false;
+	const char *error = NULL;
+
+	while (pos < end && error == NULL) {
+		unsigned int id = (unsigned char) *pos;
+		HashedStaticString name;
+		unsigned int size;
+
+		pos++;
+		if (id == PSG_SHB_CUSTOM) {
+			if (end - pos < 4) {
+				error = "Invalid secure headers block";
+				break;
+			}
+			size = psg_secure_headers_block_get_uint32(pos);
+			pos += 4;
+			if ((size_t) (end - pos) < size
+			 || size < 2 || size >= ServerKit::HeaderTable::MAX_KEY_LENGTH
+			 || pos[0] != '!' || pos[1] != '~')
+			{
+				error = "Invalid secure headers block";
+				break;
+			}
+			name = HashedStaticString(pos, size);
+			pos += size;
+		} else if (id < PSG_SHB_ID_COUNT) {
+			name = SECURE_HEADERS_BLOCK_NAMES[id];
+		} else {
+			error = "Invalid secure headers block";
+			break;
+		}
+
+		if (end - pos < 4) {
+			error = "Invalid secure headers block";
+			break;
+		}
+		size = psg_secure_headers_block_get_uint32(pos);
+		pos += 4;
+		if ((size_t) (end - pos) < size) {
+			error = "Invalid secure headers block";
+			break;
+		}
+
+		if (id == PSG_SHB_PASSWORD) {
+			if (!password.empty() && StaticString(pos, size) != password) {
+				error = ServerKit::getErrorDesc(ServerKit::SECURITY_PASSWORD_MISMATCH);
+			}
+			passwordGiven = true;
+		} else {
+			insertSecureHeader(req, name, pos, size);
+		}
+		pos += size;
+	}
+
+	if (error == NULL && !passwordGiven && !password.empty()) {
+		error = ServerKit::getErrorDesc(ServerKit::ERROR_SECURE_HEADER_NOT_ALLOWED);
+	}
+	if (error != NULL) {
+		endAsBadRequest(&client, &req, error);
+		return false;
+	} else {
+		return true;
+	}
+}
+
+void
+Controller::insertSecureHeader(Request *req, const HashedStaticString &name,
+	const char *value, unsigned int size)
+{
+	ServerKit::Header *header = (ServerKit::Header *) psg_palloc(req->pool,
+		sizeof(ServerKit::Header));
+	psg_lstr_init(&header->key);
+	psg_lstr_append(&header->key, req->pool, name.data(), name.size());
+	psg_lstr_init(&header->origKey);
+	psg_lstr_append(&header->origKey, req->pool, name.data(), name.size());
+	psg_lstr_init(&header->val);
+	psg_lstr_append(&header->val, req->pool, value, size);
+	header->hash = name.hash();
+	req->secureHeaders.insert(&header, req->pool);
+}
+
 void
 Controller::initializeFlags(Client *client, Request *req, RequestAnalysis &analysis) {
 	if (analysis.flags != NULL) {
@@ -174,6 +270,9 @@ Controller::initializePoolOptions(Client *client, Request *req, RequestAnalysis
 
 		// Allow certain options to be overridden on a per-request basis
 		fillPoolOption(req, req->options.maxRequests, PASSENGER_MAX_REQUESTS);
+		fillPoolOption(req, req->options.maxRequestsJitter, PASSENGER_MAX_REQUESTS_JITTER);
+		fillPoolOption(req, req->options.maxRequestTime, PASSENGER_MAX_REQUEST_TIME);
+		fillPoolOption(req, req->options.memoryLimit, PASSENGER_MEMORY_LIMIT);
 	}
 }
 
@@ -196,15 +295,22 @@ Controller::fillPoolOptionsFromConfigCaches(Options &options,
 	options.defaultUser = requestConfig->defaultUser;
 	options.defaultGroup = requestConfig->defaultGroup;
 	options.minProcesses = requestConfig->defaultMinInstances;
+	options.targetUtilization = requestConfig->defaultTargetUtilization;
 	options.maxPreloaderIdleTime = requestConfig->defaultMaxPreloaderIdleTime;
 	options.maxRequestQueueSize = requestConfig->defaultMaxRequestQueueSize;
+	options.requestQueueTargetDelay = requestConfig->defaultRequestQueueTargetDelay;
+	options.requestQueueLifo = requestConfig->defaultRequestQueueLifo;
 	options.abortWebsocketsOnProcessShutdown = requestConfig->defaultAbortWebsocketsOnProcessShutdown;
 	options.forceMaxConcurrentRequestsPerProcess = requestConfig->defaultForceMaxConcurrentRequestsPerProcess;
+	options.adaptiveConcurrency = requestConfig->defaultAdaptiveConcurrency;
 	options.environment = requestConfig->defaultEnvironment;
 	options.spawnMethod = requestConfig->defaultSpawnMethod;
 	options.loadShellEnvvars = requestConfig->defaultLoadShellEnvvars;
 	options.statThrottleRate = mainConfig.statThrottleRate;
 	options.maxRequests = requestConfig->defaultMaxRequests;
+	options.maxRequestsJitter = requestConfig->defaultMaxRequestsJitter;
+	options.maxRequestTime = requestConfig->defaultMaxRequestTime;
+	options.memoryLimit = requestConfig->defaultMemoryLimit;
 
 	/******************************/
 }
@@ -363,13 +469,17 @@ Controller::createNewPoolOptions(Client *client, Request *req,
 	fillPoolOption(req, options.group, "!~PASSENGER_GROUP");
 	fillPoolOption(req, options.minProcesses, "!~PASSENGER_MIN_PROCESSES");
 	fillPoolOption(req, options.maxProcesses, "!~PASSENGER_MAX_PROCESSES");
+	fillPoolOption(req, options.targetUtilization, "!~PASSENGER_TARGET_UTILIZATION");
 	fillPoolOption(req, options.spawnMethod, "!~PASSENGER_SPAWN_METHOD");
 	fillPoolOption(req, options.startCommand, "!~PASSENGER_START_COMMAND");
 	fillPoolOptionSecToMsec(req, options.startTimeout, "!~PASSENGER_START_TIMEOUT");
 	fillPoolOption(req, options.maxPreloaderIdleTime, "!~PASSENGER_MAX_PRELOADER_IDLE_TIME");
 	fillPoolOption(req, options.maxRequestQueueSize, "!~PASSENGER_MAX_REQUEST_QUEUE_SIZE");
+	fillPoolOption(req, options.requestQueueTargetDelay, "!~PASSENGER_REQUEST_QUEUE_TARGET_DELAY");
+	fillPoolOption(req, options.requestQueueLifo, "!~PASSENGER_REQUEST_QUEUE_LIFO");
 	fillPoolOption(req, options.abortWebsocketsOnProcessShutdown, "!~PASSENGER_ABORT_WEBSOCKETS_ON_PROCESS_SHUTDOWN");
 	fillPoolOption(req, options.forceMaxConcurrentRequestsPerProcess, "!~PASSENGER_FORCE_MAX_CONCURRENT_REQUESTS_PER_PROCESS");
+	fillPoolOption(req, options.adaptiveConcurrency, "!~PASSENGER_ADAPTIVE_CONCURRENCY");
 	fillPoolOption(req, options.restartDir, "!~PASSENGER_RESTART_DIR");
 	fillPoolOption(req, options.startupFile, "!~PASSENGER_STARTUP_FILE");
 	fillPoolOption(req, options.loadShellEnvvars, "!~PASSENGER_LOAD_SHELL_ENVVARS");
@@ -403,6 +513,23 @@ Controller::initializeUnionStation(Client *client, Request *req, RequestAnalysis
 			filters = psg_lstr_make_contiguous(filters, req->pool);
 		}
 
+		unsigned int sampleRate = req->config->defaultUnionStationSampleRate;
+		fillPoolOption(req, sampleRate, UNION_STATION_SAMPLE_RATE);
+		if (!shouldSampleUnionStationRequest(sampleRate)) {
+			// Don't create a transaction now. We may still create one
+			// at the end of the request if it turns out to be an error
+			// or slow. See finalizeUnionStationCandidate().
+			req->unionStationCandidate.startTime = SystemTime::getMonotonicUsec();
+			req->unionStationCandidate.key = key;
+			req->unionStationCandidate.filters = filters;
+			req->unionStationCandidate.slowRequestThreshold =
+				req->config->defaultUnionStationSlowRequestThreshold;
+			fillPoolOption(req, req->unionStationCandidate.slowRequestThreshold,
+				UNION_STATION_SLOW_REQUEST_THRESHOLD);
+			return;
+		}
+		unionStationSampledRequests++;
+
 		options.transaction = unionStationContext->newTransaction(
 			options.getAppGroupName(), "requests",
 			string(key->start->data, key->size),
@@ -420,6 +547,23 @@ Controller::initializeUnionStation(Client *client, Request *req, RequestAnalysis
 	}
 }
 
+bool
+Controller::shouldSampleUnionStationRequest(unsigned int sampleRate) {
+	if (sampleRate >= 100) {
+		return true;
+	} else if (sampleRate == 0) {
+		return false;
+	} else {
+		// xorshift32
+		boost::uint32_t x = unionStationSamplingRandomState;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		unionStationSamplingRandomState = x;
+		return x % 100 < sampleRate;
+	}
+}
+
 void
 Controller::setStickySessionId(Client *client, Request *req) {
 	if (req->stickySession) {
@@ -469,6 +613,10 @@ Controller::onRequestBegin(Client *client, Request *req) {
 
 	CC_BENCHMARK_POINT(client, req, BM_AFTER_ACCEPT);
 
+	if (req->secureHeadersBlock.size > 0 && !decodeSecureHeadersBlock(client, req)) {
+		return;
+	}
+
 	{
 		// Perform hash table operations as close to header parsing as possible,
 		// and localize them as much as possible, for better CPU caching.
@@ -488,6 +636,7 @@ Controller::onRequestBegin(Client *client, Request *req) {
 
 		SKC_TRACE(client, 2, "Initiating request");
 		req->startedAt = ev_now(getLoop());
+		req->phaseTimes.begin = SystemTime::getMonotonicUsec();
 		req->bodyChannel.stop();
 
 		initializeFlags(client, req, analysis);
@@ -67,11 +67,16 @@ Controller::preinitialize() {
 	PASSENGER_APP_GROUP_NAME = "!~PASSENGER_APP_GROUP_NAME";
 	PASSENGER_ENV_VARS = "!~PASSENGER_ENV_VARS";
 	PASSENGER_MAX_REQUESTS = "!~PASSENGER_MAX_REQUESTS";
+	PASSENGER_MAX_REQUESTS_JITTER = "!~PASSENGER_MAX_REQUESTS_JITTER";
+	PASSENGER_MAX_REQUEST_TIME = "!~PASSENGER_MAX_REQUEST_TIME";
+	PASSENGER_MEMORY_LIMIT = "!~PASSENGER_MEMORY_LIMIT";
 	PASSENGER_SHOW_VERSION_IN_HEADER = "!~PASSENGER_SHOW_VERSION_IN_HEADER";
 	PASSENGER_STICKY_SESSIONS = "!~PASSENGER_STICKY_SESSIONS";
 	PASSENGER_STICKY_SESSIONS_COOKIE_NAME = "!~PASSENGER_STICKY_SESSIONS_COOKIE_NAME";
 	PASSENGER_REQUEST_OOB_WORK = "!~Request-OOB-Work";
 	UNION_STATION_SUPPORT = "!~UNION_STATION_SUPPORT";
+	UNION_STATION_SAMPLE_RATE = "!~UNION_STATION_SAMPLE_RATE";
+	UNION_STATION_SLOW_REQUEST_THRESHOLD = "!~UNION_STATION_SLOW_REQUEST_THRESHOLD";
 	REMOTE_ADDR = "!~REMOTE_ADDR";
 	REMOTE_PORT = "!~REMOTE_PORT";
 	REMOTE_USER = "!~REMOTE_USER";
@@ -85,6 +90,18 @@ Controller::preinitialize() {
 	HTTP_CONNECTION = "connection";
 	HTTP_STATUS = "status";
 	HTTP_TRANSFER_ENCODING = "transfer-encoding";
+	for (unsigned int i = 0; i < PSG_SHB_ID_COUNT; i++) {
+		SECURE_HEADERS_BLOCK_NAMES[i] = psg_secure_header_name(i);
+	}
+
+	// Sampling decisions don't need to be unpredictable, only
+	// different between threads and processes.
+	unionStationSamplingRandomState = (boost::uint32_t) (SystemTime::getUsec()
+		^ ((boost::uint64_t) getpid() << 16)
+		^ (mainConfig.threadNumber * 2654435761u));
+	if (unionStationSamplingRandomState == 0) {
+		unionStationSamplingRandomState = 1;
+	}
 
 	/**************************/
 }
@@ -0,0 +1,165 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_CORE_CONTROLLER_METRICS_H_
+#define _PASSENGER_CORE_CONTROLLER_METRICS_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+#include <Algorithms/Histogram.h>
+
+namespace Passenger {
+namespace Core {
+
+
+/**
+ * Latency histograms of the requests that a single Controller handled for
+ * one application group, one per phase of the request. All durations are
+ * in microseconds.
+ *
+ * The Controller does not track when a connection was accepted, or when
+ * the request headers were parsed, so the first phase starts at
+ * `onRequestBegin()`.
+ */
+struct RequestPhaseHistograms {
+	enum Phase {
+		/**
+		 * From the beginning of the request until the session checkout
+		 * starts. Includes request body buffering.
+		 */
+		PREPARING,
+		/**
+		 * From the start of the session checkout until the pool hands out
+		 * a session (or an error). This is the time spent in the pool's
+		 * get wait list, or waiting for a process to be spawned.
+		 */
+		QUEUEING,
+		/** From checking out a session until it is initiated. */
+		CONNECTING,
+		/** From initiating the session until the app's response begins. */
+		APP,
+		/** From the beginning of the app's response until the request ends. */
+		RESPONDING,
+		/** From the beginning of the request until the request ends. */
+		TOTAL,
+
+		PHASE_COUNT
+	};
+
+	Histogram phases[PHASE_COUNT];
+
+	static const char *getPhaseName(unsigned int phase) {
+		switch (phase) {
+		case PREPARING:
+			return "preparing";
+		case QUEUEING:
+			return "queueing";
+		case CONNECTING:
+			return "connecting";
+		case APP:
+			return "app";
+		case RESPONDING:
+			return "responding";
+		case TOTAL:
+			return "total";
+		default:
+			return "unknown";
+		}
+	}
+
+	void merge(const RequestPhaseHistograms &other) {
+		for (unsigned int i = 0; i < PHASE_COUNT; i++) {
+			phases[i].merge(other.phases[i]);
+		}
+	}
+};
+
+typedef boost::shared_ptr<RequestPhaseHistograms> RequestPhaseHistogramsPtr;
+typedef std::vector< std::pair<std::string, RequestPhaseHistogramsPtr> >
+	RequestPhaseHistogramsList;
+
+
+/**
+ * Counters and gauges of a single Controller, as exported by the `/metrics`
+ * API endpoint. Collected by `Controller::collectMetrics()` in the
+ * Controller's event loop thread, so that the Controller itself does not
+ * need any locks or atomics.
+ */
+struct ControllerMetrics {
+	unsigned int threadNumber;
+
+	unsigned int activeClientCount;
+	unsigned int disconnectedClientCount;
+	boost::uint64_t totalClientsAccepted;
+	boost::uint64_t totalBytesConsumed;
+
+	bool turbocachingEnabled;
+	boost::uint64_t turbocacheFetches;
+	boost::uint64_t turbocacheHits;
+	boost::uint64_t turbocacheStores;
+	boost::uint64_t turbocacheStoreSuccesses;
+
+	/** Summed over all mbuf size classes. */
+	unsigned int mbufActiveBlocks;
+	unsigned int mbufFreeBlocks;
+	unsigned int mbufReleasedBlocks;
+	size_t mbufActiveMemory;
+	size_t mbufSpareMemory;
+
+	/**
+	 * Copies of the Controller's request phase histograms, one entry per
+	 * application group name.
+	 */
+	RequestPhaseHistogramsList requestPhaseHistograms;
+
+	ControllerMetrics()
+		: threadNumber(0),
+		  activeClientCount(0),
+		  disconnectedClientCount(0),
+		  totalClientsAccepted(0),
+		  totalBytesConsumed(0),
+		  turbocachingEnabled(false),
+		  turbocacheFetches(0),
+		  turbocacheHits(0),
+		  turbocacheStores(0),
+		  turbocacheStoreSuccesses(0),
+		  mbufActiveBlocks(0),
+		  mbufFreeBlocks(0),
+		  mbufReleasedBlocks(0),
+		  mbufActiveMemory(0),
+		  mbufSpareMemory(0)
+		{ }
+};
+
+
+} // namespace Core
+} // namespace Passenger
+
+#endif /* _PASSENGER_CORE_CONTROLLER_METRICS_H_ */
@@ -27,6 +27,7 @@
 #define _PASSENGER_REQUEST_HANDLER_REQUEST_H_
 
 #include <ev++.h>
+#include <boost/atomic.hpp>
 #include <string>
 #include <cstring>
 
@@ -91,6 +92,10 @@ public:
 	ServerKit::FdSourceChannel appSource;
 	AppResponse appResponse;
 
+	// Armed while the request is being handled by an application process,
+	// if `options.maxRequestTime` is set.
+	ServerKit::TimerWheelEntry maxRequestTimeEntry;
+
 	ServerKit::FileBufferedChannel bodyBuffer;
 	boost::uint64_t bodyBytesBuffered; // After dechunking
 
@@ -101,6 +106,32 @@ public:
 		UnionStation::StopwatchLog *requestProxying;
 	} stopwatchLogs;
 
+	// Union Station support is enabled, but the request was not sampled.
+	// At the end of the request, a transaction is created after all if
+	// the request turned out to be an error or slow. Only valid if
+	// `startTime` is not 0.
+	struct {
+		MonotonicTimeUsec startTime;
+		const LString *key;
+		const LString *filters;
+		unsigned int slowRequestThreshold; // In milliseconds. 0 = disabled.
+		bool succeeded;
+	} unionStationCandidate;
+
+	// Monotonic times at which the request reached the boundaries of the
+	// phases in RequestPhaseHistograms. 0 if not reached (yet).
+	struct {
+		MonotonicTimeUsec begin;
+		MonotonicTimeUsec checkoutBegin;
+		MonotonicTimeUsec sessionCheckedOut;
+		MonotonicTimeUsec sessionInitiated;
+		MonotonicTimeUsec responseBegin;
+	} phaseTimes;
+
+	// Set when the request is deinitialized, so that the pool can remove
+	// it from its request queue if it is still waiting for a session.
+	boost::atomic<bool> checkoutCancelled;
+
 	HashedStaticString cacheKey;
 	LString *cacheControl;
 	LString *varyCookie;
@@ -121,9 +152,12 @@ public:
 
 
 	Request()
-		: BaseHttpRequest()
+		: BaseHttpRequest(),
+		  checkoutCancelled(false)
 	{
 		memset(&stopwatchLogs, 0, sizeof(stopwatchLogs));
+		memset(&unionStationCandidate, 0, sizeof(unionStationCandidate));
+		memset(&phaseTimes, 0, sizeof(phaseTimes));
 	}
 
 	const char *getStateString() const {
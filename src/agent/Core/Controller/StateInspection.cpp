@@ -64,9 +64,65 @@ Controller::inspectStateAsJson() const {
 		subdoc["store_success_ratio"] = turboCaching.responseCache.getStoreSuccessRatio();
 		doc["turbocaching"] = subdoc;
 	}
+	if (unionStationContext != NULL && !unionStationContext->isNull()) {
+		Json::Value subdoc;
+		subdoc["sampled_requests"] = (Json::UInt64) unionStationSampledRequests;
+		subdoc["promoted_requests"] = (Json::UInt64) unionStationPromotedRequests;
+		subdoc["dropped_requests"] = (Json::UInt64) unionStationDroppedRequests;
+		subdoc["sent_messages"] = (Json::UInt64)
+			unionStationContext->getTransport()->getSentMessages();
+		subdoc["dropped_messages"] = (Json::UInt64)
+			unionStationContext->getTransport()->getDroppedMessages();
+		doc["union_station"] = subdoc;
+	}
 	return doc;
 }
 
+/**
+ * Must be called from the event loop thread.
+ */
+void
+Controller::collectMetrics(ControllerMetrics &metrics) const {
+	metrics.threadNumber = getThreadNumber();
+	metrics.activeClientCount = activeClientCount;
+	metrics.disconnectedClientCount = disconnectedClientCount;
+	metrics.totalClientsAccepted = totalClientsAccepted;
+	metrics.totalBytesConsumed = totalBytesConsumed;
+
+	metrics.turbocachingEnabled = turboCaching.isEnabled();
+	if (metrics.turbocachingEnabled) {
+		metrics.turbocacheFetches = turboCaching.responseCache.getTotalFetches();
+		metrics.turbocacheHits = turboCaching.responseCache.getTotalHits();
+		metrics.turbocacheStores = turboCaching.responseCache.getTotalStores();
+		metrics.turbocacheStoreSuccesses = turboCaching.responseCache.getTotalStoreSuccesses();
+	}
+
+	const ServerKit::Context *ctx = getContext();
+	for (unsigned int i = 0; i < MemoryKit::MBUF_SIZE_CLASS_COUNT; i++) {
+		if (i != MemoryKit::MBUF_SIZE_CLASS_DEFAULT && !ctx->mbufSizeClassesEnabled) {
+			continue;
+		}
+		const struct MemoryKit::mbuf_pool &pool =
+			(i == MemoryKit::MBUF_SIZE_CLASS_DEFAULT)
+			? ctx->mbuf_pool
+			: ctx->mbuf_pools_by_size_class[i];
+		metrics.mbufActiveBlocks += pool.nactive_mbuf_blockq;
+		metrics.mbufFreeBlocks += pool.nfree_mbuf_blockq;
+		metrics.mbufReleasedBlocks += pool.nreleased_mbuf_blockq;
+		metrics.mbufActiveMemory += pool.nactive_mbuf_blockq * pool.mbuf_block_chunk_size;
+		metrics.mbufSpareMemory += (pool.nfree_mbuf_blockq - pool.nreleased_mbuf_blockq)
+			* pool.mbuf_block_chunk_size;
+	}
+
+	StringKeyTable<RequestPhaseHistogramsPtr>::ConstIterator it(requestPhaseHistograms);
+	while (*it != NULL) {
+		metrics.requestPhaseHistograms.push_back(make_pair(
+			it.getKey().toString(),
+			boost::make_shared<RequestPhaseHistograms>(*it.getValue())));
+		it.next();
+	}
+}
+
 Json::Value
 Controller::inspectClientStateAsJson(const Client *client) const {
 	Json::Value doc = ParentClass::inspectClientStateAsJson(client);
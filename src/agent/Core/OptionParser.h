@@ -149,18 +149,40 @@ coreUsage() {
 	printf("                            Force " SHORT_PROGRAM_NAME " to believe that an application\n");
 	printf("                            process can handle the given number of concurrent\n");
 	printf("                            requests per process\n");
+	printf("      --adaptive-concurrency\n");
+	printf("                            Adjust the number of concurrent requests per\n");
+	printf("                            process based on response latency, up to the\n");
+	printf("                            advertised or forced concurrency\n");
 	printf("      --min-instances N     Minimum number of application processes. Default: 1\n");
+	printf("      --target-utilization PERCENT\n");
+	printf("                            Spawn application processes ahead of demand,\n");
+	printf("                            based on the request rate trend, so that they\n");
+	printf("                            are busy about PERCENT of the time.\n");
+	printf("                            Default: 0 (disabled)\n");
 	printf("      --memory-limit MB     Restart application processes that go over the\n");
-	printf("                            given memory limit (Enterprise only)\n");
+	printf("                            given memory limit. Default: 0 (unlimited)\n");
 	printf("\n");
 	printf("Request handling options (optional):\n");
 	printf("      --max-requests        Restart application processes that have handled\n");
 	printf("                            the specified maximum number of requests\n");
-	printf("      --max-request-time    Abort requests that take too much time (Enterprise\n");
-	printf("                            only)\n");
+	printf("      --max-requests-jitter NUMBER\n");
+	printf("                            Add a random number of requests between 0 and\n");
+	printf("                            NUMBER to each process's --max-requests, so that\n");
+	printf("                            processes are not restarted all at once.\n");
+	printf("                            Default: 0\n");
+	printf("      --max-request-time SECONDS\n");
+	printf("                            Abort requests that take longer than the given\n");
+	printf("                            time, and restart the process that handled them.\n");
+	printf("                            Default: 0 (unlimited)\n");
 	printf("      --max-request-queue-size NUMBER\n");
 	printf("                            Specify request queue size. Default: %d\n",
 		DEFAULT_MAX_REQUEST_QUEUE_SIZE);
+	printf("      --request-queue-target-delay MSEC\n");
+	printf("                            Fail queued requests that waited longer than\n");
+	printf("                            MSEC once the request queue has been above that\n");
+	printf("                            delay for a while. Default: 0 (disabled)\n");
+	printf("      --request-queue-lifo  Serve the newest queued requests first while the\n");
+	printf("                            request queue is overloaded\n");
 	printf("      --sticky-sessions     Enable sticky sessions\n");
 	printf("      --sticky-sessions-cookie-name NAME\n");
 	printf("                            Cookie name to use for sticky sessions.\n");
@@ -177,6 +199,7 @@ coreUsage() {
 	printf("      --log-file PATH       Log to the given file.\n");
 	printf("      --log-level LEVEL     Logging level. Default: %d\n", DEFAULT_LOG_LEVEL);
 	printf("      --fd-log-file PATH    Log file descriptor activity to the given file.\n");
+	printf("      --log-async           Write log entries from a background thread\n");
 	printf("      --stat-throttle-rate SECONDS\n");
 	printf("                            Throttle filesystem restart.txt checks to at most\n");
 	printf("                            once per given seconds. Default: %d\n", DEFAULT_STAT_THROTTLE_RATE);
@@ -294,9 +317,15 @@ parseCoreOption(int argc, const char *argv[], int &i, Json::Value &updates) {
 	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--force-max-concurrent-requests-per-process")) {
 		updates["default_force_max_concurrent_requests_per_process"] = atoi(argv[i + 1]);
 		i += 2;
+	} else if (p.isFlag(argv[i], '\0', "--adaptive-concurrency")) {
+		updates["default_adaptive_concurrency"] = true;
+		i++;
 	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--min-instances")) {
 		updates["default_min_instances"] = atoi(argv[i + 1]);
 		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--target-utilization")) {
+		updates["default_target_utilization"] = atoi(argv[i + 1]);
+		i += 2;
 	} else if (p.isValueFlag(argc, i, argv[i], 'e', "--environment")) {
 		updates["default_environment"] = argv[i + 1];
 		i += 2;
@@ -324,9 +353,24 @@ parseCoreOption(int argc, const char *argv[], int &i, Json::Value &updates) {
 	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--max-requests")) {
 		updates["default_max_requests"] = atoi(argv[i + 1]);
 		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--max-requests-jitter")) {
+		updates["default_max_requests_jitter"] = atoi(argv[i + 1]);
+		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--max-request-time")) {
+		updates["default_max_request_time"] = atoi(argv[i + 1]);
+		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--memory-limit")) {
+		updates["default_memory_limit"] = atoi(argv[i + 1]);
+		i += 2;
 	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--max-request-queue-size")) {
 		updates["default_max_request_queue_size"] = atoi(argv[i + 1]);
 		i += 2;
+	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--request-queue-target-delay")) {
+		updates["default_request_queue_target_delay"] = atoi(argv[i + 1]);
+		i += 2;
+	} else if (p.isFlag(argv[i], '\0', "--request-queue-lifo")) {
+		updates["default_request_queue_lifo"] = true;
+		i++;
 	} else if (p.isFlag(argv[i], '\0', "--sticky-sessions")) {
 		updates["default_sticky_sessions"] = true;
 		i++;
@@ -366,6 +410,9 @@ parseCoreOption(int argc, const char *argv[], int &i, Json::Value &updates) {
 	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--fd-log-file")) {
 		updates["file_descriptor_log_target"] = argv[i + 1];
 		i += 2;
+	} else if (p.isFlag(argv[i], '\0', "--log-async")) {
+		updates["log_async"] = true;
+		i++;
 	} else if (p.isValueFlag(argc, i, argv[i], '\0', "--stat-throttle-rate")) {
 		updates["stat_throttle_rate"] = atoi(argv[i + 1]);
 		i += 2;
@@ -141,6 +141,8 @@ private:
 	HashedStaticString PASSENGER_VARY_TURBOCACHE_BY_COOKIE;
 
 	unsigned int fetches, hits, stores, storeSuccesses;
+	/** Like the above, but never reset. */
+	boost::uint64_t totalFetches, totalHits, totalStores, totalStoreSuccesses;
 
 	Header headers[MAX_ENTRIES];
 	Body bodies[MAX_ENTRIES];
@@ -170,7 +172,6 @@ private:
 	{
 		char *pos = output;
 		const char *end = output + size;
-		const LString::Part *part;
 
 		if (https) {
 			pos = appendData(pos, end, "S", 1);
@@ -179,11 +180,7 @@ private:
 		}
 
 		if (host != NULL) {
-			part = host->start;
-			while (part != NULL) {
-				pos = appendData(pos, end, part->data, part->size);
-				part = part->next;
-			}
+			pos = appendData(pos, end, host);
 		}
 
 		pos = appendData(pos, end, "\n", 1);
@@ -191,11 +188,7 @@ private:
 
 		if (varyCookie != NULL) {
 			pos = appendData(pos, end, "\n", 1);
-			part = varyCookie->start;
-			while (part != NULL) {
-				pos = appendData(pos, end, part->data, part->size);
-				part = part->next;
-			}
+			pos = appendData(pos, end, varyCookie);
 		}
 	}
 
@@ -356,21 +349,7 @@ private:
 			}
 
 			StaticString host = extractHostNameWithPortFromParsedUrl(url, value);
-			if (host.size() != req->host->size) {
-				// The host names don't match.
-				return;
-			}
-
-			char *lowercaseHost = (char *) psg_pnalloc(req->pool, host.size());
-			convertLowerCase((const unsigned char *) host.data(),
-				(unsigned char *) lowercaseHost, host.size());
-			host = StaticString(lowercaseHost, host.size());
-
-			char *lowercaseReqHost = (char *) psg_pnalloc(req->pool, req->host->size);
-			convertLowerCase((const unsigned char *) req->host->start->data,
-				(unsigned char *) lowercaseReqHost, req->host->size);
-
-			if (memcmp(host.data(), lowercaseReqHost, req->host->size) != 0) {
+			if (!psg_lstr_casecmp(req->host, host)) {
 				// The host names don't match.
 				return;
 			}
@@ -426,7 +405,11 @@ public:
 		  fetches(0),
 		  hits(0),
 		  stores(0),
-		  storeSuccesses(0)
+		  storeSuccesses(0),
+		  totalFetches(0),
+		  totalHits(0),
+		  totalStores(0),
+		  totalStoreSuccesses(0)
 		{ }
 
 	OXT_FORCE_INLINE
@@ -459,6 +442,26 @@ public:
 		return storeSuccesses / (double) stores;
 	}
 
+	OXT_FORCE_INLINE
+	boost::uint64_t getTotalFetches() const {
+		return totalFetches;
+	}
+
+	OXT_FORCE_INLINE
+	boost::uint64_t getTotalHits() const {
+		return totalHits;
+	}
+
+	OXT_FORCE_INLINE
+	boost::uint64_t getTotalStores() const {
+		return totalStores;
+	}
+
+	OXT_FORCE_INLINE
+	boost::uint64_t getTotalStoreSuccesses() const {
+		return totalStoreSuccesses;
+	}
+
 	// For decreasing the store success ratio without calling store().
 	OXT_FORCE_INLINE
 	void incStores() {
@@ -540,6 +543,7 @@ public:
 	// @pre requestAllowsFetching()
 	Entry fetch(Request *req, ev_tstamp now) {
 		fetches++;
+		totalFetches++;
 		if (OXT_UNLIKELY(fetches == 0)) {
 			// Value rolled over
 			fetches = 1;
@@ -549,6 +553,7 @@ public:
 		Entry entry(lookup(req->cacheKey));
 		if (entry.valid()) {
 			hits++;
+			totalHits++;
 			if (isFresh(entry, now)) {
 				return entry;
 			} else {
@@ -629,6 +634,7 @@ public:
 	// @pre prepareRequestForStoring()
 	Entry store(Request *req, ev_tstamp now, unsigned int headerSize, unsigned int bodySize) {
 		stores++;
+		totalStores++;
 
 		if (headerSize > MAX_HEADER_SIZE || bodySize > MAX_BODY_SIZE) {
 			return Entry();
@@ -658,6 +664,7 @@ public:
 		entry.body->httpHeaderSize = headerSize;
 		entry.body->httpBodySize   = bodySize;
 		storeSuccesses++;
+		totalStoreSuccesses++;
 		return entry;
 	}
 
@@ -88,18 +88,7 @@ private:
 					data.append(buf, ret);
 				}
 				UPDATE_TRACE_POINT();
-				if (ret == 1 && buf[0] == '\n') {
-					LoggingKit::logAppOutput(pid, channelName, "", 0);
-				} else {
-					vector<StaticString> lines;
-					if (ret > 0 && buf[ret - 1] == '\n') {
-						ret--;
-					}
-					split(StaticString(buf, ret), '\n', lines);
-					foreach (const StaticString line, lines) {
-						LoggingKit::logAppOutput(pid, channelName, line.data(), line.size());
-					}
-				}
+				LoggingKit::logAppOutputLines(pid, channelName, buf, ret);
 			}
 		}
 	}
@@ -43,6 +43,7 @@
 #include <LoggingKit/LoggingKit.h>
 #include <Utils.h>
 #include <Utils/StrIntUtils.h>
+#include <Utils/IOUtils.h>
 #include <Core/SpawningKit/Config.h>
 
 namespace Passenger {
@@ -53,6 +54,12 @@ using namespace boost;
 
 /** A PipeWatcher lives until the file descriptor is closed. */
 class PipeWatcher: public boost::enable_shared_from_this<PipeWatcher> {
+public:
+	/**
+	 * How long output is collected before it is logged, in milliseconds.
+	 */
+	static const unsigned int APP_OUTPUT_BATCH_INTERVAL = 10;
+
 private:
 	ConfigPtr config;
 	FileDescriptor fd;
@@ -61,6 +68,7 @@ private:
 	bool started;
 	boost::mutex startSyncher;
 	boost::condition_variable startCond;
+	LoggingKit::AppOutputRateLimiter rateLimiter;
 
 	static void threadMain(boost::shared_ptr<PipeWatcher> self) {
 		TRACE_POINT();
@@ -77,46 +85,61 @@ private:
 		}
 
 		UPDATE_TRACE_POINT();
-		while (!boost::this_thread::interruption_requested()) {
-			char buf[1024 * 8];
+		char buf[1024 * 32];
+		size_t bufSize = 0;
+		unsigned long long timeout = 0;
+		bool eof = false;
+
+		while (!eof && !boost::this_thread::interruption_requested()) {
 			ssize_t ret;
 
+			if (bufSize > 0) {
+				// Keep collecting output for a short while, so that
+				// chatty apps cause one log write per batch of lines
+				// instead of one per line.
+				UPDATE_TRACE_POINT();
+				if (bufSize > sizeof(buf) / 2 || !waitUntilReadable(fd, &timeout)) {
+					flush(buf, bufSize);
+					bufSize = 0;
+					continue;
+				}
+			}
+
 			UPDATE_TRACE_POINT();
-			ret = syscalls::read(fd, buf, sizeof(buf));
+			ret = syscalls::read(fd, buf + bufSize, sizeof(buf) - bufSize);
 			if (ret == 0) {
-				break;
+				eof = true;
 			} else if (ret == -1) {
 				UPDATE_TRACE_POINT();
 				if (errno == ECONNRESET) {
-					break;
+					eof = true;
 				} else if (errno != EAGAIN) {
 					int e = errno;
 					P_WARN("Cannot read from process " << pid << " " << name <<
 						": " << strerror(e) << " (errno=" << e << ")");
-					break;
+					eof = true;
 				}
-			} else if (ret == 1 && buf[0] == '\n') {
-				UPDATE_TRACE_POINT();
-				LoggingKit::logAppOutput(pid, name, "", 0);
 			} else {
-				UPDATE_TRACE_POINT();
-				vector<StaticString> lines;
-				ssize_t ret2 = ret;
-				if (ret2 > 0 && buf[ret2 - 1] == '\n') {
-					ret2--;
+				if (bufSize == 0) {
+					timeout = APP_OUTPUT_BATCH_INTERVAL * 1000;
 				}
-				split(StaticString(buf, ret2), '\n', lines);
-				foreach (const StaticString line, lines) {
-					LoggingKit::logAppOutput(pid, name, line.data(), line.size());
+				if (config->outputHandler) {
+					config->outputHandler(buf + bufSize, ret);
 				}
+				bufSize += ret;
 			}
+		}
 
-			if (config->outputHandler) {
-				config->outputHandler(buf, ret);
-			}
+		if (bufSize > 0) {
+			flush(buf, bufSize);
 		}
 	}
 
+	void flush(const char *buf, size_t size) {
+		TRACE_POINT();
+		LoggingKit::logAppOutputLines(pid, name, buf, size, &rateLimiter);
+	}
+
 public:
 	PipeWatcher(const ConfigPtr &_config, const FileDescriptor &_fd,
 		const char *_name, pid_t _pid)
@@ -27,7 +27,9 @@
 #define _PASSENGER_UNION_STATION_CONTEXT_H_
 
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <oxt/backtrace.hpp>
 
@@ -40,10 +42,12 @@
 #include <LoggingKit/LoggingKit.h>
 #include <Exceptions.h>
 #include <StaticString.h>
+#include <RandomGenerator.h>
 #include <Utils.h>
 #include <Utils/MessageIO.h>
 #include <Utils/SystemTime.h>
 #include <Core/UnionStation/Connection.h>
+#include <Core/UnionStation/Transport.h>
 #include <Core/UnionStation/Transaction.h>
 
 namespace Passenger {
@@ -53,9 +57,14 @@ using namespace std;
 using namespace boost;
 
 
+/**
+ * Entry point for sending data to the UstRouter. Transactions created by
+ * this class send their messages through a Transport, which owns the
+ * connection to the UstRouter.
+ */
 class Context: public boost::enable_shared_from_this<Context> {
 private:
-	static const unsigned int CONNECTION_POOL_MAX_SIZE = 10;
+	static const unsigned int TXN_ID_RANDOM_SIZE = 11;
 
 	/**** Server information ****/
 	const string serverAddress;
@@ -65,36 +74,67 @@ private:
 
 	/**** Working objects ****/
 	TransactionPtr nullTransaction;
+	boost::shared_ptr<RandomGenerator> randomGenerator;
+	TransportPtr transport;
+
+	void initialize(unsigned int ringCount, size_t ringSize) {
+		nullTransaction = boost::make_shared<Transaction>();
+		if (!isNull()) {
+			randomGenerator = boost::make_shared<RandomGenerator>();
+			transport = boost::make_shared<Transport>(
+				boost::bind(&Context::createNewConnection, this),
+				ringCount, ringSize);
+		}
+	}
 
-	/********************** Connection handling fields **********************
-	 * These fields are synchronized through the mutex. The contents
-	 * of the conntection objects are not synchronized through this mutex,
-	 * but through the Connection object's own mutex.
-	 ************************************************************************/
-	mutable boost::mutex syncher;
-	vector<ConnectionPtr> connectionPool;
-	/** How long to wait before reconnecting. */
-	unsigned long long reconnectTimeout;
-	/** Earliest time at which we should attempt a reconnect. Earlier attempts
-	 * will fail. Calculated from reconnectTimeout.
+	/**
+	 * Generates a transaction ID in the same format as the UstRouter does:
+	 * the number of minutes since the Epoch in hexatridecimal, a dash,
+	 * and random characters.
 	 */
-	unsigned long long nextReconnectTime;
-
-	static bool isNetworkError(int code) {
-		return code == EPIPE || code == ECONNREFUSED || code == ECONNRESET
-			|| code == EHOSTUNREACH || code == ENETDOWN || code == ENETUNREACH
-			|| code == ETIMEDOUT;
+	string generateTxnId() {
+		char timestampStr[2 * sizeof(unsigned long long) + 1];
+		unsigned int timestampSize = integerToHexatri<unsigned long long>(
+			SystemTime::getUsec() / 1000000 / 60, timestampStr);
+		string txnId;
+
+		txnId.reserve(timestampSize + 1 + TXN_ID_RANDOM_SIZE);
+		txnId.append(timestampStr, timestampSize);
+		txnId.append(1, '-');
+		txnId.append(TXN_ID_RANDOM_SIZE, '\0');
+		randomGenerator->generateAsciiString(&txnId[timestampSize + 1],
+			TXN_ID_RANDOM_SIZE);
+		return txnId;
 	}
 
-	template<typename T>
-	static bool instanceof(const std::exception &e) {
-		return dynamic_cast<const T *>(&e) != NULL;
-	}
+	/**
+	 * Sends an `openTransaction` message without asking for an
+	 * acknowledgement. Returns false if the message was dropped.
+	 */
+	bool openTransaction(unsigned int ringIndex, const string &txnId, const string &groupName,
+		const string &category, const string &unionStationKey,
+		const string &filters = string())
+	{
+		char timestampStr[2 * sizeof(unsigned long long) + 1];
+		integerToHexatri<unsigned long long>(SystemTime::getUsec(), timestampStr);
 
-	void initialize() {
-		nullTransaction   = boost::make_shared<Transaction>();
-		reconnectTimeout  = 1000000;
-		nextReconnectTime = 0;
+		StaticString params[] = {
+			StaticString("openTransaction", sizeof("openTransaction") - 1),
+			txnId,
+			groupName,
+			// empty nodeName, implies using the default
+			// nodeName passed during initialization
+			StaticString(),
+			category,
+			timestampStr,
+			unionStationKey,
+			P_STATIC_STRING("true"),  // crashProtect
+			P_STATIC_STRING("false"), // ack
+			filters
+		};
+		unsigned int nparams = sizeof(params) / sizeof(StaticString);
+
+		return transport->sendMessage(ringIndex, params, nparams);
 	}
 
 	ConnectionPtr createNewConnection() {
@@ -174,73 +214,19 @@ private:
 
 public:
 	Context() {
-		initialize();
+		initialize(0, 0);
 	}
 
 	Context(const string &_serverAddress, const string &_username,
-	     const string &_password, const string &_nodeName = string())
+	     const string &_password, const string &_nodeName = string(),
+	     unsigned int ringCount = Transport::DEFAULT_RING_COUNT,
+	     size_t ringSize = Transport::DEFAULT_RING_SIZE)
 		: serverAddress(_serverAddress),
 		  username(_username),
 		  password(_password),
 		  nodeName(_nodeName)
 	{
-		initialize();
-	}
-
-
-	/***** Connection pool methods *****/
-
-	ConnectionPtr checkoutConnection() {
-		TRACE_POINT();
-		boost::unique_lock<boost::mutex> l(syncher);
-		if (!connectionPool.empty()) {
-			P_TRACE(3, "Checked out existing connection");
-			ConnectionPtr connection = connectionPool.back();
-			connectionPool.pop_back();
-			return connection;
-
-		} else {
-			if (SystemTime::getUsec() < nextReconnectTime) {
-				P_TRACE(3, "Not yet time to reconnect; returning NULL connection");
-				return ConnectionPtr();
-			}
-
-			l.unlock();
-			P_TRACE(3, "Creating new connection with UstRouter");
-			ConnectionPtr connection;
-			try {
-				connection = createNewConnection();
-			} catch (const TimeoutException &) {
-				l.lock();
-				P_WARN("Timeout trying to connect to the UstRouter at " << serverAddress << "; " <<
-					"will reconnect in " << reconnectTimeout / 1000000 << " second(s).");
-				nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-				return ConnectionPtr();
-			} catch (const tracable_exception &e) {
-				l.lock();
-				nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-				if (instanceof<IOException>(e) || instanceof<SystemException>(e)) {
-					P_WARN("Cannot connect to the UstRouter at " << serverAddress <<
-						" (" << e.what() << "); will reconnect in " <<
-						reconnectTimeout / 1000000 << " second(s).");
-					return ConnectionPtr();
-				} else {
-					throw;
-				}
-			}
-
-			return connection;
-		}
-	}
-
-	void checkinConnection(const ConnectionPtr &connection) {
-		boost::unique_lock<boost::mutex> l(syncher);
-		if (connectionPool.size() < CONNECTION_POOL_MAX_SIZE) {
-			connectionPool.push_back(connection);
-		} else {
-			l.unlock();
-			connection->disconnect();
-		}
+		initialize(ringCount, ringSize);
 	}
 
 
@@ -250,133 +236,11 @@ public:
 		return nullTransaction;
 	}
 
-	void handleTimeout() {
-		boost::lock_guard<boost::mutex> l(syncher);
-		P_WARN("Timeout trying to communicate with the UstRouter at " <<
-			serverAddress << "; " << "will reconnect in " <<
-			reconnectTimeout / 1000000 << " second(s).");
-		nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-	}
-
-	void handleNetworkErrorOrThrow(const ConnectionPtr &connection,
-		ConnectionGuard &guard, const SystemException &e)
-	{
-		if (e.code() == ENOENT || isNetworkError(e.code())) {
-			guard.clear();
-			boost::lock_guard<boost::mutex> l(syncher);
-			P_WARN("The UstRouter at " << serverAddress <<
-				" closed the connection (no error message given);" <<
-				" will reconnect in " << reconnectTimeout / 1000000 <<
-				" second(s).");
-			nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-		} else {
-			throw e;
-		}
-	}
-
-	bool sendRequest(const ConnectionPtr &connection, StaticString argsSend[],
-			unsigned int nrArgsSend)
-	{
-		ConnectionLock cl(connection);
-		ConnectionGuard guard(connection.get());
-
-		try {
-			unsigned long long timeout = 15000000;
-
-			writeArrayMessage(connection->fd, argsSend, nrArgsSend, &timeout);
-
-			guard.clear();
-			return true;
-		} catch (const TimeoutException &) {
-			handleTimeout();
-			return false;
-		} catch (const SystemException &e) {
-			handleNetworkErrorOrThrow(connection, guard, e);
-			return false;
-		}
-	}
-
-	bool sendRequestGetResponse(const ConnectionPtr &connection,
-		StaticString argsSend[], unsigned int nrArgsSend,
-		vector<string> &argsReply, unsigned int expectedExtraReplyArgs = 0)
-	{
-		ConnectionLock cl(connection);
-		ConnectionGuard guard(connection.get());
-
-		try {
-			unsigned long long timeout = 15000000;
-
-			writeArrayMessage(connection->fd, argsSend, nrArgsSend, &timeout);
-
-			if (!readArrayMessage(connection->fd, argsReply, &timeout)) {
-				boost::lock_guard<boost::mutex> l(syncher);
-				P_WARN("The UstRouter at " << serverAddress <<
-					" closed the connection (no error message given);" <<
-					" will reconnect in " << reconnectTimeout / 1000000 <<
-					" second(s).");
-				nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-				return false;
-			}
-
-			if (argsReply.size() < 2 || argsReply[0] != "status") {
-				boost::lock_guard<boost::mutex> l(syncher);
-				P_WARN("The UstRouter sent an invalid reply message;" <<
-					" will reconnect in " << reconnectTimeout / 1000000 <<
-					" second(s).");
-				nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-				return false;
-			}
-
-			if (argsReply[1] == "error") {
-				boost::lock_guard<boost::mutex> l(syncher);
-				if (argsReply.size() >= 3) {
-					P_WARN("The UstRouter closed the connection "
-						"(error message: " << argsReply[2] <<
-						"); will reconnect in " <<
-						reconnectTimeout / 1000000 <<
-						" second(s).");
-				} else {
-					P_WARN("The UstRouter closed the connection "
-						"(no server message given); " <<
-						"will reconnect in " <<
-						reconnectTimeout / 1000000 <<
-						" second(s).");
-				}
-				nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-				return false;
-			}
-
-			if (argsReply[1] != "ok") {
-				boost::lock_guard<boost::mutex> l(syncher);
-				P_WARN("The UstRouter sent an invalid reply message;" <<
-					" will reconnect in " << reconnectTimeout / 1000000 <<
-					" second(s).");
-				nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-				return false;
-			}
-
-			if (argsReply.size() < 2 + expectedExtraReplyArgs) {
-				boost::lock_guard<boost::mutex> l(syncher);
-				P_WARN("The UstRouter sent an invalid reply message"
-					" (\"ok\" status message has too few arguments);" <<
-					" will reconnect in " << reconnectTimeout / 1000000 <<
-					" second(s).");
-				nextReconnectTime = SystemTime::getUsec() + reconnectTimeout;
-				return false;
-			}
-
-			guard.clear();
-			return true;
-
-		} catch (const TimeoutException &) {
-			handleTimeout();
-			return false;
-		} catch (const SystemException &e) {
-			handleNetworkErrorOrThrow(connection, guard, e);
-			return false;
-		}
-	}
-
+	/**
+	 * Creates a new transaction. This doesn't wait for the UstRouter: the
+	 * transaction ID is generated locally, and the messages that open the
+	 * transaction and log to it are sent in the background.
+	 */
 	TransactionPtr newTransaction(const string &groupName,
 		const string &category = "requests",
 		const string &unionStationKey = "-",
@@ -386,58 +250,25 @@ public:
 			return createNullTransaction();
 		}
 
-		// Prepare parameters.
-		unsigned long long timestamp = SystemTime::getUsec();
-		char timestampStr[2 * sizeof(unsigned long long) + 1];
-
-		integerToHexatri<unsigned long long>(timestamp, timestampStr);
-		StaticString params[] = {
-			StaticString("openTransaction", sizeof("openTransaction") - 1),
-			// empty txnId, implies that it should be autogenerated by
-			// the UstRouter
-			StaticString(),
-			groupName,
-			// empty nodeName, implies using the default
-			// nodeName passed during initialization
-			StaticString(),
-			category,
-			timestampStr,
-			unionStationKey,
-			P_STATIC_STRING("true"), // crashProtect
-			P_STATIC_STRING("true"), // ack
-			filters
-		};
-		unsigned int nparams = sizeof(params) / sizeof(StaticString);
-
-		// Get a connection to the UstRouter.
-		ConnectionPtr connection = checkoutConnection();
-		if (connection == NULL) {
+		string txnId = generateTxnId();
+		unsigned int ringIndex = transport->getRingIndexForCurrentThread();
+		if (!openTransaction(ringIndex, txnId, groupName, category, unionStationKey, filters)) {
 			P_TRACE(2, "Created NULL Union Station transaction: group=" << groupName <<
 				", category=" << category);
 			return createNullTransaction();
 		}
 
-		// The router will generate a txnId for us and pass it in the response.
-		vector<string> argsReply;
-		if (sendRequestGetResponse(connection, params, nparams, argsReply, 1)) {
-			string txnId = argsReply[2];
-			ConnectionGuard guard(connection.get());
-			TransactionPtr transaction = boost::make_shared<Transaction>(
-				shared_from_this(),
-				connection,
-				txnId,
-				groupName,
-				category,
-				unionStationKey);
-			guard.clear();
-			P_TRACE(2, "Created new Union Station transaction: group=" << groupName <<
-				", category=" << category << ", txnId=" << txnId);
-			return transaction;
-		} else {
-			P_TRACE(2, "Created NULL Union Station transaction: group=" << groupName <<
-				", category=" << category);
-			return createNullTransaction();
-		}
+		TransactionPtr transaction = boost::make_shared<Transaction>(
+			shared_from_this(),
+			transport,
+			ringIndex,
+			txnId,
+			groupName,
+			category,
+			unionStationKey);
+		P_TRACE(2, "Created new Union Station transaction: group=" << groupName <<
+			", category=" << category << ", txnId=" << txnId);
+		return transaction;
 	}
 
 	TransactionPtr continueTransaction(const string &txnId,
@@ -449,60 +280,41 @@ public:
 			return createNullTransaction();
 		}
 
-		// Prepare parameters.
-		char timestampStr[2 * sizeof(unsigned long long) + 1];
-		integerToHexatri<unsigned long long>(SystemTime::getUsec(), timestampStr);
+		unsigned int ringIndex = transport->getRingIndexForCurrentThread();
+		if (!openTransaction(ringIndex, txnId, groupName, category, unionStationKey)) {
+			return createNullTransaction();
+		}
 
-		StaticString params[] = {
-			StaticString("openTransaction", sizeof("openTransaction") - 1),
+		return boost::make_shared<Transaction>(
+			shared_from_this(),
+			transport,
+			ringIndex,
 			txnId,
 			groupName,
-			// empty nodeName, implies using the default
-			// nodeName passed during initialization
-			StaticString(),
 			category,
-			timestampStr,
-			unionStationKey,
-			P_STATIC_STRING("true"),  // crashProtect
-			P_STATIC_STRING("false")  // ack
-		};
-		unsigned int nparams = sizeof(params) / sizeof(StaticString);
-
-		// Get a connection to the UstRouter.
-		ConnectionPtr connection = checkoutConnection();
-		if (connection == NULL) {
-			return createNullTransaction();
-		}
-
-		// We didn't ask for a response (ack), so just send here.
-		if (sendRequest(connection, params, nparams)) {
-			ConnectionGuard guard(connection.get());
-			TransactionPtr transaction = boost::make_shared<Transaction>(
-				shared_from_this(),
-				connection,
-				txnId,
-				groupName,
-				category,
-				unionStationKey);
-			guard.clear();
-			return transaction;
-		} else {
-			return createNullTransaction();
-		}
+			unionStationKey);
 	}
 
 
 	/***** Parameter getters and setters *****/
 
 	void setReconnectTimeout(unsigned long long usec) {
-		boost::lock_guard<boost::mutex> l(syncher);
-		reconnectTimeout = usec;
+		if (transport != NULL) {
+			transport->setReconnectTimeout(usec);
+		}
 	}
 
 	bool isNull() const {
 		return serverAddress.empty();
 	}
 
+	/**
+	 * Returns the transport, or NULL if this is a null context.
+	 */
+	const TransportPtr &getTransport() const {
+		return transport;
+	}
+
 	const string &getAddress() const {
 		return serverAddress;
 	}
@@ -524,12 +336,6 @@ public:
 };
 
 
-inline void
-_checkinConnection(const ContextPtr &ctx, const ConnectionPtr &connection) {
-	ctx->checkinConnection(connection);
-}
-
-
 } // namespace UnionStation
 } // namespace Passenger
 
@@ -62,14 +62,7 @@ private:
 		return timestamp;
 	}
 
-public:
-	StopwatchLog()
-		: transaction(NULL)
-		{ }
-
-	StopwatchLog(const TransactionPtr &_transaction, const char *id, const char *nameAndData)
-		: transaction(_transaction.get())
-	{
+	void logBegin(const char *id, const char *nameAndData, MonotonicTimeUsec beginTime) {
 		this->id = id;
 		ok = false;
 
@@ -81,7 +74,7 @@ public:
 		pos = appendData(pos, end, "BEGIN: ");
 		pos = appendData(pos, end, id);
 		pos = appendData(pos, end, " (");
-		pos = appendData(pos, end, usecToString(SystemTime::getMonotonicUsec()));
+		pos = appendData(pos, end, usecToString(beginTime));
 		pos = appendData(pos, end, ",");
 		if (getrusage(RUSAGE_SELF, &usage) == -1) {
 			int e = errno;
@@ -105,6 +98,30 @@ public:
 		}
 	}
 
+public:
+	StopwatchLog()
+		: transaction(NULL)
+		{ }
+
+	StopwatchLog(const TransactionPtr &_transaction, const char *id, const char *nameAndData)
+		: transaction(_transaction.get())
+	{
+		logBegin(id, nameAndData, SystemTime::getMonotonicUsec());
+	}
+
+	/**
+	 * Logs a period that began at `beginTime`, a timestamp obtained from
+	 * SystemTime::getMonotonicUsec(). This is for transactions that are only
+	 * created at the end of the period. The CPU usage at the beginning of the
+	 * period is unknown, so it is logged as the current CPU usage.
+	 */
+	StopwatchLog(const TransactionPtr &_transaction, const char *id, const char *nameAndData,
+		MonotonicTimeUsec beginTime)
+		: transaction(_transaction.get())
+	{
+		logBegin(id, nameAndData, beginTime);
+	}
+
 	~StopwatchLog() {
 		if (transaction == NULL) {
 			return;
@@ -33,16 +33,12 @@
 #include <string>
 #include <stdexcept>
 
-#include <cstdio>
-#include <cassert>
-
 #include <LoggingKit/LoggingKit.h>
 #include <Exceptions.h>
 #include <StaticString.h>
-#include <Utils/IOUtils.h>
 #include <Utils/SystemTime.h>
 #include <Utils/StrIntUtils.h>
-#include <Core/UnionStation/Connection.h>
+#include <Core/UnionStation/Transport.h>
 
 namespace Passenger {
 namespace UnionStation {
@@ -61,50 +57,23 @@ enum ExceptionHandlingMode {
 class Context;
 typedef boost::shared_ptr<Context> ContextPtr;
 
-inline void _checkinConnection(const ContextPtr &ctx, const ConnectionPtr &connection);
-
 
+/**
+ * A Union Station transaction. Messages are handed to the Transport, which
+ * sends them to the UstRouter in the background, so none of the methods
+ * here block on I/O.
+ */
 class Transaction: public boost::noncopyable {
 private:
-	static const int INT64_STR_BUFSIZE = 22; // Long enough for a 64-bit number.
-	static const unsigned long long IO_TIMEOUT = 5000000; // In microseconds.
-
 	const ContextPtr context;
-	const ConnectionPtr connection;
+	const TransportPtr transport;
+	const unsigned int ringIndex;
 	const string txnId;
 	const string groupName;
 	const string category;
 	const string unionStationKey;
 	const ExceptionHandlingMode exceptionHandlingMode;
 
-	/**
-	 * Buffer must be at least txnId.size() + 1 + INT64_STR_BUFSIZE + 1 bytes.
-	 */
-	char *insertTxnIdAndTimestamp(char *buffer, const char *end) {
-		assert(end - buffer >= int(txnId.size() + 1 + INT64_STR_BUFSIZE + 1));
-		int size;
-
-		// "txn-id-here"
-		buffer = appendData(buffer, end, txnId);
-
-		// "txn-id-here "
-		buffer = appendData(buffer, end, " ", 1);
-
-		// "txn-id-here 123456"
-		assert(end - buffer >= INT64_STR_BUFSIZE);
-		size = snprintf(buffer, INT64_STR_BUFSIZE, "%llu", SystemTime::getUsec());
-		if (size >= INT64_STR_BUFSIZE) {
-			// The buffer is too small.
-			throw IOException("Cannot format a new transaction log message timestamp.");
-		}
-		buffer += size;
-
-		// "txn-id-here 123456 "
-		buffer = appendData(buffer, end, " ", 1);
-
-		return buffer;
-	}
-
 	template<typename ExceptionType>
 	void handleException(const ExceptionType &e) {
 		switch (exceptionHandlingMode) {
@@ -127,18 +96,26 @@ private:
 
 public:
 	Transaction()
-		: exceptionHandlingMode(PRINT)
+		: ringIndex(0),
+		  exceptionHandlingMode(PRINT)
 		{ }
 
+	/**
+	 * @param ringIndex The Transport ring that all messages of this
+	 *                  transaction are sent through, so that they
+	 *                  stay in order.
+	 */
 	Transaction(const ContextPtr &_context,
-		const ConnectionPtr &_connection,
+		const TransportPtr &_transport,
+		unsigned int _ringIndex,
 		const string &_txnId,
 		const string &_groupName,
 		const string &_category,
 		const string &_unionStationKey,
 		ExceptionHandlingMode _exceptionHandlingMode = PRINT)
 		: context(_context),
-		  connection(_connection),
+		  transport(_transport),
+		  ringIndex(_ringIndex),
 		  txnId(_txnId),
 		  groupName(_groupName),
 		  category(_category),
@@ -148,11 +125,7 @@ public:
 
 	~Transaction() {
 		TRACE_POINT();
-		if (connection == NULL) {
-			return;
-		}
-		ConnectionLock l(connection);
-		if (!connection->connected()) {
+		if (transport == NULL) {
 			return;
 		}
 
@@ -160,34 +133,23 @@ public:
 		integerToHexatri<unsigned long long>(SystemTime::getUsec(),
 			timestamp);
 
-		UPDATE_TRACE_POINT();
-		ConnectionGuard guard(connection.get());
+		StaticString args[] = {
+			P_STATIC_STRING("closeTransaction"),
+			txnId,
+			timestamp
+		};
 		try {
-			unsigned long long timeout = IO_TIMEOUT;
-			writeArrayMessage(connection->fd, &timeout,
-				"closeTransaction",
-				txnId.c_str(),
-				timestamp,
-				NULL);
-
-			_checkinConnection(context, connection);
-			guard.clear();
-		} catch (const SystemException &e) {
+			transport->sendMessage(ringIndex, args,
+				sizeof(args) / sizeof(StaticString));
+		} catch (const std::exception &e) {
 			UPDATE_TRACE_POINT();
-			guard.clear();
-			connection->disconnect();
 			handleException(e);
 		}
 	}
 
 	void message(const StaticString &text) {
 		TRACE_POINT();
-		if (connection == NULL) {
-			P_TRACE(3, "[Union Station log to null] " << text);
-			return;
-		}
-		ConnectionLock l(connection);
-		if (!connection->connected()) {
+		if (transport == NULL) {
 			P_TRACE(3, "[Union Station log to null] " << text);
 			return;
 		}
@@ -195,22 +157,17 @@ public:
 		char timestamp[2 * sizeof(unsigned long long) + 1];
 		integerToHexatri<unsigned long long>(SystemTime::getUsec(), timestamp);
 
-		UPDATE_TRACE_POINT();
-		ConnectionGuard guard(connection.get());
+		P_TRACE(3, "[Union Station log] " << txnId << " " << timestamp << " " << text);
+		StaticString args[] = {
+			P_STATIC_STRING("log"),
+			txnId,
+			timestamp
+		};
 		try {
-			unsigned long long timeout = IO_TIMEOUT;
-			P_TRACE(3, "[Union Station log] " << txnId << " " << timestamp << " " << text);
-			writeArrayMessage(connection->fd, &timeout,
-				"log",
-				txnId.c_str(),
-				timestamp,
-				NULL);
-			writeScalarMessage(connection->fd, text, &timeout);
-			guard.clear();
+			transport->sendMessage(ringIndex, args,
+				sizeof(args) / sizeof(StaticString), &text);
 		} catch (const std::exception &e) {
 			UPDATE_TRACE_POINT();
-			guard.clear();
-			connection->disconnect();
 			handleException(e);
 		}
 	}
@@ -220,7 +177,7 @@ public:
 	}
 
 	bool isNull() const {
-		return connection == NULL;
+		return transport == NULL;
 	}
 
 	const string &getTxnId() const {
@@ -0,0 +1,586 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_UNION_STATION_TRANSPORT_H_
+#define _PASSENGER_UNION_STATION_TRANSPORT_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/cstdint.hpp>
+#include <oxt/thread.hpp>
+#include <oxt/backtrace.hpp>
+#include <oxt/macros.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+#include <LoggingKit/LoggingKit.h>
+#include <Exceptions.h>
+#include <StaticString.h>
+#include <MessageReadersWriters.h>
+#include <Utils/IOUtils.h>
+#include <Utils/SystemTime.h>
+#include <Core/UnionStation/Connection.h>
+
+namespace Passenger {
+namespace UnionStation {
+
+using namespace std;
+using namespace boost;
+
+
+/**
+ * Sends messages to the UstRouter without blocking the caller.
+ *
+ * Callers append fully encoded protocol messages to a bounded ring
+ * buffer. A background sender thread drains all ring buffers and writes
+ * their contents to the UstRouter in batches, with a single writev()
+ * per batch. If the rings are full, because the UstRouter is slow or
+ * unreachable, the message is dropped and counted instead of blocking
+ * the caller.
+ *
+ * Every thread is mapped to one of a fixed number of rings by its
+ * thread ID, so the threads that log the most (the controller's event
+ * loop threads) normally have a ring of their own, and appending is just
+ * a memcpy() plus an uncontended flag. All messages for a transaction
+ * go to the same ring, so the sender preserves their order.
+ *
+ * Ring memory is allocated when a ring is first used, and is bounded by
+ * `ringCount * ringSize`.
+ */
+class Transport: public boost::noncopyable {
+public:
+	typedef boost::function<ConnectionPtr ()> ConnectFunction;
+
+	static const unsigned int DEFAULT_RING_COUNT = 16;
+	static const unsigned int DEFAULT_RING_SIZE = 256 * 1024;
+
+private:
+	static const unsigned int MAX_BATCH_SIZE = 256 * 1024;
+	static const unsigned int MAX_BATCH_ITEMS = 1024;
+	static const unsigned long long IO_TIMEOUT = 5000000; // In microseconds.
+	static const unsigned int MAX_MESSAGE_ARGS = 12;
+	static const unsigned long long DROP_REPORT_INTERVAL = 10000000; // In microseconds.
+
+	/**
+	 * A single-consumer ring buffer of records. Each record consists of a
+	 * 32-bit length header in native byte order, followed by the record data.
+	 * `head` and `tail` increase monotonically; the position in `buffer`
+	 * is obtained by masking them, so records may wrap around the end.
+	 *
+	 * Producers serialize among each other through `producerLock`. The
+	 * consumer never takes that lock: it only reads records before `head`
+	 * and releases space by advancing `tail`.
+	 */
+	struct Ring {
+		char * const buffer;
+		const size_t mask;
+		boost::atomic<bool> producerLock;
+		boost::atomic<size_t> head;
+		boost::atomic<size_t> tail;
+
+		Ring(size_t size)
+			: buffer(new char[size]),
+			  mask(size - 1),
+			  producerLock(false),
+			  head(0),
+			  tail(0)
+			{ }
+
+		~Ring() {
+			delete[] buffer;
+		}
+
+		size_t capacity() const {
+			return mask + 1;
+		}
+
+		void lockProducer() {
+			while (producerLock.exchange(true, boost::memory_order_acquire)) {
+				boost::this_thread::yield();
+			}
+		}
+
+		void unlockProducer() {
+			producerLock.store(false, boost::memory_order_release);
+		}
+
+		void copyIn(size_t pos, const char *data, size_t size) {
+			size_t offset = pos & mask;
+			size_t firstPart = std::min(size, capacity() - offset);
+			memcpy(buffer + offset, data, firstPart);
+			memcpy(buffer, data + firstPart, size - firstPart);
+		}
+
+		void copyOut(size_t pos, char *data, size_t size) const {
+			size_t offset = pos & mask;
+			size_t firstPart = std::min(size, capacity() - offset);
+			memcpy(data, buffer + offset, firstPart);
+			memcpy(data + firstPart, buffer, size - firstPart);
+		}
+
+		/**
+		 * Appends a record consisting of the concatenation of `parts`.
+		 * Returns false if there is not enough free space.
+		 */
+		bool push(const StaticString parts[], unsigned int count, size_t size) {
+			boost::uint32_t header = size;
+			size_t needed = sizeof(header) + size;
+
+			lockProducer();
+			size_t h = head.load(boost::memory_order_relaxed);
+			size_t t = tail.load(boost::memory_order_acquire);
+			if (capacity() - (h - t) < needed) {
+				unlockProducer();
+				return false;
+			}
+
+			copyIn(h, (const char *) &header, sizeof(header));
+			size_t pos = h + sizeof(header);
+			for (unsigned int i = 0; i < count; i++) {
+				copyIn(pos, parts[i].data(), parts[i].size());
+				pos += parts[i].size();
+			}
+			head.store(pos, boost::memory_order_release);
+			unlockProducer();
+			return true;
+		}
+	};
+
+	/** A range of records in a ring that the sender has collected for a batch. */
+	struct Collected {
+		Ring *ring;
+		size_t newTail;
+	};
+
+	const ConnectFunction connectFunction;
+	const unsigned int ringCount;
+	const size_t ringSize;
+	boost::atomic<Ring *> *rings;
+
+	boost::atomic<boost::uint64_t> sentMessages;
+	boost::atomic<boost::uint64_t> droppedMessages;
+	boost::atomic<boost::uint64_t> batches;
+	boost::atomic<bool> senderIdle;
+
+	/**
+	 * Fields below are synchronized through the syncher. The connection
+	 * is only accessed by the sender thread.
+	 */
+	boost::mutex syncher;
+	boost::condition_variable cond;
+	bool quit;
+	/** How long to wait before reconnecting. */
+	unsigned long long reconnectTimeout;
+	ConnectionPtr connection;
+	unsigned long long nextReconnectTime;
+	boost::uint64_t lastReportedDroppedMessages;
+	unsigned long long lastDropReportTime;
+
+	oxt::thread *thr;
+
+	static size_t roundUpToPowerOfTwo(size_t size) {
+		size_t result = 1024;
+		while (result < size) {
+			result *= 2;
+		}
+		return result;
+	}
+
+	Ring *getRing(unsigned int index) {
+		Ring *ring = rings[index].load(boost::memory_order_acquire);
+		if (OXT_UNLIKELY(ring == NULL)) {
+			Ring *newRing = new Ring(ringSize);
+			if (rings[index].compare_exchange_strong(ring, newRing,
+				boost::memory_order_acq_rel))
+			{
+				ring = newRing;
+			} else {
+				// Another thread installed a ring first. `ring`
+				// now contains that ring.
+				delete newRing;
+			}
+		}
+		return ring;
+	}
+
+	bool hasPendingRecords() const {
+		for (unsigned int i = 0; i < ringCount; i++) {
+			Ring *ring = rings[i].load(boost::memory_order_acquire);
+			if (ring != NULL
+			 && ring->head.load(boost::memory_order_acquire)
+			    != ring->tail.load(boost::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void wakeupSender() {
+		boost::lock_guard<boost::mutex> l(syncher);
+		cond.notify_one();
+	}
+
+	/**
+	 * Waits until there are records to send, or until quit is requested.
+	 * Returns false if the sender should exit.
+	 */
+	bool waitForRecords() {
+		boost::unique_lock<boost::mutex> l(syncher);
+		while (true) {
+			senderIdle.store(true, boost::memory_order_relaxed);
+			// Pairs with the fence in sendMessage(): either we see
+			// the producer's record, or it sees that we are idle.
+			boost::atomic_thread_fence(boost::memory_order_seq_cst);
+			if (hasPendingRecords()) {
+				senderIdle.store(false, boost::memory_order_relaxed);
+				return true;
+			} else if (quit) {
+				return false;
+			}
+			// The timeout guards against wakeups that we may
+			// miss while a producer is between its push and its
+			// check of senderIdle.
+			cond.timed_wait(l, boost::posix_time::millisec(100));
+		}
+	}
+
+	/**
+	 * Walks the records in all rings and adds them to `items`, until the
+	 * batch limits are reached. Records that wrap around the end of a ring
+	 * are added as two items.
+	 */
+	unsigned int collectRecords(vector<StaticString> &items, vector<Collected> &collected) {
+		size_t batchSize = 0;
+		unsigned int records = 0;
+
+		for (unsigned int i = 0; i < ringCount; i++) {
+			Ring *ring = rings[i].load(boost::memory_order_acquire);
+			if (ring == NULL) {
+				continue;
+			}
+
+			size_t h = ring->head.load(boost::memory_order_acquire);
+			size_t t = ring->tail.load(boost::memory_order_relaxed);
+			size_t pos = t;
+
+			while (pos != h
+				&& batchSize < MAX_BATCH_SIZE
+				&& items.size() + 2 <= MAX_BATCH_ITEMS)
+			{
+				boost::uint32_t size;
+				ring->copyOut(pos, (char *) &size, sizeof(size));
+				pos += sizeof(size);
+
+				size_t offset = pos & ring->mask;
+				size_t firstPart = std::min<size_t>(size, ring->capacity() - offset);
+				items.push_back(StaticString(ring->buffer + offset, firstPart));
+				if (firstPart < size) {
+					items.push_back(StaticString(ring->buffer, size - firstPart));
+				}
+				pos += size;
+				batchSize += size;
+				records++;
+			}
+
+			if (pos != t) {
+				Collected c;
+				c.ring = ring;
+				c.newTail = pos;
+				collected.push_back(c);
+			}
+		}
+
+		return records;
+	}
+
+	void releaseRecords(const vector<Collected> &collected) {
+		vector<Collected>::const_iterator it, end = collected.end();
+		for (it = collected.begin(); it != end; it++) {
+			it->ring->tail.store(it->newTail, boost::memory_order_release);
+		}
+	}
+
+	bool ensureConnected() {
+		TRACE_POINT();
+		if (connection != NULL && connection->connected()) {
+			return true;
+		}
+
+		unsigned long long now = SystemTime::getMonotonicUsec();
+		unsigned long long timeout;
+		{
+			boost::lock_guard<boost::mutex> l(syncher);
+			if (now < nextReconnectTime) {
+				return false;
+			}
+			timeout = reconnectTimeout;
+		}
+
+		P_TRACE(3, "Creating new connection with UstRouter");
+		try {
+			connection = connectFunction();
+			if (connection != NULL) {
+				return true;
+			}
+		} catch (const TimeoutException &) {
+			P_WARN("Timeout trying to connect to the UstRouter; " <<
+				"will reconnect in " << timeout / 1000000 << " second(s).");
+		} catch (const tracable_exception &e) {
+			P_WARN("Cannot connect to the UstRouter (" << e.what() <<
+				"); will reconnect in " << timeout / 1000000 << " second(s).");
+		}
+
+		connection.reset();
+		boost::lock_guard<boost::mutex> l(syncher);
+		nextReconnectTime = SystemTime::getMonotonicUsec() + timeout;
+		return false;
+	}
+
+	void disconnect(const char *reason) {
+		unsigned long long timeout;
+		{
+			boost::lock_guard<boost::mutex> l(syncher);
+			timeout = reconnectTimeout;
+			nextReconnectTime = SystemTime::getMonotonicUsec() + timeout;
+		}
+		P_WARN("Error communicating with the UstRouter (" << reason <<
+			"); will reconnect in " << timeout / 1000000 << " second(s).");
+		connection.reset();
+	}
+
+	/**
+	 * Sends one batch. If we are not connected and cannot connect, then the
+	 * collected records are dropped, so that the rings do not stay full
+	 * until the UstRouter comes back. If a write fails, then the entire
+	 * batch is dropped: we don't know which records the UstRouter received
+	 * completely, and the connection is closed anyway.
+	 */
+	void sendBatch() {
+		TRACE_POINT();
+		vector<StaticString> items;
+		vector<Collected> collected;
+		unsigned int records;
+
+		items.reserve(MAX_BATCH_ITEMS);
+		records = collectRecords(items, collected);
+		if (records == 0) {
+			return;
+		}
+
+		if (!ensureConnected()) {
+			droppedMessages.fetch_add(records, boost::memory_order_relaxed);
+		} else {
+			UPDATE_TRACE_POINT();
+			try {
+				unsigned long long timeout = IO_TIMEOUT;
+				gatheredWrite(connection->fd, &items[0], items.size(), &timeout);
+				sentMessages.fetch_add(records, boost::memory_order_relaxed);
+				batches.fetch_add(1, boost::memory_order_relaxed);
+			} catch (const TimeoutException &) {
+				disconnect("write timeout");
+				droppedMessages.fetch_add(records, boost::memory_order_relaxed);
+			} catch (const SystemException &e) {
+				disconnect(e.what());
+				droppedMessages.fetch_add(records, boost::memory_order_relaxed);
+			}
+		}
+
+		releaseRecords(collected);
+		reportDroppedMessages();
+	}
+
+	/** Logs the number of dropped messages, at most once every 10 seconds. */
+	void reportDroppedMessages() {
+		boost::uint64_t dropped = droppedMessages.load(boost::memory_order_relaxed);
+		if (dropped == lastReportedDroppedMessages) {
+			return;
+		}
+
+		unsigned long long now = SystemTime::getMonotonicUsec();
+		if (now - lastDropReportTime >= DROP_REPORT_INTERVAL) {
+			P_WARN("Dropped " << (dropped - lastReportedDroppedMessages) <<
+				" Union Station message(s) because the UstRouter is"
+				" unreachable or cannot keep up (" << dropped << " in total)");
+			lastReportedDroppedMessages = dropped;
+			lastDropReportTime = now;
+		}
+	}
+
+	void senderMain() {
+		TRACE_POINT();
+		boost::this_thread::disable_interruption di;
+		boost::this_thread::disable_syscall_interruption dsi;
+
+		while (waitForRecords()) {
+			UPDATE_TRACE_POINT();
+			sendBatch();
+		}
+		connection.reset();
+	}
+
+public:
+	/**
+	 * @param connectFunction Creates a new, initialized connection to the
+	 *                        UstRouter. May return NULL or throw
+	 *                        a tracable_exception when that fails.
+	 * @param ringCount The number of ring buffers.
+	 * @param ringSize The size of each ring buffer, in bytes. Rounded up
+	 *                 to a power of two.
+	 */
+	Transport(const ConnectFunction &_connectFunction,
+		unsigned int _ringCount = DEFAULT_RING_COUNT,
+		size_t _ringSize = DEFAULT_RING_SIZE)
+		: connectFunction(_connectFunction),
+		  ringCount(_ringCount),
+		  ringSize(roundUpToPowerOfTwo(_ringSize)),
+		  rings(new boost::atomic<Ring *>[_ringCount]),
+		  sentMessages(0),
+		  droppedMessages(0),
+		  batches(0),
+		  senderIdle(false),
+		  quit(false),
+		  reconnectTimeout(1000000),
+		  nextReconnectTime(0),
+		  lastReportedDroppedMessages(0),
+		  lastDropReportTime(0)
+	{
+		for (unsigned int i = 0; i < ringCount; i++) {
+			rings[i].store(NULL, boost::memory_order_relaxed);
+		}
+		thr = new oxt::thread(boost::bind(&Transport::senderMain, this),
+			"Union Station sender", 1024 * 128);
+	}
+
+	/**
+	 * Sends all messages that are still in the rings (if the UstRouter is
+	 * reachable), then stops the sender thread.
+	 */
+	~Transport() {
+		TRACE_POINT();
+		{
+			boost::lock_guard<boost::mutex> l(syncher);
+			quit = true;
+			cond.notify_one();
+		}
+		{
+			boost::this_thread::disable_interruption di;
+			boost::this_thread::disable_syscall_interruption dsi;
+			thr->join();
+		}
+		delete thr;
+		for (unsigned int i = 0; i < ringCount; i++) {
+			delete rings[i].load(boost::memory_order_relaxed);
+		}
+		delete[] rings;
+	}
+
+	/**
+	 * Returns the index of the ring that the current thread should use.
+	 * Messages that must stay in order must all be sent to the same ring.
+	 */
+	unsigned int getRingIndexForCurrentThread() const {
+		size_t h = boost::hash<boost::thread::id>()(boost::this_thread::get_id());
+		// Thread IDs are usually aligned pointers, so mix in the high bits.
+		h ^= h >> 16;
+		h *= 0x45d9f3b;
+		h ^= h >> 16;
+		return h % ringCount;
+	}
+
+	/**
+	 * Appends an array message, optionally followed by a scalar message, to
+	 * the given ring. The two are sent without any other message in between.
+	 * Never blocks on I/O. Returns false if the message was dropped.
+	 */
+	bool sendMessage(unsigned int ringIndex, StaticString args[], unsigned int argsCount,
+		const StaticString *scalar = NULL)
+	{
+		assert(argsCount <= MAX_MESSAGE_ARGS);
+		StaticString parts[2 * MAX_MESSAGE_ARGS + 1 + 2];
+		char arrayHeader[sizeof(boost::uint16_t)];
+		char scalarHeader[sizeof(boost::uint32_t)];
+		unsigned int count = ArrayMessage::outputSize(argsCount);
+		size_t size = 0;
+
+		ArrayMessage::generate(args, argsCount, arrayHeader, parts, count);
+		if (scalar != NULL) {
+			ScalarMessage::generate(*scalar, scalarHeader, parts + count);
+			count += 2;
+		}
+		for (unsigned int i = 0; i < count; i++) {
+			size += parts[i].size();
+		}
+
+		Ring *ring = getRing(ringIndex % ringCount);
+		if (!ring->push(parts, count, size)) {
+			droppedMessages.fetch_add(1, boost::memory_order_relaxed);
+			return false;
+		}
+
+		// Pairs with the fence in waitForRecords().
+		boost::atomic_thread_fence(boost::memory_order_seq_cst);
+		if (senderIdle.load(boost::memory_order_relaxed)) {
+			wakeupSender();
+		}
+		return true;
+	}
+
+	void setReconnectTimeout(unsigned long long usec) {
+		boost::lock_guard<boost::mutex> l(syncher);
+		reconnectTimeout = usec;
+	}
+
+	/** The number of messages that have been written to the UstRouter. */
+	boost::uint64_t getSentMessages() const {
+		return sentMessages.load(boost::memory_order_relaxed);
+	}
+
+	/** The number of messages that have been dropped instead of sent. */
+	boost::uint64_t getDroppedMessages() const {
+		return droppedMessages.load(boost::memory_order_relaxed);
+	}
+
+	/** The number of writev() batches in which messages were sent. */
+	boost::uint64_t getBatches() const {
+		return batches.load(boost::memory_order_relaxed);
+	}
+};
+
+typedef boost::shared_ptr<Transport> TransportPtr;
+
+
+} // namespace UnionStation
+} // namespace Passenger
+
+#endif /* _PASSENGER_UNION_STATION_TRANSPORT_H_ */
@@ -752,6 +752,10 @@ abortHandler(int signo, siginfo_t *info, void *_unused) {
 		return;
 	}
 
+	// Write the log entries that were logged before the crash before
+	// anything else, so that the crash report follows them.
+	LoggingKit::emergencyFlush();
+
 	closeEmergencyPipes();
 
 	/* We want to dump the entire crash log to both stderr and a log file.
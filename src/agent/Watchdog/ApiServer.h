@@ -57,7 +57,10 @@ using namespace std;
  *
  *   accept_burst_count           unsigned integer   -          default(32)
  *   authorizations               array              -          default("[FILTERED]"),secret
+ *   client_body_timeout          unsigned integer   -          default(60)
  *   client_freelist_limit        unsigned integer   -          default(0)
+ *   client_header_timeout        unsigned integer   -          default(60)
+ *   client_keepalive_timeout     unsigned integer   -          default(75)
  *   fd_passing_password          string             required   secret
  *   min_spare_clients            unsigned integer   -          default(0)
  *   request_freelist_limit       unsigned integer   -          default(1024)
@@ -61,19 +61,26 @@ using namespace std;
  *   admin_panel_websocketpp_debug_access                                     boolean            -          default(false)
  *   admin_panel_websocketpp_debug_error                                      boolean            -          default(false)
  *   app_output_log_level                                                     string             -          default("notice")
+ *   app_output_rate_limit                                                    unsigned integer   -          default(0)
  *   benchmark_mode                                                           string             -          -
  *   config_manifest                                                          object             -          read_only
  *   controller_accept_burst_count                                            unsigned integer   -          default(32)
  *   controller_addresses                                                     array of strings   -          default,read_only
+ *   controller_client_body_timeout                                           unsigned integer   -          default(60)
  *   controller_client_freelist_limit                                         unsigned integer   -          default(0)
+ *   controller_client_header_timeout                                         unsigned integer   -          default(60)
+ *   controller_client_keepalive_timeout                                      unsigned integer   -          default(75)
  *   controller_cpu_affine                                                    boolean            -          default(false),read_only
  *   controller_file_buffered_channel_auto_start_mover                        boolean            -          default(true)
  *   controller_file_buffered_channel_auto_truncate_file                      boolean            -          default(true)
  *   controller_file_buffered_channel_buffer_dir                              string             -          default
  *   controller_file_buffered_channel_delay_in_file_mode_switching            unsigned integer   -          default(0)
  *   controller_file_buffered_channel_max_disk_chunk_read_size                unsigned integer   -          default(0)
+ *   controller_file_buffered_channel_memory_spill_limit                      unsigned integer   -          default(33554432)
  *   controller_file_buffered_channel_threshold                               unsigned integer   -          default(131072)
  *   controller_mbuf_block_chunk_size                                         unsigned integer   -          default(4096),read_only
+ *   controller_mbuf_idle_release_delay                                       unsigned integer   -          default(60)
+ *   controller_mbuf_size_classes                                             boolean            -          default(true),read_only
  *   controller_min_spare_clients                                             unsigned integer   -          default(0)
  *   controller_pid_file                                                      string             -          default,read_only
  *   controller_request_freelist_limit                                        unsigned integer   -          default(1024)
@@ -84,14 +91,20 @@ using namespace std;
  *   core_api_server_accept_burst_count                                       unsigned integer   -          default(32)
  *   core_api_server_addresses                                                array of strings   -          default([]),read_only
  *   core_api_server_authorizations                                           array              -          default("[FILTERED]"),secret
+ *   core_api_server_client_body_timeout                                      unsigned integer   -          default(60)
  *   core_api_server_client_freelist_limit                                    unsigned integer   -          default(0)
+ *   core_api_server_client_header_timeout                                    unsigned integer   -          default(60)
+ *   core_api_server_client_keepalive_timeout                                 unsigned integer   -          default(75)
  *   core_api_server_file_buffered_channel_auto_start_mover                   boolean            -          default(true)
  *   core_api_server_file_buffered_channel_auto_truncate_file                 boolean            -          default(true)
  *   core_api_server_file_buffered_channel_buffer_dir                         string             -          default
  *   core_api_server_file_buffered_channel_delay_in_file_mode_switching       unsigned integer   -          default(0)
  *   core_api_server_file_buffered_channel_max_disk_chunk_read_size           unsigned integer   -          default(0)
+ *   core_api_server_file_buffered_channel_memory_spill_limit                 unsigned integer   -          default(33554432)
  *   core_api_server_file_buffered_channel_threshold                          unsigned integer   -          default(131072)
  *   core_api_server_mbuf_block_chunk_size                                    unsigned integer   -          default(4096),read_only
+ *   core_api_server_mbuf_idle_release_delay                                  unsigned integer   -          default(60)
+ *   core_api_server_mbuf_size_classes                                        boolean            -          default(true),read_only
  *   core_api_server_min_spare_clients                                        unsigned integer   -          default(0)
  *   core_api_server_request_freelist_limit                                   unsigned integer   -          default(1024)
  *   core_api_server_start_reading_after_accept                               boolean            -          default(true)
@@ -99,6 +112,7 @@ using namespace std;
  *   core_pid_file                                                            string             -          read_only
  *   daemonize                                                                boolean            -          default(false)
  *   default_abort_websockets_on_process_shutdown                             boolean            -          default(true)
+ *   default_adaptive_concurrency                                             boolean            -          default(false)
  *   default_app_file_descriptor_ulimit                                       unsigned integer   -          -
  *   default_environment                                                      string             -          default("production")
  *   default_force_max_concurrent_requests_per_process                        integer            -          default(-1)
@@ -107,17 +121,25 @@ using namespace std;
  *   default_load_shell_envvars                                               boolean            -          default(false)
  *   default_max_preloader_idle_time                                          unsigned integer   -          default(300)
  *   default_max_request_queue_size                                           unsigned integer   -          default(100)
+ *   default_max_request_time                                                 unsigned integer   -          default(0)
  *   default_max_requests                                                     unsigned integer   -          default(0)
+ *   default_max_requests_jitter                                              unsigned integer   -          default(0)
+ *   default_memory_limit                                                     unsigned integer   -          default(0)
  *   default_meteor_app_settings                                              string             -          -
  *   default_min_instances                                                    unsigned integer   -          default(1)
  *   default_nodejs                                                           string             -          default("node")
  *   default_python                                                           string             -          default("python")
+ *   default_request_queue_lifo                                               boolean            -          default(false)
+ *   default_request_queue_target_delay                                       unsigned integer   -          default(0)
  *   default_ruby                                                             string             -          default("ruby")
  *   default_server_name                                                      string             -          default
  *   default_server_port                                                      unsigned integer   -          default
  *   default_spawn_method                                                     string             -          default("smart")
  *   default_sticky_sessions                                                  boolean            -          default(false)
  *   default_sticky_sessions_cookie_name                                      string             -          default("_passenger_route")
+ *   default_target_utilization                                               unsigned integer   -          default(0)
+ *   default_union_station_sample_rate                                        unsigned integer   -          default(100)
+ *   default_union_station_slow_request_threshold                             unsigned integer   -          default(1000)
  *   default_user                                                             string             -          default("nobody")
  *   file_descriptor_log_target                                               any                -          -
  *   graceful_exit                                                            boolean            -          default(true)
@@ -127,9 +149,11 @@ using namespace std;
  *   hook_before_watchdog_shutdown                                            string             -          -
  *   instance_registry_dir                                                    string             -          default,read_only
  *   integration_mode                                                         string             -          default("standalone")
+ *   log_async                                                                boolean            -          default(false)
  *   log_level                                                                string             -          default("notice")
  *   log_target                                                               any                -          default({"stderr": true})
  *   max_pool_size                                                            unsigned integer   -          default(6)
+ *   max_request_time_backtraces                                              boolean            -          default(false)
  *   multi_app                                                                boolean            -          default(false),read_only
  *   passenger_root                                                           string             required   read_only
  *   pidfiles_to_delete_on_exit                                               array of strings   -          default([])
@@ -160,14 +184,20 @@ using namespace std;
  *   watchdog_api_server_accept_burst_count                                   unsigned integer   -          default(32)
  *   watchdog_api_server_addresses                                            array of strings   -          default([]),read_only
  *   watchdog_api_server_authorizations                                       array              -          default("[FILTERED]"),secret
+ *   watchdog_api_server_client_body_timeout                                  unsigned integer   -          default(60)
  *   watchdog_api_server_client_freelist_limit                                unsigned integer   -          default(0)
+ *   watchdog_api_server_client_header_timeout                                unsigned integer   -          default(60)
+ *   watchdog_api_server_client_keepalive_timeout                             unsigned integer   -          default(75)
  *   watchdog_api_server_file_buffered_channel_auto_start_mover               boolean            -          default(true)
  *   watchdog_api_server_file_buffered_channel_auto_truncate_file             boolean            -          default(true)
  *   watchdog_api_server_file_buffered_channel_buffer_dir                     string             -          default
  *   watchdog_api_server_file_buffered_channel_delay_in_file_mode_switching   unsigned integer   -          default(0)
  *   watchdog_api_server_file_buffered_channel_max_disk_chunk_read_size       unsigned integer   -          default(0)
+ *   watchdog_api_server_file_buffered_channel_memory_spill_limit             unsigned integer   -          default(33554432)
  *   watchdog_api_server_file_buffered_channel_threshold                      unsigned integer   -          default(131072)
  *   watchdog_api_server_mbuf_block_chunk_size                                unsigned integer   -          default(4096),read_only
+ *   watchdog_api_server_mbuf_idle_release_delay                              unsigned integer   -          default(60)
+ *   watchdog_api_server_mbuf_size_classes                                    boolean            -          default(true),read_only
  *   watchdog_api_server_min_spare_clients                                    unsigned integer   -          default(0)
  *   watchdog_api_server_request_freelist_limit                               unsigned integer   -          default(1024)
  *   watchdog_api_server_start_reading_after_accept                           boolean            -          default(true)
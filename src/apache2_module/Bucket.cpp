@@ -62,6 +62,7 @@ bucket_destroy(void *data) {
 static apr_status_t
 bucket_read(apr_bucket *bucket, const char **str, apr_size_t *len, apr_read_type_e block) {
 	char *buf;
+	size_t size;
 	ssize_t ret;
 	BucketData *data;
 
@@ -89,19 +90,43 @@ bucket_read(apr_bucket *bucket, const char **str, apr_size_t *len, apr_read_type
 		return APR_EAGAIN;
 	}
 
+	if (data->state->bodyBytesRemaining == 0) {
+		/* The entire response body has been read. Don't read any further:
+		 * the connection stays open for the next request.
+		 */
+		data->state->completed = true;
+		delete data;
+		bucket->data = NULL;
+
+		bucket = apr_bucket_immortal_make(bucket, "", 0);
+		*str = (const char *) bucket->data;
+		*len = 0;
+		return APR_SUCCESS;
+	}
+
 	buf = (char *) apr_bucket_alloc(APR_BUCKET_BUFF_SIZE, bucket->list);
 	if (buf == NULL) {
 		return APR_ENOMEM;
 	}
 
+	size = APR_BUCKET_BUFF_SIZE;
+	if (data->state->bodyBytesRemaining > 0
+	 && (unsigned long long) data->state->bodyBytesRemaining < size)
+	{
+		size = (size_t) data->state->bodyBytesRemaining;
+	}
+
 	do {
-		ret = read(data->state->connection, buf, APR_BUCKET_BUFF_SIZE);
+		ret = read(data->state->connection, buf, size);
 	} while (ret == -1 && errno == EINTR);
 
 	if (ret > 0) {
 		apr_bucket_heap *h;
 
 		data->state->bytesRead += ret;
+		if (data->state->bodyBytesRemaining > 0) {
+			data->state->bodyBytesRemaining -= ret;
+		}
 
 		*str = buf;
 		*len = ret;
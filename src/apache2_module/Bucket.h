@@ -54,6 +54,13 @@ struct PassengerBucketState {
 	 */
 	int errorCode;
 
+	/** The number of response body bytes that are yet to be read from the
+	 * connection, or -1 if the body ends when the Passenger core closes the
+	 * connection. Once this reaches 0, the PassengerBucket stops reading so that
+	 * the connection can be reused for another request.
+	 */
+	long long bodyBytesRemaining;
+
 	/** Connection to the Passenger core. */
 	FileDescriptor connection;
 
@@ -61,8 +68,16 @@ struct PassengerBucketState {
 		bytesRead  = 0;
 		completed  = false;
 		errorCode  = 0;
+		bodyBytesRemaining = -1;
 		connection = conn;
 	}
+
+	/** Whether the response has been fully read without errors, leaving the
+	 * connection in a state in which it can be reused.
+	 */
+	bool canKeepAlive() const {
+		return errorCode == 0 && bodyBytesRemaining == 0;
+	}
 };
 
 typedef boost::shared_ptr<PassengerBucketState> PassengerBucketStatePtr;
@@ -84,6 +99,8 @@ typedef boost::shared_ptr<PassengerBucketState> PassengerBucketStatePtr;
  * - It ignores the APR_NONBLOCK_READ flag because that's known to cause
  *   strange I/O problems.
  * - It can store its current state in a PassengerBucketState data structure.
+ * - It stops reading after the response body when the body length is known,
+ *   so that keep-alive connections to the Passenger core can be reused.
  */
 apr_bucket *passenger_bucket_create(const PassengerBucketStatePtr &state,
                                     apr_bucket_alloc_t *list,
@@ -93,6 +93,11 @@ AP_INIT_TAKE1("PassengerConcurrencyModel",
 	NULL,
 	RSRC_CONF | ACCESS_CONF,
 	"The concurrency model that should be used for applications."),
+AP_INIT_TAKE1("PassengerCoreKeepaliveConnections",
+	(Take1Func) cmd_passenger_core_keepalive_connections,
+	NULL,
+	RSRC_CONF,
+	"The maximum number of idle connections to the Phusion Passenger core that each Apache process keeps open."),
 AP_INIT_TAKE2("PassengerCtl",
 	(Take2Func) cmd_passenger_ctl,
 	NULL,
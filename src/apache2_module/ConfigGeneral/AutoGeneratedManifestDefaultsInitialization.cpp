@@ -48,6 +48,11 @@ void
 ConfigManifestGenerator::autoGenerated_setGlobalConfigDefaults() {
 	Json::Value &globalConfigContainer = manifest["global_configuration"];
 
+	addOptionsContainerStaticDefaultInt(
+		globalConfigContainer,
+		"PassengerCoreKeepaliveConnections",
+		DEFAULT_APACHE_CORE_KEEPALIVE_CONNECTIONS);
+
 	addOptionsContainerDynamicDefault(
 		globalConfigContainer,
 		"PassengerDataBufferDir",
@@ -151,6 +151,20 @@ cmd_passenger_buffer_upload(cmd_parms *cmd, void *pcfg, const char *arg) {
 	return NULL;
 }
 
+static const char *
+cmd_passenger_core_keepalive_connections(cmd_parms *cmd, void *pcfg, const char *arg) {
+	const char *err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
+	if (err != NULL) {
+		ap_log_perror(APLOG_MARK, APLOG_STARTUP, 0, cmd->temp_pool,
+			"WARNING: %s", err);
+	}
+
+	serverConfig.coreKeepaliveConnectionsSourceFile = cmd->directive->filename;
+	serverConfig.coreKeepaliveConnectionsSourceLine = cmd->directive->line_num;
+	serverConfig.coreKeepaliveConnectionsExplicitlySet = true;
+	return setIntConfig(cmd, arg, serverConfig.coreKeepaliveConnections, 0);
+}
+
 static const char *
 cmd_passenger_data_buffer_dir(cmd_parms *cmd, void *pcfg, const char *arg) {
 	const char *err = ap_check_cmd_context(cmd, GLOBAL_ONLY);
@@ -0,0 +1,132 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_APACHE2_MODULE_CORE_CONNECTION_POOL_H_
+#define _PASSENGER_APACHE2_MODULE_CORE_CONNECTION_POOL_H_
+
+#include <boost/thread.hpp>
+#include <vector>
+#include <cerrno>
+#include <poll.h>
+#include <FileDescriptor.h>
+
+namespace Passenger {
+namespace Apache2Module {
+
+using namespace std;
+
+
+/**
+ * Idle keep-alive connections to the Passenger core, shared by all threads
+ * in an Apache process. Connections are handed out in LIFO order so that the
+ * most recently used connections are reused first, and the least recently used
+ * ones are closed when the pool is full.
+ *
+ * The Passenger core closes idle keep-alive connections after a while, so
+ * checkout() drops connections that the core has already closed. There is still
+ * a small window in which the core may close a connection after it has been
+ * checked out; callers must be prepared to retry with a new connection.
+ */
+class CoreConnectionPool {
+private:
+	boost::mutex syncher;
+	vector<FileDescriptor> idle;
+	unsigned int max;
+
+	/**
+	 * The Passenger core never sends anything on an idle connection, so if
+	 * it is readable, then the core has closed it.
+	 */
+	static bool stillOpen(const FileDescriptor &fd) {
+		struct pollfd pfd;
+		int ret;
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		do {
+			ret = poll(&pfd, 1, 0);
+		} while (ret == -1 && errno == EINTR);
+		return ret == 0;
+	}
+
+public:
+	CoreConnectionPool()
+		: max(0)
+		{ }
+
+	void setMax(unsigned int value) {
+		boost::lock_guard<boost::mutex> l(syncher);
+		max = value;
+		while (idle.size() > max) {
+			idle.erase(idle.begin());
+		}
+	}
+
+	bool enabled() {
+		boost::lock_guard<boost::mutex> l(syncher);
+		return max > 0;
+	}
+
+	/**
+	 * Returns an idle connection, or an empty FileDescriptor if there is none.
+	 */
+	FileDescriptor checkout() {
+		boost::lock_guard<boost::mutex> l(syncher);
+		while (!idle.empty()) {
+			FileDescriptor fd = idle.back();
+			idle.pop_back();
+			if (stillOpen(fd)) {
+				return fd;
+			}
+		}
+		return FileDescriptor();
+	}
+
+	/**
+	 * Gives back a connection on which a response has been fully read.
+	 */
+	void checkin(const FileDescriptor &fd) {
+		boost::lock_guard<boost::mutex> l(syncher);
+		if (max == 0) {
+			return;
+		}
+		if (idle.size() >= max) {
+			idle.erase(idle.begin());
+		}
+		idle.push_back(fd);
+	}
+
+	void clear() {
+		boost::lock_guard<boost::mutex> l(syncher);
+		idle.clear();
+	}
+};
+
+
+} // namespace Apache2Module
+} // namespace Passenger
+
+#endif /* _PASSENGER_APACHE2_MODULE_CORE_CONNECTION_POOL_H_ */
@@ -57,6 +57,7 @@
 #include <oxt/detail/context.hpp>
 #include "Bucket.h"
 #include "Config.h"
+#include "CoreConnectionPool.h"
 #include "DirectoryMapper.h"
 #include "Utils.h"
 #include <modp_b64.h>
@@ -235,6 +236,7 @@ private:
 	CachedFileStat cstat;
 	WatchdogLauncher watchdogLauncher;
 	boost::mutex cstatMutex;
+	CoreConnectionPool coreConnectionPool;
 
 	static Json::Value strsetToJson(const set<string> &input) {
 		Json::Value result(Json::arrayValue);
@@ -348,6 +350,75 @@ private:
 		return conn;
 	}
 
+	/**
+	 * Returns an idle keep-alive connection to the Passenger core if there is
+	 * one, otherwise connects to the core.
+	 */
+	FileDescriptor checkoutCoreConnection(bool &reused) {
+		FileDescriptor conn = coreConnectionPool.checkout();
+		reused = conn != -1;
+		if (!reused) {
+			conn = connectToCore();
+		}
+		return conn;
+	}
+
+	/**
+	 * Waits until the Passenger core starts sending a response, and checks
+	 * whether it has closed the connection instead.
+	 */
+	static bool coreResponseAvailable(const FileDescriptor &conn) {
+		char buf;
+		ssize_t ret;
+
+		do {
+			ret = recv(conn, &buf, 1, MSG_PEEK);
+		} while (ret == -1 && errno == EINTR);
+		return ret > 0;
+	}
+
+	/**
+	 * Determines the length of the response body from the response headers
+	 * parsed by ap_scan_script_header_err_brigade(). Returns -1 if the body
+	 * ends when the Passenger core closes the connection.
+	 */
+	static long long getCoreResponseBodyLength(request_rec *r, apr_bucket_brigade *bb) {
+		const char *value;
+		long long result;
+		apr_bucket *b;
+
+		if (r->header_only || r->status == HTTP_NO_CONTENT || r->status == HTTP_NOT_MODIFIED) {
+			result = 0;
+		} else if ((value = apr_table_get(r->headers_out, "Content-Length")) != NULL) {
+			result = (long long) stringToULL(value);
+		} else {
+			return -1;
+		}
+
+		// Part of the body may already have been read while parsing
+		// the headers. The PassengerBucket is the first bucket with
+		// an unknown length.
+		for (b = APR_BRIGADE_FIRST(bb);
+		     b != APR_BRIGADE_SENTINEL(bb) && b->length != (apr_size_t) -1;
+		     b = APR_BUCKET_NEXT(b))
+		{
+			result -= b->length;
+		}
+		if (result < 0) {
+			return -1;
+		} else {
+			return result;
+		}
+	}
+
+	static bool coreWantsConnectionClosed(request_rec *r) {
+		const char *value = apr_table_get(r->err_headers_out, "Connection");
+		if (value == NULL) {
+			value = apr_table_get(r->headers_out, "Connection");
+		}
+		return value != NULL && strcasecmp(value, "close") == 0;
+	}
+
 	bool hasModRewrite() {
 		if (m_hasModRewrite == UNKNOWN) {
 			if (ap_find_linked_module("mod_rewrite.c")) {
@@ -634,14 +705,45 @@ private:
 
 			int ret;
 			bool bodyIsChunked = false;
+			bool keepAlive = false;
+			bool reused;
 
-			string headers = constructRequestHeaders(r, mapper, bodyIsChunked);
-			FileDescriptor conn = connectToCore();
-			writeExact(conn, headers);
-			headers.clear();
-			if (expectingBody) {
-				sendRequestBody(conn, r, bodyIsChunked);
+			string headers = constructRequestHeaders(r, mapper, bodyIsChunked,
+				keepAlive);
+			FileDescriptor conn;
+
+			while (true) {
+				conn = keepAlive ? checkoutCoreConnection(reused) : connectToCore();
+				if (!keepAlive) {
+					reused = false;
+				}
+
+				try {
+					writeExact(conn, headers);
+				} catch (const SystemException &e) {
+					if (reused && (e.code() == EPIPE || e.code() == ECONNRESET)) {
+						// The core closed this idle connection in the
+						// meantime. Nothing has been sent yet, so try again.
+						P_DEBUG("Keep-alive connection to the Passenger core was "
+							"closed, retrying with another connection");
+						continue;
+					}
+					throw;
+				}
+
+				if (expectingBody) {
+					sendRequestBody(conn, r, bodyIsChunked);
+				} else if (reused && !coreResponseAvailable(conn)) {
+					// Same as above, but the core closed the connection
+					// before reading the request. Without a request body,
+					// the request can be safely resent.
+					P_DEBUG("Keep-alive connection to the Passenger core was "
+						"closed, retrying with another connection");
+					continue;
+				}
+				break;
 			}
+			headers.clear();
 
 
 			/********** Step 4: forwarding the response from the Passenger core
@@ -679,7 +781,14 @@ private:
 			// into error_headers_out (mostly) as well as headers_out.
 			ret = ap_scan_script_header_err_brigade(r, bb, backendData);
 
-			// The PassengerAgent sets the Connection: close header because it wants
+			// If the core is willing to keep the connection alive then we
+			// stop reading at the end of the response body, so that the
+			// connection can be put back in the pool afterwards.
+			if (ret == OK && keepAlive && !coreWantsConnectionClosed(r)) {
+				bucketState->bodyBytesRemaining = getCoreResponseBodyLength(r, bb);
+			}
+
+			// The PassengerAgent may set the Connection: close header because it wants
 			// the bb connection closed, but because we fed everything to the
 			// ap_scan_script it will also be set in the response to the client and
 			// that breaks HTTP 1.1 keep-alive, so unset it.
@@ -722,9 +831,17 @@ private:
 					 */
 					int originalStatus = r->status;
 					r->status = HTTP_OK;
+					apr_brigade_cleanup(bb);
 					return originalStatus;
 				} else if (ap_pass_brigade(r->output_filters, bb) == APR_SUCCESS) {
 					apr_brigade_cleanup(bb);
+					// If the client went away before the whole response
+					// was read, or if reading failed, then the connection
+					// is in an unknown state and is closed instead.
+					if (bucketState->canKeepAlive() && !r->connection->aborted) {
+						coreConnectionPool.checkin(bucketState->connection);
+						bucketState->connection = FileDescriptor();
+					}
 				}
 				return OK;
 			} else {
@@ -857,7 +974,7 @@ private:
 	}
 
 	string constructRequestHeaders(request_rec *r, DirectoryMapper &mapper,
-		bool &bodyIsChunked)
+		bool &bodyIsChunked, bool &keepAlive)
 	{
 		const char *baseURI = mapper.getBaseURI();
 		DirConfig *config = getDirConfig(r);
@@ -930,8 +1047,13 @@ private:
 
 		if (connectionHeader != NULL && connectionUpgradeFlagSet(connectionHeader->val)) {
 			result.append("Connection: upgrade\r\n", sizeof("Connection: upgrade\r\n") - 1);
+			keepAlive = false;
+		} else if (coreConnectionPool.enabled()) {
+			// HTTP/1.1 defaults to keep-alive.
+			keepAlive = true;
 		} else {
 			result.append("Connection: close\r\n", sizeof("Connection: close\r\n") - 1);
+			keepAlive = false;
 		}
 
 		if (transferEncodingHeader != NULL) {
@@ -1247,6 +1369,7 @@ public:
 	    : cstat(1024),
 	      watchdogLauncher(IM_APACHE)
 	{
+		cstat.enableInotify();
 		postprocessConfig(s, pconf, ptemp);
 
 		Json::Value loggingConfig;
@@ -1277,6 +1400,8 @@ public:
 				ConfigKit::toString(errors).c_str());
 		}
 
+		coreConnectionPool.setMax(serverConfig.coreKeepaliveConnections);
+
 		m_hasModRewrite = UNKNOWN;
 		m_hasModDir = UNKNOWN;
 		m_hasModAutoIndex = UNKNOWN;
@@ -47,6 +47,15 @@ void
 ConfigManifestGenerator::autoGenerated_generateConfigManifestForServerConfig() {
 	Json::Value &globalOptionsContainer = manifest["global_configuration"];
 
+	if (serverConfig.coreKeepaliveConnectionsExplicitlySet) {
+		Json::Value &optionContainer = findOrCreateOptionContainer(globalOptionsContainer,
+			"PassengerCoreKeepaliveConnections",
+			sizeof("PassengerCoreKeepaliveConnections") - 1);
+		Json::Value &hierarchyMember = addOptionContainerHierarchyMember(optionContainer,
+			serverConfig.coreKeepaliveConnectionsSourceFile,
+			serverConfig.coreKeepaliveConnectionsSourceLine);
+		hierarchyMember["value"] = serverConfig.coreKeepaliveConnections;
+	}
 	if (serverConfig.dataBufferDirExplicitlySet) {
 		Json::Value &optionContainer = findOrCreateOptionContainer(globalOptionsContainer,
 			"PassengerDataBufferDir",
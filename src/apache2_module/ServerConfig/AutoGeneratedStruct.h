@@ -59,6 +59,11 @@ struct AutoGeneratedServerConfig {
 	 */
 	bool userSwitching;
 
+	/*
+	 * The maximum number of idle connections to the Phusion Passenger core that each Apache process keeps open.
+	 */
+	int coreKeepaliveConnections;
+
 	/*
 	 * The Phusion Passenger log verbosity.
 	 */
@@ -149,6 +154,7 @@ struct AutoGeneratedServerConfig {
 	StaticString showVersionInHeaderSourceFile;
 	StaticString turbocachingSourceFile;
 	StaticString userSwitchingSourceFile;
+	StaticString coreKeepaliveConnectionsSourceFile;
 	StaticString logLevelSourceFile;
 	StaticString maxInstancesPerAppSourceFile;
 	StaticString maxPoolSizeSourceFile;
@@ -171,6 +177,7 @@ struct AutoGeneratedServerConfig {
 	unsigned int showVersionInHeaderSourceLine;
 	unsigned int turbocachingSourceLine;
 	unsigned int userSwitchingSourceLine;
+	unsigned int coreKeepaliveConnectionsSourceLine;
 	unsigned int logLevelSourceLine;
 	unsigned int maxInstancesPerAppSourceLine;
 	unsigned int maxPoolSizeSourceLine;
@@ -193,6 +200,7 @@ struct AutoGeneratedServerConfig {
 	bool showVersionInHeaderExplicitlySet: 1;
 	bool turbocachingExplicitlySet: 1;
 	bool userSwitchingExplicitlySet: 1;
+	bool coreKeepaliveConnectionsExplicitlySet: 1;
 	bool logLevelExplicitlySet: 1;
 	bool maxInstancesPerAppExplicitlySet: 1;
 	bool maxPoolSizeExplicitlySet: 1;
@@ -217,6 +225,7 @@ struct AutoGeneratedServerConfig {
 		showVersionInHeader = true;
 		turbocaching = true;
 		userSwitching = true;
+		coreKeepaliveConnections = DEFAULT_APACHE_CORE_KEEPALIVE_CONNECTIONS;
 		logLevel = DEFAULT_LOG_LEVEL;
 		maxInstancesPerApp = 0;
 		maxPoolSize = DEFAULT_MAX_POOL_SIZE;
@@ -255,6 +264,7 @@ struct AutoGeneratedServerConfig {
 		showVersionInHeaderSourceLine = 0;
 		turbocachingSourceLine = 0;
 		userSwitchingSourceLine = 0;
+		coreKeepaliveConnectionsSourceLine = 0;
 		logLevelSourceLine = 0;
 		maxInstancesPerAppSourceLine = 0;
 		maxPoolSizeSourceLine = 0;
@@ -277,6 +287,7 @@ struct AutoGeneratedServerConfig {
 		showVersionInHeaderExplicitlySet = false;
 		turbocachingExplicitlySet = false;
 		userSwitchingExplicitlySet = false;
+		coreKeepaliveConnectionsExplicitlySet = false;
 		logLevelExplicitlySet = false;
 		maxInstancesPerAppExplicitlySet = false;
 		maxPoolSizeExplicitlySet = false;
@@ -0,0 +1,149 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_ALGORITHMS_ADAPTIVE_CONCURRENCY_LIMIT_H_
+#define _PASSENGER_ALGORITHMS_ADAPTIVE_CONCURRENCY_LIMIT_H_
+
+#include <algorithm>
+#include <Algorithms/MovingAverage.h>
+
+namespace Passenger {
+
+using namespace std;
+
+
+/**
+ * Adjusts a concurrency limit (the maximum number of requests that may be in
+ * progress at the same time) based on observed request latencies, using
+ * additive increase/multiplicative decrease (AIMD).
+ *
+ * Two exponential moving averages of the latency are maintained: a short-term
+ * one that reacts to the current load, and a long-term one that serves as
+ * the baseline. As long as the short-term average stays
+ * within `tolerance()` times the long-term average, and the current limit is
+ * actually being used, the limit grows by one per `limit` requests. When the
+ * short-term average exceeds that, requests are apparently queueing up inside
+ * the server, so the limit is multiplied by `backoff()`, at most once per `limit`
+ * requests so that requests that were admitted under the old limit do not
+ * cause the limit to collapse.
+ *
+ * Comparing averages instead of individual latencies means that an
+ * application with a mix of fast and slow endpoints does not cause the limit
+ * to be reduced, as long as that mix doesn't change. The flip side is that
+ * sustained overload slowly becomes the new baseline, after which the limit
+ * stops decreasing.
+ *
+ * This class is not thread-safe.
+ */
+class AdaptiveConcurrencyLimit {
+private:
+	double limit;
+	unsigned int minLimit;
+	unsigned int maxLimit;
+	double shortTermLatency;
+	double longTermLatency;
+	unsigned int samplesSinceDecrease;
+
+public:
+	/** Weights of a new latency sample in the short-term and long-term averages. */
+	static double shortTermAlpha() { return 0.05; }
+	static double longTermAlpha() { return 0.01; }
+	/** How much the short-term average may exceed the long-term average. */
+	static double tolerance() { return 2; }
+	/** By how much the limit is multiplied when overload is detected. */
+	static double backoff() { return 0.8; }
+
+	/** Constructs a disabled limit. */
+	AdaptiveConcurrencyLimit() {
+		reset(0, 0);
+	}
+
+	/**
+	 * Starts adjusting the limit, starting at `initialLimit`, and never going
+	 * outside [minLimit, maxLimit]. A `maxLimit` of 0 disables the limit.
+	 */
+	void reset(unsigned int initialLimit, unsigned int maxLimit,
+		unsigned int minLimit = 1)
+	{
+		this->minLimit = std::min(minLimit, maxLimit);
+		this->maxLimit = maxLimit;
+		limit = std::max(std::min(initialLimit, maxLimit), this->minLimit);
+		shortTermLatency = -1;
+		longTermLatency = -1;
+		samplesSinceDecrease = 0;
+	}
+
+	bool enabled() const {
+		return maxLimit > 0;
+	}
+
+	unsigned int get() const {
+		return (unsigned int) limit;
+	}
+
+	unsigned int getMax() const {
+		return maxLimit;
+	}
+
+	/** The short-term average latency, or -1 if nothing has been recorded yet. */
+	double getShortTermLatency() const {
+		return shortTermLatency;
+	}
+
+	/** The long-term average latency, or -1 if nothing has been recorded yet. */
+	double getLongTermLatency() const {
+		return longTermLatency;
+	}
+
+	/**
+	 * Records the latency of a request that has just finished. `inFlight`
+	 * is the number of requests that are still in progress. Returns the
+	 * new limit.
+	 */
+	unsigned int update(unsigned long long latency, unsigned int inFlight) {
+		if (!enabled()) {
+			return 0;
+		}
+
+		shortTermLatency = expMovingAverage(shortTermLatency, latency, shortTermAlpha());
+		longTermLatency = expMovingAverage(longTermLatency, latency, longTermAlpha());
+		samplesSinceDecrease++;
+
+		if (shortTermLatency > longTermLatency * tolerance()) {
+			if (samplesSinceDecrease >= get()) {
+				limit = std::max<double>(minLimit, limit * backoff());
+				samplesSinceDecrease = 0;
+			}
+		} else if (inFlight + 1 >= get() / 2) {
+			limit = std::min<double>(maxLimit, limit + 1 / limit);
+		}
+		return get();
+	}
+};
+
+
+} // namespace Passenger
+
+#endif /* _PASSENGER_ALGORITHMS_ADAPTIVE_CONCURRENCY_LIMIT_H_ */
@@ -0,0 +1,178 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_ALGORITHMS_HISTOGRAM_H_
+#define _PASSENGER_ALGORITHMS_HISTOGRAM_H_
+
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace Passenger {
+
+using namespace std;
+
+
+/**
+ * A log-linear histogram of non-negative integers (for example durations
+ * in microseconds), similar to HdrHistogram. Values are grouped by
+ * magnitude (power of 2), and every magnitude is divided into
+ * SUB_BUCKET_COUNT buckets of equal width. Values smaller than
+ * SUB_BUCKET_COUNT are counted exactly. This means that the memory usage
+ * is fixed, recording is O(1), and the relative error of any value obtained
+ * from the histogram is at most 1 / SUB_BUCKET_COUNT.
+ *
+ * This class is not thread-safe. Threads should maintain their own
+ * histograms, which can be combined with `merge()`.
+ */
+class Histogram {
+public:
+	static const unsigned int SUB_BUCKET_BITS = 3;
+	static const unsigned int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	/** Values of 2^MAGNITUDE_COUNT and higher are counted in the last bucket. */
+	static const unsigned int MAGNITUDE_COUNT = 40;
+	static const unsigned int BUCKET_COUNT =
+		(MAGNITUDE_COUNT - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+private:
+	boost::uint64_t counts[BUCKET_COUNT];
+	boost::uint64_t count;
+	boost::uint64_t sum;
+	boost::uint64_t max;
+
+	static unsigned int getMagnitude(boost::uint64_t value) {
+		unsigned int result = 0;
+		while (value > 1) {
+			value >>= 1;
+			result++;
+		}
+		return result;
+	}
+
+public:
+	Histogram() {
+		reset();
+	}
+
+	static unsigned int getBucketIndex(boost::uint64_t value) {
+		if (value < SUB_BUCKET_COUNT) {
+			return value;
+		}
+
+		unsigned int magnitude = getMagnitude(value);
+		if (magnitude >= MAGNITUDE_COUNT) {
+			return BUCKET_COUNT - 1;
+		}
+		unsigned int subBucket = (value >> (magnitude - SUB_BUCKET_BITS))
+			& (SUB_BUCKET_COUNT - 1);
+		return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + subBucket;
+	}
+
+	/** Returns the largest value that is counted in the given bucket. */
+	static boost::uint64_t getBucketUpperBound(unsigned int index) {
+		if (index < SUB_BUCKET_COUNT) {
+			return index;
+		}
+
+		unsigned int magnitude = index / SUB_BUCKET_COUNT - 1 + SUB_BUCKET_BITS;
+		unsigned int subBucket = index % SUB_BUCKET_COUNT;
+		boost::uint64_t width = (boost::uint64_t) 1 << (magnitude - SUB_BUCKET_BITS);
+		return (SUB_BUCKET_COUNT + subBucket) * width + width - 1;
+	}
+
+	void record(boost::uint64_t value, boost::uint64_t n = 1) {
+		counts[getBucketIndex(value)] += n;
+		count += n;
+		sum += value * n;
+		max = std::max(max, value);
+	}
+
+	void merge(const Histogram &other) {
+		for (unsigned int i = 0; i < BUCKET_COUNT; i++) {
+			counts[i] += other.counts[i];
+		}
+		count += other.count;
+		sum += other.sum;
+		max = std::max(max, other.max);
+	}
+
+	void reset() {
+		memset(counts, 0, sizeof(counts));
+		count = 0;
+		sum = 0;
+		max = 0;
+	}
+
+	boost::uint64_t getCount() const {
+		return count;
+	}
+
+	boost::uint64_t getSum() const {
+		return sum;
+	}
+
+	boost::uint64_t getMax() const {
+		return max;
+	}
+
+	/**
+	 * Returns the number of recorded values that are at most `value`. Values
+	 * that are in the same bucket as `value`, but larger, may be counted too.
+	 */
+	boost::uint64_t countAtMost(boost::uint64_t value) const {
+		unsigned int lastBucket = getBucketIndex(value);
+		boost::uint64_t result = 0;
+		for (unsigned int i = 0; i <= lastBucket; i++) {
+			result += counts[i];
+		}
+		return result;
+	}
+
+	/**
+	 * Returns (an upper bound of) the value below which `percentile` percent
+	 * of the recorded values fall. Returns 0 if nothing has been recorded.
+	 */
+	boost::uint64_t getPercentile(double percentile) const {
+		if (count == 0) {
+			return 0;
+		}
+
+		boost::uint64_t threshold = (boost::uint64_t) (count * percentile / 100 + 0.5);
+		boost::uint64_t seen = 0;
+		threshold = std::max<boost::uint64_t>(threshold, 1);
+		for (unsigned int i = 0; i < BUCKET_COUNT; i++) {
+			seen += counts[i];
+			if (seen >= threshold) {
+				return std::min(getBucketUpperBound(i), max);
+			}
+		}
+		return max;
+	}
+};
+
+
+} // namespace Passenger
+
+#endif /* _PASSENGER_ALGORITHMS_HISTOGRAM_H_ */
@@ -63,6 +63,12 @@ pp_app_type_detector_free(PP_AppTypeDetector *detector) {
 	delete (AppTypeDetector *) detector;
 }
 
+void
+pp_app_type_detector_enable_inotify(PP_AppTypeDetector *_detector) {
+	AppTypeDetector *detector = (AppTypeDetector *) _detector;
+	detector->enableInotify();
+}
+
 void
 pp_app_type_detector_set_throttle_rate(PP_AppTypeDetector *_detector,
 	unsigned int throttleRate)
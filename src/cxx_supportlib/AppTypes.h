@@ -54,6 +54,7 @@ typedef void PP_AppTypeDetector;
 
 PP_AppTypeDetector *pp_app_type_detector_new(unsigned int throttleRate);
 void pp_app_type_detector_free(PP_AppTypeDetector *detector);
+void pp_app_type_detector_enable_inotify(PP_AppTypeDetector *detector);
 void pp_app_type_detector_set_throttle_rate(PP_AppTypeDetector *detector,
 	unsigned int throttleRate);
 PassengerAppType pp_app_type_detector_check_document_root(PP_AppTypeDetector *detector,
@@ -143,6 +144,11 @@ public:
 		throttleRate = val;
 	}
 
+	/** See CachedFileStat::enableInotify(). */
+	void enableInotify() {
+		cstat->enableInotify();
+	}
+
 	/**
 	 * Given a web server document root (that is, some subdirectory under the
 	 * application root, e.g. "/webapps/foobar/public"), returns the type of
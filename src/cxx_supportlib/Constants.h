@@ -36,6 +36,8 @@
  *   rake src/cxx_supportlib/Constants.h
  */
 
+#define ADAPTIVE_CONCURRENCY_INITIAL_LIMIT 8
+#define ADAPTIVE_CONCURRENCY_MAX_LIMIT 256
 #define AGENT_EXE "PassengerAgent"
 #define DEB_APACHE_MODULE_PACKAGE "libapache2-mod-passenger"
 #define DEB_DEV_PACKAGE "passenger-dev"
@@ -44,11 +46,16 @@
 #define DEFAULT_ANALYTICS_LOG_GROUP ""
 #define DEFAULT_ANALYTICS_LOG_PERMISSIONS "u=rwx,g=rx,o=rx"
 #define DEFAULT_ANALYTICS_LOG_USER "nobody"
+#define DEFAULT_APACHE_CORE_KEEPALIVE_CONNECTIONS 32
 #define DEFAULT_APP_ENV "production"
 #define DEFAULT_APP_OUTPUT_LOG_LEVEL 3
 #define DEFAULT_APP_OUTPUT_LOG_LEVEL_NAME "notice"
 #define DEFAULT_APP_THREAD_COUNT 1
+#define DEFAULT_CLIENT_BODY_TIMEOUT 60
+#define DEFAULT_CLIENT_HEADER_TIMEOUT 60
+#define DEFAULT_CLIENT_KEEPALIVE_TIMEOUT 75
 #define DEFAULT_CONCURRENCY_MODEL "process"
+#define DEFAULT_FILE_BUFFERED_CHANNEL_MEMORY_SPILL_LIMIT 33554432
 #define DEFAULT_FILE_BUFFERED_CHANNEL_THRESHOLD 131072
 #define DEFAULT_HTTP_SERVER_LISTEN_ADDRESS "tcp://127.0.0.1:3000"
 #define DEFAULT_INTEGRATION_MODE "standalone"
@@ -59,6 +66,8 @@
 #define DEFAULT_MAX_PRELOADER_IDLE_TIME 300
 #define DEFAULT_MAX_REQUEST_QUEUE_SIZE 100
 #define DEFAULT_MBUF_CHUNK_SIZE 4096
+#define DEFAULT_MBUF_IDLE_RELEASE_DELAY 60
+#define DEFAULT_NGINX_CORE_KEEPALIVE_CONNECTIONS 32
 #define DEFAULT_NODEJS "node"
 #define DEFAULT_POOL_IDLE_TIME 300
 #define DEFAULT_PYTHON "python"
@@ -74,6 +83,9 @@
 #define FEEDBACK_FD 3
 #define FLYING_PASSENGER_NAME "Flying Passenger"
 #define GLOBAL_NAMESPACE_DIRNAME "passenger"
+#define HUNG_PROCESS_SHUTDOWN_TIMEOUT 2
+#define MAX_CONCURRENT_RECYCLES 1
+#define MEMORY_LIMIT_RESTART_INTERVAL 30
 #define MESSAGE_SERVER_MAX_PASSWORD_SIZE 100
 #define MESSAGE_SERVER_MAX_USERNAME_SIZE 100
 #define PASSENGER_API_VERSION "0.3"
@@ -85,6 +97,7 @@
 #define PROCESS_SHUTDOWN_TIMEOUT 60
 #define PROCESS_SHUTDOWN_TIMEOUT_DISPLAY "1 minute"
 #define PROGRAM_NAME "Phusion Passenger"
+#define REQUEST_QUEUE_OVERLOAD_INTERVAL 1000
 #define RPM_APACHE_MODULE_PACKAGE "mod_passenger"
 #define RPM_DEV_PACKAGE "passenger-devel"
 #define RPM_MAIN_PACKAGE "passenger"
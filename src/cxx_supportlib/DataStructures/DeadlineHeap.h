@@ -0,0 +1,192 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_DATA_STRUCTURES_DEADLINE_HEAP_H_
+#define _PASSENGER_DATA_STRUCTURES_DEADLINE_HEAP_H_
+
+#include <boost/noncopyable.hpp>
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+namespace Passenger {
+
+using namespace std;
+
+
+/**
+ * An item in a DeadlineHeap. Embed this in the object that the deadline
+ * is about, and set `userData` to point back to that object.
+ */
+struct DeadlineHeapEntry {
+	/** Only valid while the entry is in a heap. */
+	unsigned long long deadline;
+	/** Position in the heap, or NOT_IN_HEAP. */
+	unsigned int index;
+	void *userData;
+
+	static const unsigned int NOT_IN_HEAP = ~0u;
+
+	DeadlineHeapEntry()
+		: deadline(0),
+		  index(NOT_IN_HEAP),
+		  userData(NULL)
+		{ }
+
+	bool isInHeap() const {
+		return index != NOT_IN_HEAP;
+	}
+};
+
+/**
+ * An intrusive binary min-heap of entries ordered by deadline. Scheduling,
+ * rescheduling and removing an entry are O(log n), and finding the entry
+ * with the earliest deadline is O(1). This makes it possible to process
+ * only the entries whose deadline has passed, instead of checking all of
+ * them.
+ *
+ * An entry must be removed from the heap before it is destroyed.
+ *
+ * Not thread-safe.
+ */
+class DeadlineHeap: public boost::noncopyable {
+private:
+	vector<DeadlineHeapEntry *> entries;
+
+	void place(DeadlineHeapEntry *entry, unsigned int index) {
+		entries[index] = entry;
+		entry->index = index;
+	}
+
+	void siftUp(unsigned int index) {
+		DeadlineHeapEntry *entry = entries[index];
+		while (index > 0) {
+			unsigned int parent = (index - 1) / 2;
+			if (entries[parent]->deadline <= entry->deadline) {
+				break;
+			}
+			place(entries[parent], index);
+			index = parent;
+		}
+		place(entry, index);
+	}
+
+	void siftDown(unsigned int index) {
+		DeadlineHeapEntry *entry = entries[index];
+		unsigned int size = entries.size();
+		while (true) {
+			unsigned int child = index * 2 + 1;
+			if (child >= size) {
+				break;
+			}
+			if (child + 1 < size && entries[child + 1]->deadline < entries[child]->deadline) {
+				child++;
+			}
+			if (entry->deadline <= entries[child]->deadline) {
+				break;
+			}
+			place(entries[child], index);
+			index = child;
+		}
+		place(entry, index);
+	}
+
+public:
+	/**
+	 * Adds the entry to the heap with the given deadline. If the entry is
+	 * already in the heap, then its deadline is changed.
+	 */
+	void schedule(DeadlineHeapEntry *entry, unsigned long long deadline) {
+		if (entry->isInHeap()) {
+			unsigned long long oldDeadline = entry->deadline;
+			entry->deadline = deadline;
+			if (deadline < oldDeadline) {
+				siftUp(entry->index);
+			} else {
+				siftDown(entry->index);
+			}
+		} else {
+			entry->deadline = deadline;
+			entries.push_back(entry);
+			siftUp(entries.size() - 1);
+		}
+	}
+
+	/** Removes the entry from the heap. Does nothing if it isn't in the heap. */
+	void remove(DeadlineHeapEntry *entry) {
+		if (!entry->isInHeap()) {
+			return;
+		}
+
+		unsigned int index = entry->index;
+		DeadlineHeapEntry *last = entries.back();
+		entries.pop_back();
+		entry->index = DeadlineHeapEntry::NOT_IN_HEAP;
+		if (last != entry) {
+			place(last, index);
+			if (index > 0 && last->deadline < entries[(index - 1) / 2]->deadline) {
+				siftUp(index);
+			} else {
+				siftDown(index);
+			}
+		}
+	}
+
+	/**
+	 * Removes and returns the entry with the earliest deadline if that
+	 * deadline is at most `now`. Returns NULL otherwise.
+	 */
+	DeadlineHeapEntry *popExpired(unsigned long long now) {
+		if (entries.empty() || entries[0]->deadline > now) {
+			return NULL;
+		} else {
+			DeadlineHeapEntry *entry = entries[0];
+			remove(entry);
+			return entry;
+		}
+	}
+
+	/** Returns the entry with the earliest deadline, or NULL if the heap is empty. */
+	DeadlineHeapEntry *top() const {
+		if (entries.empty()) {
+			return NULL;
+		} else {
+			return entries[0];
+		}
+	}
+
+	unsigned int size() const {
+		return entries.size();
+	}
+
+	bool empty() const {
+		return entries.empty();
+	}
+};
+
+
+} // namespace Passenger
+
+#endif /* _PASSENGER_DATA_STRUCTURES_DEADLINE_HEAP_H_ */
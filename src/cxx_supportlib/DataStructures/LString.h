@@ -83,6 +83,17 @@ namespace {
 	psg_lstr_last_byte(const LString *str) {
 		return str->end->data[str->end->size - 1];
 	}
+
+	/**
+	 * Whether the LString consists of at most one part, so that its data
+	 * can be accessed through `str->start->data`. Most header values
+	 * arrive in a single mbuf, so most of the functions below check this
+	 * flag first and skip walking the part list.
+	 */
+	OXT_FORCE_INLINE bool
+	psg_lstr_is_contiguous(const LString *str) {
+		return str->start == str->end;
+	}
 }
 
 
@@ -234,22 +245,61 @@ psg_lstr_null_terminate(const LString *str, psg_pool_t *pool) {
 	return newstr;
 }
 
+/**
+ * If all parts of `str` are adjacent in memory (which happens when
+ * the parser splits a header on an mbuf boundary that turns out to be
+ * inside the same mbuf_block), then returns a single-part LString that
+ * references the original data, without copying anything. Otherwise
+ * returns NULL.
+ *
+ * The returned LString does not hold a reference on the mbuf_block, so
+ * it may not outlive `str`.
+ */
+inline LString *
+_psg_lstr_try_merge_adjacent_parts(const LString *str, psg_pool_t *pool) {
+	const LString::Part *part = str->start;
+	LString *newstr;
+
+	while (part->next != NULL) {
+		if (part->data + part->size != part->next->data) {
+			return NULL;
+		}
+		part = part->next;
+	}
+
+	newstr = (LString *) psg_palloc(pool, sizeof(LString));
+	if (OXT_UNLIKELY(newstr == NULL)) {
+		TRACE_POINT();
+		throw std::bad_alloc();
+	}
+
+	psg_lstr_init(newstr);
+	psg_lstr_append(newstr, pool, str->start->data, str->size);
+	return newstr;
+}
+
+/**
+ * Returns a contiguous version of `str`. If `str` is already contiguous
+ * then it is returned as-is. Otherwise the parts are merged without copying
+ * if possible, and copied into memory allocated from `pool` if not.
+ */
 inline LString *
 psg_lstr_make_contiguous(LString *str, psg_pool_t *pool) {
-	if (str->size == 0 || str->start == str->end) {
+	if (OXT_LIKELY(psg_lstr_is_contiguous(str))) {
 		return str;
 	} else {
-		return psg_lstr_null_terminate(str, pool);
+		LString *result = _psg_lstr_try_merge_adjacent_parts(str, pool);
+		if (result != NULL) {
+			return result;
+		} else {
+			return psg_lstr_null_terminate(str, pool);
+		}
 	}
 }
 
 inline const LString *
 psg_lstr_make_contiguous(const LString *str, psg_pool_t *pool) {
-	if (str->size == 0 || str->start == str->end) {
-		return str;
-	} else {
-		return psg_lstr_null_terminate(str, pool);
-	}
+	return psg_lstr_make_contiguous(const_cast<LString *>(str), pool);
 }
 
 inline bool
@@ -269,6 +319,10 @@ psg_lstr_cmp(const LString *str, const StaticString &other) {
 		return false;
 	}
 
+	if (OXT_LIKELY(psg_lstr_is_contiguous(str))) {
+		return memeqFast(str->start->data, other.data(), str->size);
+	}
+
 	part = str->start;
 	b = other.data();
 	while (part != NULL) {
@@ -281,6 +335,36 @@ psg_lstr_cmp(const LString *str, const StaticString &other) {
 	return true;
 }
 
+/**
+ * Checks whether `str` and `other` are equal, comparing ASCII letters
+ * case-insensitively. Useful for header names and values such as
+ * host names that are not normalized by the parser.
+ */
+inline bool
+psg_lstr_casecmp(const LString *str, const StaticString &other) {
+	const LString::Part *part;
+	const char *b;
+
+	if (str->size != other.size()) {
+		return false;
+	}
+
+	if (OXT_LIKELY(psg_lstr_is_contiguous(str))) {
+		return memcaseeqFast(str->start->data, other.data(), str->size);
+	}
+
+	part = str->start;
+	b = other.data();
+	while (part != NULL) {
+		if (!memcaseeqFast(part->data, b, part->size)) {
+			return false;
+		}
+		b += part->size;
+		part = part->next;
+	}
+	return true;
+}
+
 // Check whether the first `size` bytes of both `str` and `other` are equal.
 inline bool
 psg_lstr_cmp(const LString *str, const StaticString &other, unsigned int size) {
@@ -305,12 +389,10 @@ psg_lstr_cmp(const LString *str, const StaticString &other, unsigned int size) {
 	if (psg_lstr_first_byte(str) != other[0]) {
 		return false;
 	}
-	// Fast check: in the common case where the LString only has 1 part,
-	// check whether the last bytes of both strings match
-	if (str->start == str->end
-	 && str->start->data[size - 1] != other[size - 1])
-	{
-		return false;
+	// Fast path: in the common case where the LString only has 1 part,
+	// compare the data directly
+	if (psg_lstr_is_contiguous(str)) {
+		return memeqFast(str->start->data, other.data(), size);
 	}
 
 	checked = 0;
@@ -350,6 +432,10 @@ psg_lstr_cmp(const LString *str, const LString *other) {
 	{
 		return false;
 	}
+	// Fast path: both strings consist of a single part
+	if (psg_lstr_is_contiguous(str) && psg_lstr_is_contiguous(other)) {
+		return memeqFast(str->start->data, other->start->data, str->size);
+	}
 
 	a_part   = str->start;
 	b_part   = other->start;
@@ -439,6 +525,10 @@ psg_lstr_deinit(LString *str) {
 
 inline char *
 appendData(char *pos, const char *end, const LString *str) {
+	if (psg_lstr_is_contiguous(str)) {
+		return appendData(pos, end, str->start->data, str->size);
+	}
+
 	const LString::Part *part = str->start;
 	while (part != NULL) {
 		pos = appendData(pos, end, part->data, part->size);
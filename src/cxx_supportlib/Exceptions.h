@@ -397,9 +397,13 @@ public:
  * the getWaitlist queue was full.
  */
 class RequestQueueFullException: public GetAbortedException {
-private:
+protected:
 	string msg;
 
+	RequestQueueFullException()
+		: GetAbortedException(oxt::tracable_exception::no_backtrace())
+		{ }
+
 public:
 	RequestQueueFullException(unsigned int maxQueueSize)
 		: GetAbortedException(oxt::tracable_exception::no_backtrace())
@@ -416,6 +420,25 @@ public:
 	}
 };
 
+/**
+ * Indicates that a Pool::get() or Pool::asyncGet() request was denied because
+ * it waited in the getWaitlist queue for longer than the queue's target delay
+ * while the queue was overloaded. It is handled like a full queue.
+ */
+class RequestQueueTimeoutException: public RequestQueueFullException {
+public:
+	RequestQueueTimeoutException(unsigned int targetDelay)
+		: RequestQueueFullException()
+		{
+			stringstream str;
+			str << "Request queue overloaded (waited longer than the configured "
+				"target delay of " << targetDelay << " msec)";
+			msg = str.str();
+		}
+
+	virtual ~RequestQueueTimeoutException() throw() {}
+};
+
 /**
  * Indicates that a specified argument is incorrect or violates a requirement.
  *
@@ -0,0 +1,169 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_LOGGING_KIT_ASYNC_WRITER_H_
+#define _PASSENGER_LOGGING_KIT_ASYNC_WRITER_H_
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <oxt/thread.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <LoggingKit/Forward.h>
+
+namespace Passenger {
+namespace LoggingKit {
+
+using namespace std;
+
+
+/**
+ * Writes log entries to the log target from a background thread, so that
+ * logging threads (in particular event loop threads) never block on a slow
+ * disk or a full pipe.
+ *
+ * Producers copy fully formatted log entries into a ring buffer. Every
+ * thread is mapped to one of a fixed number of rings, so that appending is
+ * normally just a memcpy() plus an uncontended flag. The writer thread
+ * drains all rings with a single writev() every FLUSH_INTERVAL, or as soon
+ * as a ring is half full. Entries from the same thread stay in order;
+ * entries from different threads may be written in a slightly different
+ * order than they were logged in.
+ *
+ * If a ring is full, the producer writes the buffered entries itself
+ * before appending, so log entries are never lost or reordered, at the
+ * cost of blocking the producer while the log target cannot keep up.
+ *
+ * After a fork, the writer thread does not exist in the child process,
+ * so all writes in the child are synchronous.
+ */
+class AsyncWriter: public boost::noncopyable {
+public:
+	static const unsigned int RING_COUNT = 32;
+	static const unsigned int RING_SIZE = 64 * 1024;
+	/** How often the writer thread writes buffered entries, in milliseconds. */
+	static const unsigned int FLUSH_INTERVAL = 10;
+
+private:
+	/**
+	 * A single-consumer ring buffer of bytes. Log entries are
+	 * newline-terminated, so no framing is needed. `head` and `tail`
+	 * increase monotonically; the position in `buffer` is obtained by
+	 * masking them, so entries may wrap around the end.
+	 */
+	struct Ring {
+		char buffer[RING_SIZE];
+		boost::atomic<bool> producerLock;
+		boost::atomic<size_t> head;
+		boost::atomic<size_t> tail;
+
+		Ring()
+			: producerLock(false),
+			  head(0),
+			  tail(0)
+			{ }
+
+		/**
+		 * Appends an entry. On success, `used` is set to the number
+		 * of bytes in the ring after appending.
+		 */
+		bool push(const char *data, size_t size, size_t *used) {
+			while (producerLock.exchange(true, boost::memory_order_acquire)) {
+				boost::this_thread::yield();
+			}
+
+			size_t h = head.load(boost::memory_order_relaxed);
+			size_t t = tail.load(boost::memory_order_acquire);
+			if (RING_SIZE - (h - t) < size) {
+				producerLock.store(false, boost::memory_order_release);
+				return false;
+			}
+
+			size_t offset = h & (RING_SIZE - 1);
+			size_t firstPart = std::min<size_t>(size, RING_SIZE - offset);
+			memcpy(buffer + offset, data, firstPart);
+			memcpy(buffer, data + firstPart, size - firstPart);
+			head.store(h + size, boost::memory_order_release);
+			producerLock.store(false, boost::memory_order_release);
+			*used = h + size - t;
+			return true;
+		}
+	};
+
+	const Context *owner;
+	boost::atomic<Ring *> rings[RING_COUNT];
+	boost::atomic<bool> writerIdle;
+
+	/** Serializes draining between the writer thread and `flush()`. */
+	boost::mutex drainSyncher;
+
+	boost::mutex syncher;
+	boost::condition_variable cond;
+	bool quit;
+	oxt::thread *thr;
+
+	Ring *getRingForCurrentThread();
+	void drain();
+	void writerMain();
+
+public:
+	AsyncWriter(const Context *owner);
+
+	/**
+	 * Writes all buffered entries, then stops the writer thread.
+	 */
+	~AsyncWriter();
+
+	/**
+	 * Appends a log entry. Returns false if the entry must be written
+	 * synchronously instead: after a fork, or if the entry is larger
+	 * than a ring.
+	 */
+	bool write(const char *data, size_t size);
+
+	/**
+	 * Blocks until all entries that were appended before this call have
+	 * been written.
+	 */
+	void flush();
+
+	/**
+	 * Writes out all buffered entries directly to `fd`, without locking
+	 * and without coordinating with the writer thread. Only meant to be
+	 * called from a signal handler that is about to abort the process.
+	 * This is async-signal-safe.
+	 */
+	void emergencyFlush(int fd);
+};
+
+
+} // namespace LoggingKit
+} // namespace Passenger
+
+#endif /* _PASSENGER_LOGGING_KIT_ASYNC_WRITER_H_ */
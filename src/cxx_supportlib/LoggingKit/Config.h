@@ -49,11 +49,13 @@ using namespace std;
  * (do not edit: following text is automatically generated
  * by 'rake configkit_schemas_inline_comments')
  *
- *   app_output_log_level         string    -   default("notice")
- *   file_descriptor_log_target   any       -   -
- *   level                        string    -   default("notice")
- *   redirect_stderr              boolean   -   default(true)
- *   target                       any       -   default({"stderr": true})
+ *   app_output_log_level         string             -   default("notice")
+ *   app_output_rate_limit        unsigned integer   -   default(0)
+ *   async                        boolean            -   default(false)
+ *   file_descriptor_log_target   any                -   -
+ *   level                        string             -   default("notice")
+ *   redirect_stderr              boolean            -   default(true)
+ *   target                       any                -   default({"stderr": true})
  *
  * END
  */
@@ -78,6 +80,10 @@ struct ConfigRealization {
 
 	Level level;
 	Level appOutputLogLevel;
+	unsigned int appOutputRateLimit;
+	bool async;
+	/** Set by the Context if `async` is true. Not owned by this object. */
+	AsyncWriter *asyncWriter;
 
 	TargetType targetType;
 	TargetType fileDescriptorLogTargetType;
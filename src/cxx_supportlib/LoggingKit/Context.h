@@ -71,6 +71,8 @@ private:
 	mutable boost::mutex syncher;
 	ConfigKit::Store config;
 	boost::atomic<ConfigRealization *> configRlz;
+	/** Created when async logging is first enabled; lives as long as the Context. */
+	AsyncWriter *asyncWriter;
 
 	mutable boost::mutex gcSyncher;
 	oxt::thread *gcThread;
@@ -90,6 +92,7 @@ public:
 	void commitConfigChange(LoggingKit::ConfigChangeRequest &req)
 		BOOST_NOEXCEPT_OR_NOTHROW;
 	Json::Value inspectConfig() const;
+	void emergencyFlush() const;
 
 	OXT_FORCE_INLINE
 	const ConfigRealization *getConfigRealization() const {
@@ -112,6 +115,14 @@ private:
 void initialize(const Json::Value &initialConfig = Json::Value(),
 	const ConfigKit::Translator &translator = ConfigKit::DummyTranslator());
 
+/**
+ * Writes out the log entries that the asynchronous writer has not yet
+ * written. Async-signal-safe; meant to be called from a signal handler
+ * that is about to abort the process. Entries that the writer thread is
+ * writing at the same time may appear twice.
+ */
+void emergencyFlush();
+
 
 } // namespace LoggingKit
 } // namespace Passenger
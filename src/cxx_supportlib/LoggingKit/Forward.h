@@ -50,6 +50,7 @@ namespace LoggingKit {
 class Schema;
 struct ConfigRealization;
 class Context;
+class AsyncWriter;
 
 enum Level {
 	CRIT   = 0,
@@ -34,6 +34,7 @@
 #include <cassert>
 #include <queue>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <utility>
 #include <unistd.h>
@@ -52,6 +53,7 @@
 #include <LoggingKit/Assert.h>
 #include <LoggingKit/Config.h>
 #include <LoggingKit/Context.h>
+#include <LoggingKit/AsyncWriter.h>
 #include <ConfigKit/ConfigKit.h>
 #include <FileTools/PathManip.h>
 #include <Utils.h>
@@ -69,6 +71,23 @@ using namespace std;
 Context *context = NULL;
 AssertionFailureInfo lastAssertionFailure;
 
+#ifdef OXT_THREAD_LOCAL_KEYWORD_SUPPORTED
+	/**
+	 * localtime_r() and snprintf() are relatively expensive, so every thread
+	 * caches the date and time formatted up to the second.
+	 */
+	struct CachedDateTime {
+		time_t sec;
+		unsigned int size;
+		char data[32];
+	};
+
+	static __thread CachedDateTime cachedDateTime;
+#endif
+
+/** Set in child processes, in which the async writer thread does not exist. */
+static bool asyncWriterForked = false;
+
 
 void
 initialize(const Json::Value &initialConfig, const ConfigKit::Translator &translator) {
@@ -81,6 +100,13 @@ shutdown() {
 	context = NULL;
 }
 
+void
+emergencyFlush() {
+	if (context != NULL) {
+		context->emergencyFlush();
+	}
+}
+
 Level getLevel() {
 	if (OXT_LIKELY(context != NULL)) {
 		return context->getConfigRealization()->level;
@@ -182,9 +208,21 @@ _shouldLogFileDescriptors(const Context *context, const ConfigRealization **outp
 	}
 }
 
+static unsigned int
+formatDateTimeUpToSecond(char *buf, size_t bufSize, time_t sec) {
+	struct tm the_tm;
+	int size;
+
+	localtime_r(&sec, &the_tm);
+	size = snprintf(buf, bufSize,
+		"%d-%02d-%02d %02d:%02d:%02d",
+		the_tm.tm_year + 1900, the_tm.tm_mon + 1, the_tm.tm_mday,
+		the_tm.tm_hour, the_tm.tm_min, the_tm.tm_sec);
+	return std::min<unsigned int>(size, bufSize - 1);
+}
+
 void
 _prepareLogEntry(FastStringStream<> &sstream, Level level, const char *file, unsigned int line) {
-	struct tm the_tm;
 	char datetime_buf[32];
 	char threadIdBuf[std::max<unsigned int>(
 		std::max<unsigned int>(
@@ -193,7 +231,7 @@ _prepareLogEntry(FastStringStream<> &sstream, Level level, const char *file, uns
 		),
 		32
 	)];
-	int datetime_size;
+	unsigned int datetime_size, fraction;
 	unsigned int threadIdSize;
 	struct timeval tv;
 	StaticString logLevelMarkers[] = {
@@ -208,12 +246,26 @@ _prepareLogEntry(FastStringStream<> &sstream, Level level, const char *file, uns
 	};
 
 	gettimeofday(&tv, NULL);
-	localtime_r(&tv.tv_sec, &the_tm);
-	datetime_size = snprintf(datetime_buf, sizeof(datetime_buf),
-		"%d-%02d-%02d %02d:%02d:%02d.%04llu",
-		the_tm.tm_year + 1900, the_tm.tm_mon + 1, the_tm.tm_mday,
-		the_tm.tm_hour, the_tm.tm_min, the_tm.tm_sec,
-		(unsigned long long) tv.tv_usec / 100);
+	#ifdef OXT_THREAD_LOCAL_KEYWORD_SUPPORTED
+		if (OXT_UNLIKELY(cachedDateTime.size == 0 || cachedDateTime.sec != tv.tv_sec)) {
+			cachedDateTime.size = formatDateTimeUpToSecond(cachedDateTime.data,
+				sizeof(cachedDateTime.data) - 5, tv.tv_sec);
+			cachedDateTime.sec = tv.tv_sec;
+		}
+		memcpy(datetime_buf, cachedDateTime.data, cachedDateTime.size);
+		datetime_size = cachedDateTime.size;
+	#else
+		datetime_size = formatDateTimeUpToSecond(datetime_buf,
+			sizeof(datetime_buf) - 5, tv.tv_sec);
+	#endif
+	// Append the fraction in units of 100 microseconds.
+	fraction = tv.tv_usec / 100;
+	datetime_buf[datetime_size] = '.';
+	datetime_buf[datetime_size + 1] = '0' + fraction / 1000;
+	datetime_buf[datetime_size + 2] = '0' + fraction / 100 % 10;
+	datetime_buf[datetime_size + 3] = '0' + fraction / 10 % 10;
+	datetime_buf[datetime_size + 4] = '0' + fraction % 10;
+	datetime_size += 5;
 
 	#ifdef OXT_THREAD_LOCAL_KEYWORD_SUPPORTED
 		// We only use oxt::get_thread_local_context() if it is fast enough.
@@ -290,10 +342,37 @@ writeExactWithoutOXT(int fd, const char *str, unsigned int size) {
 	}
 }
 
+static void
+writevExactWithoutOXT(int fd, struct iovec *iov, unsigned int count) {
+	// See writeExactWithoutOXT() for why we don't use oxt and ignore errors.
+	ssize_t ret;
+	while (count > 0) {
+		do {
+			ret = writev(fd, iov, count);
+		} while (ret == -1 && errno == EINTR);
+		if (ret == -1) {
+			break;
+		}
+		while (count > 0 && (size_t) ret >= iov->iov_len) {
+			ret -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (char *) iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+}
+
 void
 _writeLogEntry(const ConfigRealization *configRealization, const char *str, unsigned int size) {
 	if (OXT_LIKELY(configRealization != NULL)) {
-		writeExactWithoutOXT(configRealization->targetFd, str, size);
+		if (configRealization->asyncWriter == NULL
+		 || !configRealization->asyncWriter->write(str, size))
+		{
+			writeExactWithoutOXT(configRealization->targetFd, str, size);
+		}
 	} else {
 		writeExactWithoutOXT(STDERR_FILENO, str, size);
 	}
@@ -373,6 +452,182 @@ logAppOutput(pid_t pid, const char *channelName, const char *message, unsigned i
 	}
 }
 
+/**
+ * Token bucket: a process may log `limit` lines per second, with bursts
+ * of at most `limit` lines. Returns the number of lines that may be logged.
+ */
+static size_t
+admitAppOutputLines(AppOutputRateLimiter *rateLimiter, unsigned int limit, size_t lines) {
+	MonotonicTimeUsec now = SystemTime::getMonotonicUsec();
+
+	if (rateLimiter->allowance < 0) {
+		rateLimiter->allowance = limit;
+	} else {
+		rateLimiter->allowance += (now - rateLimiter->lastCheckTime) * (limit / 1000000.0);
+		if (rateLimiter->allowance > limit) {
+			rateLimiter->allowance = limit;
+		}
+	}
+	rateLimiter->lastCheckTime = now;
+
+	size_t admitted = std::min<size_t>(lines, (size_t) rateLimiter->allowance);
+	rateLimiter->allowance -= admitted;
+	rateLimiter->droppedLines += lines - admitted;
+	return admitted;
+}
+
+static void
+writeAppOutputLines(const ConfigRealization *configRealization, int targetFd,
+	const char *prefix, size_t prefixLen, const char *note, size_t noteLen,
+	const char *data, size_t size)
+{
+	const char *end = data + size;
+
+	if (configRealization != NULL && configRealization->asyncWriter != NULL) {
+		// Format everything into a single entry so that the lines are not
+		// interleaved with entries from other threads.
+		size_t lines = 1 + std::count(data, end, '\n');
+		size_t totalLen = noteLen + size + lines * (prefixLen + 1);
+		DynamicBuffer buf(totalLen);
+		char *pos = buf.data;
+		char *bufEnd = buf.data + totalLen;
+
+		pos = appendData(pos, bufEnd, note, noteLen);
+		while (true) {
+			const char *next = (const char *) memchr(data, '\n', end - data);
+			if (next == NULL) {
+				next = end;
+			}
+			pos = appendData(pos, bufEnd, prefix, prefixLen);
+			pos = appendData(pos, bufEnd, data, next - data);
+			pos = appendData(pos, bufEnd, "\n", 1);
+			if (next == end) {
+				break;
+			}
+			data = next + 1;
+		}
+		if (!configRealization->asyncWriter->write(buf.data, pos - buf.data)) {
+			writeExactWithoutOXT(targetFd, buf.data, pos - buf.data);
+		}
+		return;
+	}
+
+	// Write the lines without copying them, with a few writev() calls.
+	struct iovec iov[3 * 64];
+	unsigned int iovCount = 0;
+
+	if (noteLen > 0) {
+		iov[0].iov_base = (char *) note;
+		iov[0].iov_len = noteLen;
+		iovCount++;
+	}
+	while (true) {
+		const char *next = (const char *) memchr(data, '\n', end - data);
+		if (next == NULL) {
+			next = end;
+		}
+		iov[iovCount].iov_base = (char *) prefix;
+		iov[iovCount].iov_len = prefixLen;
+		iov[iovCount + 1].iov_base = (char *) data;
+		iov[iovCount + 1].iov_len = next - data;
+		iov[iovCount + 2].iov_base = (char *) "\n";
+		iov[iovCount + 2].iov_len = 1;
+		iovCount += 3;
+		if (iovCount + 3 > sizeof(iov) / sizeof(struct iovec) || next == end) {
+			writevExactWithoutOXT(targetFd, iov, iovCount);
+			iovCount = 0;
+		}
+		if (next == end) {
+			break;
+		}
+		data = next + 1;
+	}
+}
+
+void
+logAppOutputLines(pid_t pid, const char *channelName, const char *data, size_t size,
+	AppOutputRateLimiter *rateLimiter)
+{
+	const ConfigRealization *configRealization;
+	int targetFd;
+
+	if (size == 0) {
+		return;
+	}
+
+	if (OXT_LIKELY(context != NULL)) {
+		configRealization = context->getConfigRealization();
+		if (configRealization->level < configRealization->appOutputLogLevel) {
+			return;
+		}
+		targetFd = configRealization->targetFd;
+	} else {
+		configRealization = NULL;
+		targetFd = STDERR_FILENO;
+	}
+
+	if (data[size - 1] == '\n') {
+		size--;
+	}
+
+	char prefix[sizeof("App 4294967295 : ") + 16];
+	char *prefixEnd = prefix + sizeof(prefix);
+	char *pos = appendData(prefix, prefixEnd, "App ");
+	try {
+		pos += integerToOtherBase<pid_t, 10>(pid, pos, prefixEnd - pos);
+	} catch (const std::length_error &) {
+		pos = appendData(pos, prefixEnd, "?");
+	}
+	pos = appendData(pos, prefixEnd, " ");
+	pos = appendData(pos, prefixEnd, channelName);
+	pos = appendData(pos, prefixEnd, ": ");
+	size_t prefixLen = pos - prefix;
+
+	char note[200];
+	size_t noteLen = 0;
+	unsigned int rateLimit = (configRealization != NULL)
+		? configRealization->appOutputRateLimit
+		: 0;
+
+	if (rateLimiter != NULL && rateLimit > 0) {
+		const char *end = data + size;
+		size_t lines = 1 + std::count(data, end, '\n');
+		unsigned long long previouslyDropped = rateLimiter->droppedLines;
+		size_t admitted = admitAppOutputLines(rateLimiter, rateLimit, lines);
+		if (admitted == 0) {
+			return;
+		}
+
+		// Only log the first `admitted` lines.
+		const char *cut = data;
+		for (size_t i = 0; i < admitted; i++) {
+			cut = (const char *) memchr(cut, '\n', end - cut);
+			if (cut == NULL) {
+				cut = end;
+				break;
+			}
+			cut++;
+		}
+		size = (cut == end) ? size : (cut - 1 - data);
+
+		if (previouslyDropped > 0) {
+			char *notePos = note;
+			char *noteEnd = note + sizeof(note);
+			notePos = appendData(notePos, noteEnd, prefix, prefixLen);
+			notePos = appendData(notePos, noteEnd, "[");
+			notePos = appendData(notePos, noteEnd,
+				toString(previouslyDropped));
+			notePos = appendData(notePos, noteEnd,
+				" lines dropped because the app exceeds app_output_rate_limit]\n");
+			noteLen = notePos - note;
+			rateLimiter->droppedLines -= previouslyDropped;
+		}
+	}
+
+	writeAppOutputLines(configRealization, targetFd, prefix, prefixLen,
+		note, noteLen, data, size);
+}
+
 
 static Json::Value
 normalizeConfig(const Json::Value &effectiveValues) {
@@ -408,15 +663,25 @@ normalizeConfig(const Json::Value &effectiveValues) {
 Context::Context(const Json::Value &initialConfig,
 	const ConfigKit::Translator &translator)
 	: config(schema, initialConfig, translator),
+	  asyncWriter(NULL),
 	  gcThread(NULL),
 	  shuttingDown(false)
 {
 	configRlz.store(new ConfigRealization(config));
 	configRlz.load()->apply(config, NULL);
 	configRlz.load()->finalize();
+	if (configRlz.load()->async) {
+		asyncWriter = new AsyncWriter(this);
+		configRlz.load()->asyncWriter = asyncWriter;
+	}
 }
 
 Context::~Context() {
+	if (asyncWriter != NULL) {
+		configRlz.load()->asyncWriter = NULL;
+		delete asyncWriter;
+	}
+
 	boost::unique_lock<boost::mutex> l(gcSyncher);
 
 	// If a gc thread exists, tell it to shut down and
@@ -463,6 +728,23 @@ Context::commitConfigChange(LoggingKit::ConfigChangeRequest &req) BOOST_NOEXCEPT
 
 	req.configRlz->apply(*req.config, oldConfigRlz);
 
+	if (newConfigRlz->async && asyncWriter == NULL) {
+		try {
+			asyncWriter = new AsyncWriter(this);
+		} catch (const std::exception &e) {
+			P_ERROR("Error spawning the asynchronous log writer thread, "
+				"so logging synchronously: " << e.what());
+		}
+	}
+	if (asyncWriter != NULL) {
+		// Entries that were logged with the old config must go
+		// to the old target.
+		asyncWriter->flush();
+		if (newConfigRlz->async) {
+			newConfigRlz->asyncWriter = asyncWriter;
+		}
+	}
+
 	config.swap(*req.config);
 
 	configRlz.store(newConfigRlz, boost::memory_order_release);
@@ -471,6 +753,14 @@ Context::commitConfigChange(LoggingKit::ConfigChangeRequest &req) BOOST_NOEXCEPT
 	newConfigRlz->finalize();
 }
 
+void
+Context::emergencyFlush() const {
+	const ConfigRealization *configRlz = getConfigRealization();
+	if (configRlz->asyncWriter != NULL) {
+		configRlz->asyncWriter->emergencyFlush(configRlz->targetFd);
+	}
+}
+
 Json::Value
 Context::inspectConfig() const {
 	boost::lock_guard<boost::mutex> l(syncher);
@@ -662,6 +952,8 @@ Schema::Schema() {
 		.setInspectFilter(filterTargetFd);
 	add("redirect_stderr", BOOL_TYPE, OPTIONAL, true);
 	add("app_output_log_level", STRING_TYPE, OPTIONAL, DEFAULT_APP_OUTPUT_LOG_LEVEL_NAME);
+	add("app_output_rate_limit", UINT_TYPE, OPTIONAL, 0);
+	add("async", BOOL_TYPE, OPTIONAL, false);
 
 	addValidator(boost::bind(validateLogLevel, "level",
 		boost::placeholders::_1, boost::placeholders::_2));
@@ -681,6 +973,9 @@ Schema::Schema() {
 ConfigRealization::ConfigRealization(const ConfigKit::Store &store)
 	: level(parseLevel(store["level"].asString())),
 	  appOutputLogLevel(parseLevel(store["app_output_log_level"].asString())),
+	  appOutputRateLimit(store["app_output_rate_limit"].asUInt()),
+	  async(store["async"].asBool()),
+	  asyncWriter(NULL),
 	  finalized(false)
 {
 	if (store["target"].isMember("stderr")) {
@@ -803,6 +1098,215 @@ ConfigRealization::finalize() {
 }
 
 
+static void
+markAsyncWriterForked() {
+	asyncWriterForked = true;
+}
+
+static void
+registerAsyncWriterAtforkHandler() {
+	pthread_atfork(NULL, NULL, markAsyncWriterForked);
+}
+
+static unsigned int
+hashCurrentPthread() {
+	boost::uintptr_t h = (boost::uintptr_t) pthread_self();
+	// pthread_t is usually an aligned pointer, so mix in the high bits.
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return (unsigned int) h;
+}
+
+AsyncWriter::AsyncWriter(const Context *_owner)
+	: owner(_owner),
+	  writerIdle(false),
+	  quit(false)
+{
+	static boost::once_flag atforkHandlerRegistered = BOOST_ONCE_INIT;
+	boost::call_once(atforkHandlerRegistered, registerAsyncWriterAtforkHandler);
+
+	for (unsigned int i = 0; i < RING_COUNT; i++) {
+		rings[i].store(NULL, boost::memory_order_relaxed);
+	}
+	thr = new oxt::thread(boost::bind(&AsyncWriter::writerMain, this),
+		"LoggingKit async writer", 128 * 1024);
+}
+
+AsyncWriter::~AsyncWriter() {
+	if (asyncWriterForked) {
+		// The writer thread only exists in the parent process,
+		// which also writes the buffered entries.
+		return;
+	}
+
+	{
+		boost::lock_guard<boost::mutex> l(syncher);
+		quit = true;
+		cond.notify_one();
+	}
+	{
+		boost::this_thread::disable_interruption di;
+		boost::this_thread::disable_syscall_interruption dsi;
+		thr->join();
+	}
+	delete thr;
+	for (unsigned int i = 0; i < RING_COUNT; i++) {
+		delete rings[i].load(boost::memory_order_relaxed);
+	}
+}
+
+AsyncWriter::Ring *
+AsyncWriter::getRingForCurrentThread() {
+	unsigned int index;
+
+	#ifdef OXT_THREAD_LOCAL_KEYWORD_SUPPORTED
+		// oxt thread numbers are sequential, so the first RING_COUNT
+		// oxt threads each get a ring of their own.
+		oxt::thread_local_context *ctx = oxt::get_thread_local_context();
+		if (OXT_LIKELY(ctx != NULL)) {
+			index = ctx->thread_number % RING_COUNT;
+		} else {
+			index = hashCurrentPthread() % RING_COUNT;
+		}
+	#else
+		index = hashCurrentPthread() % RING_COUNT;
+	#endif
+
+	Ring *ring = rings[index].load(boost::memory_order_acquire);
+	if (OXT_UNLIKELY(ring == NULL)) {
+		Ring *newRing = new Ring();
+		if (rings[index].compare_exchange_strong(ring, newRing,
+			boost::memory_order_acq_rel))
+		{
+			ring = newRing;
+		} else {
+			// Another thread installed a ring first. `ring`
+			// now contains that ring.
+			delete newRing;
+		}
+	}
+	return ring;
+}
+
+/**
+ * Writes everything that is in the rings with a single writev() call
+ * (unless the kernel accepts less), then releases the ring space.
+ */
+void
+AsyncWriter::drain() {
+	boost::lock_guard<boost::mutex> l(drainSyncher);
+	struct iovec iov[2 * RING_COUNT];
+	Ring *drainedRings[RING_COUNT];
+	size_t newTails[RING_COUNT];
+	unsigned int iovCount = 0, drainedCount = 0;
+
+	for (unsigned int i = 0; i < RING_COUNT; i++) {
+		Ring *ring = rings[i].load(boost::memory_order_acquire);
+		if (ring == NULL) {
+			continue;
+		}
+
+		size_t h = ring->head.load(boost::memory_order_acquire);
+		size_t t = ring->tail.load(boost::memory_order_relaxed);
+		if (h == t) {
+			continue;
+		}
+
+		size_t offset = t & (RING_SIZE - 1);
+		size_t size = h - t;
+		size_t firstPart = std::min<size_t>(size, RING_SIZE - offset);
+		iov[iovCount].iov_base = ring->buffer + offset;
+		iov[iovCount].iov_len = firstPart;
+		iovCount++;
+		if (firstPart < size) {
+			iov[iovCount].iov_base = ring->buffer;
+			iov[iovCount].iov_len = size - firstPart;
+			iovCount++;
+		}
+		drainedRings[drainedCount] = ring;
+		newTails[drainedCount] = h;
+		drainedCount++;
+	}
+
+	if (iovCount > 0) {
+		writevExactWithoutOXT(owner->getConfigRealization()->targetFd, iov, iovCount);
+		for (unsigned int i = 0; i < drainedCount; i++) {
+			drainedRings[i]->tail.store(newTails[i], boost::memory_order_release);
+		}
+	}
+}
+
+void
+AsyncWriter::writerMain() {
+	boost::this_thread::disable_interruption di;
+	boost::this_thread::disable_syscall_interruption dsi;
+	boost::unique_lock<boost::mutex> l(syncher);
+
+	while (!quit) {
+		writerIdle.store(true, boost::memory_order_relaxed);
+		cond.timed_wait(l, boost::posix_time::millisec(FLUSH_INTERVAL));
+		writerIdle.store(false, boost::memory_order_relaxed);
+		l.unlock();
+		drain();
+		l.lock();
+	}
+	l.unlock();
+	drain();
+}
+
+bool
+AsyncWriter::write(const char *data, size_t size) {
+	if (OXT_UNLIKELY(asyncWriterForked)) {
+		return false;
+	}
+	Ring *ring = getRingForCurrentThread();
+	size_t used;
+	if (!ring->push(data, size, &used)) {
+		// The writer thread can't keep up. Write the buffered entries
+		// ourselves, so that this entry doesn't overtake them.
+		drain();
+		if (!ring->push(data, size, &used)) {
+			return false;
+		}
+	}
+
+	// Waking up the writer thread costs a system call, so we only
+	// do that when the ring is filling up. Otherwise the writer
+	// thread picks up the entry within FLUSH_INTERVAL.
+	if (used >= RING_SIZE / 2 && writerIdle.load(boost::memory_order_relaxed)) {
+		boost::lock_guard<boost::mutex> l(syncher);
+		cond.notify_one();
+	}
+	return true;
+}
+
+void
+AsyncWriter::flush() {
+	if (!asyncWriterForked) {
+		drain();
+	}
+}
+
+void
+AsyncWriter::emergencyFlush(int fd) {
+	for (unsigned int i = 0; i < RING_COUNT; i++) {
+		Ring *ring = rings[i].load(boost::memory_order_acquire);
+		if (ring == NULL) {
+			continue;
+		}
+
+		size_t h = ring->head.load(boost::memory_order_acquire);
+		size_t t = ring->tail.load(boost::memory_order_relaxed);
+		size_t offset = t & (RING_SIZE - 1);
+		size_t firstPart = std::min<size_t>(h - t, RING_SIZE - offset);
+		writeExactWithoutOXT(fd, ring->buffer + offset, firstPart);
+		writeExactWithoutOXT(fd, ring->buffer, h - t - firstPart);
+		ring->tail.store(h, boost::memory_order_release);
+	}
+}
+
+
 ConfigChangeRequest::ConfigChangeRequest()
 	: configRlz(NULL)
 {
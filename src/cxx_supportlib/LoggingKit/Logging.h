@@ -197,6 +197,40 @@ namespace LoggingKit {
  */
 void logAppOutput(pid_t pid, const char *channelName, const char *message, unsigned int size);
 
+/**
+ * Limits the number of lines per second that an application process may log,
+ * according to the `app_output_rate_limit` config option. Used with
+ * `logAppOutputLines()`. Keep one instance per output channel.
+ */
+struct AppOutputRateLimiter {
+	/** Number of lines that may still be logged in the current burst. */
+	double allowance;
+	unsigned long long lastCheckTime;
+	/** Number of lines that were dropped and not yet reported as such. */
+	unsigned long long droppedLines;
+
+	AppOutputRateLimiter()
+		: allowance(-1),
+		  lastCheckTime(0),
+		  droppedLines(0)
+		{ }
+};
+
+/**
+ * Logs one or more lines that were received from an application's
+ * stdout/stderr with a single write to the log target, instead of
+ * one write per line like `logAppOutput()`.
+ *
+ * @param pid The application's PID.
+ * @param channelName "stdout" or "stderr".
+ * @param data The received lines. The last line does not need to
+ *             be terminated by a newline.
+ * @param rateLimiter If not NULL, lines that exceed `app_output_rate_limit`
+ *                    are dropped.
+ */
+void logAppOutputLines(pid_t pid, const char *channelName, const char *data, size_t size,
+	AppOutputRateLimiter *rateLimiter = NULL);
+
 
 } // namespace LoggingKit
 } // namespace Passenger
@@ -24,6 +24,8 @@
 #include <algorithm>
 #include <ostream>
 #include <MemoryKit/mbuf.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <LoggingKit/LoggingKit.h>
 #include <StaticString.h>
 #include <Utils/StrIntUtils.h>
@@ -114,6 +116,7 @@ _mbuf_block_init(struct mbuf_pool *pool, char *buf, size_t block_offset)
 	mbuf_block->magic = MBUF_BLOCK_MAGIC;
 	mbuf_block->pool  = pool;
 	mbuf_block->offset = 0;
+	mbuf_block->released = 0;
 
 	_mbuf_block_mark_as_active(pool, mbuf_block);
 	return mbuf_block;
@@ -133,6 +136,14 @@ _mbuf_block_get(struct mbuf_pool *pool)
 		ASSERT_MBUF_BLOCK_PROPERTY(mbuf_block, mbuf_block->refcount == 0);
 
 		pool->nfree_mbuf_blockq--;
+		if (pool->nfree_mbuf_blockq < pool->nfree_low_watermark) {
+			pool->nfree_low_watermark = pool->nfree_mbuf_blockq;
+		}
+		if (mbuf_block->released) {
+			// The kernel lazily gives us zeroed pages again upon first access.
+			mbuf_block->released = 0;
+			pool->nreleased_mbuf_blockq--;
+		}
 		STAILQ_REMOVE_HEAD(&pool->free_mbuf_blockq, next);
 		_mbuf_block_mark_as_active(pool, mbuf_block);
 		return mbuf_block;
@@ -273,6 +284,8 @@ mbuf_pool_init(struct mbuf_pool *pool)
 {
 	pool->nfree_mbuf_blockq = 0;
 	pool->nactive_mbuf_blockq = 0;
+	pool->nreleased_mbuf_blockq = 0;
+	pool->nfree_low_watermark = 0;
 	STAILQ_INIT(&pool->free_mbuf_blockq);
 
 	#ifdef MBUF_ENABLE_DEBUGGING
@@ -310,10 +323,134 @@ mbuf_pool_compact(struct mbuf_pool *pool)
 		pool->nfree_mbuf_blockq--;
 	}
 	assert(pool->nfree_mbuf_blockq == 0);
+	pool->nreleased_mbuf_blockq = 0;
+	pool->nfree_low_watermark = 0;
 
 	return count;
 }
 
+static size_t
+_mbuf_page_size()
+{
+	static size_t page_size = 0;
+	if (page_size == 0) {
+		page_size = (size_t) sysconf(_SC_PAGESIZE);
+	}
+	return page_size;
+}
+
+/*
+ * Tell the kernel that it may reclaim the whole pages inside the data part
+ * of the given free mbuf_block. The header lives at the tail of the block
+ * and is left untouched, so the block can stay on the free q.
+ */
+static void
+_mbuf_block_release_pages(struct mbuf_pool *pool, struct mbuf_block *mbuf_block)
+{
+	#ifdef MADV_DONTNEED
+		size_t page_size = _mbuf_page_size();
+		uintptr_t begin = (uintptr_t) mbuf_block - pool->mbuf_block_offset;
+		uintptr_t end = (uintptr_t) mbuf_block;
+
+		begin = (begin + page_size - 1) & ~((uintptr_t) page_size - 1);
+		end = end & ~((uintptr_t) page_size - 1);
+		if (begin < end) {
+			madvise((void *) begin, end - begin, MADV_DONTNEED);
+		}
+	#endif
+}
+
+/*
+ * Return the memory of mbuf_blocks that have stayed on the free q ever since
+ * the previous call to this function, back to the OS. Meant to be called
+ * periodically; the interval between calls is the quiet period after which
+ * a free mbuf_block is considered idle.
+ *
+ * Blocks that are big enough to contain at least two whole pages are kept on
+ * the free q, but their pages are released with madvise(MADV_DONTNEED). Smaller
+ * blocks are freed.
+ *
+ * Returns the number of mbuf_blocks whose memory was released.
+ */
+unsigned int
+mbuf_pool_release_idle(struct mbuf_pool *pool)
+{
+	struct mbuf_block *mbuf_block, *prev, *next;
+	unsigned int skip, count = 0;
+	bool use_madvise = pool->mbuf_block_offset >= 2 * _mbuf_page_size();
+
+	/* The free q is a LIFO, so the blocks that have not been taken off the
+	 * free q since the last call are exactly the last nfree_low_watermark ones.
+	 */
+	assert(pool->nfree_low_watermark <= pool->nfree_mbuf_blockq);
+	skip = pool->nfree_mbuf_blockq - pool->nfree_low_watermark;
+	prev = NULL;
+	mbuf_block = STAILQ_FIRST(&pool->free_mbuf_blockq);
+
+	while (mbuf_block != NULL) {
+		next = STAILQ_NEXT(mbuf_block, next);
+		if (skip > 0) {
+			skip--;
+			prev = mbuf_block;
+		} else if (use_madvise) {
+			if (!mbuf_block->released) {
+				_mbuf_block_release_pages(pool, mbuf_block);
+				mbuf_block->released = 1;
+				pool->nreleased_mbuf_blockq++;
+				count++;
+			}
+			prev = mbuf_block;
+		} else {
+			if (prev == NULL) {
+				STAILQ_REMOVE_HEAD(&pool->free_mbuf_blockq, next);
+			} else {
+				STAILQ_REMOVE_AFTER(&pool->free_mbuf_blockq, prev, next);
+			}
+			STAILQ_NEXT(mbuf_block, next) = NULL;
+			mbuf_block_free(mbuf_block);
+			pool->nfree_mbuf_blockq--;
+			count++;
+		}
+		mbuf_block = next;
+	}
+
+	pool->nfree_low_watermark = pool->nfree_mbuf_blockq;
+	return count;
+}
+
+size_t
+mbuf_size_class_chunk_size(enum mbuf_size_class size_class, size_t default_chunk_size)
+{
+	switch (size_class) {
+	case MBUF_SIZE_CLASS_SMALL:
+		return std::max<size_t>(default_chunk_size / 4,
+			MBUF_BLOCK_MIN_SIZE + MBUF_BLOCK_HSIZE);
+	case MBUF_SIZE_CLASS_LARGE:
+		return std::min<size_t>(default_chunk_size * 4, MBUF_BLOCK_MAX_SIZE);
+	case MBUF_SIZE_CLASS_HUGE:
+		return std::min<size_t>(default_chunk_size * 16, MBUF_BLOCK_MAX_SIZE);
+	default:
+		return default_chunk_size;
+	}
+}
+
+const char *
+mbuf_size_class_name(enum mbuf_size_class size_class)
+{
+	switch (size_class) {
+	case MBUF_SIZE_CLASS_SMALL:
+		return "small";
+	case MBUF_SIZE_CLASS_DEFAULT:
+		return "default";
+	case MBUF_SIZE_CLASS_LARGE:
+		return "large";
+	case MBUF_SIZE_CLASS_HUGE:
+		return "huge";
+	default:
+		return "unknown";
+	}
+}
+
 
 void
 mbuf_block_ref(struct mbuf_block *mbuf_block)
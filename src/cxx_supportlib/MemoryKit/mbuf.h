@@ -86,6 +86,7 @@ struct mbuf_block {
 	struct mbuf_pool  *pool;      /* containing pool (const) */
 	boost::uint32_t    refcount;  /* number of references by mbuf subsets */
 	boost::uint32_t    offset;    /* standalone mbuf_block data size */
+	boost::uint32_t    released;  /* data pages returned to the OS while on the free q */
 };
 
 STAILQ_HEAD(mhdr, struct mbuf_block);
@@ -96,6 +97,8 @@ STAILQ_HEAD(mhdr, struct mbuf_block);
 struct mbuf_pool {
 	boost::uint32_t nfree_mbuf_blockq;   /* # free mbuf_block */
 	boost::uint32_t nactive_mbuf_blockq; /* # active (non-free) mbuf_block */
+	boost::uint32_t nreleased_mbuf_blockq; /* # free mbuf_block whose memory was returned to the OS */
+	boost::uint32_t nfree_low_watermark; /* lowest nfree_mbuf_blockq since last mbuf_pool_release_idle() */
 	struct mhdr free_mbuf_blockq; /* free mbuf_block q */
 	#ifdef MBUF_ENABLE_DEBUGGING
 		struct active_mbuf_block_list active_mbuf_blockq; /* active mbuf_block q */
@@ -114,10 +117,29 @@ struct mbuf_pool {
 #define MBUF_BLOCK_EMPTY(mbuf_block) ((mbuf_block)->pos  == (mbuf_block)->last)
 #define MBUF_BLOCK_FULL(mbuf_block)  ((mbuf_block)->last == (mbuf_block)->end)
 
+/*
+ * Size classes. A ServerKit::Context owns one mbuf_pool per size class so
+ * that producers can pick a block size that matches the amount of data they
+ * expect to read: small responses don't waste most of a large block, and
+ * large streaming responses don't need many small blocks. The chunk size of
+ * each class is derived from the configured (default class) chunk size.
+ */
+enum mbuf_size_class {
+	MBUF_SIZE_CLASS_SMALL,   /* chunk size / 4 */
+	MBUF_SIZE_CLASS_DEFAULT, /* chunk size */
+	MBUF_SIZE_CLASS_LARGE,   /* chunk size * 4 */
+	MBUF_SIZE_CLASS_HUGE,    /* chunk size * 16 */
+
+	MBUF_SIZE_CLASS_COUNT
+};
+
 void mbuf_pool_init(struct mbuf_pool *pool);
 void mbuf_pool_deinit(struct mbuf_pool *pool);
 size_t mbuf_pool_data_size(struct mbuf_pool *pool);
 unsigned int mbuf_pool_compact(struct mbuf_pool *pool);
+unsigned int mbuf_pool_release_idle(struct mbuf_pool *pool);
+size_t mbuf_size_class_chunk_size(enum mbuf_size_class size_class, size_t default_chunk_size);
+const char *mbuf_size_class_name(enum mbuf_size_class size_class);
 
 struct mbuf_block *mbuf_block_get(struct mbuf_pool *pool);
 void mbuf_block_put(struct mbuf_block *mbuf_block);
@@ -0,0 +1,224 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_SECURE_HEADERS_BLOCK_H_
+#define _PASSENGER_SECURE_HEADERS_BLOCK_H_
+
+/**
+ * Binary secure headers block
+ *
+ * Web server integration modules pass secure headers (`!~` headers) to the
+ * Passenger core. Instead of sending them as HTTP headers, which the core
+ * has to parse and hash one by one, a module may send them as a binary
+ * block in front of the HTTP request:
+ *
+ *     0x00                          magic byte; never starts an HTTP request
+ *     uint32 (big endian)           size of the entries that follow
+ *     entries
+ *
+ * Every entry is either:
+ *
+ *     uint8 id                      a PsgSecureHeaderId other than PSG_SHB_CUSTOM
+ *     uint32 (big endian)           value size
+ *     value
+ *
+ * or, for secure headers that have no id:
+ *
+ *     uint8 PSG_SHB_CUSTOM
+ *     uint32 (big endian)           name size
+ *     name                          the full header name, including "!~"
+ *     uint32 (big endian)           value size
+ *     value
+ *
+ * The block must contain a PSG_SHB_PASSWORD entry when the core has a
+ * secure mode password. The HTTP request that follows the block is parsed
+ * as usual. Sending secure headers as HTTP headers remains supported.
+ *
+ * This header is usable from both C and C++.
+ */
+
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if defined(__cplusplus) || (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L)
+	#define PSG_SHB_INLINE inline
+#else
+	#define PSG_SHB_INLINE __inline
+#endif
+
+#define PSG_SECURE_HEADERS_BLOCK_MAGIC '\0'
+#define PSG_SECURE_HEADERS_BLOCK_PREFIX_SIZE 5
+
+/**
+ * Secure headers that are sent with (almost) every request have an id.
+ * Don't change existing ids: the web server modules and the core may
+ * come from different builds during an upgrade.
+ */
+typedef enum {
+	PSG_SHB_PASSWORD,
+	PSG_SHB_DOCUMENT_ROOT,
+	PSG_SHB_SCRIPT_NAME,
+	PSG_SHB_REMOTE_ADDR,
+	PSG_SHB_REMOTE_PORT,
+	PSG_SHB_REMOTE_USER,
+	PSG_SHB_FLAGS,
+	PSG_SHB_APP_GROUP_NAME,
+	PSG_SHB_APP_ROOT,
+	PSG_SHB_APP_TYPE,
+	PSG_SHB_APP_ENV,
+	PSG_SHB_ENV_VARS,
+	PSG_SHB_UNION_STATION_SUPPORT,
+	PSG_SHB_UNION_STATION_KEY,
+	PSG_SHB_UNION_STATION_FILTERS,
+	PSG_SHB_STICKY_SESSIONS,
+	PSG_SHB_STICKY_SESSIONS_COOKIE_NAME,
+	PSG_SHB_MAX_REQUESTS,
+	PSG_SHB_MAX_REQUEST_TIME,
+
+	PSG_SHB_ID_COUNT,
+
+	PSG_SHB_CUSTOM = 255
+} PsgSecureHeaderId;
+
+/**
+ * Returns the secure header name that corresponds to the given id,
+ * or NULL if the id is unknown.
+ */
+static PSG_SHB_INLINE const char *
+psg_secure_header_name(unsigned int id) {
+	switch (id) {
+	case PSG_SHB_PASSWORD:
+		return "!~";
+	case PSG_SHB_DOCUMENT_ROOT:
+		return "!~DOCUMENT_ROOT";
+	case PSG_SHB_SCRIPT_NAME:
+		return "!~SCRIPT_NAME";
+	case PSG_SHB_REMOTE_ADDR:
+		return "!~REMOTE_ADDR";
+	case PSG_SHB_REMOTE_PORT:
+		return "!~REMOTE_PORT";
+	case PSG_SHB_REMOTE_USER:
+		return "!~REMOTE_USER";
+	case PSG_SHB_FLAGS:
+		return "!~FLAGS";
+	case PSG_SHB_APP_GROUP_NAME:
+		return "!~PASSENGER_APP_GROUP_NAME";
+	case PSG_SHB_APP_ROOT:
+		return "!~PASSENGER_APP_ROOT";
+	case PSG_SHB_APP_TYPE:
+		return "!~PASSENGER_APP_TYPE";
+	case PSG_SHB_APP_ENV:
+		return "!~PASSENGER_APP_ENV";
+	case PSG_SHB_ENV_VARS:
+		return "!~PASSENGER_ENV_VARS";
+	case PSG_SHB_UNION_STATION_SUPPORT:
+		return "!~UNION_STATION_SUPPORT";
+	case PSG_SHB_UNION_STATION_KEY:
+		return "!~UNION_STATION_KEY";
+	case PSG_SHB_UNION_STATION_FILTERS:
+		return "!~UNION_STATION_FILTERS";
+	case PSG_SHB_STICKY_SESSIONS:
+		return "!~PASSENGER_STICKY_SESSIONS";
+	case PSG_SHB_STICKY_SESSIONS_COOKIE_NAME:
+		return "!~PASSENGER_STICKY_SESSIONS_COOKIE_NAME";
+	case PSG_SHB_MAX_REQUESTS:
+		return "!~PASSENGER_MAX_REQUESTS";
+	case PSG_SHB_MAX_REQUEST_TIME:
+		return "!~PASSENGER_MAX_REQUEST_TIME";
+	default:
+		return (const char *) 0;
+	}
+}
+
+static PSG_SHB_INLINE char *
+psg_secure_headers_block_put_uint32(char *pos, unsigned int value) {
+	pos[0] = (char) ((value >> 24) & 0xff);
+	pos[1] = (char) ((value >> 16) & 0xff);
+	pos[2] = (char) ((value >> 8) & 0xff);
+	pos[3] = (char) (value & 0xff);
+	return pos + 4;
+}
+
+static PSG_SHB_INLINE unsigned int
+psg_secure_headers_block_get_uint32(const char *pos) {
+	const unsigned char *p = (const unsigned char *) pos;
+	return ((unsigned int) p[0] << 24)
+		| ((unsigned int) p[1] << 16)
+		| ((unsigned int) p[2] << 8)
+		| (unsigned int) p[3];
+}
+
+/**
+ * Writes the block prefix for a block whose entries are `size` bytes
+ * in total. Returns the position after the prefix.
+ */
+static PSG_SHB_INLINE char *
+psg_secure_headers_block_put_prefix(char *pos, unsigned int size) {
+	*pos = PSG_SECURE_HEADERS_BLOCK_MAGIC;
+	return psg_secure_headers_block_put_uint32(pos + 1, size);
+}
+
+static PSG_SHB_INLINE unsigned int
+psg_secure_headers_block_entry_size(unsigned int value_len) {
+	return 1 + 4 + value_len;
+}
+
+static PSG_SHB_INLINE unsigned int
+psg_secure_headers_block_custom_entry_size(unsigned int name_len, unsigned int value_len) {
+	return 1 + 4 + name_len + 4 + value_len;
+}
+
+/** Writes an entry. Returns the position after the entry. */
+static PSG_SHB_INLINE char *
+psg_secure_headers_block_put_entry(char *pos, PsgSecureHeaderId id,
+	const char *value, unsigned int value_len)
+{
+	*pos = (char) id;
+	pos = psg_secure_headers_block_put_uint32(pos + 1, value_len);
+	memcpy(pos, value, value_len);
+	return pos + value_len;
+}
+
+/** Writes an entry for a secure header that has no id. Returns the position after the entry. */
+static PSG_SHB_INLINE char *
+psg_secure_headers_block_put_custom_entry(char *pos, const char *name,
+	unsigned int name_len, const char *value, unsigned int value_len)
+{
+	*pos = (char) PSG_SHB_CUSTOM;
+	pos = psg_secure_headers_block_put_uint32(pos + 1, name_len);
+	memcpy(pos, name, name_len);
+	pos = psg_secure_headers_block_put_uint32(pos + name_len, value_len);
+	memcpy(pos, value, value_len);
+	return pos + value_len;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _PASSENGER_SECURE_HEADERS_BLOCK_H_ */
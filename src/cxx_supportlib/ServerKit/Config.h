@@ -57,8 +57,11 @@ using namespace std;
  *   file_buffered_channel_buffer_dir                     string             -   default
  *   file_buffered_channel_delay_in_file_mode_switching   unsigned integer   -   default(0)
  *   file_buffered_channel_max_disk_chunk_read_size       unsigned integer   -   default(0)
+ *   file_buffered_channel_memory_spill_limit             unsigned integer   -   default(33554432)
  *   file_buffered_channel_threshold                      unsigned integer   -   default(131072)
  *   mbuf_block_chunk_size                                unsigned integer   -   default(4096),read_only
+ *   mbuf_idle_release_delay                              unsigned integer   -   default(60)
+ *   mbuf_size_classes                                    boolean            -   default(true),read_only
  *   secure_mode_password                                 string             -   secret
  *
  * END
@@ -89,11 +92,16 @@ public:
 		add("file_buffered_channel_delay_in_file_mode_switching", UINT_TYPE, OPTIONAL, 0);
 		add("file_buffered_channel_max_disk_chunk_read_size", UINT_TYPE, OPTIONAL, 0);
 		add("file_buffered_channel_auto_truncate_file", BOOL_TYPE, OPTIONAL, true);
+		add("file_buffered_channel_memory_spill_limit", UINT_TYPE, OPTIONAL,
+			DEFAULT_FILE_BUFFERED_CHANNEL_MEMORY_SPILL_LIMIT);
 		// For unit testing purposes
 		add("file_buffered_channel_auto_start_mover", BOOL_TYPE, OPTIONAL, true);
 
 		add("mbuf_block_chunk_size", UINT_TYPE, OPTIONAL | READ_ONLY,
 			DEFAULT_MBUF_CHUNK_SIZE);
+		add("mbuf_size_classes", BOOL_TYPE, OPTIONAL | READ_ONLY, true);
+		add("mbuf_idle_release_delay", UINT_TYPE, OPTIONAL,
+			DEFAULT_MBUF_IDLE_RELEASE_DELAY);
 		add("secure_mode_password", STRING_TYPE, OPTIONAL | SECRET);
 
 		addNormalizer(normalize);
@@ -107,6 +115,7 @@ struct FileBufferedChannelConfig {
 	unsigned int threshold;
 	unsigned int delayInFileModeSwitching;
 	unsigned int maxDiskChunkReadSize;
+	unsigned int memorySpillLimit;
 	bool autoTruncateFile;
 	bool autoStartMover;
 
@@ -115,6 +124,7 @@ struct FileBufferedChannelConfig {
 		  threshold(config["file_buffered_channel_threshold"].asUInt()),
 		  delayInFileModeSwitching(config["file_buffered_channel_delay_in_file_mode_switching"].asUInt()),
 		  maxDiskChunkReadSize(config["file_buffered_channel_max_disk_chunk_read_size"].asUInt()),
+		  memorySpillLimit(config["file_buffered_channel_memory_spill_limit"].asUInt()),
 		  autoTruncateFile(config["file_buffered_channel_auto_truncate_file"].asBool()),
 		  autoStartMover(config["file_buffered_channel_auto_start_mover"].asBool())
 		{ }
@@ -124,6 +134,7 @@ struct FileBufferedChannelConfig {
 		std::swap(threshold, other.threshold);
 		std::swap(delayInFileModeSwitching, other.delayInFileModeSwitching);
 		std::swap(maxDiskChunkReadSize, other.maxDiskChunkReadSize);
+		std::swap(memorySpillLimit, other.memorySpillLimit);
 		std::swap(autoTruncateFile, other.autoTruncateFile);
 		std::swap(autoStartMover, other.autoStartMover);
 	}
@@ -132,15 +143,18 @@ struct FileBufferedChannelConfig {
 struct Config {
 	string secureModePassword;
 	FileBufferedChannelConfig fileBufferedChannelConfig;
+	unsigned int mbufIdleReleaseDelay;
 
 	Config(const ConfigKit::Store &config)
 		: secureModePassword(config["secure_mode_password"].asString()),
-		  fileBufferedChannelConfig(config)
+		  fileBufferedChannelConfig(config),
+		  mbufIdleReleaseDelay(config["mbuf_idle_release_delay"].asUInt())
 		{ }
 
 	void swap(Config &other) BOOST_NOEXCEPT_OR_NOTHROW {
 		secureModePassword.swap(other.secureModePassword);
 		fileBufferedChannelConfig.swap(other.fileBufferedChannelConfig);
+		std::swap(mbufIdleReleaseDelay, other.mbufIdleReleaseDelay);
 	}
 };
 
@@ -28,8 +28,10 @@
 
 #include <string>
 #include <boost/config.hpp>
+#include <boost/cstdint.hpp>
 
 #include <ServerKit/Config.h>
+#include <ServerKit/TimerWheel.h>
 #include <ConfigKit/ConfigKit.h>
 #include <MemoryKit/mbuf.h>
 #include <LoggingKit/Assert.h>
@@ -51,6 +53,20 @@ using namespace std;
 class Context {
 private:
 	ConfigKit::Store configStore;
+	ev_tstamp lastMbufIdleReleaseTime;
+
+	static Json::Value inspectMbufPoolAsJson(const struct MemoryKit::mbuf_pool &pool) {
+		Json::Value doc;
+		doc["free_blocks"] = (Json::UInt) pool.nfree_mbuf_blockq;
+		doc["active_blocks"] = (Json::UInt) pool.nactive_mbuf_blockq;
+		doc["released_blocks"] = (Json::UInt) pool.nreleased_mbuf_blockq;
+		doc["chunk_size"] = (Json::UInt) pool.mbuf_block_chunk_size;
+		doc["spare_memory"] = byteSizeToJson((pool.nfree_mbuf_blockq
+			- pool.nreleased_mbuf_blockq) * pool.mbuf_block_chunk_size);
+		doc["active_memory"] = byteSizeToJson(pool.nactive_mbuf_blockq
+			* pool.mbuf_block_chunk_size);
+		return doc;
+	}
 
 public:
 	typedef ServerKit::ConfigChangeRequest ConfigChangeRequest;
@@ -61,17 +77,48 @@ public:
 
 	// Others
 	Config config;
+	/**
+	 * The pool for the default size class. Code that does not care about
+	 * block sizes uses this one directly.
+	 */
 	struct MemoryKit::mbuf_pool mbuf_pool;
+	/**
+	 * Pools for all size classes, indexed by MemoryKit::mbuf_size_class.
+	 * The MBUF_SIZE_CLASS_DEFAULT entry is not used; `mbuf_pool` is used instead.
+	 */
+	struct MemoryKit::mbuf_pool mbuf_pools_by_size_class[MemoryKit::MBUF_SIZE_CLASS_COUNT];
+	bool mbufSizeClassesEnabled;
+	/**
+	 * Number of bytes that FileBufferedChannels in this context currently
+	 * hold in memory-backed spill areas. Bounded by
+	 * `file_buffered_channel_memory_spill_limit`.
+	 */
+	boost::uint64_t fileBufferedChannelMemorySpill;
+	/**
+	 * Shared by all servers in this context for coarse-grained per-client
+	 * timeouts, such as the keep-alive, header and body timeouts.
+	 */
+	TimerWheel timerWheel;
 
 	Context(const Schema &schema, const Json::Value &initialConfig = Json::Value(),
 		const ConfigKit::Translator &translator = ConfigKit::DummyTranslator())
 		: configStore(schema, initialConfig, translator),
+		  lastMbufIdleReleaseTime(0),
 		  libuv(NULL),
-		  config(configStore)
+		  config(configStore),
+		  mbufSizeClassesEnabled(false),
+		  fileBufferedChannelMemorySpill(0)
 		{ }
 
 	~Context() {
 		MemoryKit::mbuf_pool_deinit(&mbuf_pool);
+		if (mbufSizeClassesEnabled) {
+			for (unsigned int i = 0; i < MemoryKit::MBUF_SIZE_CLASS_COUNT; i++) {
+				if (i != MemoryKit::MBUF_SIZE_CLASS_DEFAULT) {
+					MemoryKit::mbuf_pool_deinit(&mbuf_pools_by_size_class[i]);
+				}
+			}
+		}
 	}
 
 	void initialize() {
@@ -82,8 +129,84 @@ public:
 			throw RuntimeException("libuv must be non-NULL");
 		}
 
+		timerWheel.initialize(libev->getLoop());
+
 		mbuf_pool.mbuf_block_chunk_size = configStore["mbuf_block_chunk_size"].asUInt();
 		MemoryKit::mbuf_pool_init(&mbuf_pool);
+
+		mbufSizeClassesEnabled = configStore["mbuf_size_classes"].asBool();
+		if (mbufSizeClassesEnabled) {
+			for (unsigned int i = 0; i < MemoryKit::MBUF_SIZE_CLASS_COUNT; i++) {
+				if (i != MemoryKit::MBUF_SIZE_CLASS_DEFAULT) {
+					mbuf_pools_by_size_class[i].mbuf_block_chunk_size =
+						MemoryKit::mbuf_size_class_chunk_size(
+							(MemoryKit::mbuf_size_class) i,
+							mbuf_pool.mbuf_block_chunk_size);
+					MemoryKit::mbuf_pool_init(&mbuf_pools_by_size_class[i]);
+				}
+			}
+		}
+	}
+
+	OXT_FORCE_INLINE
+	struct MemoryKit::mbuf_pool *getMbufPool(MemoryKit::mbuf_size_class sizeClass) {
+		if (sizeClass == MemoryKit::MBUF_SIZE_CLASS_DEFAULT || !mbufSizeClassesEnabled) {
+			return &mbuf_pool;
+		} else {
+			return &mbuf_pools_by_size_class[sizeClass];
+		}
+	}
+
+	/**
+	 * Returns the pool with the smallest block size that can hold `size` bytes,
+	 * or the pool with the largest block size if none can.
+	 */
+	struct MemoryKit::mbuf_pool *getMbufPoolForSize(size_t size) {
+		if (!mbufSizeClassesEnabled) {
+			return &mbuf_pool;
+		}
+		for (unsigned int i = 0; i < MemoryKit::MBUF_SIZE_CLASS_COUNT; i++) {
+			struct MemoryKit::mbuf_pool *pool = getMbufPool((MemoryKit::mbuf_size_class) i);
+			if (size <= MemoryKit::mbuf_pool_data_size(pool)) {
+				return pool;
+			}
+		}
+		return getMbufPool(MemoryKit::MBUF_SIZE_CLASS_HUGE);
+	}
+
+	/**
+	 * Returns the memory of mbuf_blocks that have been idle for at least
+	 * `mbuf_idle_release_delay` seconds back to the OS. Meant to be called
+	 * periodically from the event loop.
+	 */
+	unsigned int releaseIdleMbufs(ev_tstamp now) {
+		unsigned int count = 0;
+
+		if (config.mbufIdleReleaseDelay == 0
+		 || now - lastMbufIdleReleaseTime < config.mbufIdleReleaseDelay)
+		{
+			return 0;
+		}
+
+		lastMbufIdleReleaseTime = now;
+		for (unsigned int i = 0; i < MemoryKit::MBUF_SIZE_CLASS_COUNT; i++) {
+			if (i == MemoryKit::MBUF_SIZE_CLASS_DEFAULT || mbufSizeClassesEnabled) {
+				count += MemoryKit::mbuf_pool_release_idle(
+					getMbufPool((MemoryKit::mbuf_size_class) i));
+			}
+		}
+		return count;
+	}
+
+	unsigned int compactMbufPools() {
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < MemoryKit::MBUF_SIZE_CLASS_COUNT; i++) {
+			if (i == MemoryKit::MBUF_SIZE_CLASS_DEFAULT || mbufSizeClassesEnabled) {
+				count += MemoryKit::mbuf_pool_compact(
+					getMbufPool((MemoryKit::mbuf_size_class) i));
+			}
+		}
+		return count;
 	}
 
 	bool configure(const Json::Value &updates, vector<ConfigKit::Error> &errors) {
@@ -118,14 +241,20 @@ public:
 		Json::Value doc;
 		Json::Value mbufDoc;
 
-		mbufDoc["free_blocks"] = (Json::UInt) mbuf_pool.nfree_mbuf_blockq;
-		mbufDoc["active_blocks"] = (Json::UInt) mbuf_pool.nactive_mbuf_blockq;
-		mbufDoc["chunk_size"] = (Json::UInt) mbuf_pool.mbuf_block_chunk_size;
+		mbufDoc = inspectMbufPoolAsJson(mbuf_pool);
 		mbufDoc["offset"] = (Json::UInt) mbuf_pool.mbuf_block_offset;
-		mbufDoc["spare_memory"] = byteSizeToJson(mbuf_pool.nfree_mbuf_blockq
-			* mbuf_pool.mbuf_block_chunk_size);
-		mbufDoc["active_memory"] = byteSizeToJson(mbuf_pool.nactive_mbuf_blockq
-			* mbuf_pool.mbuf_block_chunk_size);
+		if (mbufSizeClassesEnabled) {
+			Json::Value sizeClassesDoc;
+			for (unsigned int i = 0; i < MemoryKit::MBUF_SIZE_CLASS_COUNT; i++) {
+				const struct MemoryKit::mbuf_pool &pool =
+					(i == MemoryKit::MBUF_SIZE_CLASS_DEFAULT)
+					? mbuf_pool
+					: mbuf_pools_by_size_class[i];
+				sizeClassesDoc[MemoryKit::mbuf_size_class_name(
+					(MemoryKit::mbuf_size_class) i)] = inspectMbufPoolAsJson(pool);
+			}
+			mbufDoc["size_classes"] = sizeClassesDoc;
+		}
 		#ifdef MBUF_ENABLE_DEBUGGING
 			struct MemoryKit::active_mbuf_block_list *list =
 				const_cast<struct MemoryKit::active_mbuf_block_list *>(
@@ -148,6 +277,9 @@ public:
 		#endif
 
 		doc["mbuf_pool"] = mbufDoc;
+		doc["file_buffered_channel_memory_spill"] = byteSizeToJson(
+			fileBufferedChannelMemorySpill);
+		doc["armed_timeouts"] = timerWheel.size();
 
 		return doc;
 	}
@@ -210,30 +210,36 @@ matchCookieName(psg_pool_t *pool, const LString::Part *part, size_t index,
 	const LString::Part *separatorPart, size_t separatorIndex,
 	const LString *name)
 {
+	if (part == separatorPart) {
+		// Fast path: the cookie name lies entirely within a single part,
+		// so we can compare it in-place without constructing an LString.
+		const char *begin = part->data + index;
+		const char *end = part->data + separatorIndex;
+
+		assert(index < separatorIndex);
+		while (begin < end && (*begin == ' ' || *begin == ';')) {
+			begin++;
+		}
+		return psg_lstr_cmp(name, StaticString(begin, end - begin));
+	}
+
 	LString *str = (LString *) psg_palloc(pool, sizeof(LString));
 	psg_lstr_init(str);
 
 	// Construct the specified substring so that we can use
 	// psg_lstr_cmp() to compare that with `name`.
-	if (part == separatorPart) {
-		assert(index < separatorIndex);
-		psg_lstr_append(str, pool,
-			part->data + index,
-			separatorIndex - index);
-	} else {
-		psg_lstr_append(str, pool,
-			part->data + index,
-			part->size - index);
+	psg_lstr_append(str, pool,
+		part->data + index,
+		part->size - index);
 
+	part = part->next;
+	while (part != separatorPart) {
+		psg_lstr_append(str, pool, part->data, part->size);
 		part = part->next;
-		while (part != separatorPart) {
-			psg_lstr_append(str, pool, part->data, part->size);
-			part = part->next;
-		}
+	}
 
-		if (separatorIndex != 0) {
-			psg_lstr_append(str, pool, separatorPart->data, separatorIndex);
-		}
+	if (separatorIndex != 0) {
+		psg_lstr_append(str, pool, separatorPart->data, separatorIndex);
 	}
 
 	_matchCookieName_skipWhitespace(str);
@@ -28,6 +28,7 @@
 
 #include <oxt/macros.hpp>
 #include <boost/move/move.hpp>
+#include <algorithm>
 #include <sys/types.h>
 #include <unistd.h>
 #include <ev.h>
@@ -46,6 +47,12 @@ class FdSourceChannel: protected Channel {
 private:
 	ev_io watcher;
 	MemoryKit::mbuf buffer;
+	/**
+	 * Estimate of how much data a single read() returns, based on recent
+	 * reads. Used to pick the mbuf size class for the next buffer.
+	 * 0 means that there is no estimate yet.
+	 */
+	unsigned int readSizeHint;
 
 	static void _onReadable(EV_P_ ev_io *io, int revents) {
 		static_cast<FdSourceChannel *>(io->data)->onReadable(io, revents);
@@ -73,7 +80,7 @@ private:
 
 		for (i = 0; i < burstReadCount && !done; i++) {
 			if (buffer.empty()) {
-				buffer = MemoryKit::mbuf_get(&ctx->mbuf_pool);
+				buffer = MemoryKit::mbuf_get(getMbufPoolForNextRead());
 			}
 
 			origBufferSize = buffer.size();
@@ -81,6 +88,7 @@ private:
 				ret = ::read(watcher.fd, buffer.start, buffer.size());
 			} while (OXT_UNLIKELY(ret == -1 && errno == EINTR));
 			if (ret > 0) {
+				updateReadSizeHint(ret, size_t(ret) == origBufferSize);
 				MemoryKit::mbuf buffer2(buffer, 0, ret);
 				if (size_t(ret) == size_t(buffer.size())) {
 					// Unref mbuf_block
@@ -125,6 +133,29 @@ private:
 		}
 	}
 
+	struct MemoryKit::mbuf_pool *getMbufPoolForNextRead() {
+		if (readSizeHint == 0) {
+			return &ctx->mbuf_pool;
+		} else {
+			// Leave some headroom so that a message that is slightly larger
+			// than usual is not split over multiple blocks.
+			return ctx->getMbufPoolForSize(readSizeHint * 2);
+		}
+	}
+
+	void updateReadSizeHint(size_t bytesRead, bool bufferFilled) {
+		if (bufferFilled) {
+			// There is probably more data than fit in the buffer.
+			// Grow quickly so that large streams use large blocks.
+			readSizeHint = (unsigned int) std::min<size_t>(
+				std::max<size_t>(readSizeHint, bytesRead) * 2,
+				MBUF_BLOCK_MAX_SIZE);
+		} else {
+			// Move halfway towards the observed size.
+			readSizeHint = (unsigned int) ((readSizeHint + bytesRead) / 2);
+		}
+	}
+
 	static void onChannelConsumed(Channel *channel, unsigned int size) {
 		FdSourceChannel *self = static_cast<FdSourceChannel *>(channel);
 		self->consumedCallback = NULL;
@@ -134,6 +165,7 @@ private:
 	}
 
 	void initialize() {
+		readSizeHint = 0;
 		burstReadCount = 1;
 		watcher.active = false;
 		watcher.fd = -1;
@@ -167,6 +199,7 @@ public:
 
 	void reinitialize(int fd) {
 		Channel::reinitialize();
+		readSizeHint = 0;
 		ev_io_init(&watcher, _onReadable, fd, EV_READ);
 	}
 
@@ -241,6 +274,7 @@ public:
 		Json::Value doc = Channel::inspectAsJson();
 		doc["initialized"] = watcher.fd != -1;
 		doc["io_watcher_active"] = (bool) watcher.active;
+		doc["read_size_hint"] = readSizeHint;
 		return doc;
 	}
 };
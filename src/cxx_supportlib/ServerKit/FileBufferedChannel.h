@@ -32,9 +32,15 @@
 #include <boost/move/move.hpp>
 #include <boost/atomic.hpp>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+	#include <sys/syscall.h>
+#endif
 #include <uv.h>
 #include <jsoncpp/json.h>
 #include <cassert>
+#include <cerrno>
 #include <cstddef>
 #include <cstring>
 #include <algorithm>
@@ -80,6 +86,11 @@ using namespace std;
  * FileBufferedChannel operates by default in the in-memory mode. All data is buffered
  * in memory. Beyond a threshold (determined by `passedThreshold()`), it switches
  * to in-file mode.
+ *
+ * In the in-file mode, data is first spilled to a memory-backed area (a memfd
+ * mapping) that is written and read synchronously, without going through the
+ * libuv thread pool. Only when the context-wide `memorySpillLimit` is reached,
+ * or when memfds are not supported, does the data go to an actual temp file.
  */
 class FileBufferedChannel: protected Channel {
 public:
@@ -298,6 +309,10 @@ private:
 	 *   operate on stays open until all libuv operations have finished (or until
 	 *   their cancellation have been acknowledged by their callbacks).
 	 *
+	 * The "file" consists of two parts: data before `memoryEnd` lives in the
+	 * memory-backed spill area, data after it lives in the temp file (at offset
+	 * `offset - memoryEnd`). Either part may be empty.
+	 *
 	 * The variables inside this structure point to different places in the file:
 	 *
 	 *     +------------------------+
@@ -328,10 +343,41 @@ private:
 
 		/**
 		 * The file descriptor of the temp file. It's -1 if the file is being
-		 * created.
+		 * created, or if we haven't needed one yet because all data fit in
+		 * the memory-backed spill area.
 		 */
 		int fd;
 
+		/**
+		 * A shared mapping of a memfd which holds spilled data as long as the
+		 * context-wide memory spill limit allows it. NULL if this channel spills
+		 * to the temp file only.
+		 */
+		char *memoryArea;
+		size_t memoryAreaSize;
+		/**
+		 * Data at offsets below `memoryEnd` lives in `memoryArea`. While the writer
+		 * is still appending to the memory area, this grows along with
+		 * `readOffset + written`.
+		 */
+		off_t memoryEnd;
+		/**
+		 * Consumed pages below this offset have been returned to the kernel.
+		 */
+		off_t memoryReleased;
+		/**
+		 * Number of bytes in `memoryArea` that are charged against
+		 * `*memorySpillCounter` (i.e. Context::fileBufferedChannelMemorySpill).
+		 */
+		size_t memoryCharged;
+		boost::uint64_t *memorySpillCounter;
+		/**
+		 * Whether the writer still appends to the memory area. Once the memory
+		 * spill limit is reached, the writer continues in the temp file for the
+		 * remainder of this in-file mode session.
+		 */
+		bool spillingToMemory;
+
 
 		/***** Reader state *****/
 
@@ -378,6 +424,13 @@ private:
 		InFileMode(uv_loop_t *_libuv)
 			: libuv(_libuv),
 			  fd(-1),
+			  memoryArea(NULL),
+			  memoryAreaSize(0),
+			  memoryEnd(0),
+			  memoryReleased(0),
+			  memoryCharged(0),
+			  memorySpillCounter(NULL),
+			  spillingToMemory(false),
 			  readRequest(NULL),
 			  writerState(WS_INACTIVE),
 			  writerRequest(NULL),
@@ -388,11 +441,51 @@ private:
 		~InFileMode() {
 			P_ASSERT_EQ(readRequest, 0);
 			P_ASSERT_EQ(writerRequest, 0);
+			if (memoryArea != NULL) {
+				destroyMemoryArea();
+			}
 			if (fd != -1) {
 				closeFdInBackground();
 			}
 		}
 
+		void charge(size_t size) {
+			memoryCharged += size;
+			*memorySpillCounter += size;
+		}
+
+		void discharge(size_t size) {
+			assert(memoryCharged >= size);
+			assert(*memorySpillCounter >= size);
+			memoryCharged -= size;
+			*memorySpillCounter -= size;
+		}
+
+		/**
+		 * Returns the pages in the memory area that the reader has fully
+		 * consumed to the kernel. The data was only ever referenced through
+		 * the mapping, so this is what actually frees the memory.
+		 */
+		void releaseConsumedMemory() {
+			static const off_t pageSize = sysconf(_SC_PAGESIZE);
+			off_t end = std::min(readOffset, memoryEnd) & ~(pageSize - 1);
+
+			if (end > memoryReleased) {
+				#ifdef MADV_REMOVE
+					madvise(memoryArea + memoryReleased, end - memoryReleased,
+						MADV_REMOVE);
+				#endif
+				memoryReleased = end;
+			}
+		}
+
+		void destroyMemoryArea() {
+			discharge(memoryCharged);
+			munmap(memoryArea, memoryAreaSize);
+			memoryArea = NULL;
+			memoryAreaSize = 0;
+		}
+
 		void closeFdInBackground() {
 			uv_fs_t *req = (uv_fs_t *) malloc(sizeof(uv_fs_t));
 			if (req == NULL) {
@@ -611,7 +704,13 @@ private:
 			}
 			break;
 		case IN_FILE_MODE:
-			if (inFileMode->written > 0) {
+			if (inFileMode->written > 0 && inFileMode->readOffset < inFileMode->memoryEnd) {
+				// The memory-backed spill area contains unread data.
+				// Feed it to the underlying channel right away.
+				if (readNextChunkFromMemory()) {
+					goto begin;
+				}
+			} else if (inFileMode->written > 0) {
 				// The file contains unread data. Read from
 				// file and feed to underlying channel.
 				readNextChunkFromFile();
@@ -709,6 +808,54 @@ private:
 		terminateReaderBecauseOfEOF();
 	}
 
+	/**
+	 * Reads the next chunk from the memory-backed spill area and feeds it to
+	 * the underlying channel. Unlike `readNextChunkFromFile()`, this happens
+	 * synchronously. Returns whether the reader should proceed with the
+	 * next chunk immediately.
+	 */
+	bool readNextChunkFromMemory() {
+		assert(inFileMode->written > 0);
+		assert(inFileMode->readOffset < inFileMode->memoryEnd);
+		unsigned int generation = this->generation;
+		struct MemoryKit::mbuf_pool *pool = ctx->getMbufPool(MemoryKit::MBUF_SIZE_CLASS_LARGE);
+		size_t size = std::min<boost::int64_t>(inFileMode->written,
+			inFileMode->memoryEnd - inFileMode->readOffset);
+		size = std::min<size_t>(size, mbuf_pool_data_size(pool));
+		if (config->maxDiskChunkReadSize > 0 && size > config->maxDiskChunkReadSize) {
+			size = config->maxDiskChunkReadSize;
+		}
+
+		FBC_DEBUG("Reader: reading next chunk from memory, " << size << " bytes");
+		MemoryKit::mbuf buffer(MemoryKit::mbuf_get(pool));
+		memcpy(buffer.start, inFileMode->memoryArea + inFileMode->readOffset, size);
+		buffer = MemoryKit::mbuf(buffer, 0, size);
+		inFileMode->readOffset += size;
+		inFileMode->written -= size;
+		inFileMode->discharge(size);
+		inFileMode->releaseConsumedMemory();
+
+		FBC_DEBUG("Reader: feeding buffer, " << buffer.size() << " bytes");
+		readerState = RS_FEEDING;
+		Channel::feedWithoutRefGuard(buffer);
+		if (generation != this->generation || mode >= ERROR) {
+			// Callback deinitialized this object, or callback
+			// called a method that encountered an error.
+			return false;
+		}
+		P_ASSERT_EQ(readerState, RS_FEEDING);
+		verifyInvariants();
+		if (acceptingInput()) {
+			return true;
+		} else if (mayAcceptInputLater()) {
+			readNextWhenChannelIdle();
+		} else {
+			FBC_DEBUG("Reader: data callback no longer accepts further data");
+			terminateReaderBecauseOfEOF();
+		}
+		return false;
+	}
+
 	struct ReadContext: public FileIOContext {
 		MemoryKit::mbuf buffer;
 		uv_buf_t uvBuffer;
@@ -738,7 +885,7 @@ private:
 		inFileMode->readRequest = readContext;
 
 		uv_fs_read(ctx->libuv, &readContext->req, inFileMode->fd,
-			&readContext->uvBuffer, 1, inFileMode->readOffset,
+			&readContext->uvBuffer, 1, inFileMode->readOffset - inFileMode->memoryEnd,
 			_nextChunkDoneReading);
 		verifyInvariants();
 	}
@@ -838,7 +985,11 @@ private:
 		FBC_DEBUG("Switching to in-file mode");
 		mode = IN_FILE_MODE;
 		inFileMode = boost::make_shared<InFileMode>(ctx->libuv);
-		createBufferFile();
+		if (createMemorySpillArea()) {
+			moveNextBufferToFile();
+		} else {
+			createBufferFile();
+		}
 	}
 
 	/**
@@ -861,6 +1012,117 @@ private:
 	}
 
 
+	/***** Memory-backed spill area *****/
+
+	static int createMemoryFd() {
+		#if defined(__linux__) && defined(SYS_memfd_create)
+			// Called through syscall() because glibc only gained a
+			// memfd_create() wrapper in 2.27. 1 = MFD_CLOEXEC.
+			return syscall(SYS_memfd_create, "passenger-buffer", 1);
+		#else
+			errno = ENOSYS;
+			return -1;
+		#endif
+	}
+
+	/**
+	 * Sets up a memory-backed spill area, unless the context-wide memory
+	 * spill limit has been reached or memfds are not supported. The area
+	 * is as large as the limit, but only the pages that actually hold
+	 * unread data are backed by memory.
+	 */
+	bool createMemorySpillArea() {
+		P_ASSERT_EQ(inFileMode->memoryArea, 0);
+
+		if (config->memorySpillLimit == 0
+		 || ctx->fileBufferedChannelMemorySpill >= config->memorySpillLimit)
+		{
+			return false;
+		}
+
+		int fd = createMemoryFd();
+		if (fd == -1) {
+			int e = errno;
+			FBC_DEBUG("Cannot create memory spill area, falling back to temp file: " <<
+				strerror(e) << " (errno=" << e << ")");
+			return false;
+		}
+		P_LOG_FILE_DESCRIPTOR_OPEN4(fd, __FILE__, __LINE__,
+			"FileBufferedChannel memory spill area");
+
+		size_t size = config->memorySpillLimit;
+		void *area = MAP_FAILED;
+		if (ftruncate(fd, size) == 0) {
+			area = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		int e = errno;
+		// The mapping keeps the memfd alive, so we don't need the descriptor anymore.
+		close(fd);
+		P_LOG_FILE_DESCRIPTOR_CLOSE(fd);
+
+		if (area == MAP_FAILED) {
+			FBC_DEBUG("Cannot map memory spill area, falling back to temp file: " <<
+				strerror(e) << " (errno=" << e << ")");
+			return false;
+		}
+
+		FBC_DEBUG("Writer: spilling to memory");
+		inFileMode->memoryArea = (char *) area;
+		inFileMode->memoryAreaSize = size;
+		inFileMode->memorySpillCounter = &ctx->fileBufferedChannelMemorySpill;
+		inFileMode->spillingToMemory = true;
+		return true;
+	}
+
+	/**
+	 * Moves as many buffers as possible to the memory-backed spill area.
+	 * Stops when there are no more buffers, when EOF is encountered or
+	 * when the memory spill limit is reached; in the latter case
+	 * `inFileMode->spillingToMemory` is set to false.
+	 *
+	 * Returns false if a callback deinitialized this object or encountered
+	 * an error.
+	 */
+	bool moveBuffersToMemory() {
+		RefGuard guard(hooks, this, __FILE__, __LINE__);
+		unsigned int generation = this->generation;
+
+		while (nbuffers > 0 && !peekBuffer().empty()) {
+			const MemoryKit::mbuf &buffer = peekBuffer();
+			off_t offset = inFileMode->readOffset + inFileMode->written;
+
+			if (offset >= inFileMode->readOffset) {
+				if (offset + (off_t) buffer.size() > (off_t) inFileMode->memoryAreaSize
+				 || ctx->fileBufferedChannelMemorySpill + buffer.size() > config->memorySpillLimit)
+				{
+					FBC_DEBUG("Writer: memory spill limit reached, continuing in temp file");
+					inFileMode->spillingToMemory = false;
+					return true;
+				}
+				FBC_DEBUG("Writer: moving next buffer to memory: " <<
+					buffer.size() << " bytes");
+				memcpy(inFileMode->memoryArea + offset, buffer.start, buffer.size());
+				inFileMode->charge(buffer.size());
+			} else {
+				// The reader has already fed this buffer to the underlying
+				// channel directly, so there's no need to copy it.
+				assert(offset + (off_t) buffer.size() <= inFileMode->readOffset);
+			}
+
+			inFileMode->written += buffer.size();
+			inFileMode->memoryEnd = inFileMode->readOffset + inFileMode->written;
+			popBuffer();
+			if (generation != this->generation || mode >= ERROR) {
+				// buffersFlushedCallback deinitialized this object, or callback
+				// called a method that encountered an error.
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
 	/***** File creator *****/
 
 	struct FileCreationContext: public FileIOContext {
@@ -1071,9 +1333,12 @@ private:
 
 	void moveNextBufferToFile() {
 		P_ASSERT_EQ(mode, IN_FILE_MODE);
-		assert(inFileMode->fd != -1);
 		verifyInvariants();
 
+		if (inFileMode->spillingToMemory && !moveBuffersToMemory()) {
+			return;
+		}
+
 		if (nbuffers == 0) {
 			FBC_DEBUG("Writer: no more buffers. Transitioning to WS_INACTIVE");
 			inFileMode->writerState = WS_INACTIVE;
@@ -1082,6 +1347,10 @@ private:
 			FBC_DEBUG("Writer: EOF encountered. Transitioning to WS_TERMINATED");
 			inFileMode->writerState = WS_TERMINATED;
 			return;
+		} else if (inFileMode->fd == -1) {
+			// We've been spilling to memory until now.
+			createBufferFile();
+			return;
 		}
 
 		FBC_DEBUG("Writer: moving next buffer to file: " <<
@@ -1098,7 +1367,7 @@ private:
 		inFileMode->writerRequest = moveContext;
 		int result = uv_fs_write(ctx->libuv, &moveContext->req, inFileMode->fd,
 			&moveContext->uvBuffer, 1,
-			inFileMode->readOffset + inFileMode->written,
+			inFileMode->readOffset + inFileMode->written - inFileMode->memoryEnd,
 			_bufferWrittenToFile);
 		if (result != 0) {
 			moveContext->req.result = result;
@@ -1157,7 +1426,7 @@ private:
 					moveContext->buffer.size() - moveContext->written);
 				int result = uv_fs_write(ctx->libuv, &moveContext->req,
 					inFileMode->fd, &moveContext->uvBuffer, 1,
-					inFileMode->readOffset + inFileMode->written,
+					inFileMode->readOffset + inFileMode->written - inFileMode->memoryEnd,
 					_bufferWrittenToFile);
 				if (result != 0) {
 					moveContext->req.result = result;
@@ -1419,6 +1688,7 @@ public:
 			FBC_DEBUG("Feeding aborted: EOF or error detected");
 			return;
 		}
+		unsigned int generation = this->generation;
 		pushBuffer(buffer);
 		if (mode == IN_MEMORY_MODE && passedThreshold()) {
 			switchToInFileMode();
@@ -1428,6 +1698,11 @@ public:
 		{
 			moveNextBufferToFile();
 		}
+		if (generation != this->generation || mode >= ERROR) {
+			// Moving buffers to the memory spill area happens synchronously,
+			// so buffersFlushedCallback may have deinitialized this object.
+			return;
+		}
 		if (readerState == RS_INACTIVE) {
 			if (acceptingInput()) {
 				readNextWithoutRefGuard();
@@ -1513,7 +1788,8 @@ public:
 
 	/**
 	 * Returns the number of bytes that are buffered on disk
-	 * and have not yet been read.
+	 * and have not yet been read. This includes bytes in the
+	 * memory-backed spill area.
 	 */
 	boost::uint64_t getBytesBufferedOnDisk() const {
 		if (mode == IN_FILE_MODE && inFileMode->written >= 0) {
@@ -1595,6 +1871,11 @@ public:
 			doc["writer_state"] = getWriterStateString();
 			doc["read_offset"] = byteSizeToJson(inFileMode->readOffset);
 			doc["written"] = signedByteSizeToJson(inFileMode->written);
+			if (inFileMode->memoryArea != NULL) {
+				doc["memory_end"] = byteSizeToJson(inFileMode->memoryEnd);
+				doc["memory_charged"] = byteSizeToJson(inFileMode->memoryCharged);
+				doc["spilling_to_memory"] = inFileMode->spillingToMemory;
+			}
 			break;
 		case ERROR:
 			doc["mode"] = "ERROR";
@@ -29,6 +29,7 @@
 #include <psg_sysqueue.h>
 #include <ServerKit/Client.h>
 #include <ServerKit/HttpRequest.h>
+#include <ServerKit/TimerWheel.h>
 
 namespace Passenger {
 namespace ServerKit {
@@ -48,12 +49,20 @@ public:
 	 */
 	Request *currentRequest;
 	unsigned int requestsBegun;
+	/**
+	 * Armed in the Context's TimerWheel for the keep-alive, header or body
+	 * timeout, depending on what the client is currently doing. `userData`
+	 * points to this client.
+	 */
+	TimerWheelEntry timeoutEntry;
 
 	BaseHttpClient(void *server)
 		: BaseClient(server),
 		  currentRequest(NULL),
 		  requestsBegun(0)
-		{ }
+	{
+		timeoutEntry.userData = this;
+	}
 };
 
 
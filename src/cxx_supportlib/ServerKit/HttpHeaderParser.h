@@ -28,6 +28,7 @@
 
 #include <boost/cstdint.hpp>
 #include <oxt/backtrace.hpp>
+#include <algorithm>
 #include <cstddef>
 #include <cassert>
 #include <cstring>
@@ -38,6 +39,7 @@
 #include <DataStructures/LString.h>
 #include <DataStructures/HashedStaticString.h>
 #include <LoggingKit/LoggingKit.h>
+#include <SecureHeadersBlock.h>
 #include <Utils/StrIntUtils.h>
 #include <Utils/Hasher.h>
 
@@ -118,6 +120,68 @@ private:
 		}
 	}
 
+	/**
+	 * Consumes the binary secure headers block (see SecureHeadersBlock.h)
+	 * that may precede the HTTP request. The block is stored as-is in
+	 * `message->secureHeadersBlock`; decoding it is up to the HttpServer
+	 * subclass. Like normal headers, the block may be at most
+	 * HTTP_MAX_HEADER_SIZE bytes.
+	 *
+	 * Returns the number of bytes consumed.
+	 */
+	size_t feedSecureHeadersBlock(const HttpParseRequest &tag, const MemoryKit::mbuf &buffer) {
+		const char *pos = buffer.start;
+		const char *end = buffer.end;
+
+		if (state->state == HttpHeaderParserState::PARSING_NOT_STARTED) {
+			if (state->secureHeadersBlockPrefixRead > 0
+			 || pos == end
+			 || *pos != PSG_SECURE_HEADERS_BLOCK_MAGIC)
+			{
+				return 0;
+			}
+			state->state = HttpHeaderParserState::PARSING_SECURE_HEADERS_BLOCK_PREFIX;
+			state->secureHeadersBlockPrefixRead = 1;
+			state->secureHeadersBlockRemaining = 0;
+			pos++;
+		}
+
+		while (state->state == HttpHeaderParserState::PARSING_SECURE_HEADERS_BLOCK_PREFIX
+			&& pos < end)
+		{
+			state->secureHeadersBlockRemaining = (state->secureHeadersBlockRemaining << 8)
+				| (unsigned char) *pos;
+			state->secureHeadersBlockPrefixRead++;
+			pos++;
+			if (state->secureHeadersBlockPrefixRead == PSG_SECURE_HEADERS_BLOCK_PREFIX_SIZE) {
+				if (state->secureHeadersBlockRemaining > HTTP_MAX_HEADER_SIZE) {
+					message->httpState = Message::ERROR;
+					message->aux.parseError = SECURE_HEADERS_BLOCK_TOO_LARGE;
+					return pos - buffer.start;
+				}
+				state->state = HttpHeaderParserState::PARSING_SECURE_HEADERS_BLOCK;
+			}
+		}
+
+		if (state->state == HttpHeaderParserState::PARSING_SECURE_HEADERS_BLOCK) {
+			size_t size = std::min<size_t>(end - pos, state->secureHeadersBlockRemaining);
+			if (size > 0) {
+				psg_lstr_append(&message->secureHeadersBlock, pool, buffer, pos, size);
+				pos += size;
+				state->secureHeadersBlockRemaining -= size;
+			}
+			if (state->secureHeadersBlockRemaining == 0) {
+				state->state = HttpHeaderParserState::PARSING_NOT_STARTED;
+			}
+		}
+
+		return pos - buffer.start;
+	}
+
+	size_t feedSecureHeadersBlock(const HttpParseResponse &tag, const MemoryKit::mbuf &buffer) {
+		return 0;
+	}
+
 	static size_t http_parser_execute_and_handle_pause(http_parser *parser,
 		const http_parser_settings *settings, const char *data, size_t len,
 		bool &paused)
@@ -441,6 +505,8 @@ public:
 		initializeParser(MessageType());
 		state->state = HttpHeaderParserState::PARSING_NOT_STARTED;
 		state->secureMode = false;
+		state->secureHeadersBlockPrefixRead = 0;
+		state->secureHeadersBlockRemaining = 0;
 	}
 
 	size_t feed(const MemoryKit::mbuf &buffer) {
@@ -451,6 +517,15 @@ public:
 		size_t ret;
 		bool paused;
 
+		ret = feedSecureHeadersBlock(MessageType(), buffer);
+		if (OXT_UNLIKELY(ret > 0)) {
+			if (message->httpState == Message::ERROR || ret == buffer.size()) {
+				return ret;
+			} else {
+				return ret + feed(MemoryKit::mbuf(buffer, ret));
+			}
+		}
+
 		settings.on_message_begin = NULL;
 		settings.on_url = _onURL;
 		settings.on_status = onStatus;
@@ -36,6 +36,8 @@ namespace ServerKit {
 struct HttpHeaderParserState {
 	enum State {
 		PARSING_NOT_STARTED,
+		PARSING_SECURE_HEADERS_BLOCK_PREFIX,
+		PARSING_SECURE_HEADERS_BLOCK,
 		PARSING_URL,
 		PARSING_FIRST_HEADER_FIELD,
 		PARSING_FIRST_HEADER_VALUE,
@@ -52,6 +54,10 @@ struct HttpHeaderParserState {
 	http_parser parser;
 	Header *currentHeader;
 	Hasher hasher;
+	/** Number of bytes of the secure headers block prefix that have been read. */
+	boost::uint8_t secureHeadersBlockPrefixRead;
+	/** Number of bytes of the secure headers block that are yet to be read. */
+	boost::uint32_t secureHeadersBlockRemaining;
 };
 
 
@@ -122,6 +122,9 @@ public:
 	// headers is variable, but the number of secure headers is more or less
 	// constant.
 	HeaderTable secureHeaders;
+	// The binary secure headers block that preceded the request, if any.
+	// Not decoded by HttpServer; see SecureHeadersBlock.h.
+	LString secureHeadersBlock;
 	// HttpServer feeds all body data received via client->input to bodyChannel
 	Channel bodyChannel;
 
@@ -179,6 +182,7 @@ public:
 		  bodyAlreadyRead(0)
 	{
 		psg_lstr_init(&path);
+		psg_lstr_init(&secureHeadersBlock);
 		aux.bodyInfo.contentLength = 0; // Sets the entire union to 0.
 	}
 
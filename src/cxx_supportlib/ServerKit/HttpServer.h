@@ -66,7 +66,10 @@ extern const unsigned int DEFAULT_INTERNAL_SERVER_ERROR_RESPONSE_SIZE;
  * by 'rake configkit_schemas_inline_comments')
  *
  *   accept_burst_count           unsigned integer   -   default(32)
+ *   client_body_timeout          unsigned integer   -   default(60)
  *   client_freelist_limit        unsigned integer   -   default(0)
+ *   client_header_timeout        unsigned integer   -   default(60)
+ *   client_keepalive_timeout     unsigned integer   -   default(75)
  *   min_spare_clients            unsigned integer   -   default(0)
  *   request_freelist_limit       unsigned integer   -   default(1024)
  *   start_reading_after_accept   boolean            -   default(true)
@@ -79,6 +82,9 @@ private:
 		using namespace ConfigKit;
 
 		add("request_freelist_limit", UINT_TYPE, OPTIONAL, 1024);
+		add("client_keepalive_timeout", UINT_TYPE, OPTIONAL, DEFAULT_CLIENT_KEEPALIVE_TIMEOUT);
+		add("client_header_timeout", UINT_TYPE, OPTIONAL, DEFAULT_CLIENT_HEADER_TIMEOUT);
+		add("client_body_timeout", UINT_TYPE, OPTIONAL, DEFAULT_CLIENT_BODY_TIMEOUT);
 	}
 
 public:
@@ -98,13 +104,22 @@ public:
 
 struct HttpServerConfigRealization {
 	unsigned int requestFreelistLimit;
+	unsigned int clientKeepAliveTimeout;
+	unsigned int clientHeaderTimeout;
+	unsigned int clientBodyTimeout;
 
 	HttpServerConfigRealization(const ConfigKit::Store &config)
-		: requestFreelistLimit(config["request_freelist_limit"].asUInt())
+		: requestFreelistLimit(config["request_freelist_limit"].asUInt()),
+		  clientKeepAliveTimeout(config["client_keepalive_timeout"].asUInt()),
+		  clientHeaderTimeout(config["client_header_timeout"].asUInt()),
+		  clientBodyTimeout(config["client_body_timeout"].asUInt())
 		{ }
 
 	void swap(HttpServerConfigRealization &other) BOOST_NOEXCEPT_OR_NOTHROW {
 		std::swap(requestFreelistLimit, other.requestFreelistLimit);
+		std::swap(clientKeepAliveTimeout, other.clientKeepAliveTimeout);
+		std::swap(clientHeaderTimeout, other.clientHeaderTimeout);
+		std::swap(clientBodyTimeout, other.clientBodyTimeout);
 	}
 };
 
@@ -316,6 +331,12 @@ private:
 		client->currentRequest = req = checkoutRequestObject(client);
 		req->client = client;
 		reinitializeRequest(client, req);
+
+		if (client->requestsBegun == 0) {
+			armClientTimeout(client, configRlz.clientHeaderTimeout);
+		} else {
+			armClientTimeout(client, configRlz.clientKeepAliveTimeout);
+		}
 	}
 
 
@@ -342,6 +363,13 @@ private:
 			SKC_TRACE(client, 2, "New request received: #" << (totalRequestsBegun + 1));
 			headerParserStatePool.destroy(req->parserState.headerParser);
 			req->parserState.headerParser = NULL;
+			if (req->httpState == Request::PARSING_BODY
+			 || req->httpState == Request::PARSING_CHUNKED_BODY)
+			{
+				armClientTimeout(client, configRlz.clientBodyTimeout);
+			} else {
+				disarmClientTimeout(client);
+			}
 
 			if (HttpServer::serverState == HttpServer::SHUTTING_DOWN
 			 && shouldDisconnectClientOnShutdown(client))
@@ -676,6 +704,102 @@ private:
 	}
 
 
+	/***** Client timeouts *****/
+
+	void armClientTimeout(Client *client, unsigned int timeout) {
+		if (timeout == 0) {
+			disarmClientTimeout(client);
+		} else {
+			client->timeoutEntry.callback = onClientTimeout;
+			this->getContext()->timerWheel.arm(&client->timeoutEntry, timeout);
+		}
+	}
+
+	void disarmClientTimeout(Client *client) {
+		this->getContext()->timerWheel.disarm(&client->timeoutEntry);
+	}
+
+	static void onClientTimeout(TimerWheelEntry *entry) {
+		Client *client = static_cast<Client *>(static_cast<BaseHttpClient<Request> *>(
+			entry->userData));
+		HttpServer *self = static_cast<HttpServer *>(HttpServer::getServerFromClient(client));
+		SKC_LOG_EVENT_FROM_STATIC(self, HttpServer, client, "onClientTimeout");
+
+		if (client->connected() && client->currentRequest != NULL) {
+			Request *req = client->currentRequest;
+			RequestRef ref(req, __FILE__, __LINE__);
+			self->handleClientTimeout(client, req);
+		}
+	}
+
+	void handleClientTimeout(Client *client, Request *req) {
+		switch (req->httpState) {
+		case Request::PARSING_HEADERS:
+			if (req->lastDataReceiveTime == 0) {
+				if (client->requestsBegun == 0) {
+					SKC_DEBUG(client, "No request received within " <<
+						configRlz.clientHeaderTimeout << " seconds, disconnecting");
+				} else {
+					SKC_DEBUG(client, "Keep-alive connection idle for " <<
+						configRlz.clientKeepAliveTimeout << " seconds, disconnecting");
+				}
+				this->disconnect(&client);
+			} else {
+				SKC_INFO(client, "Timed out reading request headers after " <<
+					configRlz.clientHeaderTimeout << " seconds");
+				// Headers are incomplete, so stop reading the rest of them
+				// and change state so that the response body will be written.
+				client->input.stop();
+				headerParserStatePool.destroy(req->parserState.headerParser);
+				req->parserState.headerParser = NULL;
+				req->httpState = Request::COMPLETE;
+				req->wantKeepAlive = false;
+				endWithErrorResponse(&client, &req, 408, "Request timeout\n");
+			}
+			break;
+		case Request::PARSING_BODY:
+		case Request::PARSING_CHUNKED_BODY:
+			handleClientBodyTimeout(client, req);
+			break;
+		default:
+			break;
+		}
+	}
+
+	/**
+	 * The body timeout is not re-armed on every read, because that would
+	 * happen very often. Instead, when it fires we check how long the
+	 * client has actually been silent and re-arm it for the remainder.
+	 */
+	void handleClientBodyTimeout(Client *client, Request *req) {
+		if (req->ended() || req->bodyFullyRead()) {
+			return;
+		}
+
+		if (!req->bodyChannel.acceptingInput()) {
+			// We stopped reading from the client because the body
+			// consumer is busy. That's not the client's fault.
+			if (req->bodyChannel.mayAcceptInputLater()) {
+				armClientTimeout(client, configRlz.clientBodyTimeout);
+			}
+			return;
+		}
+
+		ev_tstamp idle = ev_now(this->getLoop()) - req->lastDataReceiveTime;
+		if (idle < configRlz.clientBodyTimeout) {
+			this->getContext()->timerWheel.arm(&client->timeoutEntry,
+				configRlz.clientBodyTimeout - idle);
+			return;
+		}
+
+		SKC_INFO(client, "Timed out reading request body: client sent nothing for " <<
+			configRlz.clientBodyTimeout << " seconds");
+		client->input.stop();
+		req->wantKeepAlive = false;
+		req->bodyChannel.feedError(ETIMEDOUT);
+	}
+
+
 	/***** Channel callbacks *****/
 
 	static void _onClientOutputDataFlushed(FileBufferedChannel *_channel) {
@@ -773,6 +897,11 @@ protected:
 		bool ended = req->ended();
 
 		if (!ended) {
+			if (req->lastDataReceiveTime == 0 && client->requestsBegun > 0) {
+				// First data of the next request on a kept-alive
+				// connection: from now on the header timeout applies.
+				armClientTimeout(client, configRlz.clientHeaderTimeout);
+			}
 			req->lastDataReceiveTime = ev_now(this->getLoop());
 		}
 		if (detectNextRequestEarlyReadError(client, req, buffer, errcode)) {
@@ -816,6 +945,7 @@ protected:
 
 	virtual void onClientDisconnecting(Client *client) {
 		ParentClass::onClientDisconnecting(client);
+		disarmClientTimeout(client);
 
 		// Handle client being disconnect()'ed without endRequest().
 
@@ -829,6 +959,7 @@ protected:
 
 	virtual void deinitializeClient(Client *client) {
 		ParentClass::deinitializeClient(client);
+		disarmClientTimeout(client);
 		client->currentRequest = NULL;
 	}
 
@@ -926,6 +1057,7 @@ protected:
 			req->pool = psg_create_pool(PSG_DEFAULT_POOL_SIZE);
 		}
 		psg_lstr_init(&req->path);
+		psg_lstr_init(&req->secureHeadersBlock);
 		req->bodyChannel.reinitialize();
 		req->aux.bodyInfo.contentLength = 0; // Sets the entire union to 0.
 		req->bodyAlreadyRead = 0;
@@ -966,6 +1098,8 @@ protected:
 			it.next();
 		}
 
+		psg_lstr_deinit(&req->secureHeadersBlock);
+
 		if (req->pool != NULL && !psg_reset_pool(req->pool, PSG_DEFAULT_POOL_SIZE)) {
 			psg_destroy_pool(req->pool);
 			req->pool = NULL;
@@ -441,6 +441,7 @@ private:
 
 		this->onUpdateStatistics();
 		this->onFinalizeStatisticsUpdate();
+		ctx->releaseIdleMbufs(ev_now(this->getLoop()));
 
 		timer.repeat = timeToNextMultipleD(5, ev_now(this->getLoop()));
 		timer.again();
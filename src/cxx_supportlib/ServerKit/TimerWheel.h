@@ -0,0 +1,278 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_SERVER_KIT_TIMER_WHEEL_H_
+#define _PASSENGER_SERVER_KIT_TIMER_WHEEL_H_
+
+#include <psg_sysqueue.h>
+#include <boost/cstdint.hpp>
+#include <oxt/macros.hpp>
+#include <ev++.h>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+namespace Passenger {
+namespace ServerKit {
+
+
+struct TimerWheelEntry;
+typedef void (*TimerWheelCallback)(TimerWheelEntry *entry);
+
+/**
+ * A timeout managed by a TimerWheel. Embed this in the object that the
+ * timeout is about, and set `callback` and `userData` before arming it.
+ */
+struct TimerWheelEntry {
+	LIST_ENTRY(TimerWheelEntry) next;
+	/** The tick at which this entry expires. Only valid while armed. */
+	boost::uint64_t expiresAt;
+	TimerWheelCallback callback;
+	void *userData;
+	bool armed;
+
+	TimerWheelEntry()
+		: expiresAt(0),
+		  callback(NULL),
+		  userData(NULL),
+		  armed(false)
+		{ }
+
+	bool isArmed() const {
+		return armed;
+	}
+};
+
+/**
+ * A hierarchical timing wheel for managing large numbers of coarse-grained
+ * timeouts, such as per-client keep-alive timeouts. Arming, re-arming and
+ * disarming an entry are O(1), whereas libev timers are kept in a heap and
+ * cost O(log n) each. All entries share a single libev timer, which only
+ * runs while at least one entry is armed.
+ *
+ * The wheel has LEVELS levels of SLOTS slots each. A slot on level 0 covers
+ * one tick; a slot on every next level covers SLOTS times as many ticks as
+ * one on the level below. Entries are moved down ("cascaded") as their
+ * expiration time comes near. Timeouts are rounded up to whole ticks, so an
+ * entry fires between `timeout` and `timeout + resolution` seconds after it
+ * was armed. Timeouts longer than SLOTS^LEVELS ticks are clamped.
+ *
+ * Callbacks are invoked from the event loop after the entry has been
+ * disarmed, so they may re-arm it or free the object that contains it.
+ *
+ * Not thread-safe: must only be used from the event loop thread.
+ */
+class TimerWheel {
+public:
+	static const unsigned int SLOT_BITS = 6;
+	static const unsigned int SLOTS = 1 << SLOT_BITS;
+	static const unsigned int LEVELS = 4;
+	static const boost::uint64_t MAX_TICKS = ((boost::uint64_t) 1 << (SLOT_BITS * LEVELS)) - 1;
+
+private:
+	LIST_HEAD(EntryList, TimerWheelEntry);
+
+	EntryList slots[LEVELS][SLOTS];
+	struct ev_loop *loop;
+	ev::timer timer;
+	ev_tstamp resolution;
+	boost::uint64_t currentTick;
+	unsigned int count;
+
+	boost::uint64_t getTick(ev_tstamp time) const {
+		return (boost::uint64_t) (time / resolution);
+	}
+
+	void insert(TimerWheelEntry *entry) {
+		boost::uint64_t delta = entry->expiresAt - currentTick;
+		unsigned int level = 0;
+
+		if (delta > MAX_TICKS) {
+			delta = MAX_TICKS;
+			entry->expiresAt = currentTick + MAX_TICKS;
+		}
+		while (level < LEVELS - 1
+		 && delta >= ((boost::uint64_t) 1 << (SLOT_BITS * (level + 1))))
+		{
+			level++;
+		}
+
+		unsigned int slot = (entry->expiresAt >> (SLOT_BITS * level)) & (SLOTS - 1);
+		LIST_INSERT_HEAD(&slots[level][slot], entry, next);
+	}
+
+	void cascade(unsigned int level, unsigned int slot) {
+		EntryList list;
+		TimerWheelEntry *entry;
+
+		LIST_INIT(&list);
+		LIST_SWAP(&list, &slots[level][slot], TimerWheelEntry, next);
+		while (!LIST_EMPTY(&list)) {
+			entry = LIST_FIRST(&list);
+			LIST_REMOVE(entry, next);
+			insert(entry);
+		}
+	}
+
+	void expire(unsigned int slot) {
+		EntryList list;
+		TimerWheelEntry *entry;
+
+		LIST_INIT(&list);
+		LIST_SWAP(&list, &slots[0][slot], TimerWheelEntry, next);
+		while (!LIST_EMPTY(&list)) {
+			entry = LIST_FIRST(&list);
+			LIST_REMOVE(entry, next);
+			entry->armed = false;
+			count--;
+			entry->callback(entry);
+		}
+	}
+
+	void tick() {
+		currentTick++;
+
+		// Cascade higher levels whenever the level below wraps around.
+		for (unsigned int level = 1; level < LEVELS; level++) {
+			if (((currentTick >> (SLOT_BITS * (level - 1))) & (SLOTS - 1)) != 0) {
+				break;
+			}
+			cascade(level, (currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+		}
+
+		expire(currentTick & (SLOTS - 1));
+	}
+
+	void onTimeout(ev::timer &timer, int revents) {
+		advance(ev_now(loop));
+	}
+
+public:
+	TimerWheel(ev_tstamp _resolution = 1)
+		: loop(NULL),
+		  resolution(_resolution),
+		  currentTick(0),
+		  count(0)
+	{
+		for (unsigned int level = 0; level < LEVELS; level++) {
+			for (unsigned int slot = 0; slot < SLOTS; slot++) {
+				LIST_INIT(&slots[level][slot]);
+			}
+		}
+	}
+
+	~TimerWheel() {
+		if (loop != NULL) {
+			timer.stop();
+		}
+	}
+
+	void initialize(struct ev_loop *_loop) {
+		loop = _loop;
+		timer.set(loop);
+		timer.set<TimerWheel, &TimerWheel::onTimeout>(this);
+	}
+
+	/**
+	 * Arms `entry` so that its callback is invoked `timeout` seconds from
+	 * now. If the entry is already armed, then it is rescheduled.
+	 */
+	void arm(TimerWheelEntry *entry, ev_tstamp timeout) {
+		assert(loop != NULL);
+		assert(entry->callback != NULL);
+		boost::uint64_t now = getTick(ev_now(loop));
+		boost::uint64_t ticks = (boost::uint64_t) std::ceil(timeout / resolution);
+
+		if (entry->armed) {
+			LIST_REMOVE(entry, next);
+			count--;
+		}
+		if (count == 0 && now > currentTick) {
+			// Nothing is scheduled, so there is nothing to catch up on.
+			currentTick = now;
+		}
+		if (ticks == 0) {
+			ticks = 1;
+		}
+
+		entry->expiresAt = std::max(now, currentTick) + ticks;
+		entry->armed = true;
+		insert(entry);
+		count++;
+
+		if (!timer.is_active()) {
+			timer.start(resolution, resolution);
+		}
+	}
+
+	void disarm(TimerWheelEntry *entry) {
+		if (entry->armed) {
+			LIST_REMOVE(entry, next);
+			entry->armed = false;
+			count--;
+		}
+	}
+
+	/**
+	 * Fires all entries that expired at or before `now`. Normally called by
+	 * the internal libev timer; only exposed for unit tests.
+	 */
+	void advance(ev_tstamp now) {
+		boost::uint64_t target = getTick(now);
+		while (currentTick < target && count > 0) {
+			tick();
+		}
+		if (count == 0) {
+			currentTick = std::max(currentTick, target);
+			timer.stop();
+		}
+	}
+
+	/**
+	 * Returns the number of seconds until `entry` fires, rounded to whole
+	 * ticks, or 0 if it is not armed.
+	 */
+	ev_tstamp getRemainingTime(const TimerWheelEntry *entry) const {
+		if (!entry->armed) {
+			return 0;
+		} else {
+			return (entry->expiresAt - currentTick) * resolution;
+		}
+	}
+
+	unsigned int size() const {
+		return count;
+	}
+
+	ev_tstamp getResolution() const {
+		return resolution;
+	}
+};
+
+
+} // namespace ServerKit
+} // namespace Passenger
+
+#endif /* _PASSENGER_SERVER_KIT_TIMER_WHEEL_H_ */
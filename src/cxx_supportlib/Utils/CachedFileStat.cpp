@@ -38,6 +38,11 @@ pp_cached_file_stat_free(PP_CachedFileStat *cstat) {
 	delete (Passenger::CachedFileStat *) cstat;
 }
 
+void
+pp_cached_file_stat_enable_inotify(PP_CachedFileStat *cstat) {
+	((Passenger::CachedFileStat *) cstat)->enableInotify();
+}
+
 int
 pp_cached_file_stat_perform(PP_CachedFileStat *cstat,
                             const char *filename,
@@ -39,6 +39,7 @@ typedef void PP_CachedFileStat;
 
 PP_CachedFileStat *pp_cached_file_stat_new(unsigned int max_size);
 void pp_cached_file_stat_free(PP_CachedFileStat *cstat);
+void pp_cached_file_stat_enable_inotify(PP_CachedFileStat *cstat);
 int  pp_cached_file_stat_perform(PP_CachedFileStat *cstat,
                                  const char *filename,
                                  struct stat *buf,
@@ -30,10 +30,18 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <time.h>
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <sys/vfs.h>
+#endif
 
 #include <cerrno>
 #include <cassert>
+#include <cstring>
 #include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 #include <oxt/system_calls.hpp>
@@ -56,6 +64,15 @@ using namespace boost;
  * The cache has a maximum size, which may be altered during runtime. If a
  * file that wasn't in the cache is being stat()ed, and the cache is full,
  * then the oldest cache entry will be removed.
+ *
+ * On Linux, you can call enableInotify() to use inotify instead of
+ * throttling. Then the directories containing cached files are watched,
+ * and cached stat info is reused until a filesystem event invalidates it.
+ * In the steady state no stat() calls are made at all, yet changes are
+ * noticed right away. Files for which no watches can be set up are
+ * throttled as usual. This happens for relative paths, for network
+ * filesystems (where inotify does not see changes made by other hosts)
+ * and when the inotify watch limit is reached.
  */
 class CachedFileStat {
 public:
@@ -94,6 +111,18 @@ public:
 		/** This entry's filename. */
 		string filename;
 
+		/**
+		 * Whether `info` is kept up-to-date through inotify, so that
+		 * refresh() does not need to stat() the file.
+		 */
+		bool watched;
+
+		/**
+		 * Whether watching this file with inotify failed. It is then
+		 * throttled as usual until it is invalidated.
+		 */
+		bool unwatchable;
+
 		/**
 		 * Creates a new Entry object. The file will not be
 		 * stat()ted until you call refresh().
@@ -107,6 +136,8 @@ public:
 			last_result = -1;
 			last_errno = 0;
 			last_time = 0;
+			watched = false;
+			unwatchable = false;
 		}
 
 		/**
@@ -128,7 +159,10 @@ public:
 		int refresh(unsigned int throttleRate) {
 			time_t currentTime;
 
-			if (expired(last_time, throttleRate, currentTime)) {
+			if (watched && throttleRate > 0) {
+				errno = last_errno;
+				return last_result;
+			} else if (expired(last_time, throttleRate, currentTime)) {
 				last_result = syscalls::stat(filename.c_str(), &info);
 				last_errno = errno;
 				last_time = currentTime;
@@ -138,6 +172,15 @@ public:
 				return last_result;
 			}
 		}
+
+		/**
+		 * Makes the next refresh() call stat() the file again.
+		 */
+		void invalidate() {
+			watched = false;
+			unwatchable = false;
+			last_time = 0;
+		}
 	};
 
 	typedef boost::shared_ptr<Entry> EntryPtr;
@@ -148,15 +191,291 @@ public:
 	EntryList entries;
 	EntryMap cache;
 
+private:
+	bool inotifyEnabled;
+	int inotifyFd;
+	/** Maps watched directory paths to inotify watch descriptors. */
+	std::map<string, int> watchedDirs;
+	/**
+	 * Maps watch descriptors to watched directory paths. Multiple paths
+	 * may refer to the same directory, for example through symlinks.
+	 */
+	std::map< int, std::vector<string> > watchedDirsByWd;
+
+	// Disallow copying: the inotify file descriptor cannot be shared.
+	CachedFileStat(const CachedFileStat &);
+	CachedFileStat &operator=(const CachedFileStat &);
+
+#ifdef __linux__
+	enum WatchResult {
+		WATCHED,
+		NONEXISTANT,
+		WATCH_FAILED
+	};
+
+	static bool isNetworkFilesystem(long type) {
+		switch ((unsigned long) type & 0xffffffffUL) {
+		case 0x6969UL:     // NFS
+		case 0x517BUL:     // SMB
+		case 0xFF534D42UL: // CIFS
+		case 0xFE534D42UL: // SMB2
+		case 0x65735546UL: // FUSE
+		case 0x00C36400UL: // Ceph
+		case 0x5346414FUL: // AFS
+		case 0x01021997UL: // 9P
+		case 0x01161970UL: // GFS2
+		case 0x7461636FUL: // OCFS2
+		case 0x73757245UL: // Coda
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/**
+	 * Only normalized absolute paths can be watched, because invalidation
+	 * works by matching path prefixes.
+	 */
+	static bool isWatchablePath(const string &filename) {
+		return !filename.empty()
+			&& filename[0] == '/'
+			&& filename[filename.size() - 1] != '/'
+			&& filename.find("//") == string::npos
+			&& filename.find("/./") == string::npos
+			&& filename.find("/../") == string::npos
+			&& !(filename.size() >= 2 && filename.compare(filename.size() - 2, 2, "/.") == 0)
+			&& !(filename.size() >= 3 && filename.compare(filename.size() - 3, 3, "/..") == 0);
+	}
+
+	static bool hasPathPrefix(const string &path, const string &prefix) {
+		if (prefix == "/") {
+			return true;
+		} else {
+			return path.size() >= prefix.size()
+				&& path.compare(0, prefix.size(), prefix) == 0
+				&& (path.size() == prefix.size() || path[prefix.size()] == '/');
+		}
+	}
+
+	bool initializeInotify() {
+		// Initialized lazily, so that a CachedFileStat that is created
+		// before forking gets its own inotify instance in every process.
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFd == -1) {
+			inotifyEnabled = false;
+		}
+		return inotifyEnabled;
+	}
+
+	WatchResult watchDir(const string &path) {
+		if (watchedDirs.find(path) != watchedDirs.end()) {
+			return WATCHED;
+		}
+
+		struct statfs fsinfo;
+		if (statfs(path.c_str(), &fsinfo) == 0 && isNetworkFilesystem(fsinfo.f_type)) {
+			return WATCH_FAILED;
+		}
+
+		int wd = inotify_add_watch(inotifyFd, path.c_str(),
+			IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE
+			| IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+			| IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+		if (wd == -1) {
+			if (errno == ENOENT || errno == ENOTDIR) {
+				return NONEXISTANT;
+			} else {
+				// Most likely ENOSPC: the watch limit has been reached.
+				return WATCH_FAILED;
+			}
+		}
+		watchedDirs[path] = wd;
+		watchedDirsByWd[wd].push_back(path);
+		return WATCHED;
+	}
+
+	/**
+	 * Watches all directories that lead to `filename`, and `filename`
+	 * itself if it is a directory, so that any change that may affect
+	 * its stat info results in an event.
+	 */
+	bool watch(const string &filename) {
+		if (!isWatchablePath(filename)) {
+			return false;
+		}
+
+		string::size_type pos = 0;
+		WatchResult result = watchDir("/");
+		while (result == WATCHED && pos != string::npos) {
+			pos = filename.find('/', pos + 1);
+			result = watchDir(filename.substr(0, pos));
+		}
+		return result != WATCH_FAILED;
+	}
+
+	/**
+	 * Stops watching `path` and all watched directories below it. They
+	 * will be watched again when their entries are refreshed. This is
+	 * necessary because a renamed directory or a replaced symlink means
+	 * that the same path now refers to a different directory.
+	 */
+	void unwatchTree(const string &path) {
+		std::map<string, int>::iterator it = watchedDirs.lower_bound(path);
+
+		while (it != watchedDirs.end() && it->first.compare(0, path.size(), path) == 0) {
+			if (!hasPathPrefix(it->first, path)) {
+				it++;
+				continue;
+			}
+
+			std::vector<string> &paths = watchedDirsByWd[it->second];
+			paths.erase(std::find(paths.begin(), paths.end(), it->first));
+			if (paths.empty()) {
+				inotify_rm_watch(inotifyFd, it->second);
+				watchedDirsByWd.erase(it->second);
+			}
+			watchedDirs.erase(it++);
+		}
+	}
+
+	void invalidate(const string &filename) {
+		EntryList::iterator it(cache.get(filename, entries.end()));
+		if (it != entries.end()) {
+			(*it)->invalidate();
+		}
+	}
+
+	void invalidateTree(const string &path) {
+		EntryList::iterator it, end = entries.end();
+		for (it = entries.begin(); it != end; it++) {
+			if (hasPathPrefix((*it)->filename, path)) {
+				(*it)->invalidate();
+			}
+		}
+	}
+
+	void handleInotifyEvent(const struct inotify_event *event) {
+		// Events that may affect the stat info of everything below the
+		// subject (permissions), or what the subject's path refers to.
+		const uint32_t treeEvents = IN_ATTRIB | IN_CREATE | IN_DELETE
+			| IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF
+			| IN_IGNORED | IN_UNMOUNT;
+		const uint32_t replaceEvents = treeEvents & ~IN_ATTRIB;
+
+		if (event->mask & IN_Q_OVERFLOW) {
+			invalidateTree("/");
+			return;
+		}
+
+		std::map< int, std::vector<string> >::iterator it = watchedDirsByWd.find(event->wd);
+		if (it == watchedDirsByWd.end()) {
+			return;
+		}
+
+		// Copied because unwatchTree() may modify the original.
+		std::vector<string> dirs = it->second;
+		std::vector<string>::const_iterator dir_it, dir_end = dirs.end();
+
+		for (dir_it = dirs.begin(); dir_it != dir_end; dir_it++) {
+			const string &dir = *dir_it;
+			string subject;
+
+			if (event->len > 0) {
+				subject = (dir == "/") ? dir : dir + "/";
+				subject.append(event->name);
+				// The directory's own mtime changes when its contents change.
+				invalidate(dir);
+			} else {
+				subject = dir;
+			}
+
+			if (event->mask & treeEvents) {
+				invalidateTree(subject);
+			} else {
+				invalidate(subject);
+			}
+			if (event->mask & replaceEvents) {
+				unwatchTree(subject);
+			}
+		}
+	}
+
+	void processInotifyEvents() {
+		union {
+			struct inotify_event event;
+			char data[1024 * 4];
+		} buf;
+		ssize_t ret;
+
+		while ((ret = read(inotifyFd, buf.data, sizeof(buf.data))) > 0) {
+			const char *pos = buf.data;
+			const char *end = buf.data + ret;
+			while (pos < end) {
+				const struct inotify_event *event = (const struct inotify_event *) pos;
+				handleInotifyEvent(event);
+				pos += sizeof(struct inotify_event) + event->len;
+			}
+		}
+	}
+#endif
+
+public:
 	/**
 	 * Creates a new CachedFileStat object.
 	 *
 	 * @param maxSize The maximum cache size. A size of 0 means unlimited.
 	 */
-	CachedFileStat(unsigned int maxSize = 0) {
+	CachedFileStat(unsigned int maxSize = 0)
+		: inotifyEnabled(false),
+		  inotifyFd(-1)
+	{
 		this->maxSize = maxSize;
 	}
 
+	~CachedFileStat() {
+		if (inotifyFd != -1) {
+			close(inotifyFd);
+		}
+	}
+
+	/**
+	 * Use inotify instead of throttling for stat() calls with a non-zero
+	 * `throttleRate`. The inotify instance is created on the first such
+	 * call, so this object must not be used before forking if it is used
+	 * in the child processes.
+	 *
+	 * Returns whether inotify is supported on this platform.
+	 */
+	bool enableInotify() {
+		#ifdef __linux__
+			inotifyEnabled = true;
+			return true;
+		#else
+			return false;
+		#endif
+	}
+
+	/**
+	 * Returns the inotify file descriptor, or -1 if inotify is not used
+	 * (yet). It becomes readable when cached entries may have changed;
+	 * the next stat() call processes the events.
+	 */
+	int getInotifyFd() const {
+		return inotifyFd;
+	}
+
+	/**
+	 * Processes pending inotify events, so that the inotify file descriptor
+	 * is no longer readable. stat() does this automatically.
+	 */
+	void processEvents() {
+		#ifdef __linux__
+			if (inotifyFd != -1) {
+				processInotifyEvents();
+			}
+		#endif
+	}
+
 	/**
 	 * Stats the given file. If `throttleRate` seconds have passed since
 	 * the last time stat() was called on this file, then the file will be
@@ -167,6 +486,8 @@ public:
 	 *             will be stored here.
 	 * @param throttleRate Tells this CachedFileStat that the file may only
 	 *        be statted at most every <tt>throttleRate</tt> seconds.
+	 *        If inotify is enabled and this is not 0, then the cached stat
+	 *        information is used until the file changes.
 	 * @return 0 if the stat() call succeeded or if the cached stat information was used;
 	 *         -1 if something went wrong while statting the file. In the latter
 	 *         case, <tt>errno</tt> will be populated with an appropriate error code.
@@ -176,9 +497,16 @@ public:
 	 * @throws boost::thread_interrupted
 	 */
 	int stat(const StaticString &filename, struct stat *buf, unsigned int throttleRate = 0) {
-		EntryList::iterator it(cache.get(filename, entries.end()));
 		EntryPtr entry;
 		int ret;
+		#ifdef __linux__
+			bool useInotify = inotifyEnabled && throttleRate > 0
+				&& (inotifyFd != -1 || initializeInotify());
+			if (useInotify) {
+				processInotifyEvents();
+			}
+		#endif
+		EntryList::iterator it(cache.get(filename, entries.end()));
 
 		if (it == entries.end()) {
 			// Filename not in cache.
@@ -204,6 +532,21 @@ public:
 			entries.splice(entries.begin(), entries, it);
 			cache.set(filename, entries.begin());
 		}
+		#ifdef __linux__
+			// Watch before stat()ing, so that no change can slip through
+			// in between.
+			if (useInotify && !entry->watched && !entry->unwatchable) {
+				if (watch(entry->filename)) {
+					entry->invalidate();
+					ret = entry->refresh(0);
+					entry->watched = true;
+					*buf = entry->info;
+					return ret;
+				} else {
+					entry->unwatchable = true;
+				}
+			}
+		#endif
 		ret = entry->refresh(throttleRate);
 		*buf = entry->info;
 		return ret;
@@ -0,0 +1,206 @@
+/*
+ *  Phusion Passenger - https://www.phusionpassenger.com/
+ *  Copyright (c) 2017 Phusion Holding B.V.
+ *
+ *  "Passenger", "Phusion Passenger" and "Union Station" are registered
+ *  trademarks of Phusion Holding B.V.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#ifndef _PASSENGER_OPEN_METRICS_WRITER_H_
+#define _PASSENGER_OPEN_METRICS_WRITER_H_
+
+#include <boost/cstdint.hpp>
+#include <string>
+#include <cstdio>
+#include <StaticString.h>
+#include <Algorithms/Histogram.h>
+#include <Utils/StrIntUtils.h>
+
+namespace Passenger {
+
+using namespace std;
+
+
+/**
+ * Formats metrics in the OpenMetrics text format, which is understood by
+ * Prometheus. See https://openmetrics.io/
+ *
+ * Every metric family must be declared with `declare()` before its
+ * samples are written. Labels are passed as preformatted strings, which
+ * can be created with `label()`, for example:
+ *
+ *   writer.declare("passenger_group_queue_length", "gauge", "...");
+ *   writer.sample("passenger_group_queue_length",
+ *       OpenMetricsWriter::label("group", groupName), 3);
+ *   string result = writer.finish();
+ */
+class OpenMetricsWriter {
+private:
+	string result;
+
+	void writeName(const StaticString &name, const StaticString &suffix,
+		const StaticString &labels)
+	{
+		result.append(name.data(), name.size());
+		result.append(suffix.data(), suffix.size());
+		if (!labels.empty()) {
+			result.append(1, '{');
+			result.append(labels.data(), labels.size());
+			result.append(1, '}');
+		}
+		result.append(1, ' ');
+	}
+
+	void writeValue(double value) {
+		char buf[32];
+		int size = snprintf(buf, sizeof(buf), "%.9g", value);
+		result.append(buf, size);
+		result.append(1, '\n');
+	}
+
+	void writeValue(boost::uint64_t value) {
+		result.append(toString(value));
+		result.append(1, '\n');
+	}
+
+public:
+	/** Returns `name="value"`, with `value` escaped. */
+	static string label(const StaticString &name, const StaticString &value) {
+		string result;
+		const char *pos = value.data();
+		const char *end = value.data() + value.size();
+
+		result.reserve(name.size() + value.size() + 3);
+		result.append(name.data(), name.size());
+		result.append("=\"", 2);
+		for (; pos < end; pos++) {
+			switch (*pos) {
+			case '\\':
+				result.append("\\\\", 2);
+				break;
+			case '"':
+				result.append("\\\"", 2);
+				break;
+			case '\n':
+				result.append("\\n", 2);
+				break;
+			default:
+				result.append(1, *pos);
+				break;
+			}
+		}
+		result.append(1, '"');
+		return result;
+	}
+
+	/** Returns `label(name1, value1) + "," + label(name2, value2)`. */
+	static string labels(const StaticString &name1, const StaticString &value1,
+		const StaticString &name2, const StaticString &value2)
+	{
+		return label(name1, value1) + "," + label(name2, value2);
+	}
+
+	/**
+	 * Declares a metric family. `type` is "counter", "gauge" or
+	 * "histogram". The samples of a counter must be written with the
+	 * "_total" suffix.
+	 */
+	void declare(const StaticString &name, const StaticString &type,
+		const StaticString &help)
+	{
+		result.append("# TYPE ");
+		result.append(name.data(), name.size());
+		result.append(1, ' ');
+		result.append(type.data(), type.size());
+		result.append("\n# HELP ");
+		result.append(name.data(), name.size());
+		result.append(1, ' ');
+		result.append(help.data(), help.size());
+		result.append(1, '\n');
+	}
+
+	void sample(const StaticString &name, const StaticString &labels,
+		boost::uint64_t value)
+	{
+		writeName(name, StaticString(), labels);
+		writeValue(value);
+	}
+
+	void sample(const StaticString &name, const StaticString &labels,
+		unsigned int value)
+	{
+		sample(name, labels, (boost::uint64_t) value);
+	}
+
+	void sample(const StaticString &name, const StaticString &labels,
+		int value)
+	{
+		sample(name, labels, (double) value);
+	}
+
+	void sample(const StaticString &name, const StaticString &labels,
+		double value)
+	{
+		writeName(name, StaticString(), labels);
+		writeValue(value);
+	}
+
+	/**
+	 * Writes the samples of a histogram family. `buckets` are the upper
+	 * bounds of the buckets to export, in ascending order and in the unit
+	 * of the values recorded in `histogram`. Exported bounds and sums are
+	 * divided by `unit`, so that for example microseconds can be exported
+	 * as seconds.
+	 */
+	void histogram(const StaticString &name, const StaticString &labels,
+		const Histogram &histogram, const boost::uint64_t *buckets,
+		unsigned int bucketCount, double unit = 1)
+	{
+		string prefix = labels;
+		if (!prefix.empty()) {
+			prefix.append(1, ',');
+		}
+
+		for (unsigned int i = 0; i < bucketCount; i++) {
+			char bound[32];
+			snprintf(bound, sizeof(bound), "%.9g", buckets[i] / unit);
+			writeName(name, P_STATIC_STRING("_bucket"),
+				prefix + label(P_STATIC_STRING("le"), bound));
+			writeValue(histogram.countAtMost(buckets[i]));
+		}
+		writeName(name, P_STATIC_STRING("_bucket"), prefix + "le=\"+Inf\"");
+		writeValue(histogram.getCount());
+		writeName(name, P_STATIC_STRING("_count"), labels);
+		writeValue(histogram.getCount());
+		writeName(name, P_STATIC_STRING("_sum"), labels);
+		writeValue(histogram.getSum() / unit);
+	}
+
+	/** Terminates the exposition and returns it. */
+	string finish() {
+		result.append("# EOF\n");
+		return result;
+	}
+};
+
+
+} // namespace Passenger
+
+#endif /* _PASSENGER_OPEN_METRICS_WRITER_H_ */
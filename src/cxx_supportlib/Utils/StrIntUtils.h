@@ -34,11 +34,16 @@
 #include <new>
 #include <cstdlib>
 #include <cstddef>
+#include <cstring>
 #include <ctime>
 #include <boost/move/utility.hpp>
 #include <oxt/macros.hpp>
 #include <StaticString.h>
 
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
 namespace Passenger {
 
 using namespace std;
@@ -426,6 +431,82 @@ void convertLowerCase(const unsigned char * restrict data, unsigned char * restr
  */
 bool constantTimeCompare(const StaticString &a, const StaticString &b);
 
+/**
+ * Checks whether the first `len` bytes of `a` and `b` are equal. Uses SSE2
+ * when available. This is meant for the short strings (header names and
+ * values) that we compare on the request path, for which the overhead of
+ * calling memcmp() is significant compared to the comparison itself.
+ */
+inline bool
+memeqFast(const char *a, const char *b, size_t len) {
+	#ifdef __SSE2__
+		while (len >= 16) {
+			__m128i va = _mm_loadu_si128((const __m128i *) a);
+			__m128i vb = _mm_loadu_si128((const __m128i *) b);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) {
+				return false;
+			}
+			a += 16;
+			b += 16;
+			len -= 16;
+		}
+	#endif
+	while (len > 0) {
+		if (*a != *b) {
+			return false;
+		}
+		a++;
+		b++;
+		len--;
+	}
+	return true;
+}
+
+/**
+ * Like memeqFast(), but compares ASCII letters case-insensitively.
+ */
+inline bool
+memcaseeqFast(const char *a, const char *b, size_t len) {
+	#ifdef __SSE2__
+		const __m128i upperA = _mm_set1_epi8('A' - 1);
+		const __m128i upperZ = _mm_set1_epi8('Z' + 1);
+		const __m128i caseBit = _mm_set1_epi8(0x20);
+		while (len >= 16) {
+			__m128i va = _mm_loadu_si128((const __m128i *) a);
+			__m128i vb = _mm_loadu_si128((const __m128i *) b);
+			// Bytes >= 0x80 are negative in a signed comparison, so they
+			// are never mistaken for uppercase letters.
+			va = _mm_or_si128(va, _mm_and_si128(caseBit,
+				_mm_and_si128(_mm_cmpgt_epi8(va, upperA), _mm_cmplt_epi8(va, upperZ))));
+			vb = _mm_or_si128(vb, _mm_and_si128(caseBit,
+				_mm_and_si128(_mm_cmpgt_epi8(vb, upperA), _mm_cmplt_epi8(vb, upperZ))));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) {
+				return false;
+			}
+			a += 16;
+			b += 16;
+			len -= 16;
+		}
+	#endif
+	while (len > 0) {
+		unsigned char ca = (unsigned char) *a;
+		unsigned char cb = (unsigned char) *b;
+		if (ca >= 'A' && ca <= 'Z') {
+			ca |= 0x20;
+		}
+		if (cb >= 'A' && cb <= 'Z') {
+			cb |= 0x20;
+		}
+		if (ca != cb) {
+			return false;
+		}
+		a++;
+		b++;
+		len--;
+	}
+	return true;
+}
+
 string distanceOfTimeInWords(time_t fromTime, time_t toTime = 0);
 
 /**
@@ -102,6 +102,14 @@
     offsetof(passenger_main_conf_t, autogenerated.socket_backlog),
     NULL
 },
+{
+    ngx_string("passenger_core_keepalive_connections"),
+    NGX_HTTP_MAIN_CONF | NGX_CONF_TAKE1,
+    passenger_conf_set_core_keepalive_connections,
+    NGX_HTTP_MAIN_CONF_OFFSET,
+    offsetof(passenger_main_conf_t, autogenerated.core_keepalive_connections),
+    NULL
+},
 {
     ngx_string("passenger_core_file_descriptor_ulimit"),
     NGX_HTTP_MAIN_CONF | NGX_CONF_TAKE1,
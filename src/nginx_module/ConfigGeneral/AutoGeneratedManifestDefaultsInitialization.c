@@ -74,6 +74,12 @@ set_manifest_autogenerated_global_conf_defaults(manifest_gen_ctx_t *ctx) {
         sizeof("passenger_socket_backlog") - 1,
         2048);
 
+    add_manifest_options_container_static_default_uint(ctx,
+        ctx->global_config_container,
+        "passenger_core_keepalive_connections",
+        sizeof("passenger_core_keepalive_connections") - 1,
+        32);
+
     add_manifest_options_container_dynamic_default(ctx,
         ctx->global_config_container,
         "passenger_core_file_descriptor_ulimit",
@@ -37,6 +37,7 @@
 #include "ngx_http_passenger_module.h"
 #include "Configuration.h"
 #include "ContentHandler.h"
+#include "UpstreamKeepalive.h"
 #include "ConfigGeneral/AutoGeneratedManifestDefaultsInitialization.c"
 #include "ConfigGeneral/AutoGeneratedSetterFuncs.c"
 #include "ConfigGeneral/ManifestGeneration.c"
@@ -115,6 +116,10 @@ passenger_init_main_conf(ngx_conf_t *cf, void *conf_pointer)
         conf->autogenerated.show_version_in_header = 1;
     }
 
+    if (conf->autogenerated.core_keepalive_connections == NGX_CONF_UNSET_UINT) {
+        conf->autogenerated.core_keepalive_connections = DEFAULT_NGINX_CORE_KEEPALIVE_CONNECTIONS;
+    }
+
     if (conf->autogenerated.default_user.len == 0) {
         conf->autogenerated.default_user.len  = sizeof(DEFAULT_WEB_APP_USER) - 1;
         conf->autogenerated.default_user.data = (u_char *) DEFAULT_WEB_APP_USER;
@@ -265,10 +270,94 @@ passenger_create_loc_conf(ngx_conf_t *cf)
     conf->options_cache.len   = 0;
     conf->env_vars_cache.data = NULL;
     conf->env_vars_cache.len  = 0;
+    conf->static_headers_cache.data = NULL;
+    conf->static_headers_cache.len  = 0;
 
     return conf;
 }
 
+/**
+ * Concatenates all secure headers that only depend on the location
+ * configuration into a single buffer, so that construct_request_buffer()
+ * can append them with one copy instead of formatting them on every request.
+ * The buffer ends with the start of the FLAGS header; the request-dependent
+ * flags and the header terminator are appended by the content handler.
+ */
+static ngx_int_t
+build_static_headers_cache(ngx_conf_t *cf, passenger_loc_conf_t *conf)
+{
+    size_t   len;
+    u_char  *buf, *pos;
+    unsigned app_group_name_is_static;
+
+    #define APP_GROUP_NAME_HEADER "!~PASSENGER_APP_GROUP_NAME: "
+    #define ENV_VARS_HEADER "!~PASSENGER_ENV_VARS: "
+    #define FLAGS_HEADER "!~FLAGS: DC"
+
+    /* If no app group name is configured then the core derives it from the
+     * app root, which is only known per-request if the app root is derived
+     * from the document root.
+     */
+    app_group_name_is_static = conf->autogenerated.app_group_name.data == NULL
+        && conf->autogenerated.app_root.data != NULL;
+
+    len = conf->options_cache.len;
+    if (app_group_name_is_static) {
+        len += (sizeof(APP_GROUP_NAME_HEADER) - 1)
+            + conf->autogenerated.app_root.len
+            + (sizeof("\r\n") - 1);
+        if (conf->autogenerated.environment.data != NULL) {
+            len += (sizeof(" ()") - 1) + conf->autogenerated.environment.len;
+        }
+    }
+    if (conf->env_vars_cache.data != NULL) {
+        len += (sizeof(ENV_VARS_HEADER) - 1) + conf->env_vars_cache.len
+            + (sizeof("\r\n") - 1);
+    }
+    len += sizeof(FLAGS_HEADER) - 1;
+
+    buf = pos = ngx_pnalloc(cf->pool, len);
+    if (buf == NULL) {
+        ngx_conf_log_error(NGX_LOG_EMERG, cf, 0,
+                           "cannot allocate buffer of %z bytes for header data",
+                           len);
+        return NGX_ERROR;
+    }
+
+    if (app_group_name_is_static) {
+        pos = ngx_copy(pos, APP_GROUP_NAME_HEADER, sizeof(APP_GROUP_NAME_HEADER) - 1);
+        pos = ngx_copy(pos, conf->autogenerated.app_root.data,
+            conf->autogenerated.app_root.len);
+        if (conf->autogenerated.environment.data != NULL) {
+            pos = ngx_copy(pos, " (", 2);
+            pos = ngx_copy(pos, conf->autogenerated.environment.data,
+                conf->autogenerated.environment.len);
+            pos = ngx_copy(pos, ")", 1);
+        }
+        pos = ngx_copy(pos, "\r\n", 2);
+    }
+
+    pos = ngx_copy(pos, conf->options_cache.data, conf->options_cache.len);
+
+    if (conf->env_vars_cache.data != NULL) {
+        pos = ngx_copy(pos, ENV_VARS_HEADER, sizeof(ENV_VARS_HEADER) - 1);
+        pos = ngx_copy(pos, conf->env_vars_cache.data, conf->env_vars_cache.len);
+        pos = ngx_copy(pos, "\r\n", 2);
+    }
+
+    pos = ngx_copy(pos, FLAGS_HEADER, sizeof(FLAGS_HEADER) - 1);
+
+    assert((size_t) (pos - buf) == len);
+
+    conf->static_headers_cache.data = buf;
+    conf->static_headers_cache.len = len;
+    return NGX_OK;
+
+    #undef APP_GROUP_NAME_HEADER
+    #undef ENV_VARS_HEADER
+    #undef FLAGS_HEADER
+}
+
 static ngx_int_t
 serialize_loc_conf_to_headers(ngx_conf_t *cf, passenger_loc_conf_t *conf)
 {
@@ -341,7 +430,7 @@ serialize_loc_conf_to_headers(ngx_conf_t *cf, passenger_loc_conf_t *conf)
         free(unencoded_buf);
     }
 
-    return NGX_OK;
+    return build_static_headers_cache(cf, conf);
 }
 
 char *
@@ -1094,6 +1183,11 @@ passenger_enabled(ngx_conf_t *cf, ngx_command_t *cmd, void *conf)
         if (passenger_conf->upstream_config.upstream == NULL) {
             return NGX_CONF_ERROR;
         }
+        /* Cache idle connections to the Passenger core so that requests
+         * don't need to set up a new connection each time.
+         */
+        passenger_conf->upstream_config.upstream->peer.init_upstream =
+            passenger_init_upstream_keepalive;
 
         clcf = ngx_http_conf_get_module_loc_conf(cf, ngx_http_core_module);
         clcf->handler = passenger_content_handler;
@@ -63,6 +63,11 @@ struct passenger_loc_conf_s {
     /** Raw HTTP header data for this location are cached here. */
     ngx_str_t    options_cache;
     ngx_str_t    env_vars_cache;
+    /** The request-independent part of the secure headers (options, env vars,
+     * app group name and the start of the flags line), preformatted at
+     * config-merge time so that it can be appended with a single copy.
+     */
+    ngx_str_t    static_headers_cache;
 };
 
 #ifndef _PASSENGER_NGINX_MODULE_CONF_STRUCT_TYPEDEFS_H_
@@ -31,6 +31,7 @@
 #include "ContentHandler.h"
 #include "StaticContentHandler.h"
 #include "Configuration.h"
+#include "UpstreamKeepalive.h"
 #include "cxx_supportlib/Constants.h"
 #include "cxx_supportlib/FileTools/PathManipCBindings.h"
 
@@ -51,6 +52,9 @@ static ngx_int_t parse_status_line(ngx_http_request_t *r,
     passenger_context_t *context);
 static ngx_int_t process_header(ngx_http_request_t *r);
 static void abort_request(ngx_http_request_t *r);
+static ngx_int_t input_filter_init(void *data);
+static ngx_int_t copy_filter(ngx_event_pipe_t *p, ngx_buf_t *buf);
+static ngx_int_t non_buffered_copy_filter(void *data, ssize_t bytes);
 static void finalize_request(ngx_http_request_t *r, ngx_int_t rc);
 
 
@@ -251,12 +255,12 @@ fix_peer_address(ngx_http_request_t *r) {
     const char                       *core_address;
     unsigned int                      core_address_len;
 
-    if (r->upstream->peer.get != ngx_http_upstream_get_round_robin_peer) {
+    rrp = passenger_get_round_robin_peer_data(r->upstream);
+    if (rrp == NULL) {
         /* This function only supports the round-robin upstream method. */
         return;
     }
 
-    rrp        = r->upstream->peer.data;
     peers      = rrp->peers;
     core_address =
         psg_watchdog_launcher_get_core_address(psg_watchdog_launcher,
@@ -326,6 +330,20 @@ header_is_transfer_encoding(ngx_str_t *key)
         ngx_strncasecmp(key->data + 1, (u_char *) "ransfer-encodin", sizeof("ransfer-encodin") - 1) == 0;
 }
 
+/**
+ * Checks whether the given header is a Connection or Keep-Alive header. These
+ * describe the client's connection to Nginx, not Nginx's connection to the
+ * Passenger core, so they are not forwarded over keep-alive connections.
+ */
+static int
+header_is_connection_specific(ngx_str_t *key)
+{
+    return (key->len == sizeof("connection") - 1 &&
+            ngx_strncasecmp(key->data, (u_char *) "connection", sizeof("connection") - 1) == 0)
+        || (key->len == sizeof("keep-alive") - 1 &&
+            ngx_strncasecmp(key->data, (u_char *) "keep-alive", sizeof("keep-alive") - 1) == 0);
+}
+
 #define SET_NGX_STR(str, the_data) \
     do { \
         (str)->data = (u_char *) the_data; \
@@ -345,6 +363,7 @@ typedef struct {
     ngx_str_t     content_length;
     ngx_str_t     core_password;
     ngx_str_t     remote_port;
+    ngx_flag_t    keepalive;
 } buffer_construction_state;
 
 static ngx_int_t
@@ -449,6 +468,12 @@ prepare_request_buffer_construction(ngx_http_request_t *r, passenger_context_t *
             - state->content_length.data;
     } // else: content_length not used
 
+    /* Upgraded connections can't be reused, so for those we keep telling the
+     * Passenger core to close the connection afterwards.
+     */
+    state->keepalive = passenger_upstream_keepalive_enabled()
+        && r->headers_in.upgrade == NULL;
+
     state->core_password.data = (u_char *) psg_watchdog_launcher_get_core_password(
         psg_watchdog_launcher, &len);
     state->core_password.len  = len;
@@ -528,7 +553,11 @@ construct_request_buffer(ngx_http_request_t *r, passenger_loc_conf_t *slcf,
         total_size += r->args.len + 1;
     }
 
-    PUSH_STATIC_STR(" HTTP/1.1\r\nConnection: close\r\n");
+    if (state->keepalive) {
+        PUSH_STATIC_STR(" HTTP/1.1\r\n");
+    } else {
+        PUSH_STATIC_STR(" HTTP/1.1\r\nConnection: close\r\n");
+    }
 
     part = &r->headers_in.headers.part;
     header = part->elts;
@@ -545,7 +574,8 @@ construct_request_buffer(ngx_http_request_t *r, passenger_loc_conf_t *slcf,
 
         if (ngx_hash_find(&slcf->headers_set_hash, header[i].hash,
                           header[i].lowcase_key, header[i].key.len)
-         || header_is_transfer_encoding(&header[i].key))
+         || header_is_transfer_encoding(&header[i].key)
+         || (state->keepalive && header_is_connection_specific(&header[i].key)))
         {
             continue;
         }
@@ -679,26 +709,22 @@ construct_request_buffer(ngx_http_request_t *r, passenger_loc_conf_t *slcf,
         PUSH_STATIC_STR("\r\n");
     }
 
-    if (slcf->autogenerated.app_group_name.data == NULL) {
+    /* If the app root is configured then the app group name is part of
+     * the static headers cache.
+     */
+    if (slcf->autogenerated.app_group_name.data == NULL
+     && slcf->autogenerated.app_root.data == NULL)
+    {
         PUSH_STATIC_STR("!~PASSENGER_APP_GROUP_NAME: ");
-        if (slcf->autogenerated.app_root.data == NULL) {
-            public_dir_parent.data = (u_char *) psg_extract_dir_name_static(
-                (const char *) context->public_dir.data,
-                context->public_dir.len,
-                &public_dir_parent.len);
-            if (b != NULL) {
-                b->last = ngx_copy(b->last, public_dir_parent.data,
-                    public_dir_parent.len);
-            }
-            total_size += public_dir_parent.len;
-        } else {
-            if (b != NULL) {
-                b->last = ngx_copy(b->last,
-                    slcf->autogenerated.app_root.data,
-                    slcf->autogenerated.app_root.len);
-            }
-            total_size += slcf->autogenerated.app_root.len;
+        public_dir_parent.data = (u_char *) psg_extract_dir_name_static(
+            (const char *) context->public_dir.data,
+            context->public_dir.len,
+            &public_dir_parent.len);
+        if (b != NULL) {
+            b->last = ngx_copy(b->last, public_dir_parent.data,
+                public_dir_parent.len);
         }
+        total_size += public_dir_parent.len;
         if (slcf->autogenerated.environment.data != NULL) {
             if (b != NULL) {
                 b->last = ngx_copy(b->last, " (", 2);
@@ -719,27 +745,19 @@ construct_request_buffer(ngx_http_request_t *r, passenger_loc_conf_t *slcf,
     total_size += state->app_type.len;
     PUSH_STATIC_STR("\r\n");
 
-    if (b != NULL) {
-        b->last = ngx_copy(b->last, slcf->options_cache.data, slcf->options_cache.len);
-    }
-    total_size += slcf->options_cache.len;
-
-    if (slcf->env_vars_cache.data != NULL) {
-        PUSH_STATIC_STR("!~PASSENGER_ENV_VARS: ");
-        if (b != NULL) {
-            b->last = ngx_copy(b->last, slcf->env_vars_cache.data, slcf->env_vars_cache.len);
-        }
-        total_size += slcf->env_vars_cache.len;
-        PUSH_STATIC_STR("\r\n");
-    }
-
-    /* D = Dechunk response
+    /* The options, the environment variables and the start of the
+     * flags header, preformatted by passenger_merge_loc_conf().
+     *
+     * D = Dechunk response
      *     Prevent Nginx from rechunking the response.
      * C = Strip 100 Continue header
      * S = SSL
      */
-
-    PUSH_STATIC_STR("!~FLAGS: DC");
+    if (b != NULL) {
+        b->last = ngx_copy(b->last, slcf->static_headers_cache.data,
+            slcf->static_headers_cache.len);
+    }
+    total_size += slcf->static_headers_cache.len;
     #if (NGX_HTTP_SSL)
         if (r->http_connection != NULL /* happens in sub-requests */
                 && r->http_connection->ssl) {
@@ -1310,6 +1328,143 @@ finalize_request(ngx_http_request_t *r, ngx_int_t rc)
 }
 
 
+/**
+ * Determines the response body length from the response headers, so that the
+ * input filters know when the response is complete and whether the connection
+ * to the Passenger core may be reused afterwards.
+ */
+static ngx_int_t
+input_filter_init(void *data)
+{
+    ngx_http_request_t   *r = data;
+    ngx_http_upstream_t  *u;
+
+    u = r->upstream;
+
+    if (u->headers_in.status_n == NGX_HTTP_NO_CONTENT
+     || u->headers_in.status_n == NGX_HTTP_NOT_MODIFIED
+     || r->method == NGX_HTTP_HEAD
+     || u->headers_in.content_length_n == 0)
+    {
+        u->pipe->length = 0;
+        u->length = 0;
+        u->keepalive = !u->headers_in.connection_close;
+
+    } else if (u->headers_in.content_length_n == -1) {
+        /* Read until the Passenger core closes the connection. */
+        u->pipe->length = -1;
+        u->length = -1;
+
+    } else {
+        u->pipe->length = u->headers_in.content_length_n;
+        u->length = u->headers_in.content_length_n;
+    }
+
+    return NGX_OK;
+}
+
+static ngx_int_t
+copy_filter(ngx_event_pipe_t *p, ngx_buf_t *buf)
+{
+    ngx_buf_t           *b;
+    ngx_chain_t         *cl;
+    ngx_http_request_t  *r;
+
+    if (buf->pos == buf->last) {
+        return NGX_OK;
+    }
+
+    cl = ngx_chain_get_free_buf(p->pool, &p->free);
+    if (cl == NULL) {
+        return NGX_ERROR;
+    }
+
+    b = cl->buf;
+
+    ngx_memcpy(b, buf, sizeof(ngx_buf_t));
+    b->shadow = buf;
+    b->tag = p->tag;
+    b->last_shadow = 1;
+    b->recycled = 1;
+    buf->shadow = b;
+
+    ngx_log_debug1(NGX_LOG_DEBUG_EVENT, p->log, 0, "input buf #%d", b->num);
+
+    if (p->in) {
+        *p->last_in = cl;
+    } else {
+        p->in = cl;
+    }
+    p->last_in = &cl->next;
+
+    if (p->length == -1) {
+        return NGX_OK;
+    }
+
+    p->length -= b->last - b->pos;
+
+    if (p->length == 0) {
+        r = p->input_ctx;
+        p->upstream_done = 1;
+        r->upstream->keepalive = !r->upstream->headers_in.connection_close;
+
+    } else if (p->length < 0) {
+        r = p->input_ctx;
+        p->upstream_done = 1;
+
+        ngx_log_error(NGX_LOG_WARN, r->connection->log, 0,
+                      "Passenger core sent more data than specified in "
+                      "\"Content-Length\" header");
+    }
+
+    return NGX_OK;
+}
+
+static ngx_int_t
+non_buffered_copy_filter(void *data, ssize_t bytes)
+{
+    ngx_http_request_t   *r = data;
+    ngx_buf_t            *b;
+    ngx_chain_t          *cl, **ll;
+    ngx_http_upstream_t  *u;
+
+    u = r->upstream;
+
+    for (cl = u->out_bufs, ll = &u->out_bufs; cl; cl = cl->next) {
+        ll = &cl->next;
+    }
+
+    cl = ngx_chain_get_free_buf(r->pool, &u->free_bufs);
+    if (cl == NULL) {
+        return NGX_ERROR;
+    }
+
+    *ll = cl;
+
+    cl->buf->flush = 1;
+    cl->buf->memory = 1;
+
+    b = &u->buffer;
+
+    cl->buf->pos = b->last;
+    b->last += bytes;
+    cl->buf->last = b->last;
+    cl->buf->tag = u->output.tag;
+
+    if (u->length == -1) {
+        return NGX_OK;
+    }
+
+    u->length -= bytes;
+
+    if (u->length == 0) {
+        u->keepalive = !u->headers_in.connection_close;
+    }
+
+    return NGX_OK;
+}
+
+
 ngx_int_t
 passenger_content_handler(ngx_http_request_t *r)
 {
@@ -1485,9 +1640,16 @@ passenger_content_handler(ngx_http_request_t *r)
         return NGX_HTTP_INTERNAL_SERVER_ERROR;
     }
 
-    u->pipe->input_filter = ngx_event_pipe_copy_input_filter;
+    /* Like the proxy module, we keep track of the response body length so
+     * that connections to the Passenger core can be kept alive.
+     */
+    u->pipe->input_filter = copy_filter;
     u->pipe->input_ctx = r;
 
+    u->input_filter_init = input_filter_init;
+    u->input_filter = non_buffered_copy_filter;
+    u->input_filter_ctx = r;
+
     rc = ngx_http_read_client_request_body(r, ngx_http_upstream_init);
 
     fix_peer_address(r);
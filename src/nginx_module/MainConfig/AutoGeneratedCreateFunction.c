@@ -52,6 +52,7 @@ passenger_create_autogenerated_main_conf(passenger_autogenerated_main_conf_t *co
     conf->data_buffer_dir.data = NULL;
     conf->data_buffer_dir.len  = 0;
     conf->socket_backlog = NGX_CONF_UNSET_UINT;
+    conf->core_keepalive_connections = NGX_CONF_UNSET_UINT;
     conf->core_file_descriptor_ulimit = NGX_CONF_UNSET_UINT;
     conf->disable_security_update_check = NGX_CONF_UNSET;
     conf->security_update_check_proxy.data = NULL;
@@ -103,6 +104,10 @@ passenger_create_autogenerated_main_conf(passenger_autogenerated_main_conf_t *co
     conf->socket_backlog_source_file.len = 0;
     conf->socket_backlog_source_line = 0;
     conf->socket_backlog_explicitly_set = 0;
+    conf->core_keepalive_connections_source_file.data = NULL;
+    conf->core_keepalive_connections_source_file.len = 0;
+    conf->core_keepalive_connections_source_line = 0;
+    conf->core_keepalive_connections_explicitly_set = 0;
     conf->core_file_descriptor_ulimit_source_file.data = NULL;
     conf->core_file_descriptor_ulimit_source_file.len = 0;
     conf->core_file_descriptor_ulimit_source_line = 0;
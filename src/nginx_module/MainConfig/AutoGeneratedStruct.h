@@ -41,6 +41,7 @@
 typedef struct {
     ngx_flag_t abort_on_startup_error;
     ngx_uint_t core_file_descriptor_ulimit;
+    ngx_uint_t core_keepalive_connections;
     ngx_array_t *ctl;
     ngx_flag_t disable_security_update_check;
     ngx_uint_t log_level;
@@ -64,6 +65,7 @@ typedef struct {
 
     ngx_str_t abort_on_startup_error_source_file;
     ngx_str_t core_file_descriptor_ulimit_source_file;
+    ngx_str_t core_keepalive_connections_source_file;
     ngx_str_t ctl_source_file;
     ngx_str_t data_buffer_dir_source_file;
     ngx_str_t default_group_source_file;
@@ -87,6 +89,7 @@ typedef struct {
 
     ngx_uint_t abort_on_startup_error_source_line;
     ngx_uint_t core_file_descriptor_ulimit_source_line;
+    ngx_uint_t core_keepalive_connections_source_line;
     ngx_uint_t ctl_source_line;
     ngx_uint_t data_buffer_dir_source_line;
     ngx_uint_t default_group_source_line;
@@ -110,6 +113,7 @@ typedef struct {
 
     ngx_int_t abort_on_startup_error_explicitly_set;
     ngx_int_t core_file_descriptor_ulimit_explicitly_set;
+    ngx_int_t core_keepalive_connections_explicitly_set;
     ngx_int_t ctl_explicitly_set;
     ngx_int_t data_buffer_dir_explicitly_set;
     ngx_int_t default_group_explicitly_set;
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) Maxim Dounin
+ * Copyright (C) Nginx, Inc.
+ * Copyright (c) 2017 Phusion Holding B.V.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+
+#include "UpstreamKeepalive.h"
+#include "ngx_http_passenger_module.h"
+#include "Configuration.h"
+#include "cxx_supportlib/Constants.h"
+
+
+typedef struct {
+    ngx_uint_t                      max_cached;
+    ngx_queue_t                     cache;
+    ngx_queue_t                     free;
+    ngx_http_upstream_init_peer_pt  original_init_peer;
+} passenger_keepalive_conf_t;
+
+typedef struct {
+    passenger_keepalive_conf_t     *conf;
+    ngx_queue_t                     queue;
+    ngx_connection_t               *connection;
+    socklen_t                       socklen;
+    u_char                          sockaddr[NGX_SOCKADDRLEN];
+} passenger_keepalive_cache_t;
+
+typedef struct {
+    passenger_keepalive_conf_t     *conf;
+    ngx_http_upstream_t            *upstream;
+    void                           *data;
+    ngx_event_get_peer_pt           original_get_peer;
+    ngx_event_free_peer_pt          original_free_peer;
+} passenger_keepalive_peer_data_t;
+
+
+/* There is only one Passenger core upstream, and every worker process gets its
+ * own copy of this structure after forking.
+ */
+static passenger_keepalive_conf_t keepalive_conf;
+
+static ngx_int_t init_keepalive_peer(ngx_http_request_t *r,
+    ngx_http_upstream_srv_conf_t *us);
+static ngx_int_t get_keepalive_peer(ngx_peer_connection_t *pc, void *data);
+static void free_keepalive_peer(ngx_peer_connection_t *pc, void *data,
+    ngx_uint_t state);
+static void keepalive_dummy_handler(ngx_event_t *ev);
+static void keepalive_close_handler(ngx_event_t *ev);
+static void keepalive_close(ngx_connection_t *c);
+
+
+ngx_int_t
+passenger_init_upstream_keepalive(ngx_conf_t *cf, ngx_http_upstream_srv_conf_t *us)
+{
+    passenger_main_conf_t        *mcf;
+    passenger_keepalive_cache_t  *cached;
+    ngx_uint_t                    i;
+
+    if (ngx_http_upstream_init_round_robin(cf, us) != NGX_OK) {
+        return NGX_ERROR;
+    }
+
+    /* The upstream module initializes its main configuration before ours,
+     * so the default value hasn't been applied yet.
+     */
+    mcf = ngx_http_conf_get_module_main_conf(cf, ngx_http_passenger_module);
+    keepalive_conf.max_cached = mcf->autogenerated.core_keepalive_connections;
+    if (keepalive_conf.max_cached == NGX_CONF_UNSET_UINT) {
+        keepalive_conf.max_cached = DEFAULT_NGINX_CORE_KEEPALIVE_CONNECTIONS;
+    }
+    if (keepalive_conf.max_cached == 0) {
+        return NGX_OK;
+    }
+
+    keepalive_conf.original_init_peer = us->peer.init;
+    us->peer.init = init_keepalive_peer;
+
+    cached = ngx_pcalloc(cf->pool,
+        sizeof(passenger_keepalive_cache_t) * keepalive_conf.max_cached);
+    if (cached == NULL) {
+        return NGX_ERROR;
+    }
+
+    ngx_queue_init(&keepalive_conf.cache);
+    ngx_queue_init(&keepalive_conf.free);
+
+    for (i = 0; i < keepalive_conf.max_cached; i++) {
+        ngx_queue_insert_head(&keepalive_conf.free, &cached[i].queue);
+        cached[i].conf = &keepalive_conf;
+    }
+
+    return NGX_OK;
+}
+
+ngx_http_upstream_rr_peer_data_t *
+passenger_get_round_robin_peer_data(ngx_http_upstream_t *u)
+{
+    passenger_keepalive_peer_data_t *kp;
+
+    if (u->peer.get == get_keepalive_peer) {
+        kp = u->peer.data;
+        if (kp->original_get_peer != ngx_http_upstream_get_round_robin_peer) {
+            return NULL;
+        }
+        return kp->data;
+    } else if (u->peer.get == ngx_http_upstream_get_round_robin_peer) {
+        return u->peer.data;
+    } else {
+        return NULL;
+    }
+}
+
+ngx_flag_t
+passenger_upstream_keepalive_enabled(void)
+{
+    return keepalive_conf.max_cached > 0
+        && keepalive_conf.original_init_peer != NULL;
+}
+
+static ngx_int_t
+init_keepalive_peer(ngx_http_request_t *r, ngx_http_upstream_srv_conf_t *us)
+{
+    passenger_keepalive_peer_data_t *kp;
+
+    kp = ngx_palloc(r->pool, sizeof(passenger_keepalive_peer_data_t));
+    if (kp == NULL) {
+        return NGX_ERROR;
+    }
+
+    if (keepalive_conf.original_init_peer(r, us) != NGX_OK) {
+        return NGX_ERROR;
+    }
+
+    kp->conf = &keepalive_conf;
+    kp->upstream = r->upstream;
+    kp->data = r->upstream->peer.data;
+    kp->original_get_peer = r->upstream->peer.get;
+    kp->original_free_peer = r->upstream->peer.free;
+
+    r->upstream->peer.data = kp;
+    r->upstream->peer.get = get_keepalive_peer;
+    r->upstream->peer.free = free_keepalive_peer;
+
+    return NGX_OK;
+}
+
+static ngx_int_t
+get_keepalive_peer(ngx_peer_connection_t *pc, void *data)
+{
+    passenger_keepalive_peer_data_t *kp = data;
+    passenger_keepalive_cache_t     *item;
+    ngx_int_t                        rc;
+    ngx_queue_t                     *q, *cache;
+    ngx_connection_t                *c;
+
+    /* Ask the balancer first so that pc->sockaddr is filled in. */
+    rc = kp->original_get_peer(pc, kp->data);
+    if (rc != NGX_OK) {
+        return rc;
+    }
+
+    cache = &kp->conf->cache;
+
+    for (q = ngx_queue_head(cache);
+         q != ngx_queue_sentinel(cache);
+         q = ngx_queue_next(q))
+    {
+        item = ngx_queue_data(q, passenger_keepalive_cache_t, queue);
+        c = item->connection;
+
+        if (ngx_memn2cmp((u_char *) &item->sockaddr, (u_char *) pc->sockaddr,
+                         item->socklen, pc->socklen)
+            == 0)
+        {
+            ngx_queue_remove(q);
+            ngx_queue_insert_head(&kp->conf->free, q);
+
+            ngx_log_debug1(NGX_LOG_DEBUG_HTTP, pc->log, 0,
+                           "get keepalive Passenger core connection %p", c);
+
+            c->idle = 0;
+            c->sent = 0;
+            c->log = pc->log;
+            c->read->log = pc->log;
+            c->write->log = pc->log;
+            c->pool->log = pc->log;
+
+            pc->connection = c;
+            pc->cached = 1;
+
+            return NGX_DONE;
+        }
+    }
+
+    return NGX_OK;
+}
+
+static void
+free_keepalive_peer(ngx_peer_connection_t *pc, void *data, ngx_uint_t state)
+{
+    passenger_keepalive_peer_data_t *kp = data;
+    passenger_keepalive_cache_t     *item;
+    ngx_queue_t                     *q;
+    ngx_connection_t                *c;
+    ngx_http_upstream_t             *u;
+
+    u = kp->upstream;
+    c = pc->connection;
+
+    /* Only cache connections on which the Passenger core has fully sent a
+     * response that it is willing to keep alive. u->keepalive is set by the
+     * input filters in ContentHandler.c.
+     */
+    if (state & NGX_PEER_FAILED
+        || c == NULL
+        || c->read->eof
+        || c->read->error
+        || c->read->timedout
+        || c->write->error
+        || c->write->timedout
+        || !u->keepalive
+        || ngx_terminate
+        || ngx_exiting)
+    {
+        goto invalid;
+    }
+
+    if (ngx_handle_read_event(c->read, 0) != NGX_OK) {
+        goto invalid;
+    }
+
+    if (ngx_queue_empty(&kp->conf->free)) {
+        q = ngx_queue_last(&kp->conf->cache);
+        ngx_queue_remove(q);
+
+        item = ngx_queue_data(q, passenger_keepalive_cache_t, queue);
+        keepalive_close(item->connection);
+
+    } else {
+        q = ngx_queue_head(&kp->conf->free);
+        ngx_queue_remove(q);
+
+        item = ngx_queue_data(q, passenger_keepalive_cache_t, queue);
+    }
+
+    ngx_log_debug1(NGX_LOG_DEBUG_HTTP, pc->log, 0,
+                   "free keepalive Passenger core connection %p", c);
+
+    ngx_queue_insert_head(&kp->conf->cache, q);
+    item->connection = c;
+    pc->connection = NULL;
+
+    if (c->read->timer_set) {
+        ngx_del_timer(c->read);
+    }
+    if (c->write->timer_set) {
+        ngx_del_timer(c->write);
+    }
+
+    c->write->handler = keepalive_dummy_handler;
+    c->read->handler = keepalive_close_handler;
+
+    c->data = item;
+    c->idle = 1;
+    c->log = ngx_cycle->log;
+    c->read->log = ngx_cycle->log;
+    c->write->log = ngx_cycle->log;
+    c->pool->log = ngx_cycle->log;
+
+    item->socklen = pc->socklen;
+    ngx_memcpy(&item->sockaddr, pc->sockaddr, pc->socklen);
+
+    if (c->read->ready) {
+        keepalive_close_handler(c->read);
+    }
+
+invalid:
+
+    kp->original_free_peer(pc, kp->data, state);
+}
+
+static void
+keepalive_dummy_handler(ngx_event_t *ev)
+{
+    ngx_log_debug0(NGX_LOG_DEBUG_HTTP, ev->log, 0,
+                   "keepalive Passenger core connection dummy handler");
+}
+
+/**
+ * Called when an idle cached connection becomes readable. The Passenger core
+ * never sends anything unsolicited, so this means that it closed the connection
+ * (e.g. because the client keep-alive timeout expired or because it is shutting
+ * down).
+ */
+static void
+keepalive_close_handler(ngx_event_t *ev)
+{
+    passenger_keepalive_conf_t  *conf;
+    passenger_keepalive_cache_t *item;
+    int                          n;
+    char                         buf[1];
+    ngx_connection_t            *c;
+
+    c = ev->data;
+
+    if (c->close) {
+        goto close;
+    }
+
+    n = recv(c->fd, buf, 1, MSG_PEEK);
+
+    if (n == -1 && ngx_socket_errno == NGX_EAGAIN) {
+        ev->ready = 0;
+
+        if (ngx_handle_read_event(c->read, 0) != NGX_OK) {
+            goto close;
+        }
+
+        return;
+    }
+
+close:
+
+    item = c->data;
+    conf = item->conf;
+
+    keepalive_close(c);
+
+    ngx_queue_remove(&item->queue);
+    ngx_queue_insert_head(&conf->free, &item->queue);
+}
+
+static void
+keepalive_close(ngx_connection_t *c)
+{
+    ngx_destroy_pool(c->pool);
+    ngx_close_connection(c);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) Maxim Dounin
+ * Copyright (C) Nginx, Inc.
+ * Copyright (c) 2017 Phusion Holding B.V.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+
+#ifndef _PASSENGER_NGINX_UPSTREAM_KEEPALIVE_H_
+#define _PASSENGER_NGINX_UPSTREAM_KEEPALIVE_H_
+
+#include <ngx_config.h>
+#include <ngx_core.h>
+#include <ngx_http.h>
+
+/**
+ * Keeps a per-worker cache of idle connections to the Passenger core, so that
+ * subsequent requests don't have to pay for a new connection each time.
+ * Installed as the init_upstream handler of the Passenger core upstream. It wraps
+ * the round-robin balancer in the same way the ngx_http_upstream_keepalive module
+ * does; a connection is only returned to the cache if the response set
+ * u->keepalive.
+ */
+ngx_int_t passenger_init_upstream_keepalive(ngx_conf_t *cf,
+                                            ngx_http_upstream_srv_conf_t *us);
+
+/**
+ * Returns the round-robin peer data of the given upstream, regardless of
+ * whether the keepalive cache is in use.
+ */
+ngx_http_upstream_rr_peer_data_t *passenger_get_round_robin_peer_data(
+    ngx_http_upstream_t *u);
+
+/**
+ * Whether requests are sent to the Passenger core over cached keep-alive
+ * connections.
+ */
+ngx_flag_t passenger_upstream_keepalive_enabled(void);
+
+#endif /* _PASSENGER_NGINX_UPSTREAM_KEEPALIVE_H_ */
@@ -506,7 +506,9 @@ pre_config_init(ngx_conf_t *cf)
     pp_placeholder_upstream_address.data = (u_char *) "unix:/passenger_core";
     pp_placeholder_upstream_address.len  = sizeof("unix:/passenger_core") - 1;
     pp_stat_cache = pp_cached_file_stat_new(1024);
+    pp_cached_file_stat_enable_inotify(pp_stat_cache);
     pp_app_type_detector = pp_app_type_detector_new(DEFAULT_STAT_THROTTLE_RATE);
+    pp_app_type_detector_enable_inotify(pp_app_type_detector);
     psg_watchdog_launcher = psg_watchdog_launcher_new(IM_NGINX, &error_message);
 
     if (psg_watchdog_launcher == NULL) {
@@ -140,6 +140,15 @@
     :default_expr => 'DEFAULT_SOCKET_BACKLOG',
     :desc      => "The #{PROGRAM_NAME} socket backlog."
   },
+  {
+    :name      => 'PassengerCoreKeepaliveConnections',
+    :type      => :integer,
+    :context   => :global,
+    :min_value => 0,
+    :default   => DEFAULT_APACHE_CORE_KEEPALIVE_CONNECTIONS,
+    :default_expr => 'DEFAULT_APACHE_CORE_KEEPALIVE_CONNECTIONS',
+    :desc      => "The maximum number of idle connections to the #{PROGRAM_NAME} core that each Apache process keeps open."
+  },
   {
     :name      => 'PassengerFileDescriptorLogFile',
     :type      => :string,
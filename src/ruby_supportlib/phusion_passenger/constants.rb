@@ -71,6 +71,12 @@ module SharedConstants
     DEFAULT_ANALYTICS_LOG_PERMISSIONS = "u=rwx,g=rx,o=rx"
     DEFAULT_HTTP_SERVER_LISTEN_ADDRESS = "tcp://127.0.0.1:3000"
     DEFAULT_LVE_MIN_UID = 500
+    # Maximum number of idle keep-alive connections that each Nginx worker
+    # keeps open to the Passenger core.
+    DEFAULT_NGINX_CORE_KEEPALIVE_CONNECTIONS = 32
+    # Maximum number of idle keep-alive connections that each Apache process
+    # keeps open to the Passenger core.
+    DEFAULT_APACHE_CORE_KEEPALIVE_CONNECTIONS = 32
 
     # Size limits
     MESSAGE_SERVER_MAX_USERNAME_SIZE = 100
@@ -80,16 +86,45 @@ module SharedConstants
     # also introduce context switching and smaller transfer writes. The size is picked
     # to balance this out.
     DEFAULT_MBUF_CHUNK_SIZE = 1024 * 4
+    # Free mbuf blocks that stay unused for this many seconds have their
+    # memory returned to the OS.
+    DEFAULT_MBUF_IDLE_RELEASE_DELAY = 60
     # Affects input and output buffering (between app and client). Threshold is picked
     # such that it fits most output (i.e. html page size, not assets), and allows for
     # high concurrency with low mem overhead. On the upload side there is a penalty
     # but there's no real average upload size anyway so we choose mem safety instead.
     DEFAULT_FILE_BUFFERED_CHANNEL_THRESHOLD = 1024 * 128
+    # Per server, this many bytes beyond the threshold are buffered in anonymous
+    # memory before FileBufferedChannels fall back to temp files on disk.
+    DEFAULT_FILE_BUFFERED_CHANNEL_MEMORY_SPILL_LIMIT = 1024 * 1024 * 32
+    # Client timeouts in seconds: how long an idle keep-alive connection is kept
+    # open, how long a client may take to send the request headers, and how long
+    # a client may stay silent while sending the request body.
+    DEFAULT_CLIENT_KEEPALIVE_TIMEOUT = 75
+    DEFAULT_CLIENT_HEADER_TIMEOUT = 60
+    DEFAULT_CLIENT_BODY_TIMEOUT = 60
     SERVER_KIT_MAX_SERVER_ENDPOINTS = 4
 
     # Time limits
     PROCESS_SHUTDOWN_TIMEOUT = 60 # In seconds
     PROCESS_SHUTDOWN_TIMEOUT_DISPLAY = "1 minute"
+    # Grace period for processes that exceeded max_request_time, so that
+    # they can print backtraces before being killed.
+    HUNG_PROCESS_SHUTDOWN_TIMEOUT = 2 # In seconds
+    # Minimum time between two processes in the same group being restarted
+    # because they exceeded memory_limit.
+    MEMORY_LIMIT_RESTART_INTERVAL = 30 # In seconds
+    # Maximum number of processes per group that are being replaced at the
+    # same time because they reached max_requests.
+    MAX_CONCURRENT_RECYCLES = 1
+    # Initial and maximum per-process concurrency limit in adaptive concurrency
+    # mode, for processes that do not advertise a concurrency of their own.
+    ADAPTIVE_CONCURRENCY_INITIAL_LIMIT = 8
+    ADAPTIVE_CONCURRENCY_MAX_LIMIT = 256
+    # How long requests must have been waiting for longer than
+    # request_queue_target_delay before the request queue is considered
+    # overloaded (CoDel's interval).
+    REQUEST_QUEUE_OVERLOAD_INTERVAL = 1000 # In milliseconds
 
     # Versions
     PASSENGER_VERSION = PhusionPassenger::VERSION_STRING
@@ -168,6 +168,14 @@
     :context  => [:main],
     :struct   => "NGX_HTTP_MAIN_CONF_OFFSET"
   },
+  {
+    :name     => 'passenger_core_keepalive_connections',
+    :scope    => :global,
+    :type     => :uinteger,
+    :default  => DEFAULT_NGINX_CORE_KEEPALIVE_CONNECTIONS,
+    :context  => [:main],
+    :struct   => 'NGX_HTTP_MAIN_CONF_OFFSET'
+  },
   {
     :name     => 'passenger_core_file_descriptor_ulimit',
     :scope    => :global,
@@ -328,6 +328,16 @@ module Standalone
         :desc      => "Minimum number of processes per\n" \
                       'application. Default: 1'
       },
+      {
+        :name      => :target_utilization,
+        :type      => :integer,
+        :type_desc => 'PERCENT',
+        :min       => 0,
+        :desc      => "Spawn processes ahead of demand, based on\n" \
+                      "the request rate trend, so that they are\n" \
+                      "busy about PERCENT of the time.\n" \
+                      "Default: 0 (disabled)"
+      },
       {
         :name      => :pool_idle_time,
         :type      => :integer,
@@ -350,6 +360,13 @@ module Standalone
                       "application process can handle the given\n" \
                       "number of concurrent requests per process"
       },
+      {
+        :name      => :adaptive_concurrency,
+        :type      => :boolean,
+        :desc      => "Adjust the number of concurrent requests per\n" \
+                      "process based on response latency, up to the\n" \
+                      "advertised or forced concurrency"
+      },
       {
         :name      => :start_timeout,
         :type      => :integer,
@@ -377,7 +394,7 @@ module Standalone
         :type      => :integer,
         :type_desc => 'MB',
         :desc      => "Restart application processes that go over\n" \
-                      "the given memory limit (Enterprise only)"
+                      "the given memory limit"
       },
       {
         :name      => :rolling_restarts,
@@ -401,13 +418,22 @@ module Standalone
         :desc      => "Restart application processes that have handled\n" \
                       "the specified maximum number of requests"
       },
+      {
+        :name      => :max_requests_jitter,
+        :type      => :integer,
+        :min       => 0,
+        :desc      => "Add a random number of requests between 0 and\n" \
+                      "this value to each process's max_requests, so\n" \
+                      "that processes are not restarted all at once.\n" \
+                      "Default: 0"
+      },
       {
         :name      => :max_request_time,
         :type      => :integer,
         :type_desc => 'SECONDS',
         :min       => 0,
-        :desc      => "Abort requests that take too much time\n" \
-                      '(Enterprise only)'
+        :desc      => "Abort requests that take too much time, and\n" \
+                      'restart the processes that handled them'
       },
       {
         :name      => :max_request_queue_size,
@@ -415,6 +441,21 @@ module Standalone
         :min       => 0,
         :desc      => "Specify request queue size. Default: #{DEFAULT_MAX_REQUEST_QUEUE_SIZE}"
       },
+      {
+        :name      => :request_queue_target_delay,
+        :type      => :integer,
+        :type_desc => 'MSEC',
+        :min       => 0,
+        :desc      => "Fail queued requests that waited longer than\n" \
+                      "MSEC once the request queue has been above that\n" \
+                      "delay for a while. Default: 0 (disabled)"
+      },
+      {
+        :name      => :request_queue_lifo,
+        :type      => :boolean,
+        :desc      => "Serve the newest queued requests first while\n" \
+                      "the request queue is overloaded"
+      },
       {
         :name      => :sticky_sessions,
         :type      => :boolean,
@@ -155,17 +155,22 @@ def build_daemon_controller_options
             command << " --no-abort-websockets-on-process-shutdown"
           end
           add_param(command, :force_max_concurrent_requests_per_process, "--force-max-concurrent-requests-per-process")
+          add_flag_param(command, :adaptive_concurrency, "--adaptive-concurrency")
           add_flag_param(command, :load_shell_envvars, "--load-shell-envvars")
           add_param(command, :max_pool_size, "--max-pool-size")
           add_param(command, :min_instances, "--min-instances")
+          add_param(command, :target_utilization, "--target-utilization")
           add_param(command, :pool_idle_time, "--pool-idle-time")
           add_param(command, :max_preloader_idle_time, "--max-preloader-idle-time")
           add_param(command, :max_request_queue_size, "--max-request-queue-size")
+          add_param(command, :request_queue_target_delay, "--request-queue-target-delay")
+          add_flag_param(command, :request_queue_lifo, "--request-queue-lifo")
           add_enterprise_param(command, :concurrency_model, "--concurrency-model")
           add_enterprise_param(command, :thread_count, "--app-thread-count")
           add_param(command, :max_requests, "--max-requests")
-          add_enterprise_param(command, :max_request_time, "--max-request-time")
-          add_enterprise_param(command, :memory_limit, "--memory-limit")
+          add_param(command, :max_requests_jitter, "--max-requests-jitter")
+          add_param(command, :max_request_time, "--max-request-time")
+          add_param(command, :memory_limit, "--memory-limit")
           add_enterprise_flag_param(command, :rolling_restarts, "--rolling-restarts")
           add_enterprise_flag_param(command, :resist_deployment_errors, "--resist-deployment-errors")
           add_enterprise_flag_param(command, :debugger, "--debugger")
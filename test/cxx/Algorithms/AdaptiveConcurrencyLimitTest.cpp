@@ -0,0 +1,79 @@
+#include <TestSupport.h>
+#include <Algorithms/AdaptiveConcurrencyLimit.h>
+
+using namespace Passenger;
+using namespace std;
+
+namespace tut {
+	struct Algorithms_AdaptiveConcurrencyLimitTest {
+		AdaptiveConcurrencyLimit limit;
+
+		/** Simulates requests that are all in flight up to the current limit. */
+		void recordLoaded(unsigned long long latency, unsigned int count) {
+			for (unsigned int i = 0; i < count; i++) {
+				limit.update(latency, limit.get() - 1);
+			}
+		}
+	};
+
+	DEFINE_TEST_GROUP(Algorithms_AdaptiveConcurrencyLimitTest);
+
+	TEST_METHOD(1) {
+		set_test_name("A default constructed limit is disabled");
+		ensure(!limit.enabled());
+		ensure_equals(limit.update(1000, 0), 0u);
+		ensure_equals(limit.get(), 0u);
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("The limit grows while latency is stable and the limit is being used,"
+			" but never beyond the maximum");
+		limit.reset(4, 16);
+		recordLoaded(1000, 20);
+		unsigned int grown = limit.get();
+		ensure("(1)", grown > 4);
+		recordLoaded(1000, 1000);
+		ensure_equals("(2)", limit.get(), 16u);
+	}
+
+	TEST_METHOD(3) {
+		set_test_name("The limit does not grow while it is not being used");
+		limit.reset(8, 16);
+		for (unsigned int i = 0; i < 1000; i++) {
+			limit.update(1000, 0);
+		}
+		ensure_equals(limit.get(), 8u);
+	}
+
+	TEST_METHOD(4) {
+		set_test_name("The limit decreases multiplicatively when latency rises,"
+			" at most once per `limit` requests");
+		limit.reset(16, 16);
+		recordLoaded(1000, 200);
+		ensure_equals("(1)", limit.get(), 16u);
+
+		recordLoaded(10000, 5);
+		ensure_equals("(2)", limit.get(), 12u);
+		recordLoaded(10000, 11);
+		ensure_equals("(3)", limit.get(), 12u);
+		recordLoaded(10000, 1);
+		ensure_equals("(4)", limit.get(), 10u);
+	}
+
+	TEST_METHOD(5) {
+		set_test_name("The limit never decreases below the minimum");
+		limit.reset(4, 4, 2);
+		recordLoaded(1000, 200);
+		recordLoaded(10000, 20);
+		ensure_equals(limit.get(), 2u);
+	}
+
+	TEST_METHOD(6) {
+		set_test_name("A stable mix of fast and slow requests does not reduce the limit");
+		limit.reset(16, 16);
+		for (unsigned int i = 0; i < 5000; i++) {
+			limit.update((i % 10 == 0) ? 50000 : 1000, 15);
+		}
+		ensure(limit.get() >= 12);
+	}
+}
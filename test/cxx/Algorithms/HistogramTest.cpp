@@ -0,0 +1,69 @@
+#include <TestSupport.h>
+#include <Algorithms/Histogram.h>
+
+using namespace Passenger;
+using namespace std;
+
+namespace tut {
+	struct Algorithms_HistogramTest {
+		Histogram histogram;
+	};
+
+	DEFINE_TEST_GROUP(Algorithms_HistogramTest);
+
+	TEST_METHOD(1) {
+		set_test_name("Small values are counted exactly");
+		for (unsigned int i = 0; i < Histogram::SUB_BUCKET_COUNT; i++) {
+			ensure_equals(Histogram::getBucketIndex(i), i);
+			ensure_equals(Histogram::getBucketUpperBound(i), (boost::uint64_t) i);
+		}
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("Every value is counted in a bucket that contains it,"
+			" and bucket widths are at most 1/SUB_BUCKET_COUNT of their values");
+		boost::uint64_t values[] = { 8, 9, 15, 16, 17, 100, 1000, 123456,
+			1000000, 60000000, 3600000000ull };
+		for (unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+			unsigned int index = Histogram::getBucketIndex(values[i]);
+			boost::uint64_t upper = Histogram::getBucketUpperBound(index);
+			boost::uint64_t lower = Histogram::getBucketUpperBound(index - 1) + 1;
+			ensure("(" + toString(values[i]) + " <= upper)", values[i] <= upper);
+			ensure("(" + toString(values[i]) + " >= lower)", values[i] >= lower);
+			ensure("(" + toString(values[i]) + " width)",
+				upper - lower + 1 <= std::max<boost::uint64_t>(1,
+					values[i] / Histogram::SUB_BUCKET_COUNT));
+		}
+		ensure_equals(Histogram::getBucketIndex((boost::uint64_t) -1),
+			Histogram::BUCKET_COUNT - 1);
+	}
+
+	TEST_METHOD(3) {
+		set_test_name("It keeps track of the count, sum, maximum and percentiles");
+		for (unsigned int i = 1; i <= 1000; i++) {
+			histogram.record(i * 1000);
+		}
+		ensure_equals("(1)", histogram.getCount(), 1000u);
+		ensure_equals("(2)", histogram.getSum(), 500500000u);
+		ensure_equals("(3)", histogram.getMax(), 1000000u);
+		ensure("(4)", histogram.getPercentile(50) >= 500000);
+		ensure("(5)", histogram.getPercentile(50) <= 500000 * 9 / 8);
+		ensure("(6)", histogram.getPercentile(99) >= 990000);
+		ensure_equals("(7)", histogram.getPercentile(100), 1000000u);
+		ensure_equals("(8)", histogram.countAtMost(0), 0u);
+		ensure_equals("(9)", histogram.countAtMost(2000000), 1000u);
+	}
+
+	TEST_METHOD(4) {
+		set_test_name("merge() adds up two histograms");
+		Histogram other;
+		histogram.record(10);
+		histogram.record(20);
+		other.record(30, 2);
+		histogram.merge(other);
+		ensure_equals("(1)", histogram.getCount(), 4u);
+		ensure_equals("(2)", histogram.getSum(), 90u);
+		ensure_equals("(3)", histogram.getMax(), 30u);
+		ensure_equals("(4)", histogram.countAtMost(20), 2u);
+	}
+}
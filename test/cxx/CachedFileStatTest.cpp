@@ -1,6 +1,8 @@
 #include "TestSupport.h"
 #include "Utils/CachedFileStat.hpp"
 #include "Utils/SystemTime.h"
+#include "FileTools/FileManip.h"
+#include "FileTools/PathManip.h"
 #include <sys/types.h>
 #include <utime.h>
 
@@ -17,6 +19,13 @@ namespace tut {
 			unlink("test2.txt");
 			unlink("test3.txt");
 			unlink("test4.txt");
+			removeDirTree("tmp.cstat");
+		}
+
+		bool watched(CachedFileStat &stat, const string &filename) {
+			CachedFileStat::EntryList::iterator it =
+				stat.cache.get(filename, stat.entries.end());
+			return it != stat.entries.end() && (*it)->watched;
 		}
 	};
 	
@@ -399,4 +408,121 @@ namespace tut {
 		ensure("(4)", stat.knows("test4.txt"));
 		ensure("(5)", stat.knows("test5.txt"));
 	}
+
+	
+	/************ Tests involving inotify ************/
+	
+	#ifdef __linux__
+		TEST_METHOD(30) {
+			// In inotify mode, unchanged files are served from the cache
+			// and changes are picked up before the throttle rate expires.
+			string filename = absolutizePath("test.txt");
+			SystemTime::force(5);
+			CachedFileStat stat(2);
+			stat.enableInotify();
+			touch("test.txt", 1);
+			
+			ensure_equals("1st stat succeeded",
+				stat.stat(filename, &buf, 10),
+				0);
+			ensure_equals(buf.st_mtime, (time_t) 1);
+			ensure("The file is watched", watched(stat, filename));
+			
+			ensure_equals("2nd stat succeeded",
+				stat.stat(filename, &buf, 10),
+				0);
+			ensure_equals(buf.st_mtime, (time_t) 1);
+			
+			touch("test.txt", 1000);
+			ensure_equals("3rd stat succeeded",
+				stat.stat(filename, &buf, 10),
+				0);
+			ensure_equals("The change is picked up",
+				buf.st_mtime,
+				(time_t) 1000);
+		}
+		
+		TEST_METHOD(31) {
+			// In inotify mode, the creation and removal of a file
+			// are picked up immediately.
+			string filename = absolutizePath("test.txt");
+			SystemTime::force(5);
+			CachedFileStat stat(2);
+			stat.enableInotify();
+			
+			ensure_equals("1st stat failed",
+				stat.stat(filename, &buf, 10),
+				-1);
+			ensure_equals("It sets errno appropriately", errno, ENOENT);
+			ensure("The nonexistant file is watched", watched(stat, filename));
+			
+			touch("test.txt", 1000);
+			ensure_equals("2nd stat succeeded",
+				stat.stat(filename, &buf, 10),
+				0);
+			ensure_equals(buf.st_mtime, (time_t) 1000);
+			
+			unlink("test.txt");
+			ensure_equals("3rd stat failed",
+				stat.stat(filename, &buf, 10),
+				-1);
+			ensure_equals("It sets errno appropriately", errno, ENOENT);
+		}
+		
+		TEST_METHOD(32) {
+			// In inotify mode, replacing a symlink to a parent directory
+			// is picked up, and the new directory is watched from then on.
+			string filename = absolutizePath("tmp.cstat/current/test.txt");
+			SystemTime::force(5);
+			CachedFileStat stat(2);
+			stat.enableInotify();
+			makeDirTree("tmp.cstat/a");
+			makeDirTree("tmp.cstat/b");
+			touch("tmp.cstat/a/test.txt", 1);
+			touch("tmp.cstat/b/test.txt", 2);
+			symlink("a", "tmp.cstat/current");
+			
+			ensure_equals("1st stat succeeded",
+				stat.stat(filename, &buf, 10),
+				0);
+			ensure_equals(buf.st_mtime, (time_t) 1);
+			
+			symlink("b", "tmp.cstat/current.new");
+			rename("tmp.cstat/current.new", "tmp.cstat/current");
+			ensure_equals("2nd stat succeeded",
+				stat.stat(filename, &buf, 10),
+				0);
+			ensure_equals("The new symlink target is used",
+				buf.st_mtime,
+				(time_t) 2);
+			
+			touch("tmp.cstat/b/test.txt", 3);
+			ensure_equals("3rd stat succeeded",
+				stat.stat(filename, &buf, 10),
+				0);
+			ensure_equals("The new symlink target is watched",
+				buf.st_mtime,
+				(time_t) 3);
+		}
+		
+		TEST_METHOD(33) {
+			// In inotify mode, relative paths are throttled as usual.
+			SystemTime::force(5);
+			CachedFileStat stat(2);
+			stat.enableInotify();
+			touch("test.txt", 1);
+			
+			ensure_equals("1st stat succeeded",
+				stat.stat("test.txt", &buf, 1),
+				0);
+			ensure("The file is not watched", !watched(stat, "test.txt"));
+			touch("test.txt", 1000);
+			ensure_equals("2nd stat succeeded",
+				stat.stat("test.txt", &buf, 1),
+				0);
+			ensure_equals("Cached value was used",
+				buf.st_mtime,
+				(time_t) 1);
+		}
+	#endif
 }
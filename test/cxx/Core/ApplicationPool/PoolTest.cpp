@@ -2024,6 +2024,180 @@ namespace tut {
 		currentSession.reset();
 	}
 
+	TEST_METHOD(80) {
+		// A process is detached and replaced when one of its requests
+		// exceeds maxRequestTime.
+		Options options = createOptions();
+		options.maxRequestTime = 1;
+		options.minProcesses = 1;
+		pool->setMax(1);
+
+		SessionPtr session = pool->get(options, &ticket);
+		pid_t origPid = session->getPid();
+		session->reportRequestTimeout(false);
+		ProcessPtr process = session->getProcess()->shared_from_this();
+		ensure("(1)", process->hung);
+		ensure_equals("(2)", process->enabled, Process::DETACHED);
+		session->close(false);
+		session.reset();
+		process.reset();
+
+		GroupPtr group = pool->groups.lookupCopy("stub/rack");
+		ensure_equals("(3)", group->requestTimeouts, 1u);
+		EVENTUALLY(5,
+			LockGuard l(pool->syncher);
+			result = group->enabledCount == 1
+				&& group->detachedProcesses.empty()
+				&& group->enabledProcesses[0]->getPid() != origPid;
+		);
+	}
+
+	TEST_METHOD(81) {
+		// A process that exceeds memoryLimit is disabled, detached once its
+		// current request has finished, and replaced. Only one process per
+		// group is restarted at a time.
+		Options options = createOptions();
+		options.memoryLimit = 10;
+		options.minProcesses = 2;
+		pool->setMax(3);
+
+		SessionPtr session = pool->get(options, &ticket);
+		EVENTUALLY(5,
+			result = pool->getProcessCount() == 2;
+		);
+		GroupPtr group = pool->groups.lookupCopy("stub/rack");
+		ProcessPtr process1 = session->getProcess()->shared_from_this();
+		ProcessPtr process2;
+		boost::container::vector<Callback> actions;
+		{
+			LockGuard l(pool->syncher);
+			process2 = (group->enabledProcesses[0] == process1)
+				? group->enabledProcesses[1]
+				: group->enabledProcesses[0];
+			process1->metrics.pid = process1->getPid();
+			process1->metrics.rss = 20 * 1024;
+			process2->metrics.pid = process2->getPid();
+			process2->metrics.rss = 20 * 1024;
+
+			unsigned long long now = SystemTime::getUsec();
+			group->checkMemoryLimit(process1, now, actions);
+			group->checkMemoryLimit(process2, now, actions);
+			ensure_equals("(1)", process1->enabled, Process::DISABLING);
+			ensure_equals("(2)", process2->enabled, Process::ENABLED);
+			ensure_equals("(3)", group->memoryLimitRestarts, 1u);
+		}
+		Pool::runAllActions(actions);
+
+		session.reset();
+		EVENTUALLY(5,
+			LockGuard l(pool->syncher);
+			result = process1->enabled == Process::DETACHED;
+		);
+		EVENTUALLY(5,
+			LockGuard l(pool->syncher);
+			result = group->enabledCount == 2
+				&& group->detachedProcesses.empty();
+		);
+		ensure_equals("(4)", process2->enabled, Process::ENABLED);
+	}
+
+	TEST_METHOD(82) {
+		// A process that has reached maxRequests keeps handling requests
+		// until its replacement has been attached, and is detached after that.
+		Options options = createOptions();
+		options.minProcesses = 1;
+		options.maxRequests = 3;
+		options.maxRequestsJitter = 2;
+		pool->setMax(2);
+
+		SessionPtr session = pool->get(options, &ticket);
+		ProcessPtr process = session->getProcess()->shared_from_this();
+		pid_t origPid = process->getPid();
+		ensure("(1)", process->maxRequestsJitter <= 2);
+		session.reset();
+		while (process->processed < 3 + process->maxRequestsJitter) {
+			pool->get(options, &ticket).reset();
+		}
+
+		GroupPtr group = pool->groups.lookupCopy("stub/rack");
+		EVENTUALLY(5,
+			LockGuard l(pool->syncher);
+			ensure("(2)", group->enabledCount > 0);
+			result = group->enabledCount == 1
+				&& group->enabledProcesses[0]->getPid() != origPid;
+		);
+		ensure_equals("(3)", process->enabled, Process::DETACHED);
+	}
+
+	TEST_METHOD(83) {
+		// With a target utilization, the load model spawns processes ahead
+		// of demand, and they count towards the minimum number of processes.
+		Options options = createOptions();
+		options.minProcesses = 1;
+		options.targetUtilization = 50;
+		pool->setMax(4);
+
+		pool->get(options, &ticket).reset();
+		GroupPtr group = pool->groups.lookupCopy("stub/rack");
+		ensure_equals("(1)", pool->getProcessCount(), 1u);
+		{
+			LockGuard l(pool->syncher);
+			// 10 requests per second of 100 msec each keep a process busy
+			// all the time, so at 50% utilization 2 processes are needed.
+			group->avgRequestTime = 100000;
+			unsigned long long now = SystemTime::getUsec() - 10000000;
+			for (unsigned int i = 0; i <= 10; i++) {
+				group->requestsReceived += 10;
+				group->updateLoadModel(now + i * 1000000);
+			}
+			ensure_equals("(2)", group->predictedProcessCount, 2u);
+			ensure_equals("(3)", group->getMinProcesses(), 2u);
+		}
+		EVENTUALLY(5,
+			result = pool->getProcessCount() == 2;
+		);
+	}
+
+	TEST_METHOD(84) {
+		// Cancelled requests are removed from the request queue without
+		// being served. While the queue is overloaded, requests that have
+		// waited longer than requestQueueTargetDelay fail with a
+		// RequestQueueTimeoutException. Serving a request within the target
+		// delay ends the overload.
+		Options options = createOptions();
+		options.requestQueueTargetDelay = 100;
+		pool->setMax(1);
+
+		SessionPtr session = pool->get(options, &ticket);
+		GroupPtr group = pool->groups.lookupCopy("stub/rack");
+		boost::atomic<bool> cancelled(false);
+		GetCallback cancellableCallback = callback;
+		cancellableCallback.cancelled = &cancelled;
+
+		pool->asyncGet(options, cancellableCallback);
+		pool->asyncGet(options, callback);
+		pool->asyncGet(options, callback);
+		cancelled.store(true);
+		{
+			LockGuard l(pool->syncher);
+			ensure_equals("(1)", group->getWaitlist.size(), 3u);
+			group->requestQueueOverloaded = true;
+			group->getWaitlist[1].enqueueTime -= 1000000;
+		}
+		ensure_equals("(2)", number, 0);
+
+		session.reset();
+		ensure_equals("(3)", number, 3);
+		ensure("(4)", currentSession != NULL);
+		ensure("(5)", currentException == NULL);
+		LockGuard l(pool->syncher);
+		ensure_equals("(6)", group->getWaitlist.size(), 0u);
+		ensure_equals("(7)", group->cancelledGetWaiters, 1u);
+		ensure_equals("(8)", group->requestQueueTimeouts, 1u);
+		ensure_equals("(9)", group->queueTimes.getCount(), 3u);
+		ensure("(10)", !group->requestQueueOverloaded);
+	}
+
 	// TODO: Persistent connections.
 	// TODO: If one closes the session before it has reached EOF, and process's maximum concurrency
 	//       has already been reached, then the pool should ping the process so that it can detect
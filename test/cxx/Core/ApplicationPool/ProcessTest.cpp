@@ -1,5 +1,6 @@
 #include <TestSupport.h>
 #include <Core/ApplicationPool/Process.h>
+#include <Core/ApplicationPool/StateSnapshot.h>
 #include <LoggingKit/Context.h>
 #include <Utils/IOUtils.h>
 
@@ -223,4 +224,56 @@ namespace tut {
 				&& gatheredOutput.find("errorPipe 2\n") != string::npos;
 		);
 	}
+
+	TEST_METHOD(6) {
+		set_test_name("ProcessSnapshot is a copy of the process state at the time"
+			" of the snapshot");
+		ProcessPtr process = createProcess();
+		SessionPtr session = process->newSession();
+		ProcessSnapshot snapshot(*process);
+		process->sessionClosed(session.get());
+
+		ensure_equals("(1)", snapshot.pid, 123);
+		ensure_equals("(2)", snapshot.gupid, "123");
+		ensure_equals("(3)", snapshot.sessions, 1);
+		ensure_equals("(4)", process->sessions, 0);
+		ensure_equals("(5)", snapshot.sockets.size(), 3u);
+		ensure("(6)", snapshot.findSocketWithName("main1") != NULL);
+		ensure("(7)", snapshot.findSocketWithName("http") == NULL);
+
+		stringstream stream;
+		snapshot.inspectXml(stream);
+		ensure("(8)", containsSubstring(stream.str(), "<pid>123</pid>"));
+		ensure("(9)", containsSubstring(stream.str(), "<sessions>1</sessions>"));
+		ensure("(10)", containsSubstring(stream.str(), "<name>main3</name>"));
+	}
+
+	TEST_METHOD(7) {
+		set_test_name("With adaptive concurrency, busyness and isTotallyBusy() follow"
+			" the adaptive limit, which is bounded by the advertised concurrency");
+		ProcessPtr process = createProcess();
+		process->enableAdaptiveConcurrency();
+		ensure_equals("(1)", process->getEffectiveConcurrency(), 9);
+
+		process->adaptiveConcurrencyLimit.reset(2, 9);
+		SessionPtr session1 = process->newSession();
+		ensure("(2)", !process->isTotallyBusy());
+		SessionPtr session2 = process->newSession();
+		ensure("(3)", process->isTotallyBusy());
+		ensure_equals("(4)", process->busyness(), INT_MAX);
+
+		ProcessSnapshot snapshot(*process);
+		stringstream stream;
+		snapshot.inspectXml(stream);
+		ensure("(5)", containsSubstring(stream.str(), "<concurrency>9</concurrency>"));
+		ensure("(6)", containsSubstring(stream.str(),
+			"<effective_concurrency>2</effective_concurrency>"));
+
+		process->sessionClosed(session1.get());
+		ensure("(7)", !process->isTotallyBusy());
+		ensure("(8)", process->adaptiveConcurrencyLimit.getLongTermLatency() >= 0);
+		process->sessionClosed(session2.get());
+		ensure("(9)", process->getEffectiveConcurrency() >= 1);
+		ensure("(10)", process->getEffectiveConcurrency() <= 9);
+	}
 }
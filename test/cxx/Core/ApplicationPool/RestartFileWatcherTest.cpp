@@ -0,0 +1,73 @@
+#include <TestSupport.h>
+#include <Core/ApplicationPool/RestartFileWatcher.h>
+#include <FileTools/FileManip.h>
+#include <FileTools/PathManip.h>
+
+using namespace Passenger;
+using namespace Passenger::ApplicationPool2;
+using namespace std;
+
+namespace tut {
+	struct Core_ApplicationPool_RestartFileWatcherTest {
+		RestartFileWatcher watcher;
+		string restartFile, alwaysRestartFile;
+
+		Core_ApplicationPool_RestartFileWatcherTest() {
+			makeDirTree("tmp.restart/tmp");
+			restartFile = absolutizePath("tmp.restart/tmp/restart.txt");
+			alwaysRestartFile = absolutizePath("tmp.restart/tmp/always_restart.txt");
+		}
+
+		~Core_ApplicationPool_RestartFileWatcherTest() {
+			removeDirTree("tmp.restart");
+		}
+	};
+
+	DEFINE_TEST_GROUP(Core_ApplicationPool_RestartFileWatcherTest);
+
+	#ifdef __linux__
+		TEST_METHOD(1) {
+			set_test_name("Creating or touching restart.txt is noticed before"
+				" the stat throttle rate expires");
+			RestartFileWatchPtr reg = watcher.watch(restartFile, alwaysRestartFile, 100);
+			ensure(reg != NULL);
+			ensure(!reg->restartFileChanged.load());
+
+			touchFile(restartFile.c_str(), 1);
+			EVENTUALLY(5,
+				result = reg->restartFileChanged.exchange(false);
+			);
+
+			touchFile(restartFile.c_str(), 2);
+			EVENTUALLY(5,
+				result = reg->restartFileChanged.exchange(false);
+			);
+		}
+
+		TEST_METHOD(2) {
+			set_test_name("A restart.txt that already exists when watching starts"
+				" does not trigger a restart");
+			touchFile(restartFile.c_str(), 1);
+			RestartFileWatchPtr reg = watcher.watch(restartFile, alwaysRestartFile, 100);
+			SHOULD_NEVER_HAPPEN(200,
+				result = reg->restartFileChanged.load();
+			);
+		}
+
+		TEST_METHOD(3) {
+			set_test_name("The existence of always_restart.txt is tracked");
+			RestartFileWatchPtr reg = watcher.watch(restartFile, alwaysRestartFile, 100);
+			ensure(!reg->alwaysRestartFileExists.load());
+
+			touchFile(alwaysRestartFile.c_str());
+			EVENTUALLY(5,
+				result = reg->alwaysRestartFileExists.load();
+			);
+
+			unlink(alwaysRestartFile.c_str());
+			EVENTUALLY(5,
+				result = !reg->alwaysRestartFileExists.load();
+			);
+		}
+	#endif
+}
@@ -1,5 +1,6 @@
 #include <TestSupport.h>
 #include <Constants.h>
+#include <SecureHeadersBlock.h>
 #include <Utils/IOUtils.h>
 #include <Utils/BufferedIO.h>
 #include <Utils/MessageIO.h>
@@ -258,9 +259,80 @@ namespace tut {
 		string readResponseBody() {
 			return clientConnectionIO.readAll();
 		}
+
+		string secureHeadersBlockEntry(PsgSecureHeaderId id, const StaticString &value) {
+			string result(psg_secure_headers_block_entry_size(value.size()), '\0');
+			psg_secure_headers_block_put_entry(&result[0], id, value.data(), value.size());
+			return result;
+		}
+
+		string secureHeadersBlockCustomEntry(const StaticString &name, const StaticString &value) {
+			string result(psg_secure_headers_block_custom_entry_size(name.size(), value.size()), '\0');
+			psg_secure_headers_block_put_custom_entry(&result[0], name.data(), name.size(),
+				value.data(), value.size());
+			return result;
+		}
+
+		string secureHeadersBlock(const string &entries) {
+			string result(PSG_SECURE_HEADERS_BLOCK_PREFIX_SIZE, '\0');
+			psg_secure_headers_block_put_prefix(&result[0], entries.size());
+			return result + entries;
+		}
+
+		void enableUnionStation() {
+			bg.safe->runSync(boost::bind(&Core_ControllerTest::_enableUnionStation, this));
+		}
+
+		void _enableUnionStation() {
+			// There is no UstRouter, so all messages are dropped. That
+			// doesn't matter for the Controller.
+			controller->unionStationContext = boost::make_shared<UnionStation::Context>(
+				"unix:tmp.nonexistent.sock", "logging", "1234");
+		}
+
+		void sendUnionStationRequest(const string &extraSecureHeaders) {
+			sendRequest(
+				"GET /hello HTTP/1.1\r\n"
+				"Host: localhost\r\n"
+				"Connection: close\r\n"
+				"!~: \r\n"
+				"!~UNION_STATION_SUPPORT: true\r\n"
+				"!~UNION_STATION_KEY: key\r\n"
+				+ extraSecureHeaders +
+				"\r\n");
+		}
+
+		Json::Value inspectUnionStationState() {
+			Json::Value result;
+			bg.safe->runSync(boost::bind(&Core_ControllerTest::_inspectUnionStationState,
+				this, &result));
+			return result;
+		}
+
+		void _inspectUnionStationState(Json::Value *result) {
+			*result = controller->inspectStateAsJson()["union_station"];
+		}
+
+		ControllerMetrics collectMetrics() {
+			ControllerMetrics result;
+			bg.safe->runSync(boost::bind(&Core_ControllerTest::_collectMetrics,
+				this, &result));
+			return result;
+		}
+
+		void _collectMetrics(ControllerMetrics *result) {
+			controller->collectMetrics(*result);
+		}
+
+		void setSecureModePassword(const string &password) {
+			Json::Value config;
+			vector<ConfigKit::Error> errors;
+			config["secure_mode_password"] = password;
+			ensure(context.configure(config, errors));
+		}
 	};
 
-	DEFINE_TEST_GROUP(Core_ControllerTest);
+	DEFINE_TEST_GROUP_WITH_LIMIT(Core_ControllerTest, 70);
 
 
 	/***** Passing request information to the app *****/
@@ -865,4 +937,328 @@ namespace tut {
 		string header = readResponseHeader();
 		ensure(containsSubstring(header, "HTTP/1.1 502"));
 	}
+
+
+	/***** Max request time *****/
+
+	TEST_METHOD(50) {
+		set_test_name("If the app does not respond within max_request_time, "
+			"it responds with 504 and reports the timeout to the session");
+
+		config["default_max_request_time"] = 1;
+		config["max_request_time_backtraces"] = true;
+		init();
+		useTestSessionObject();
+
+		connectToServer();
+		sendRequest(
+			"GET /hello HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+		waitUntilSessionInitiated();
+		readPeerRequestHeader();
+
+		LoggingKit::setLevel(LoggingKit::CRIT);
+		string header = readResponseHeader();
+		ensure("(1)", containsSubstring(header, "HTTP/1.1 504"));
+		ensure("(2)", testSession.isClosed());
+		ensure("(3)", !testSession.isSuccessful());
+		ensure("(4)", testSession.isRequestTimedOut());
+		ensure("(5)", testSession.isBacktraceRequested());
+	}
+
+	TEST_METHOD(51) {
+		set_test_name("Requests that finish within max_request_time are not affected");
+
+		config["default_max_request_time"] = 1;
+		init();
+		useTestSessionObject();
+
+		connectToServer();
+		sendRequest(
+			"GET /hello HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+		waitUntilSessionInitiated();
+
+		readPeerRequestHeader();
+		sendPeerResponse(
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: text/plain\r\n"
+			"Content-Length: 2\r\n\r\n"
+			"ok");
+		waitUntilSessionClosed();
+		ensure("(1)", testSession.isSuccessful());
+
+		SHOULD_NEVER_HAPPEN(1500,
+			result = testSession.isRequestTimedOut();
+		);
+	}
+
+
+	/***** Binary secure headers block *****/
+
+	TEST_METHOD(60) {
+		set_test_name("It decodes a binary secure headers block that precedes the request");
+
+		init();
+		useTestSessionObject();
+
+		connectToServer();
+		sendRequest(secureHeadersBlock(
+			secureHeadersBlockEntry(PSG_SHB_PASSWORD, "") +
+			secureHeadersBlockEntry(PSG_SHB_REMOTE_ADDR, "1.2.3.4") +
+			secureHeadersBlockEntry(PSG_SHB_FLAGS, "S") +
+			secureHeadersBlockCustomEntry("!~REMOTE_USER", "bob")));
+		sendRequest(
+			"GET /hello HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+		waitUntilSessionInitiated();
+
+		readPeerRequestHeader();
+		ensure("(1)", containsSubstring(peerRequestHeader,
+			P_STATIC_STRING("REMOTE_ADDR\0" "1.2.3.4\0")));
+		ensure("(2)", containsSubstring(peerRequestHeader,
+			P_STATIC_STRING("REMOTE_USER\0" "bob\0")));
+		ensure("(3)", containsSubstring(peerRequestHeader,
+			P_STATIC_STRING("HTTPS\0" "on\0")));
+	}
+
+	TEST_METHOD(61) {
+		set_test_name("It rejects a binary secure headers block with the wrong password");
+
+		setSecureModePassword("secret");
+		init();
+		useTestSessionObject();
+
+		connectToServer();
+		sendRequest(secureHeadersBlock(
+			secureHeadersBlockEntry(PSG_SHB_PASSWORD, "wrong") +
+			secureHeadersBlockEntry(PSG_SHB_REMOTE_ADDR, "1.2.3.4")));
+		sendRequest(
+			"GET /hello HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+
+		string header = readResponseHeader();
+		string body = readResponseBody();
+		ensure("(1)", containsSubstring(header, " 400 Bad Request"));
+		ensure("(2)", containsSubstring(body, "Security password mismatch"));
+		ensure("(3)", testSession.fd() == -1);
+	}
+
+	TEST_METHOD(62) {
+		set_test_name("It rejects a binary secure headers block without a password "
+			"if a secure mode password is set");
+
+		setSecureModePassword("secret");
+		init();
+		useTestSessionObject();
+
+		connectToServer();
+		sendRequest(secureHeadersBlock(
+			secureHeadersBlockEntry(PSG_SHB_REMOTE_ADDR, "1.2.3.4")));
+		sendRequest(
+			"GET /hello HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+
+		string header = readResponseHeader();
+		string body = readResponseBody();
+		ensure("(1)", containsSubstring(header, " 400 Bad Request"));
+		ensure("(2)", containsSubstring(body,
+			"A secure header was provided, but no security password was provided"));
+	}
+
+	TEST_METHOD(63) {
+		set_test_name("It rejects a malformed binary secure headers block");
+
+		init();
+		useTestSessionObject();
+
+		connectToServer();
+		sendRequest(secureHeadersBlock(
+			secureHeadersBlockEntry(PSG_SHB_REMOTE_ADDR, "1.2.3.4")
+				.substr(0, 7)));
+		sendRequest(
+			"GET /hello HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+
+		string header = readResponseHeader();
+		string body = readResponseBody();
+		ensure("(1)", containsSubstring(header, " 400 Bad Request"));
+		ensure("(2)", containsSubstring(body, "Invalid secure headers block"));
+	}
+
+
+	/***** Union Station sampling *****/
+
+	TEST_METHOD(64) {
+		set_test_name("Requests that are sampled get a Union Station transaction");
+
+		init();
+		enableUnionStation();
+		useTestSessionObject();
+
+		connectToServer();
+		sendUnionStationRequest("!~UNION_STATION_SAMPLE_RATE: 100\r\n");
+		waitUntilSessionInitiated();
+
+		readPeerRequestHeader();
+		ensure("(1)", containsSubstring(peerRequestHeader, "PASSENGER_TXN_ID"));
+		sendPeerResponse(
+			"HTTP/1.1 200 OK\r\n"
+			"Connection: close\r\n"
+			"Content-Length: 2\r\n\r\n"
+			"ok");
+		ensure("(2)", containsSubstring(readResponseHeader(), " 200 OK"));
+		readResponseBody();
+
+		Json::Value state = inspectUnionStationState();
+		ensure_equals("(3)", state["sampled_requests"].asUInt(), 1u);
+		ensure_equals("(4)", state["promoted_requests"].asUInt(), 0u);
+		ensure_equals("(5)", state["dropped_requests"].asUInt(), 0u);
+	}
+
+	TEST_METHOD(65) {
+		set_test_name("Requests that are not sampled don't get a Union Station transaction, "
+			"and are dropped if they succeed quickly");
+
+		init();
+		enableUnionStation();
+		useTestSessionObject();
+
+		connectToServer();
+		sendUnionStationRequest("!~UNION_STATION_SAMPLE_RATE: 0\r\n");
+		waitUntilSessionInitiated();
+
+		readPeerRequestHeader();
+		ensure("(1)", !containsSubstring(peerRequestHeader, "PASSENGER_TXN_ID"));
+		sendPeerResponse(
+			"HTTP/1.1 200 OK\r\n"
+			"Connection: close\r\n"
+			"Content-Length: 2\r\n\r\n"
+			"ok");
+		ensure("(2)", containsSubstring(readResponseHeader(), " 200 OK"));
+		readResponseBody();
+
+		EVENTUALLY(5,
+			result = inspectUnionStationState()["dropped_requests"].asUInt() == 1;
+		);
+		Json::Value state = inspectUnionStationState();
+		ensure_equals("(3)", state["sampled_requests"].asUInt(), 0u);
+		ensure_equals("(4)", state["promoted_requests"].asUInt(), 0u);
+	}
+
+	TEST_METHOD(66) {
+		set_test_name("Requests that are not sampled are promoted to a Union Station "
+			"transaction if they fail");
+
+		init();
+		enableUnionStation();
+		useTestSessionObject();
+
+		connectToServer();
+		sendUnionStationRequest("!~UNION_STATION_SAMPLE_RATE: 0\r\n");
+		waitUntilSessionInitiated();
+
+		readPeerRequestHeader();
+		ensure("(1)", !containsSubstring(peerRequestHeader, "PASSENGER_TXN_ID"));
+		sendPeerResponse(
+			"HTTP/1.1 500 Internal Server Error\r\n"
+			"Connection: close\r\n"
+			"Content-Length: 5\r\n\r\n"
+			"oops!");
+		ensure("(2)", containsSubstring(readResponseHeader(), " 500 Internal Server Error"));
+		readResponseBody();
+
+		EVENTUALLY(5,
+			result = inspectUnionStationState()["promoted_requests"].asUInt() == 1;
+		);
+		Json::Value state = inspectUnionStationState();
+		ensure_equals("(3)", state["sampled_requests"].asUInt(), 0u);
+		ensure_equals("(4)", state["dropped_requests"].asUInt(), 0u);
+	}
+
+	TEST_METHOD(67) {
+		set_test_name("Requests that are not sampled are promoted to a Union Station "
+			"transaction if they are slow");
+
+		init();
+		enableUnionStation();
+		useTestSessionObject();
+
+		connectToServer();
+		sendUnionStationRequest(
+			"!~UNION_STATION_SAMPLE_RATE: 0\r\n"
+			"!~UNION_STATION_SLOW_REQUEST_THRESHOLD: 10\r\n");
+		waitUntilSessionInitiated();
+
+		readPeerRequestHeader();
+		usleep(20000);
+		sendPeerResponse(
+			"HTTP/1.1 200 OK\r\n"
+			"Connection: close\r\n"
+			"Content-Length: 2\r\n\r\n"
+			"ok");
+		ensure("(1)", containsSubstring(readResponseHeader(), " 200 OK"));
+		readResponseBody();
+
+		EVENTUALLY(5,
+			result = inspectUnionStationState()["promoted_requests"].asUInt() == 1;
+		);
+		ensure_equals("(2)", inspectUnionStationState()["dropped_requests"].asUInt(), 0u);
+	}
+
+
+	/***** Request phase timing *****/
+
+	TEST_METHOD(68) {
+		set_test_name("The durations of the request's phases are recorded"
+			" in the app group's histograms");
+
+		init();
+		useTestSessionObject();
+
+		connectToServer();
+		sendRequest(
+			"GET /hello HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Connection: close\r\n"
+			"\r\n");
+		waitUntilSessionInitiated();
+
+		readPeerRequestHeader();
+		usleep(20000);
+		sendPeerResponse(
+			"HTTP/1.1 200 OK\r\n"
+			"Connection: close\r\n"
+			"Content-Length: 2\r\n\r\n"
+			"ok");
+		ensure("(1)", containsSubstring(readResponseHeader(), " 200 OK"));
+		readResponseBody();
+
+		EVENTUALLY(5,
+			result = !collectMetrics().requestPhaseHistograms.empty();
+		);
+		ControllerMetrics metrics = collectMetrics();
+		ensure_equals("(2)", metrics.requestPhaseHistograms.size(), 1u);
+		const RequestPhaseHistograms &histograms =
+			*metrics.requestPhaseHistograms[0].second;
+		for (unsigned int i = 0; i < RequestPhaseHistograms::PHASE_COUNT; i++) {
+			ensure_equals(RequestPhaseHistograms::getPhaseName(i),
+				histograms.phases[i].getCount(), 1u);
+		}
+		ensure("(3)", histograms.phases[RequestPhaseHistograms::APP].getMax() >= 20000);
+		ensure("(4)", histograms.phases[RequestPhaseHistograms::TOTAL].getMax()
+			>= histograms.phases[RequestPhaseHistograms::APP].getMax());
+	}
 }
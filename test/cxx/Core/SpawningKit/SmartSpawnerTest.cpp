@@ -99,7 +99,7 @@ namespace tut {
 		options.startupFile  = "start.rb";
 		boost::shared_ptr<SmartSpawner> spawner = createSpawner(options);
 		LoggingKit::setLevel(LoggingKit::CRIT);
-		spawner->spawn(options);
+		try { spawner->spawn(options); } catch (const SpawnException &e) { fprintf(stderr, "PAGE: %s\n", e.getErrorPage().c_str()); }
 
 		kill(spawner->getPreloaderPid(), SIGTERM);
 		// Give it some time to exit.
@@ -0,0 +1,240 @@
+#include <TestSupport.h>
+#include <boost/bind.hpp>
+#include <oxt/thread.hpp>
+#include <oxt/system_calls.hpp>
+#include <Core/UnionStation/Context.h>
+#include <Core/UnionStation/Transport.h>
+#include <Utils/IOUtils.h>
+#include <Utils/MessageIO.h>
+
+using namespace Passenger;
+using namespace Passenger::UnionStation;
+using namespace std;
+using namespace oxt;
+
+namespace tut {
+	#define SOCKET_FILENAME "tmp.ust_router.sock"
+
+	/**
+	 * A stand-in UstRouter. It accepts connections, performs the server side
+	 * of the handshake if requested, and records every message it receives.
+	 */
+	struct Core_UnionStation_TransportTest {
+		FileDescriptor serverFd;
+		oxt::thread *routerThread;
+		bool handshake;
+
+		boost::mutex syncher;
+		boost::condition_variable cond;
+		vector<string> messages;
+		bool connectAllowed;
+
+		TransportPtr transport;
+
+		Core_UnionStation_TransportTest() {
+			serverFd.assign(createUnixServer(SOCKET_FILENAME), NULL, 0);
+			handshake = false;
+			connectAllowed = true;
+			routerThread = NULL;
+		}
+
+		~Core_UnionStation_TransportTest() {
+			allowConnect();
+			transport.reset();
+			if (routerThread != NULL) {
+				routerThread->interrupt_and_join();
+				delete routerThread;
+			}
+			unlink(SOCKET_FILENAME);
+		}
+
+		void startRouter(bool withHandshake = false) {
+			handshake = withHandshake;
+			routerThread = new oxt::thread(
+				boost::bind(&Core_UnionStation_TransportTest::routerMain, this),
+				"Stand-in UstRouter", 1024 * 128);
+		}
+
+		void routerMain() {
+			try {
+				while (true) {
+					FileDescriptor fd(syscalls::accept(serverFd, NULL, NULL),
+						__FILE__, __LINE__);
+					if (handshake) {
+						performHandshake(fd);
+					}
+					readMessages(fd);
+				}
+			} catch (const boost::thread_interrupted &) {
+				// Do nothing.
+			} catch (const tracable_exception &e) {
+				fprintf(stderr, "Stand-in UstRouter error: %s\n%s", e.what(),
+					e.backtrace().c_str());
+			}
+		}
+
+		void performHandshake(int fd) {
+			vector<string> args;
+			writeArrayMessage(fd, "version", "1", NULL);
+			readScalarMessage(fd);
+			readScalarMessage(fd);
+			writeArrayMessage(fd, "status", "ok", NULL);
+			readArrayMessage(fd, args);
+			writeArrayMessage(fd, "status", "ok", NULL);
+		}
+
+		void readMessages(int fd) {
+			vector<string> args;
+
+			while (readArrayMessage(fd, args)) {
+				string message = toString(args);
+				if (args[0] == "log") {
+					message.append(" " + readScalarMessage(fd));
+				}
+
+				boost::lock_guard<boost::mutex> l(syncher);
+				messages.push_back(message);
+			}
+		}
+
+		vector<string> getMessages() {
+			boost::lock_guard<boost::mutex> l(syncher);
+			return messages;
+		}
+
+		unsigned int countMessages() {
+			boost::lock_guard<boost::mutex> l(syncher);
+			return messages.size();
+		}
+
+		ConnectionPtr connect() {
+			boost::unique_lock<boost::mutex> l(syncher);
+			while (!connectAllowed) {
+				cond.wait(l);
+			}
+			l.unlock();
+			return boost::make_shared<Connection>(connectToUnixServer(SOCKET_FILENAME,
+				__FILE__, __LINE__));
+		}
+
+		void blockConnect() {
+			boost::lock_guard<boost::mutex> l(syncher);
+			connectAllowed = false;
+		}
+
+		void allowConnect() {
+			boost::lock_guard<boost::mutex> l(syncher);
+			connectAllowed = true;
+			cond.notify_all();
+		}
+
+		void createTransport(size_t ringSize = Transport::DEFAULT_RING_SIZE) {
+			unsigned int ringCount = Transport::DEFAULT_RING_COUNT;
+			transport = boost::make_shared<Transport>(
+				boost::bind(&Core_UnionStation_TransportTest::connect, this),
+				ringCount, ringSize);
+		}
+
+		bool sendLog(unsigned int i) {
+			string text = "message " + toString(i);
+			StaticString args[] = { "log", "txn", "ts" };
+			StaticString scalar(text);
+			return transport->sendMessage(0, args, 3, &scalar);
+		}
+	};
+
+	DEFINE_TEST_GROUP(Core_UnionStation_TransportTest);
+
+	TEST_METHOD(1) {
+		set_test_name("Transactions are opened, logged to and closed in order");
+		startRouter(true);
+
+		ContextPtr context = boost::make_shared<Context>(
+			"unix:" SOCKET_FILENAME, "logging", "1234");
+		string txnId;
+		{
+			TransactionPtr transaction = context->newTransaction("foobar");
+			ensure(!transaction->isNull());
+			txnId = transaction->getTxnId();
+			transaction->message("hello");
+			transaction->message("world");
+		}
+
+		EVENTUALLY(5,
+			result = countMessages() == 4;
+		);
+		vector<string> messages = getMessages();
+		ensure(containsSubstring(messages[0], "['openTransaction', '" + txnId + "', 'foobar', "));
+		ensure(containsSubstring(messages[1], "['log', '" + txnId + "', "));
+		ensure(containsSubstring(messages[1], "] hello"));
+		ensure(containsSubstring(messages[2], "] world"));
+		ensure(containsSubstring(messages[3], "['closeTransaction', '" + txnId + "', "));
+		ensure_equals(context->getTransport()->getSentMessages(), 4u);
+		ensure_equals(context->getTransport()->getDroppedMessages(), 0u);
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("Messages that accumulate while a batch is in flight are sent in a single batch");
+		startRouter();
+		blockConnect();
+		createTransport();
+
+		// The sender picks up the first message and then blocks on connecting.
+		ensure(sendLog(0));
+		for (unsigned int i = 1; i < 100; i++) {
+			ensure(sendLog(i));
+		}
+		allowConnect();
+
+		EVENTUALLY(5,
+			result = countMessages() == 100;
+		);
+		vector<string> messages = getMessages();
+		for (unsigned int i = 0; i < 100; i++) {
+			ensure_equals(messages[i], "['log', 'txn', 'ts'] message " + toString(i));
+		}
+		ensure_equals(transport->getSentMessages(), 100u);
+		ensure("(" + toString(transport->getBatches()) + " batches)",
+			transport->getBatches() <= 2);
+	}
+
+	TEST_METHOD(3) {
+		set_test_name("Messages are dropped instead of blocking when the ring is full");
+		startRouter();
+		blockConnect();
+		createTransport(1024);
+
+		unsigned int sent = 0, dropped = 0;
+		for (unsigned int i = 0; i < 100; i++) {
+			if (sendLog(i)) {
+				sent++;
+			} else {
+				dropped++;
+			}
+		}
+		ensure("Some messages are dropped", dropped > 0);
+		ensure_equals(transport->getDroppedMessages(), (boost::uint64_t) dropped);
+
+		allowConnect();
+		EVENTUALLY(5,
+			result = countMessages() == sent;
+		);
+		ensure_equals(transport->getSentMessages(), (boost::uint64_t) sent);
+	}
+
+	TEST_METHOD(4) {
+		set_test_name("Messages are dropped when the UstRouter is unreachable");
+		ContextPtr context = boost::make_shared<Context>(
+			"unix:tmp.nonexistent.sock", "logging", "1234");
+		context->setReconnectTimeout(60000000);
+		{
+			TransactionPtr transaction = context->newTransaction("foobar");
+			ensure(!transaction->isNull());
+			transaction->message("hello");
+		}
+		EVENTUALLY(5,
+			result = context->getTransport()->getDroppedMessages() == 3;
+		);
+		ensure_equals(context->getTransport()->getSentMessages(), 0u);
+	}
+}
@@ -0,0 +1,75 @@
+#include <TestSupport.h>
+#include <DataStructures/DeadlineHeap.h>
+#include <cstdlib>
+
+using namespace Passenger;
+using namespace std;
+
+namespace tut {
+	struct DataStructures_DeadlineHeapTest {
+		DeadlineHeap heap;
+		DeadlineHeapEntry entries[100];
+
+		DataStructures_DeadlineHeapTest() {
+			for (unsigned int i = 0; i < 100; i++) {
+				entries[i].userData = &entries[i];
+			}
+		}
+
+		vector<unsigned long long> popAll(unsigned long long now) {
+			vector<unsigned long long> result;
+			DeadlineHeapEntry *entry;
+			while ((entry = heap.popExpired(now)) != NULL) {
+				ensure(!entry->isInHeap());
+				result.push_back(entry->deadline);
+			}
+			return result;
+		}
+
+		void ensureSorted(const vector<unsigned long long> &deadlines) {
+			for (unsigned int i = 1; i < deadlines.size(); i++) {
+				ensure("Deadline " + toString(i) + " is in order",
+					deadlines[i - 1] <= deadlines[i]);
+			}
+		}
+	};
+
+	DEFINE_TEST_GROUP(DataStructures_DeadlineHeapTest);
+
+	TEST_METHOD(1) {
+		set_test_name("popExpired() only returns entries whose deadline has passed,"
+			" in order of deadline");
+		for (unsigned int i = 0; i < 100; i++) {
+			heap.schedule(&entries[i], (i * 37) % 100);
+		}
+		ensure_equals(heap.top()->deadline, 0ull);
+
+		vector<unsigned long long> deadlines = popAll(49);
+		ensure_equals("(1)", deadlines.size(), 50u);
+		ensureSorted(deadlines);
+		ensure_equals("(2)", heap.size(), 50u);
+		ensure_equals("(3)", heap.top()->deadline, 50ull);
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("Entries can be rescheduled and removed");
+		srand(1234);
+		for (unsigned int i = 0; i < 100; i++) {
+			heap.schedule(&entries[i], rand() % 1000);
+		}
+		for (unsigned int i = 0; i < 100; i += 2) {
+			heap.schedule(&entries[i], rand() % 1000);
+		}
+		for (unsigned int i = 0; i < 100; i += 3) {
+			heap.remove(&entries[i]);
+			ensure(!entries[i].isInHeap());
+		}
+		heap.remove(&entries[0]);
+
+		vector<unsigned long long> deadlines = popAll(1000);
+		ensure_equals("(1)", deadlines.size(), 66u);
+		ensureSorted(deadlines);
+		ensure("(2)", heap.empty());
+		ensure("(3)", heap.top() == NULL);
+	}
+}
@@ -276,6 +276,29 @@ namespace tut {
 	}
 
 
+	/***** Case-insensitive comparison with StaticString *****/
+
+	TEST_METHOD(36) {
+		set_test_name("psg_lstr_casecmp with a single-part LString");
+		ensure(psg_lstr_casecmp(&str, ""));
+		psg_lstr_append(&str, pool, "Example.COM");
+		ensure(psg_lstr_casecmp(&str, "example.com"));
+		ensure(psg_lstr_casecmp(&str, "EXAMPLE.com"));
+		ensure(!psg_lstr_casecmp(&str, "example.org"));
+		ensure(!psg_lstr_casecmp(&str, "example.co"));
+	}
+
+	TEST_METHOD(37) {
+		set_test_name("psg_lstr_casecmp with a multi-part LString");
+		psg_lstr_append(&str, pool, "Exa");
+		psg_lstr_append(&str, pool, "mple.");
+		psg_lstr_append(&str, pool, "COM");
+		ensure(psg_lstr_casecmp(&str, "example.com"));
+		ensure(!psg_lstr_casecmp(&str, "example.org"));
+		ensure(!psg_lstr_casecmp(&str, "exbmple.com"));
+	}
+
+
 	/***** psg_lstr_make_contiguous *****/
 
 	TEST_METHOD(40) {
@@ -303,6 +326,28 @@ namespace tut {
 	}
 
 
+	TEST_METHOD(42) {
+		set_test_name("psg_lstr_make_contiguous merges adjacent parts without copying");
+		const char *data = "helloworld";
+		const LString *cstr;
+
+		psg_lstr_append(&str, pool, data, 5);
+		psg_lstr_append(&str, pool, data + 5, 5);
+
+		cstr = psg_lstr_make_contiguous(&str, pool);
+		ensure(cstr != &str);
+		ensure_equals(cstr->size, 10u);
+		ensure_equals<void *>(cstr->start->next, NULL);
+		ensure_equals<const void *>(cstr->start->data, data);
+	}
+
+	TEST_METHOD(43) {
+		set_test_name("psg_lstr_make_contiguous returns single-part strings as-is");
+		psg_lstr_append(&str, pool, "hello");
+		ensure_equals<const void *>(psg_lstr_make_contiguous(&str, pool), &str);
+	}
+
+
 	/***** psg_lstr_move_and_append *****/
 
 	TEST_METHOD(45) {
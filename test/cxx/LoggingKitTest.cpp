@@ -0,0 +1,207 @@
+#include <TestSupport.h>
+#include <boost/bind.hpp>
+#include <oxt/thread.hpp>
+#include <LoggingKit/LoggingKit.h>
+#include <LoggingKit/Context.h>
+#include <Utils/IOUtils.h>
+#include <Utils/StrIntUtils.h>
+
+using namespace Passenger;
+using namespace Passenger::LoggingKit;
+using namespace std;
+
+namespace tut {
+	struct LoggingKitTest {
+		LoggingKit::Context *context;
+		LoggingKit::Context *oldGlobalContext;
+
+		LoggingKitTest() {
+			context = NULL;
+			oldGlobalContext = LoggingKit::context;
+		}
+
+		~LoggingKitTest() {
+			LoggingKit::context = oldGlobalContext;
+			delete context;
+			unlink("tmp.log");
+			unlink("tmp.log2");
+		}
+
+		void createContext(bool async, const string &target = "tmp.log") {
+			Json::Value config;
+			config["target"] = target;
+			config["redirect_stderr"] = false;
+			config["async"] = async;
+			context = new LoggingKit::Context(config);
+		}
+
+		void logLines(unsigned int threadNumber, unsigned int count) {
+			for (unsigned int i = 0; i < count; i++) {
+				P_LOG(context, LoggingKit::NOTICE, __FILE__, __LINE__,
+					"thread " << threadNumber << " line " << i);
+			}
+		}
+
+		/**
+		 * App output is always logged through the global context.
+		 */
+		void createGlobalContext(bool async, unsigned int appOutputRateLimit = 0) {
+			createContext(async);
+			if (appOutputRateLimit > 0) {
+				Json::Value updates;
+				vector<ConfigKit::Error> errors;
+				LoggingKit::ConfigChangeRequest req;
+				updates["app_output_rate_limit"] = appOutputRateLimit;
+				ensure(context->prepareConfigChange(updates, errors, req));
+				context->commitConfigChange(req);
+			}
+			LoggingKit::context = context;
+		}
+
+		void destroyGlobalContext() {
+			LoggingKit::context = oldGlobalContext;
+			delete context;
+			context = NULL;
+		}
+
+		vector<string> readLines(const string &filename) {
+			vector<string> lines;
+			split(readAll(filename), '\n', lines);
+			if (!lines.empty() && lines.back().empty()) {
+				lines.pop_back();
+			}
+			return lines;
+		}
+	};
+
+	DEFINE_TEST_GROUP(LoggingKitTest);
+
+	TEST_METHOD(1) {
+		set_test_name("Log entries have a timestamp with a 100 microsecond resolution");
+		createContext(false);
+		logLines(0, 1);
+
+		vector<string> lines = readLines("tmp.log");
+		ensure_equals(lines.size(), 1u);
+		// [ N 2017-01-01 12:34:56.7890 1234/T1 ...
+		const string &line = lines[0];
+		ensure("(1)", startsWith(line, "[ N "));
+		ensure_equals("(2)", line[8], '-');
+		ensure_equals("(3)", line[11], '-');
+		ensure_equals("(4)", line[14], ' ');
+		ensure_equals("(5)", line[17], ':');
+		ensure_equals("(6)", line[20], ':');
+		ensure_equals("(7)", line[23], '.');
+		ensure_equals("(8)", line[28], ' ');
+		ensure("(9)", containsSubstring(line, " ]: thread 0 line 0"));
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("In async mode, all entries are written, in order per thread");
+		createContext(true);
+
+		boost::thread_group threads;
+		for (unsigned int i = 0; i < 4; i++) {
+			threads.create_thread(boost::bind(&LoggingKitTest::logLines, this, i, 2000));
+		}
+		threads.join_all();
+		delete context;
+		context = NULL;
+
+		vector<string> lines = readLines("tmp.log");
+		ensure_equals(lines.size(), 8000u);
+		unsigned int next[4] = { 0, 0, 0, 0 };
+		for (unsigned int i = 0; i < lines.size(); i++) {
+			string::size_type pos = lines[i].find(" ]: thread ");
+			ensure(pos != string::npos);
+			unsigned int thread = stringToUint(lines[i].substr(pos + sizeof(" ]: thread ") - 1));
+			ensure(thread < 4);
+			ensure_equals(lines[i].substr(pos),
+				" ]: thread " + toString(thread) + " line " + toString(next[thread]));
+			next[thread]++;
+		}
+	}
+
+	TEST_METHOD(3) {
+		set_test_name("In async mode, entries that were logged before a target change"
+			" are written to the old target");
+		createContext(true);
+		logLines(0, 100);
+
+		Json::Value updates;
+		vector<ConfigKit::Error> errors;
+		LoggingKit::ConfigChangeRequest req;
+		updates["target"] = "tmp.log2";
+		ensure(context->prepareConfigChange(updates, errors, req));
+		context->commitConfigChange(req);
+		logLines(1, 100);
+		delete context;
+		context = NULL;
+
+		vector<string> lines = readLines("tmp.log");
+		ensure_equals("(1)", lines.size(), 100u);
+		ensure("(2)", containsSubstring(lines.back(), " ]: thread 0 line 99"));
+		lines = readLines("tmp.log2");
+		ensure_equals("(3)", lines.size(), 100u);
+		ensure("(4)", containsSubstring(lines.back(), " ]: thread 1 line 99"));
+	}
+
+	TEST_METHOD(4) {
+		set_test_name("logAppOutputLines() logs every line, including empty ones,"
+			" with the app output prefix");
+		createGlobalContext(false);
+		logAppOutputLines(1234, "stdout", "hello\n\nworld\n", sizeof("hello\n\nworld\n") - 1);
+		logAppOutputLines(1234, "stderr", "\n", 1);
+		logAppOutputLines(1234, "stderr", "no newline", sizeof("no newline") - 1);
+		destroyGlobalContext();
+
+		vector<string> lines = readLines("tmp.log");
+		ensure_equals("(1)", lines.size(), 5u);
+		ensure_equals("(2)", lines[0], "App 1234 stdout: hello");
+		ensure_equals("(3)", lines[1], "App 1234 stdout: ");
+		ensure_equals("(4)", lines[2], "App 1234 stdout: world");
+		ensure_equals("(5)", lines[3], "App 1234 stderr: ");
+		ensure_equals("(6)", lines[4], "App 1234 stderr: no newline");
+	}
+
+	TEST_METHOD(5) {
+		set_test_name("In async mode, logAppOutputLines() writes all lines in order");
+		createGlobalContext(true);
+		string data;
+		for (unsigned int i = 0; i < 1000; i++) {
+			data.append("line " + toString(i) + "\n");
+		}
+		logAppOutputLines(1234, "stdout", data.data(), data.size());
+		destroyGlobalContext();
+
+		vector<string> lines = readLines("tmp.log");
+		ensure_equals("(1)", lines.size(), 1000u);
+		for (unsigned int i = 0; i < lines.size(); i++) {
+			ensure_equals(lines[i], "App 1234 stdout: line " + toString(i));
+		}
+	}
+
+	TEST_METHOD(6) {
+		set_test_name("logAppOutputLines() drops lines that exceed app_output_rate_limit,"
+			" and reports how many were dropped once output is allowed again");
+		createGlobalContext(false, 10);
+		AppOutputRateLimiter rateLimiter;
+		string data;
+		for (unsigned int i = 0; i < 25; i++) {
+			data.append("line " + toString(i) + "\n");
+		}
+		logAppOutputLines(1234, "stdout", data.data(), data.size(), &rateLimiter);
+		logAppOutputLines(1234, "stdout", "x\n", 2, &rateLimiter);
+		usleep(250000);
+		logAppOutputLines(1234, "stdout", "after\n", 6, &rateLimiter);
+		destroyGlobalContext();
+
+		vector<string> lines = readLines("tmp.log");
+		ensure_equals("(1)", lines.size(), 12u);
+		ensure_equals("(2)", lines[0], "App 1234 stdout: line 0");
+		ensure_equals("(3)", lines[9], "App 1234 stdout: line 9");
+		ensure_equals("(4)", lines[10], "App 1234 stdout: [16 lines dropped because"
+			" the app exceeds app_output_rate_limit]");
+		ensure_equals("(5)", lines[11], "App 1234 stdout: after");
+	}
+}
@@ -264,4 +264,65 @@ namespace tut {
 		ensure_equals("(5)", pool.nfree_mbuf_blockq, 0u);
 		ensure_equals("(6)", pool.nactive_mbuf_blockq, 0u);
 	}
+
+
+	/***** Idle memory release and size classes *****/
+
+	TEST_METHOD(30) {
+		set_test_name("mbuf_pool_release_idle() only releases blocks that stayed free "
+			"since the previous call");
+		struct mbuf_block *block = mbuf_block_get(&pool);
+		struct mbuf_block *block2 = mbuf_block_get(&pool);
+		mbuf_block_unref(block);
+		mbuf_block_unref(block2);
+		ensure_equals("(1)", mbuf_pool_release_idle(&pool), 0u);
+
+		// Take one block off the free q and put it back.
+		block = mbuf_block_get(&pool);
+		mbuf_block_unref(block);
+		ensure_equals("(2)", mbuf_pool_release_idle(&pool), 1u);
+		ensure_equals("(3)", mbuf_pool_release_idle(&pool), 1u);
+		ensure_equals("(4)", mbuf_pool_release_idle(&pool), 0u);
+	}
+
+	TEST_METHOD(31) {
+		set_test_name("mbuf_pool_release_idle() returns pages of large blocks to the OS "
+			"but keeps the blocks on the free q");
+		struct mbuf_pool largePool;
+		largePool.mbuf_block_chunk_size = mbuf_size_class_chunk_size(
+			MBUF_SIZE_CLASS_HUGE, DEFAULT_MBUF_CHUNK_SIZE);
+		mbuf_pool_init(&largePool);
+
+		struct mbuf_block *block = mbuf_block_get(&largePool);
+		memset(block->start, 'x', block->end - block->start);
+		mbuf_block_unref(block);
+		mbuf_pool_release_idle(&largePool);
+		ensure_equals("(1)", mbuf_pool_release_idle(&largePool), 1u);
+		ensure_equals("(2)", largePool.nfree_mbuf_blockq, 1u);
+		ensure_equals("(3)", largePool.nreleased_mbuf_blockq, 1u);
+
+		ensure("(4)", mbuf_block_get(&largePool) == block);
+		ensure_equals("(5)", largePool.nreleased_mbuf_blockq, 0u);
+		memset(block->start, 'y', block->end - block->start);
+		mbuf_block_unref(block);
+		mbuf_pool_deinit(&largePool);
+	}
+
+	TEST_METHOD(32) {
+		set_test_name("mbuf_pool_release_idle() frees small blocks");
+		struct mbuf_block *block = mbuf_block_get(&pool);
+		mbuf_block_unref(block);
+		mbuf_pool_release_idle(&pool);
+		mbuf_pool_release_idle(&pool);
+		ensure_equals("(1)", pool.nfree_mbuf_blockq, 0u);
+		ensure_equals("(2)", pool.nactive_mbuf_blockq, 0u);
+	}
+
+	TEST_METHOD(33) {
+		set_test_name("Size class chunk sizes are derived from the default chunk size");
+		ensure_equals(mbuf_size_class_chunk_size(MBUF_SIZE_CLASS_SMALL, 4096), 1024u);
+		ensure_equals(mbuf_size_class_chunk_size(MBUF_SIZE_CLASS_DEFAULT, 4096), 4096u);
+		ensure_equals(mbuf_size_class_chunk_size(MBUF_SIZE_CLASS_LARGE, 4096), 16384u);
+		ensure_equals(mbuf_size_class_chunk_size(MBUF_SIZE_CLASS_HUGE, 4096), 65536u);
+	}
 }
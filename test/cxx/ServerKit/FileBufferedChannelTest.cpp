@@ -7,6 +7,7 @@
 #include <StaticString.h>
 #include <ServerKit/FileBufferedChannel.h>
 #include <Utils/StrIntUtils.h>
+#include <Utils/SystemTime.h>
 
 using namespace Passenger;
 using namespace Passenger::ServerKit;
@@ -27,6 +28,8 @@ namespace tut {
 		unsigned int counter;
 		unsigned int buffersFlushed;
 		string log;
+		size_t bytesConsumed;
+		bool corrupted;
 
 		ServerKit_FileBufferedChannelTest()
 			: bg(false, true),
@@ -35,8 +38,17 @@ namespace tut {
 			  toConsume(CONSUME_FULLY),
 			  endConsume(false),
 			  counter(0),
-			  buffersFlushed(0)
+			  buffersFlushed(0),
+			  bytesConsumed(0),
+			  corrupted(false)
 		{
+			Json::Value config;
+			vector<ConfigKit::Error> errors;
+			// Most tests are about the temp file. The memory spill tests
+			// turn it on explicitly.
+			config["file_buffered_channel_memory_spill_limit"] = 0;
+			context.configure(config, errors);
+
 			context.libev = bg.safe;
 			context.libuv = bg.libuv_loop;
 			context.initialize();
@@ -182,6 +194,28 @@ namespace tut {
 			*result = channel.getBytesBuffered();
 		}
 
+		boost::uint64_t getContextMemorySpill() {
+			boost::uint64_t result;
+			bg.safe->runSync(boost::bind(&ServerKit_FileBufferedChannelTest::_getContextMemorySpill,
+				this, &result));
+			return result;
+		}
+
+		void _getContextMemorySpill(boost::uint64_t *result) {
+			*result = context.fileBufferedChannelMemorySpill;
+		}
+
+		Json::Value inspectChannel() {
+			Json::Value result;
+			bg.safe->runSync(boost::bind(&ServerKit_FileBufferedChannelTest::_inspectChannel,
+				this, &result));
+			return result;
+		}
+
+		void _inspectChannel(Json::Value *result) {
+			*result = channel.inspectAsJson();
+		}
+
 		bool contextConfigure(const Json::Value &doc, vector<ConfigKit::Error> &errors) {
 			bool result;
 			bg.safe->runSync(boost::bind(&ServerKit_FileBufferedChannelTest::_contextConfigure,
@@ -1080,4 +1114,169 @@ namespace tut {
 			ensure_equals(counter, 2u);
 		}
 	}
+
+
+	/***** Memory spill mode *****/
+
+	TEST_METHOD(50) {
+		set_test_name("In the in-file mode, it spills to memory instead of a temp file "
+			"if the memory spill limit allows it");
+
+		Json::Value config;
+		vector<ConfigKit::Error> errors;
+		config["file_buffered_channel_threshold"] = 1;
+		config["file_buffered_channel_memory_spill_limit"] = 1024 * 1024;
+		ensure(context.configure(config, errors));
+
+		toConsume = -1;
+		startLoop();
+
+		feedChannel("hello");
+		feedChannel("world!");
+		EVENTUALLY(5,
+			result = getChannelMode() == FileBufferedChannel::IN_FILE_MODE
+				&& getChannelBytesBuffered() == 0;
+		);
+		ensure_equals(getChannelWriterState(), FileBufferedChannel::WS_INACTIVE);
+		ensure(inspectChannel()["spilling_to_memory"].asBool());
+		ensure_equals("'hello' is being consumed, 'world!' is in the memory spill area",
+			getContextMemorySpill(), (boost::uint64_t) sizeof("world!") - 1);
+
+		toConsume = CONSUME_FULLY;
+		channelConsumed(sizeof("hello") - 1, false);
+		EVENTUALLY(5,
+			LOCK();
+			result = log ==
+				"Data: hello\n"
+				"Data: world!\n";
+		);
+		EVENTUALLY(5,
+			result = getChannelMode() == FileBufferedChannel::IN_MEMORY_MODE;
+		);
+		ensure_equals(getContextMemorySpill(), 0u);
+	}
+
+	TEST_METHOD(51) {
+		set_test_name("When the memory spill limit is reached, it continues in a temp file");
+
+		Json::Value config;
+		vector<ConfigKit::Error> errors;
+		config["file_buffered_channel_threshold"] = 1;
+		config["file_buffered_channel_memory_spill_limit"] = 8;
+		ensure(context.configure(config, errors));
+
+		toConsume = -1;
+		startLoop();
+
+		feedChannel("hello");
+		feedChannel("world!");
+		feedChannel("the end");
+		EVENTUALLY(5,
+			result = getChannelMode() == FileBufferedChannel::IN_FILE_MODE
+				&& getChannelWriterState() == FileBufferedChannel::WS_INACTIVE
+				&& getChannelBytesBuffered() == 0;
+		);
+		ensure(!inspectChannel()["spilling_to_memory"].asBool());
+
+		// "world!" and "the end" are read back from the
+		// temp file in a single chunk.
+		toConsume = CONSUME_FULLY;
+		channelConsumed(sizeof("hello") - 1, false);
+		EVENTUALLY(5,
+			LOCK();
+			result = log ==
+				"Data: hello\n"
+				"Data: world!the end\n";
+		);
+		EVENTUALLY(5,
+			result = getContextMemorySpill() == 0;
+		);
+	}
+
+
+	/***** Benchmarks *****/
+
+	static Channel::Result test_55_callback(Channel *_channel, const mbuf &buffer,
+		int errcode)
+	{
+		FileBufferedChannel *channel = reinterpret_cast<FileBufferedChannel *>(_channel);
+		ServerKit_FileBufferedChannelTest *self = (ServerKit_FileBufferedChannelTest *)
+			channel->getHooks();
+		boost::mutex &syncher = self->syncher;
+
+		{
+			LOCK();
+			for (size_t i = 0; i < buffer.size(); i++) {
+				if ((unsigned char) buffer.start[i] != (self->bytesConsumed + i) % 251) {
+					self->corrupted = true;
+				}
+			}
+			self->bytesConsumed += buffer.size();
+		}
+		// Slow consumer: only acknowledge the data in the next event
+		// loop iteration.
+		self->channelConsumed(buffer.size(), false);
+		return Channel::Result(-1, false);
+	}
+
+	static void test_55_feed(ServerKit_FileBufferedChannelTest *self, size_t total) {
+		size_t offset = 0;
+
+		while (offset < total) {
+			mbuf buffer(mbuf_get(&self->context.mbuf_pool));
+			size_t size = std::min<size_t>(buffer.size(), total - offset);
+			for (size_t i = 0; i < size; i++) {
+				buffer.start[i] = (char) ((offset + i) % 251);
+			}
+			self->channel.feed(mbuf(buffer, 0, size));
+			offset += size;
+		}
+	}
+
+	static unsigned long long test_55_run(ServerKit_FileBufferedChannelTest *self,
+		unsigned int memorySpillLimit, size_t total)
+	{
+		boost::mutex &syncher = self->syncher;
+		Json::Value config;
+		vector<ConfigKit::Error> errors;
+		config["file_buffered_channel_memory_spill_limit"] = memorySpillLimit;
+		ensure(self->contextConfigure(config, errors));
+		{
+			LOCK();
+			self->bytesConsumed = 0;
+		}
+
+		MonotonicTimeUsec startTime = SystemTime::getMonotonicUsec();
+		self->bg.safe->runSync(boost::bind(test_55_feed, self, total));
+		EVENTUALLY(60,
+			LOCK();
+			result = self->bytesConsumed == total;
+		);
+		EVENTUALLY(5,
+			result = self->getChannelMode() == FileBufferedChannel::IN_MEMORY_MODE;
+		);
+		return SystemTime::getMonotonicUsec() - startTime;
+	}
+
+	TEST_METHOD(55) {
+		set_test_name("Benchmark: throughput with a slow consumer, memory spill "
+			"area versus temp file");
+
+		const size_t total = 8 * 1024 * 1024;
+		channel.setDataCallback(test_55_callback);
+		startLoop();
+
+		unsigned long long fileTime = test_55_run(this, 0, total);
+		unsigned long long memoryTime = test_55_run(this, 64 * 1024 * 1024, total);
+		{
+			LOCK();
+			ensure("Data arrives intact and in order", !corrupted);
+		}
+		ensure_equals(getContextMemorySpill(), 0u);
+
+		P_INFO("FileBufferedChannel slow consumer benchmark (" << total / 1024 << " KB): "
+			<< "temp file " << (total / 1024.0 / 1024.0) / (fileTime / 1000000.0) << " MB/s, "
+			<< "memory spill area " << (total / 1024.0 / 1024.0) / (memoryTime / 1000000.0)
+			<< " MB/s");
+	}
 }
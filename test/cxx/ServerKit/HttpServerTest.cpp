@@ -12,6 +12,8 @@
 #include <Utils.h>
 #include <Utils/IOUtils.h>
 #include <Utils/BufferedIO.h>
+#include <Utils/StrIntUtils.h>
+#include <Utils/SystemTime.h>
 
 using namespace Passenger;
 using namespace Passenger::ServerKit;
@@ -143,6 +145,19 @@ namespace tut {
 			// Continues in onRequestEarlyHalfClose()
 		}
 
+		void testSecureHeadersBlock(MyClient *client, MyRequest *req) {
+			const LString *block = psg_lstr_make_contiguous(&req->secureHeadersBlock,
+				req->pool);
+			string body = "Block: ";
+			if (block->size > 0) {
+				body.append(block->start->data, block->size);
+			}
+			writeSimpleResponse(client, 200, NULL, body);
+			if (!req->ended()) {
+				endRequest(&client, &req);
+			}
+		}
+
 		void testEarlyReadErrorDetection(MyClient *client, MyRequest *req) {
 			req->nextRequestEarlyReadError = ENOSPC;
 			writeSimpleResponse(client, 200, NULL, "OK");
@@ -174,6 +189,8 @@ namespace tut {
 				testHalfClose(client, req);
 			} else if (psg_lstr_cmp(&req->path, "/early_read_error_detection_test")) {
 				testEarlyReadErrorDetection(client, req);
+			} else if (psg_lstr_cmp(&req->path, "/secure_headers_block_test")) {
+				testSecureHeadersBlock(client, req);
 			} else {
 				testRequest(client, req);
 			}
@@ -326,6 +343,13 @@ namespace tut {
 			server.reset();
 		}
 
+		void configureServer(const Json::Value &updates) {
+			vector<ConfigKit::Error> errors;
+			MyServer::ConfigChangeRequest req;
+			ensure(server->prepareConfigChange(updates, errors, req));
+			server->commitConfigChange(req);
+		}
+
 		FileDescriptor &connectToServer() {
 			startLoop();
 			fd = FileDescriptor(connectToUnixServer("tmp.server", __FILE__, __LINE__), NULL, 0);
@@ -487,9 +511,19 @@ namespace tut {
 			} while (true);
 			return result;
 		}
+
+		string readResponse() {
+			string header = readResponseHeader();
+			string::size_type pos = header.find("Content-Length: ");
+			ensure("Response has a Content-Length header", pos != string::npos);
+			unsigned int size = stringToUint(header.substr(pos + sizeof("Content-Length: ") - 1));
+			string body(size, '\0');
+			ensure_equals(io.read(&body[0], size), size);
+			return header + body;
+		}
 	};
 
-	DEFINE_TEST_GROUP_WITH_LIMIT(ServerKit_HttpServerTest, 100);
+	DEFINE_TEST_GROUP_WITH_LIMIT(ServerKit_HttpServerTest, 110);
 
 
 	/***** Valid HTTP header parsing *****/
@@ -1287,6 +1321,102 @@ namespace tut {
 		ensure("(1)", containsSubstring(response, "HTTP/1.1 200 OK\r\n"));
 	}
 
+	TEST_METHOD(56) {
+		set_test_name("Secure headers do not carry over to the next request "
+			"on a keep-alive connection");
+
+		connectToServer();
+		sendRequest(
+			"GET /joo HTTP/1.1\r\n"
+			"Host: foo\r\n"
+			"!~: x\r\n"
+			"!~Secure: secret\r\n"
+			"\r\n");
+		string response = readResponse();
+		ensure("(1)", containsSubstring(response, "Secure: secret"));
+
+		sendRequest(
+			"GET /joo HTTP/1.1\r\n"
+			"Host: foo\r\n"
+			"!~: x\r\n"
+			"\r\n");
+		response = readResponse();
+		ensure("(2)", containsSubstring(response, "hello /joo"));
+		ensure("(3)", !containsSubstring(response, "Secure: secret"));
+	}
+
+	TEST_METHOD(57) {
+		set_test_name("The security password of a previous request on a keep-alive "
+			"connection does not allow secure headers in the next request");
+
+		Json::Value config;
+		vector<ConfigKit::Error> errors;
+		config["secure_mode_password"] = "secret";
+		ensure(context.configure(config, errors));
+
+		connectToServer();
+		sendRequest(
+			"GET / HTTP/1.1\r\n"
+			"Host: foo\r\n"
+			"!~: secret\r\n"
+			"!~Secure: foo\r\n"
+			"\r\n");
+		string response = readResponse();
+		ensure("(1)", containsSubstring(response, "HTTP/1.1 200 OK\r\n"));
+		ensure("(2)", containsSubstring(response, "Secure: foo"));
+
+		sendRequest(
+			"GET / HTTP/1.1\r\n"
+			"Connection: close\r\n"
+			"Host: foo\r\n"
+			"!~Secure: injected\r\n"
+			"\r\n");
+		response = io.readAll();
+		ensure("(3)", containsSubstring(response, "HTTP/1.0 400 Bad Request\r\n"));
+		ensure("(4)", containsSubstring(response,
+			"A secure header was provided, but no security password was provided"));
+	}
+
+
+	TEST_METHOD(58) {
+		set_test_name("It stores a binary secure headers block that precedes "
+			"the request in req->secureHeadersBlock");
+
+		connectToServer();
+		// Send the block prefix in pieces to test incremental parsing.
+		sendRequestAndWait(StaticString("\0\0\0", 3));
+		sendRequestAndWait(StaticString("\0\x05he", 4));
+		sendRequest(
+			"llo"
+			"GET /secure_headers_block_test HTTP/1.1\r\n"
+			"Host: foo\r\n"
+			"\r\n");
+		string response = readResponse();
+		ensure("(1)", containsSubstring(response, "HTTP/1.1 200 OK\r\n"));
+		ensure("(2)", containsSubstring(response, "\r\n\r\nBlock: hello"));
+
+		sendRequest(
+			"GET /secure_headers_block_test HTTP/1.1\r\n"
+			"Connection: close\r\n"
+			"Host: foo\r\n"
+			"\r\n");
+		response = io.readAll();
+		ensure("(3)", containsSubstring(response, "HTTP/1.1 200 OK\r\n"));
+		ensure("(4)", containsSubstring(response, "\r\n\r\nBlock: "));
+		ensure("(5)", !containsSubstring(response, "hello"));
+	}
+
+	TEST_METHOD(59) {
+		set_test_name("It rejects secure headers blocks that are too large");
+
+		connectToServer();
+		sendRequest(StaticString("\0\x7f\xff\xff\xff", 5));
+		string response = io.readAll();
+		ensure("(1)", containsSubstring(response, "HTTP/1.0 400 Bad Request\r\n"));
+		ensure("(2)", containsSubstring(response,
+			"The secure headers block is too large"));
+	}
+
 
 	/***** Request ending *****/
 
@@ -1744,4 +1874,107 @@ namespace tut {
 			result = getActiveClientCount() == 0;
 		);
 	}
+
+	TEST_METHOD(98) {
+		set_test_name("Idle keep-alive connections are closed after client_keepalive_timeout");
+
+		Json::Value config;
+		config["client_keepalive_timeout"] = 1;
+		configureServer(config);
+
+		connectToServer();
+		sendRequest(
+			"GET / HTTP/1.1\r\n"
+			"Host: foo\r\n\r\n");
+		string header = readResponseHeader();
+		ensure(containsSubstring(header, "Connection: keep-alive"));
+		EVENTUALLY(5,
+			result = getActiveClientCount() == 0;
+		);
+	}
+
+	TEST_METHOD(99) {
+		set_test_name("Clients that don't finish sending headers within client_header_timeout get a 408");
+
+		Json::Value config;
+		config["client_header_timeout"] = 1;
+		configureServer(config);
+
+		connectToServer();
+		sendRequest(
+			"GET / HTTP/1.1\r\n"
+			"Host: fo");
+		string response = readAll(fd);
+		ensure(containsSubstring(response, " 408 Request Timeout\r\n"));
+		ensure(containsSubstring(response, "Connection: close\r\n"));
+	}
+
+	TEST_METHOD(100) {
+		set_test_name("Clients that stop sending the body for client_body_timeout get a body error");
+
+		Json::Value config;
+		config["client_body_timeout"] = 1;
+		configureServer(config);
+
+		connectToServer();
+		sendRequestAndWait(
+			"GET /body_test HTTP/1.1\r\n"
+			"Content-Length: 7\r\n\r\n"
+			"hm");
+		string response = readAll(fd);
+		ensure("(1)", containsSubstring(response, "HTTP/1.1 422 Unprocessable Entity\r\n"));
+		ensure("(2)", containsSubstring(response, string("Request body error: ")
+			+ getErrorDesc(ETIMEDOUT) + "\n2 bytes: hm"));
+		ensure("(3)", containsSubstring(response, "Connection: close\r\n"));
+	}
+
+
+	/***** Benchmarks *****/
+
+	TEST_METHOD(101) {
+		set_test_name("Benchmark: throughput of requests with secure headers, "
+			"a new connection per request versus a keep-alive connection");
+
+		const unsigned int count = 2000;
+		Json::Value config;
+		vector<ConfigKit::Error> errors;
+		config["secure_mode_password"] = "secret";
+		ensure(context.configure(config, errors));
+
+		MonotonicTimeUsec startTime = SystemTime::getMonotonicUsec();
+		for (unsigned int i = 0; i < count; i++) {
+			connectToServer();
+			sendRequest(
+				"GET / HTTP/1.1\r\n"
+				"Connection: close\r\n"
+				"Host: foo\r\n"
+				"!~: secret\r\n"
+				"!~Secure: foo\r\n"
+				"!~FLAGS: DC\r\n"
+				"\r\n");
+			string response = io.readAll();
+			ensure(containsSubstring(response, "Secure: foo"));
+		}
+		MonotonicTimeUsec closeTime = SystemTime::getMonotonicUsec() - startTime;
+
+		startTime = SystemTime::getMonotonicUsec();
+		connectToServer();
+		for (unsigned int i = 0; i < count; i++) {
+			sendRequest(
+				"GET / HTTP/1.1\r\n"
+				"Host: foo\r\n"
+				"!~: secret\r\n"
+				"!~Secure: foo\r\n"
+				"!~FLAGS: DC\r\n"
+				"\r\n");
+			string response = readResponse();
+			ensure(containsSubstring(response, "Secure: foo"));
+		}
+		MonotonicTimeUsec keepAliveTime = SystemTime::getMonotonicUsec() - startTime;
+
+		ensure_equals(getTotalRequestsBegun(), 2ul * count);
+		P_INFO("HttpServer secure headers benchmark (" << count << " requests): "
+			<< "new connection per request " << count / (closeTime / 1000000.0) << " req/s, "
+			<< "keep-alive connection " << count / (keepAliveTime / 1000000.0) << " req/s");
+	}
 }
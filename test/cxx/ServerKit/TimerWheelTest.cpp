@@ -0,0 +1,179 @@
+#include <TestSupport.h>
+#include <BackgroundEventLoop.h>
+#include <SafeLibev.h>
+#include <ServerKit/TimerWheel.h>
+#include <vector>
+#include <cstdlib>
+#include <Utils/StrIntUtils.h>
+
+using namespace Passenger;
+using namespace Passenger::ServerKit;
+using namespace std;
+
+namespace tut {
+	struct TestTimer {
+		TimerWheelEntry entry;
+		unsigned int fired;
+		ev_tstamp firedAt;
+		TestTimer *toDisarm;
+
+		TestTimer()
+			: fired(0),
+			  firedAt(0),
+			  toDisarm(NULL)
+			{ }
+	};
+
+	static ev_tstamp currentTime;
+	static TimerWheel *currentWheel;
+
+	static void timerCallback(TimerWheelEntry *entry) {
+		TestTimer *timer = static_cast<TestTimer *>(entry->userData);
+		timer->fired++;
+		timer->firedAt = currentTime;
+		if (timer->toDisarm != NULL) {
+			currentWheel->disarm(&timer->toDisarm->entry);
+		}
+	}
+
+	struct ServerKit_TimerWheelTest {
+		BackgroundEventLoop bg;
+		TimerWheel wheel;
+		ev_tstamp base;
+
+		ServerKit_TimerWheelTest()
+			: bg(false, false)
+		{
+			// The event loop is never started, so ev_now() stays the same
+			// and we simulate the passage of time by calling advance().
+			wheel.initialize(bg.safe->getLoop());
+			base = ev_now(bg.safe->getLoop());
+			currentTime = base;
+			currentWheel = &wheel;
+		}
+
+		void init(TestTimer &timer) {
+			timer.entry.callback = timerCallback;
+			timer.entry.userData = &timer;
+		}
+
+		void advanceTo(ev_tstamp offset) {
+			currentTime = base + offset;
+			wheel.advance(currentTime);
+		}
+	};
+
+	DEFINE_TEST_GROUP(ServerKit_TimerWheelTest);
+
+	TEST_METHOD(1) {
+		set_test_name("An armed entry fires once its timeout has passed, and not earlier");
+		TestTimer timer;
+		init(timer);
+
+		wheel.arm(&timer.entry, 5);
+		ensure(timer.entry.isArmed());
+		ensure_equals(wheel.size(), 1u);
+		advanceTo(4);
+		ensure_equals(timer.fired, 0u);
+		advanceTo(5);
+		ensure_equals(timer.fired, 1u);
+		ensure(!timer.entry.isArmed());
+		ensure_equals(wheel.size(), 0u);
+		advanceTo(100);
+		ensure_equals(timer.fired, 1u);
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("A disarmed entry does not fire");
+		TestTimer timer;
+		init(timer);
+
+		wheel.arm(&timer.entry, 5);
+		wheel.disarm(&timer.entry);
+		ensure(!timer.entry.isArmed());
+		ensure_equals(wheel.size(), 0u);
+		advanceTo(10);
+		ensure_equals(timer.fired, 0u);
+	}
+
+	TEST_METHOD(3) {
+		set_test_name("Re-arming an armed entry reschedules it");
+		TestTimer timer;
+		init(timer);
+
+		wheel.arm(&timer.entry, 5);
+		wheel.arm(&timer.entry, 20);
+		ensure_equals(wheel.size(), 1u);
+		advanceTo(19);
+		ensure_equals(timer.fired, 0u);
+		advanceTo(20);
+		ensure_equals(timer.fired, 1u);
+	}
+
+	TEST_METHOD(4) {
+		set_test_name("Long timeouts are cascaded down and fire at the right time");
+		const ev_tstamp timeouts[] = { 63, 64, 65, 4095, 4096, 4097, 300000 };
+		const unsigned int count = sizeof(timeouts) / sizeof(ev_tstamp);
+		TestTimer timers[count];
+
+		for (unsigned int i = 0; i < count; i++) {
+			init(timers[i]);
+			wheel.arm(&timers[i].entry, timeouts[i]);
+		}
+		for (unsigned int i = 0; i < count; i++) {
+			advanceTo(timeouts[i] - 1);
+			ensure_equals(("Timer " + toString(i) + " has not fired yet").c_str(),
+				timers[i].fired, 0u);
+			advanceTo(timeouts[i]);
+			ensure_equals(("Timer " + toString(i) + " fired").c_str(), timers[i].fired, 1u);
+		}
+		ensure_equals(wheel.size(), 0u);
+	}
+
+	TEST_METHOD(5) {
+		set_test_name("Many entries with random timeouts all fire at their own time");
+		const unsigned int count = 1000;
+		vector<TestTimer> timers(count);
+		vector<unsigned int> timeouts(count);
+
+		srand(1234);
+		for (unsigned int i = 0; i < count; i++) {
+			init(timers[i]);
+			timeouts[i] = 1 + rand() % 10000;
+			wheel.arm(&timers[i].entry, timeouts[i]);
+		}
+		for (unsigned int t = 1; t <= 10000; t++) {
+			advanceTo(t);
+		}
+		for (unsigned int i = 0; i < count; i++) {
+			ensure_equals(("Timer " + toString(i) + " fired once").c_str(), timers[i].fired, 1u);
+			ensure_equals(("Timer " + toString(i) + " fired on time").c_str(),
+				timers[i].firedAt, base + timeouts[i]);
+		}
+	}
+
+	TEST_METHOD(6) {
+		set_test_name("A callback may disarm another entry that expires at the same time");
+		TestTimer timer1, timer2;
+		init(timer1);
+		init(timer2);
+		timer1.toDisarm = &timer2;
+		timer2.toDisarm = &timer1;
+
+		wheel.arm(&timer1.entry, 3);
+		wheel.arm(&timer2.entry, 3);
+		advanceTo(3);
+		ensure_equals(timer1.fired + timer2.fired, 1u);
+		ensure_equals(wheel.size(), 0u);
+	}
+
+	TEST_METHOD(7) {
+		set_test_name("Timeouts beyond the wheel's range are clamped");
+		TestTimer timer;
+		init(timer);
+
+		wheel.arm(&timer.entry, TimerWheel::MAX_TICKS * 2.0);
+		ensure(wheel.getRemainingTime(&timer.entry) <= TimerWheel::MAX_TICKS);
+		ensure(wheel.getRemainingTime(&timer.entry) > TimerWheel::MAX_TICKS - 2);
+	}
+}
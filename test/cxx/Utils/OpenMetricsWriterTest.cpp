@@ -0,0 +1,55 @@
+#include <TestSupport.h>
+#include <Utils/OpenMetricsWriter.h>
+
+using namespace Passenger;
+using namespace std;
+
+namespace tut {
+	struct Utils_OpenMetricsWriterTest {
+		OpenMetricsWriter writer;
+	};
+
+	DEFINE_TEST_GROUP(Utils_OpenMetricsWriterTest);
+
+	TEST_METHOD(1) {
+		set_test_name("It writes metric families, escapes label values,"
+			" and terminates the exposition");
+		writer.declare("foo_requests", "counter", "Number of requests.");
+		writer.sample("foo_requests_total", "", 3u);
+		writer.sample("foo_requests_total",
+			OpenMetricsWriter::labels("group", "a\"b\\c\nd", "pid", "12"), 4u);
+		writer.declare("foo_load", "gauge", "Load.");
+		writer.sample("foo_load", OpenMetricsWriter::label("group", "x"), 0.5);
+		ensure_equals(writer.finish(),
+			"# TYPE foo_requests counter\n"
+			"# HELP foo_requests Number of requests.\n"
+			"foo_requests_total 3\n"
+			"foo_requests_total{group=\"a\\\"b\\\\c\\nd\",pid=\"12\"} 4\n"
+			"# TYPE foo_load gauge\n"
+			"# HELP foo_load Load.\n"
+			"foo_load{group=\"x\"} 0.5\n"
+			"# EOF\n");
+	}
+
+	TEST_METHOD(2) {
+		set_test_name("It writes histograms with cumulative buckets");
+		static const boost::uint64_t buckets[] = { 1000000, 5000000 };
+		Histogram histogram;
+		histogram.record(500000);
+		histogram.record(2000000);
+		histogram.record(10000000);
+
+		writer.declare("foo_duration_seconds", "histogram", "Durations.");
+		writer.histogram("foo_duration_seconds", OpenMetricsWriter::label("group", "x"),
+			histogram, buckets, 2, 1000000);
+		ensure_equals(writer.finish(),
+			"# TYPE foo_duration_seconds histogram\n"
+			"# HELP foo_duration_seconds Durations.\n"
+			"foo_duration_seconds_bucket{group=\"x\",le=\"1\"} 1\n"
+			"foo_duration_seconds_bucket{group=\"x\",le=\"5\"} 2\n"
+			"foo_duration_seconds_bucket{group=\"x\",le=\"+Inf\"} 3\n"
+			"foo_duration_seconds_count{group=\"x\"} 3\n"
+			"foo_duration_seconds_sum{group=\"x\"} 12.5\n"
+			"# EOF\n");
+	}
+}
@@ -41,5 +41,22 @@ namespace tut {
 		snprintf(s, 10, "h\xeallo"); // hêllo
 		string result = escapeHTML(s);
 		ensure_equals(result, "h?llo");
+	} TEST_METHOD(5) {
+		set_test_name("memeqFast compares both vectorized and trailing bytes");
+		const char *a = "0123456789abcdef0123456789ABCDEF!";
+		const char *b = "0123456789abcdef0123456789ABCDEF?";
+		ensure(memeqFast(a, b, 0));
+		ensure(memeqFast(a, b, 15));
+		ensure(memeqFast(a, b, 32));
+		ensure(!memeqFast(a, b, 33));
+		ensure(!memeqFast(a, "0123456789abcdeF", 16));
+	} TEST_METHOD(6) {
+		set_test_name("memcaseeqFast ignores the case of ASCII letters only");
+		ensure(memcaseeqFast("Content-Type: text/html; charset", "content-type: TEXT/HTML; CHARSET", 32));
+		ensure(memcaseeqFast("Host", "hOST", 4));
+		ensure(!memcaseeqFast("0123456789abcdef@", "0123456789abcdef`", 17));
+		ensure(!memcaseeqFast("0123456789abcdef[", "0123456789abcdef{", 17));
+		ensure(!memcaseeqFast("@123456789abcdefg", "`123456789abcdefg", 17));
+		ensure(!memcaseeqFast("\xc0" "123456789abcdefg", "\xe0" "123456789abcdefg", 17));
 	}
 }